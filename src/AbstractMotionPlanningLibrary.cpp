@@ -6,7 +6,10 @@ namespace motion_planning_libraries
 // PUBLIC
 AbstractMotionPlanningLibrary::AbstractMotionPlanningLibrary(Config config) : 
         mConfig(config),
-        mPathCost(nan(""))
+        mPathCost(nan("")),
+        mpTravClassTable(),
+        mpTravGrid(NULL),
+        mpTravData()
 {
 }
 
@@ -24,6 +27,11 @@ bool AbstractMotionPlanningLibrary::partialMapUpdate(std::vector<CellUpdate>& ce
     return false;
 }
         
+bool AbstractMotionPlanningLibrary::shiftMap(int shift_x, int shift_y, 
+        std::vector<CellUpdate>& cell_updates) {
+    return false;
+}
+
 bool AbstractMotionPlanningLibrary::initialize_arm() {
     LOG_WARN("Abstract arm initialization is used");
     return false;
@@ -10,6 +10,9 @@
 
 #include "Config.hpp"
 #include "State.hpp"
+#include "PlanningStatistics.hpp"
+#include "TravClassTable.hpp"
+#include "ArmCollisionChecker.hpp"
 
 namespace motion_planning_libraries
 {
@@ -31,6 +34,24 @@ struct CellUpdate {
     }
 };
 
+/**
+ * Describes a horizontal run of changed cells [mXBegin, mXEnd) within row mY.
+ * Collected in addition to the cell updates to allow cheap region based
+ * tests (e.g. whether a path is affected by a map update).
+ */
+struct CellUpdateSpan {
+    size_t mY;
+    size_t mXBegin;
+    size_t mXEnd;
+    
+    CellUpdateSpan() : mY(0), mXBegin(0), mXEnd(0) {
+    }
+    
+    CellUpdateSpan(size_t y, size_t x_begin, size_t x_end) : 
+            mY(y), mXBegin(x_begin), mXEnd(x_end) {
+    }
+};
+
 /**
  * Base class for a motion planning library.
  */
@@ -39,10 +60,35 @@ class AbstractMotionPlanningLibrary
  protected: 
     Config mConfig;
     double mPathCost;
+    // Class to cost lookup table of the current map, shared by all planning libraries.
+    boost::shared_ptr<TravClassTable> mpTravClassTable;
+    // Current map, required by partial map updates which have to rebind to the new data.
+    envire::TraversabilityGrid* mpTravGrid;
+    boost::shared_ptr<TravData> mpTravData;
         
  public: 
     AbstractMotionPlanningLibrary(Config config = Config());
     virtual ~AbstractMotionPlanningLibrary();
+    
+    /**
+     * Sets the class to cost lookup table of the current map. Called by 
+     * MotionPlanningLibraries before each initialize() or partialMapUpdate().
+     * The table must not be modified by the planning library.
+     */
+    inline void setTravClassTable(boost::shared_ptr<TravClassTable> trav_class_table) {
+        mpTravClassTable = trav_class_table;
+    }
+    
+    /**
+     * Sets the current map. Called by MotionPlanningLibraries before each 
+     * initialize() or partialMapUpdate(). The passed data is only valid
+     * until the next map has been received.
+     */
+    inline void setTravGrid(envire::TraversabilityGrid* trav_grid, 
+            boost::shared_ptr<TravData> grid_data) {
+        mpTravGrid = trav_grid;
+        mpTravData = grid_data;
+    }
                 
     /**
      * Implement for robot navigation: 
@@ -63,11 +109,32 @@ class AbstractMotionPlanningLibrary
      */
     virtual bool partialMapUpdate(std::vector<CellUpdate>& cell_updates);
     
+    /**
+     * Called instead of partialMapUpdate() if the new map is a pure translation 
+     * of the previous one (Config::mShiftScrollingMap): The new cell (x, y) 
+     * covers the previous cell (x + shift_x, y + shift_y). The internal map 
+     * has to be shifted accordingly, \a cell_updates contains the newly exposed cells
+     * and the changed cells within the overlap. mpTravData already contains the new map,
+     * start and goal are set again afterwards.
+     * \return By default false is returned, the map is applied by 
+     * partialMapUpdate() or initialize() then.
+     */
+    virtual bool shiftMap(int shift_x, int shift_y, std::vector<CellUpdate>& cell_updates);
+    
     /**
      * Implement for arm motion planning.
      */
     virtual bool initialize_arm();
     
+    /**
+     * Can be implemented for arm motion planning to check the states with 
+     * the passed collision backend.
+     * \return By default false is returned.
+     */
+    virtual bool setArmCollisionChecker(boost::shared_ptr<ArmCollisionChecker const> checker) {
+        return false;
+    }
+    
     /**
      * Sets the start and the goal within the planning environment.
      * This method is only called if a new pose has been received 
@@ -75,6 +142,25 @@ class AbstractMotionPlanningLibrary
      */
     virtual bool setStartGoal(struct State start_state, struct State goal_state) = 0;
     
+    /**
+     * Can be implemented to plan to the cheapest one of several goals within 
+     * a single search (MotionPlanningLibraries::planToGoals()). The goals are 
+     * kept until setStartGoal() is called again, getReachedGoal() returns the goal 
+     * of the last solution.
+     * \return By default false is returned, the goals are planned one by one then.
+     */
+    virtual bool setStartGoals(struct State start_state, std::vector<struct State> const& goal_states) {
+        return false;
+    }
+    
+    /**
+     * Index of the goal of setStartGoals() which is reached by the last solution,
+     * -1 if unknown.
+     */
+    virtual int getReachedGoal() {
+        return -1;
+    }
+    
     /**
      * Tries to find a solution (if the environment has just been initialized) 
      * or to improve the existing solution.
@@ -103,6 +189,15 @@ class AbstractMotionPlanningLibrary
         return mPathCost;
     }
     
+    /**
+     * Can be implemented by anytime planners to return the suboptimality 
+     * bound of the current solution (1.0 means optimal). 
+     * By default nan is returned.
+     */
+    virtual double getEpsilon() {
+        return nan("");
+    }
+    
     /**
      * Can be implemented to check whether the start and/or goal state
      * are not valid. In this case MPL_ERR_START_ON_OBSTACLE,
@@ -122,6 +217,14 @@ class AbstractMotionPlanningLibrary
     virtual bool foundFinalSolution() {
         return true;
     }
+    
+    /**
+     * Can be implemented to add the library specific values (primitive 
+     * generation time, counters of the last solve()) to the passed statistics.
+     * By default nothing is added.
+     */
+    virtual void fillStatistics(struct PlanningStatistics& statistics) {
+    }
 };
 
 } // end namespace motion_planning_libraries
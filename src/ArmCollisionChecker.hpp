@@ -0,0 +1,36 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_ARM_COLLISION_CHECKER_HPP_
+#define _MOTION_PLANNING_LIBRARIES_ARM_COLLISION_CHECKER_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Collision backend of the arm planning (ENV_ARM), e.g. a robot model checked
+ * against an octomap using FCL. Has to be implemented by the user and passed
+ * to MotionPlanningLibraries::setArmCollisionChecker().
+ */
+class ArmCollisionChecker {
+ public:
+    virtual ~ArmCollisionChecker() {}
+
+    /**
+     * Returns true if the arm does not collide with itself or the environment.
+     * Has to be re-entrant if Config::mNumParallelPlanners is greater than one.
+     */
+    virtual bool isCollisionFree(std::vector<double> const& joint_angles) const = 0;
+
+    /**
+     * Has to be changed by the implementation whenever the environment
+     * changes, the cached results of the previous revision are dropped then.
+     */
+    virtual uint64_t getEnvironmentRevision() const {
+        return 0;
+    }
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_ARM_COLLISION_CHECKER_HPP_
@@ -0,0 +1,631 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <motion_planning_libraries/MotionPlanningLibraries.hpp>
+#include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/PlanningProblem.hpp>
+
+#include <envire/core/Environment.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+
+/**
+ * Benchmarks all combinations of planning library, environment and planner
+ * on a reproducible set of traversability maps (open field, clutter, narrow
+ * passages in several sizes), on a serialized Envire environment or on
+ * logged planning problems (see PlanningProblem). A problem is replayed with
+ * its own map, start, goal and configuration, so it results in a single run;
+ * these runs are listed in the order of the --problem options.
+ * Each run is executed within its own process, so the peak memory (maxrss)
+ * belongs to a single run and a crashing planner does not stop the benchmark.
+ * The results are written as CSV (default) or JSON.
+ *
+ * motion_planning_libraries_bench [--time <sec>] [--step <sec>] [--sizes <n,n,..>]
+ *     [--seed <n>] [--json] [--output <file>] [--env <path> --map-id <id>]
+ *     [--problem <file>]...
+ */
+
+using namespace motion_planning_libraries;
+
+namespace {
+
+static const double CELL_SIZE = 0.1;
+static const double START_GOAL_MARGIN = 1.0;
+static const unsigned char CLASS_UNKNOWN = 0;
+static const unsigned char CLASS_OBSTACLE = 1;
+static const unsigned char CLASS_FREE = 2;
+
+enum MapType {
+    MAP_OPEN,
+    MAP_CLUTTER,
+    MAP_NARROW,
+    MAP_LOADED,
+    MAP_PROBLEM
+};
+
+const char* MapTypeString[] = {"open", "clutter", "narrow", "loaded", "problem"};
+const char* LibString[] = {"sbpl", "ompl"};
+const char* EnvString[] = {"xy", "xytheta", "arm", "sherpa"};
+const char* PlannerString[] = {"undefined", "ad*", "ana*", "ara*"};
+
+struct BenchOptions {
+    double mMaxTime;
+    double mStepTime;
+    std::vector<int> mSizes;
+    unsigned int mSeed;
+    bool mJson;
+    std::string mOutput;
+    std::string mEnvPath;
+    std::string mMapId;
+    std::vector<std::string> mProblemPaths;
+
+    BenchOptions() : mMaxTime(10.0),
+            mStepTime(0.5),
+            mSizes(),
+            mSeed(42),
+            mJson(false),
+            mOutput(),
+            mEnvPath(),
+            mMapId(),
+            mProblemPaths() {
+        mSizes.push_back(100);
+        mSizes.push_back(200);
+        mSizes.push_back(400);
+    }
+};
+
+/**
+ * Result of a single run, is passed from the child process through a pipe
+ * so it has to be a POD.
+ */
+struct RunResult {
+    bool mSolved;
+    int mError;
+    double mTimeToFirstSolution; // sec, nan if no solution has been found
+    double mTimeToEpsilonOne; // sec, nan if epsilon 1.0 has not been reached
+    double mCost;
+    double mEpsilon;
+    double mPathLength; // m
+    unsigned int mNumSolutions;
+    long mPeakMemoryKB;
+};
+
+struct Run {
+    enum MapType mMapType;
+    int mSize;
+    int mProblem; // Index within BenchOptions::mProblemPaths, -1 otherwise.
+    enum PlanningLibraryType mLib;
+    enum EnvType mEnv;
+    enum Planners mPlanner;
+    bool mSupported;
+    struct RunResult mResult;
+};
+
+/**
+ * Linear congruential generator, std::rand() is not guaranteed to create
+ * the same maps on all platforms.
+ */
+class Random {
+ public:
+    Random(unsigned int seed) : mState(seed) {
+    }
+
+    unsigned int next() {
+        mState = mState * 1103515245u + 12345u;
+        return (mState >> 16) & 0x7fff;
+    }
+
+    int range(int min, int max) {
+        return min + (int)(next() % (unsigned int)(max - min + 1));
+    }
+
+ private:
+    unsigned int mState;
+};
+
+Config createConfig(enum PlanningLibraryType lib, enum EnvType env, enum Planners planner) {
+    Config conf;
+    conf.mPlanningLibType = lib;
+    conf.mEnvType = env;
+    conf.mPlanner = planner;
+    conf.mSearchUntilFirstSolution = false;
+    conf.mMaxAllowedSampleDist = 1.0;
+    conf.mEscapeTrajRadiusFactor = 1.4;
+    conf.mMobility.mSpeed = 0.8;
+    conf.mMobility.mTurningSpeed = 0.5;
+    conf.mMobility.mMultiplierForward = 1;
+    conf.mMobility.mMultiplierBackward = 2;
+    conf.mMobility.mMultiplierBackwardTurn = 4;
+    conf.mMobility.mMultiplierLateral = 0;
+    conf.mMobility.mMultiplierForwardTurn = 3;
+    conf.mMobility.mMultiplierPointTurn = 3;
+    conf.mMobility.mMinTurningRadius = 1.0;
+    conf.mReplanning.mReplanDuringEachUpdate = true;
+    conf.mFootprintRadiusMinMax = MinMaxValue(0.3, 0.3);
+    conf.mFootprintLengthMinMax = MinMaxValue(0.6, 0.6);
+    conf.mFootprintWidthMinMax = MinMaxValue(0.4, 0.4);
+    if(env == ENV_SHERPA) {
+        conf.mFootprintRadiusMinMax = MinMaxValue(0.3, 0.5);
+        conf.mFootprintLengthMinMax = MinMaxValue(0.0, 0.0);
+        conf.mFootprintWidthMinMax = MinMaxValue(0.0, 0.0);
+    }
+    conf.mNumFootprintClasses = 5;
+    conf.mTimeToAdaptFootprint = 10;
+    conf.mAdaptFootprintPenalty = 2;
+    conf.mSBPLForwardSearch = true;
+    conf.mNumIntermediatePoints = 4;
+    conf.mNumPrimPartition = 4;
+    conf.mPrimAccuracy = 0.15;
+    conf.mJointBorders.clear();
+    return conf;
+}
+
+/**
+ * Only these combinations are created by MotionPlanningLibraries.
+ * OMPL ignores Config::mPlanner and the arm planning does not use the
+ * traversability map, so these runs are listed as unsupported.
+ */
+bool isSupported(enum PlanningLibraryType lib, enum EnvType env, enum Planners planner) {
+    switch(lib) {
+        case LIB_SBPL:
+            return (env == ENV_XY || env == ENV_XYTHETA) && planner != UNDEFINED_PLANNER;
+        case LIB_OMPL:
+            return env != ENV_ARM && planner == UNDEFINED_PLANNER;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Fills the map with free cells and adds the obstacles of the map type.
+ * Start and goal areas (margin around the start and goal positions)
+ * are kept free.
+ */
+void generateMap(enum MapType map_type, int size, unsigned int seed, TravData& data) {
+    for(int y=0; y < size; ++y) {
+        for(int x=0; x < size; ++x) {
+            data[y][x] = CLASS_FREE;
+        }
+    }
+
+    int margin = (int)(START_GOAL_MARGIN / CELL_SIZE) * 2;
+    Random random(seed + size * 31 + map_type);
+
+    switch(map_type) {
+        case MAP_CLUTTER: {
+            // Squares with an edge length of 2 - 6 cells covering about 10 % of the map.
+            int num_squares = size * size / 160;
+            for(int i=0; i < num_squares; ++i) {
+                int edge = random.range(2, 6);
+                int x0 = random.range(0, size - edge);
+                int y0 = random.range(0, size - edge);
+                if((x0 < margin && y0 < margin) ||
+                        (x0 + edge > size - margin && y0 + edge > size - margin)) {
+                    continue;
+                }
+                for(int y=y0; y < y0 + edge; ++y) {
+                    for(int x=x0; x < x0 + edge; ++x) {
+                        data[y][x] = CLASS_OBSTACLE;
+                    }
+                }
+            }
+            break;
+        }
+        case MAP_NARROW: {
+            // Vertical walls with a single gap which is slightly wider than the robot.
+            int gap = (int)std::ceil(2 * 0.5 * 1.3 / CELL_SIZE);
+            int num_walls = 3;
+            for(int w=1; w <= num_walls; ++w) {
+                int x0 = size * w / (num_walls + 1);
+                int gap_y = random.range(gap, size - 2 * gap);
+                for(int y=0; y < size; ++y) {
+                    if(y >= gap_y && y < gap_y + gap) {
+                        continue;
+                    }
+                    for(int x=x0; x < x0 + 2 && x < size; ++x) {
+                        data[y][x] = CLASS_OBSTACLE;
+                    }
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+envire::TraversabilityGrid* createTravGrid(envire::Environment* env, int size) {
+    envire::TraversabilityGrid* trav = new envire::TraversabilityGrid(size, size,
+            CELL_SIZE, CELL_SIZE);
+    trav->setTraversabilityClass(CLASS_UNKNOWN, envire::TraversabilityClass(0.5));
+    trav->setTraversabilityClass(CLASS_OBSTACLE, envire::TraversabilityClass(0.0));
+    trav->setTraversabilityClass(CLASS_FREE, envire::TraversabilityClass(1.0));
+    trav->setUniqueId("/trav_map");
+    env->attachItem(trav);
+    envire::FrameNode* frame_node = new envire::FrameNode();
+    env->getRootNode()->addChild(frame_node);
+    trav->setFrameNode(frame_node);
+    return trav;
+}
+
+double pathLength(std::vector<struct State> const& path) {
+    double length = 0.0;
+    for(unsigned int i=1; i < path.size(); ++i) {
+        length += (path[i].mPose.position - path[i-1].mPose.position).norm();
+    }
+    return length;
+}
+
+/**
+ * Plans using the asynchronous planning to receive the time of each
+ * improved solution, inputs have to be set already.
+ */
+void planAndMeasure(MotionPlanningLibraries& mpl, BenchOptions const& options,
+        struct RunResult& result) {
+    if(mpl.planAsync(options.mMaxTime, options.mStepTime,
+            [&result](struct AnytimeSolution const& solution) {
+                if(solution.mNumber == 1) {
+                    result.mTimeToFirstSolution = solution.mPlanningTime;
+                }
+                if(solution.mEpsilon == 1.0 && std::isnan(result.mTimeToEpsilonOne)) {
+                    result.mTimeToEpsilonOne = solution.mPlanningTime;
+                }
+                result.mNumSolutions = solution.mNumber;
+            })) {
+        while(mpl.isPlanningAsync()) {
+            usleep(1000);
+        }
+        mpl.cancelAsync();
+    }
+
+    struct AnytimeSolution solution;
+    if(mpl.getLatestSolution(solution)) {
+        result.mSolved = true;
+        result.mCost = solution.mCost;
+        result.mEpsilon = solution.mEpsilon;
+        result.mPathLength = pathLength(solution.mPathInWorld);
+    } else {
+        result.mError = mpl.getError();
+    }
+
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0) {
+        result.mPeakMemoryKB = usage.ru_maxrss;
+    }
+}
+
+/**
+ * Executes a single run.
+ */
+void executeRun(Run const& run, BenchOptions const& options, struct RunResult& result) {
+    result.mSolved = false;
+    result.mError = MPL_ERR_NONE;
+    result.mTimeToFirstSolution = nan("");
+    result.mTimeToEpsilonOne = nan("");
+    result.mCost = nan("");
+    result.mEpsilon = nan("");
+    result.mPathLength = nan("");
+    result.mNumSolutions = 0;
+    result.mPeakMemoryKB = 0;
+
+    if(run.mMapType == MAP_PROBLEM) {
+        PlanningProblem problem;
+        if(!problem.load(options.mProblemPaths[run.mProblem])) {
+            result.mError = MPL_ERR_MISSING_TRAV;
+            return;
+        }
+        MotionPlanningLibraries mpl(problem.getConfig());
+        if(!mpl.setProblem(problem)) {
+            result.mError = mpl.getError();
+            return;
+        }
+        planAndMeasure(mpl, options, result);
+        return;
+    }
+
+    envire::Environment* env = NULL;
+    std::string map_id = "/trav_map";
+    if(run.mMapType == MAP_LOADED) {
+        env = envire::Environment::unserialize(options.mEnvPath);
+        map_id = options.mMapId;
+    } else {
+        env = new envire::Environment();
+        envire::TraversabilityGrid* trav = createTravGrid(env, run.mSize);
+        TravData& data = trav->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
+        generateMap(run.mMapType, run.mSize, options.mSeed, data);
+    }
+
+    envire::TraversabilityGrid* trav = env->getItem<envire::TraversabilityGrid>(map_id).get();
+    if(trav == NULL) {
+        std::cerr << "Traversability map " << map_id << " is not available" << std::endl;
+        result.mError = MPL_ERR_MISSING_TRAV;
+        delete env;
+        return;
+    }
+    double size_x = trav->getCellSizeX() * trav->getScaleX();
+    double size_y = trav->getCellSizeY() * trav->getScaleY();
+
+    base::samples::RigidBodyState rbs_start, rbs_goal;
+    rbs_start.setPose(base::Pose(base::Position(START_GOAL_MARGIN, START_GOAL_MARGIN, 0),
+            base::Orientation::Identity()));
+    rbs_goal.setPose(base::Pose(base::Position(size_x - START_GOAL_MARGIN,
+            size_y - START_GOAL_MARGIN, 0), base::Orientation::Identity()));
+
+    Config conf = createConfig(run.mLib, run.mEnv, run.mPlanner);
+    MotionPlanningLibraries mpl(conf);
+    if(!mpl.setTravGrid(env, map_id) ||
+            !mpl.setStartState(State(rbs_start)) ||
+            !mpl.setGoalState(State(rbs_goal))) {
+        result.mError = mpl.getError();
+        delete env;
+        return;
+    }
+    planAndMeasure(mpl, options, result);
+    delete env;
+}
+
+/**
+ * Forks a child for the run, the result is passed back through a pipe.
+ * \return False if the child has not returned a result (crashed).
+ */
+bool executeRunInChild(Run const& run, BenchOptions const& options, struct RunResult& result) {
+    int fds[2];
+    if(pipe(fds) != 0) {
+        perror("pipe");
+        return false;
+    }
+
+    pid_t pid = fork();
+    if(pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if(pid == 0) {
+        close(fds[0]);
+        struct RunResult child_result;
+        executeRun(run, options, child_result);
+        ssize_t written = write(fds[1], &child_result, sizeof(child_result));
+        close(fds[1]);
+        _exit(written == (ssize_t)sizeof(child_result) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t bytes_read = 0;
+    char* buffer = (char*)&result;
+    while(bytes_read < (ssize_t)sizeof(result)) {
+        ssize_t n = read(fds[0], buffer + bytes_read, sizeof(result) - bytes_read);
+        if(n <= 0) {
+            break;
+        }
+        bytes_read += n;
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return bytes_read == (ssize_t)sizeof(result);
+}
+
+std::string toString(double value) {
+    if(std::isnan(value)) {
+        return "nan";
+    }
+    std::stringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+std::string errorString(int err) {
+    if(err < 0 || err >= MPL_ERR_NUM_TYPES) {
+        return "";
+    }
+    return MplErrorsString[err];
+}
+
+void writeCsv(std::ostream& os, std::vector<Run> const& runs) {
+    os << "map,size,library,environment,planner,status,solved,time_to_first_solution,"
+            "time_to_epsilon_one,cost,epsilon,path_length,num_solutions,peak_memory_kb,error"
+            << std::endl;
+    std::vector<Run>::const_iterator it = runs.begin();
+    for(; it != runs.end(); ++it) {
+        struct RunResult const& r = it->mResult;
+        os << MapTypeString[it->mMapType] << "," << it->mSize << ","
+                << LibString[it->mLib] << "," << EnvString[it->mEnv] << ","
+                << PlannerString[it->mPlanner] << ",";
+        if(!it->mSupported) {
+            os << "unsupported,,,,,,,,,," << std::endl;
+            continue;
+        }
+        os << (r.mError < 0 ? "crashed" : "done") << ","
+                << (r.mSolved ? 1 : 0) << ","
+                << toString(r.mTimeToFirstSolution) << ","
+                << toString(r.mTimeToEpsilonOne) << ","
+                << toString(r.mCost) << ","
+                << toString(r.mEpsilon) << ","
+                << toString(r.mPathLength) << ","
+                << r.mNumSolutions << ","
+                << r.mPeakMemoryKB << ","
+                << (r.mError > 0 ? errorString(r.mError) : "") << std::endl;
+    }
+}
+
+std::string jsonNumber(double value) {
+    return std::isnan(value) ? "null" : toString(value);
+}
+
+void writeJson(std::ostream& os, std::vector<Run> const& runs) {
+    os << "[" << std::endl;
+    std::vector<Run>::const_iterator it = runs.begin();
+    for(; it != runs.end(); ++it) {
+        struct RunResult const& r = it->mResult;
+        os << "  {\"map\": \"" << MapTypeString[it->mMapType] << "\", "
+                << "\"size\": " << it->mSize << ", "
+                << "\"library\": \"" << LibString[it->mLib] << "\", "
+                << "\"environment\": \"" << EnvString[it->mEnv] << "\", "
+                << "\"planner\": \"" << PlannerString[it->mPlanner] << "\", ";
+        if(!it->mSupported) {
+            os << "\"status\": \"unsupported\"}";
+        } else {
+            os << "\"status\": \"" << (r.mError < 0 ? "crashed" : "done") << "\", "
+                    << "\"solved\": " << (r.mSolved ? "true" : "false") << ", "
+                    << "\"time_to_first_solution\": " << jsonNumber(r.mTimeToFirstSolution) << ", "
+                    << "\"time_to_epsilon_one\": " << jsonNumber(r.mTimeToEpsilonOne) << ", "
+                    << "\"cost\": " << jsonNumber(r.mCost) << ", "
+                    << "\"epsilon\": " << jsonNumber(r.mEpsilon) << ", "
+                    << "\"path_length\": " << jsonNumber(r.mPathLength) << ", "
+                    << "\"num_solutions\": " << r.mNumSolutions << ", "
+                    << "\"peak_memory_kb\": " << r.mPeakMemoryKB << ", "
+                    << "\"error\": \"" << (r.mError > 0 ? errorString(r.mError) : "") << "\"}";
+        }
+        os << (it + 1 != runs.end() ? "," : "") << std::endl;
+    }
+    os << "]" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for(int i=1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(arg == "--json") {
+            options.mJson = true;
+        } else if(arg == "--time" && has_value) {
+            options.mMaxTime = atof(argv[++i]);
+        } else if(arg == "--step" && has_value) {
+            options.mStepTime = atof(argv[++i]);
+        } else if(arg == "--seed" && has_value) {
+            options.mSeed = atoi(argv[++i]);
+        } else if(arg == "--output" && has_value) {
+            options.mOutput = argv[++i];
+        } else if(arg == "--env" && has_value) {
+            options.mEnvPath = argv[++i];
+        } else if(arg == "--map-id" && has_value) {
+            options.mMapId = argv[++i];
+        } else if(arg == "--problem" && has_value) {
+            options.mProblemPaths.push_back(argv[++i]);
+        } else if(arg == "--sizes" && has_value) {
+            options.mSizes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string size;
+            while(std::getline(ss, size, ',')) {
+                options.mSizes.push_back(atoi(size.c_str()));
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--time <sec>] [--step <sec>] "
+                    "[--sizes <n,n,..>] [--seed <n>] [--json] [--output <file>] "
+                    "[--env <path> --map-id <id>] [--problem <file>]..." << std::endl;
+            return false;
+        }
+    }
+    if(!options.mEnvPath.empty() && options.mMapId.empty()) {
+        std::cerr << "--env requires --map-id" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if(!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<Run> runs;
+    std::vector<std::pair<enum MapType, int> > maps;
+    if(!options.mProblemPaths.empty()) {
+        // Only the configuration is required here, the child maps the problem again.
+        for(unsigned int i=0; i < options.mProblemPaths.size(); ++i) {
+            PlanningProblem problem;
+            Run run;
+            memset(&run.mResult, 0, sizeof(run.mResult));
+            run.mMapType = MAP_PROBLEM;
+            run.mSize = 0;
+            run.mProblem = i;
+            run.mLib = LIB_SBPL;
+            run.mEnv = ENV_XY;
+            run.mPlanner = UNDEFINED_PLANNER;
+            run.mSupported = problem.load(options.mProblemPaths[i]);
+            if(run.mSupported) {
+                run.mSize = problem.getCellSizeX();
+                run.mLib = problem.getConfig().mPlanningLibType;
+                run.mEnv = problem.getConfig().mEnvType;
+                run.mPlanner = problem.getConfig().mPlanner;
+            } else {
+                std::cerr << options.mProblemPaths[i] << " is not a planning problem" << std::endl;
+            }
+            runs.push_back(run);
+        }
+    } else if(!options.mEnvPath.empty()) {
+        maps.push_back(std::make_pair(MAP_LOADED, 0));
+    } else {
+        for(int map_type = MAP_OPEN; map_type < MAP_LOADED; ++map_type) {
+            for(unsigned int i=0; i < options.mSizes.size(); ++i) {
+                maps.push_back(std::make_pair((enum MapType)map_type, options.mSizes[i]));
+            }
+        }
+    }
+
+    for(unsigned int m=0; m < maps.size(); ++m) {
+        for(int lib = LIB_SBPL; lib <= LIB_OMPL; ++lib) {
+            for(int env = ENV_XY; env <= ENV_SHERPA; ++env) {
+                for(int planner = UNDEFINED_PLANNER; planner <= ANYTIME_ASTAR; ++planner) {
+                    Run run;
+                    memset(&run.mResult, 0, sizeof(run.mResult));
+                    run.mMapType = maps[m].first;
+                    run.mSize = maps[m].second;
+                    run.mProblem = -1;
+                    run.mLib = (enum PlanningLibraryType)lib;
+                    run.mEnv = (enum EnvType)env;
+                    run.mPlanner = (enum Planners)planner;
+                    run.mSupported = isSupported(run.mLib, run.mEnv, run.mPlanner);
+                    runs.push_back(run);
+                }
+            }
+        }
+    }
+
+    for(unsigned int i=0; i < runs.size(); ++i) {
+        Run& run = runs[i];
+        if(!run.mSupported) {
+            continue;
+        }
+        std::cerr << "[" << i+1 << "/" << runs.size() << "] " << MapTypeString[run.mMapType]
+                << " " << run.mSize << " " << LibString[run.mLib] << " "
+                << EnvString[run.mEnv] << " " << PlannerString[run.mPlanner] << std::endl;
+        if(!executeRunInChild(run, options, run.mResult)) {
+            memset(&run.mResult, 0, sizeof(run.mResult));
+            run.mResult.mError = -1; // crashed
+        }
+    }
+
+    std::ofstream file;
+    if(!options.mOutput.empty()) {
+        file.open(options.mOutput.c_str());
+        if(!file.is_open()) {
+            std::cerr << "Output file " << options.mOutput << " could not be opened" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& os = file.is_open() ? file : std::cout;
+    if(options.mJson) {
+        writeJson(os, runs);
+    } else {
+        writeCsv(os, runs);
+    }
+    return 0;
+}
@@ -51,6 +51,13 @@ Config::Config() : mPlanningLibType(LIB_SBPL),
                    mPlanner(UNDEFINED_PLANNER),
                    mSearchUntilFirstSolution(false), // use to 'just provide ptimal trajectories'?
                    mReplanning(),
+                   mNumBatchThreads(0),
+                   mShiftScrollingMap(false),
+                   mPostProcessPath(false),
+                   mEndToEndDeadline(false),
+                   mRecordFile(),
+                   mRecordMaxSize(64 * 1024 * 1024),
+                   mRandomSeed(0),
                    mMobility(),
                    mFootprintRadiusMinMax(0,0),  
                    mFootprintLengthMinMax(0,0),
@@ -59,14 +66,26 @@ Config::Config() : mPlanningLibType(LIB_SBPL),
                    mTimeToAdaptFootprint(40.0),
                    mAdaptFootprintPenalty(20.0),
                    mMaxAllowedSampleDist(-1),
+                   mUseObstacleDistanceMap(false),
+                   mLazyCollisionChecking(false),
+                   mNumParallelPlanners(1),
+                   mUseCostToGoField(false),
+                   mOmplWarmStart(false),
                    mSBPLEnvFile(),
                    mSBPLMotionPrimitivesFile(), 
+                   mSBPLMotionPrimitivesCacheDir(),
                    mSBPLForwardSearch(true),
+                   mSBPLCoarseFactor(0),
+                   mSBPLCorridorWidth(2.0),
+                   mSBPLDeferUpdateDist(0.0),
+                   mSBPLInflateObstacles(false),
                    mNumIntermediatePoints(0),
                    mNumPrimPartition(2),
                    mPrimAccuracy(0.25),
+                   mSymmetricPrimitives(false),
                    mEscapeTrajRadiusFactor(1.0),
-                   mJointBorders()
+                   mJointBorders(),
+                   mArmValidityCacheResolution(0.0)
 {
     if(mNumPrimPartition < 1) {
         LOG_WARN("Number of sub-primitives (mNumPrimPartition) has to be at least 1 ");
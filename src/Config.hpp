@@ -158,6 +158,10 @@ struct Replanning {
     bool mReplanOnNewStartPose;
     bool mReplanOnNewGoalPose;
     bool mReplanOnNewMap;
+    // Restricts mReplanOnNewMap to maps which change at least one cell swept by
+    // the footprint along the current path. Maps which cannot be applied by 
+    // a partial update (new size, shifted map) still require a replanning.
+    bool mReplanOnlyIfPathAffected;
     // If > 0 this describes the minimal distance in the world frame in meter between start 
     // and goal to initiate a replanning if a new trav map or start pose has been received.
     // In other words: This parameter allows you to define a area around the
@@ -171,6 +175,7 @@ struct Replanning {
         mReplanOnNewStartPose(false),
         mReplanOnNewGoalPose(true),
         mReplanOnNewMap(true),
+        mReplanOnlyIfPathAffected(false),
         mReplanMinDistStartGoal(0.0) {
     }
 };
@@ -211,6 +216,33 @@ struct Config {
     // complete available time.
     bool mSearchUntilFirstSolution; 
     struct Replanning mReplanning;
+    // Number of threads used by MotionPlanningLibraries::planBatch(), 
+    // 0 uses one thread for each available core.
+    unsigned int mNumBatchThreads;
+    // If set, a new map which is a pure translation of the previous one (a scrolling, 
+    // robot-centric map with the same size, scale and orientation) is shifted within 
+    // the planning library (SBPL) instead of being reinitialized. Only the newly 
+    // exposed and the changed cells are applied.
+    bool mShiftScrollingMap;
+    // If set, the planned path is simplified (collinear states, collision free 
+    // shortcuts) and its corners are replaced by arcs with mMobility.mMinTurningRadius
+    // before it is converted to the world (MotionPlanningLibraries::plan()).
+    bool mPostProcessPath;
+    // If set, the max_time of MotionPlanningLibraries::plan() is the deadline of the 
+    // complete call: solve() only gets the time which remains after the preparation 
+    // and the expected duration of the path extraction and conversion (measured 
+    // during the previous call). If the deadline has been passed after solve(), 
+    // the post-processing is skipped and the path cells are computed later.
+    bool mEndToEndDeadline;
+    // If set, each setTravGrid() (as cell diff), setStartState(), setGoalState() and 
+    // plan() call is recorded with its duration to this file to be replayed offline
+    // (motion_planning_libraries_replay), see PlanningRecorder.
+    std::string mRecordFile;
+    // Max size (bytes) of the recording, the oldest calls are dropped.
+    unsigned int mRecordMaxSize;
+    // OMPL: If not 0, the random number generator is seeded with this value, so plans
+    // can be reproduced (single planner, only before the first OMPL planner of the process).
+    unsigned int mRandomSeed;
     
     // NAVIGATION
     struct Mobility mMobility;
@@ -233,11 +265,49 @@ struct Config {
     // define the maximal allowed distance between two samples.
     // If it is set to a negative value or nan it will be ignored.
     double mMaxAllowedSampleDist;
+    // If set to true a distance transform of the obstacles is created and used 
+    // to check the circular footprints (XYTHETA, SHERPA) with a single lookup.
+    bool mUseObstacleDistanceMap;
+    // ENV_XY and ENV_SHERPA: Lazy planners (LazyRRT, LazyPRMstar) check the edges 
+    // only if they become part of a candidate solution. The edges are checked 
+    // along the crossed grid cells (GridMotionValidator) instead of sampling them.
+    bool mLazyCollisionChecking;
+    // Number of planners (ENV_XY and ENV_SHERPA) which are executed in parallel 
+    // threads, their solutions are hybridized. Values < 2 use a single planner.
+    unsigned int mNumParallelPlanners;
+    // SBPL ENV_XYTHETA and OMPL ENV_XY, ENV_XYTHETA, ENV_SHERPA: A goal rooted 
+    // 2D cost-to-go field (Dijkstra) is used as heuristic. It is reused while 
+    // the goal does not change and repaired incrementally by partial map updates.
+    bool mUseCostToGoField;
+    // Geometric OMPL environments (ENV_XY, ENV_SHERPA, ENV_ARM): After a new start,
+    // goal or an invalidating map update, the rest of the previous solution is
+    // re-checked and connected to the new start and goal. If it is still valid
+    // it is returned if the planner does not find a cheaper path, with
+    // mSearchUntilFirstSolution the planner is not executed at all.
+    bool mOmplWarmStart;
      
     // SBPL
     std::string mSBPLEnvFile;
     std::string mSBPLMotionPrimitivesFile;
+    // Generated motion primitives are passed to SBPL directly. If set, they are 
+    // additionally stored within this directory (named by a hash of their 
+    // configuration), e.g. to inspect them or to use them as mSBPLMotionPrimitivesFile.
+    std::string mSBPLMotionPrimitivesCacheDir;
     bool mSBPLForwardSearch;
+    // Coarse-to-fine planning (ENV_XYTHETA): If greater than 1, a 2D path is planned 
+    // first on a grid downsampled by this factor (worst cost of the covered cells)
+    // and the XYTHETA search is restricted to a corridor around this path.
+    unsigned int mSBPLCoarseFactor;
+    // Distance in meter to each side of the coarse path which is contained
+    // in the corridor.
+    double mSBPLCorridorWidth;
+    // Partial map updates farther than this distance in meter from the last 
+    // SBPL path are deferred until they could affect the solution (a new 
+    // start or goal or a new path which passes them). 0 applies all updates.
+    double mSBPLDeferUpdateDist;
+    // ENV_XY: The obstacles of the SBPL map are inflated by getMaxRadius(), 
+    // so the planned point robot keeps the footprint free.
+    bool mSBPLInflateObstacles;
     // Can be used to create and use intermediate points for each motion primitive.
     // E.g. if you want to get 10 points per primitive, you have
     // to set this variable to 8 (8 + start and end point).
@@ -246,6 +316,10 @@ struct Config {
     unsigned int mNumPrimPartition;
     // Max distance in grids from the reached end position to the next discrete one.
     double mPrimAccuracy;
+    // Only the start angles of the first octant are generated, the primitives of
+    // the other angles are derived by rotation and reflection. Requires a number
+    // of discrete angles which is a multiple of 8.
+    bool mSymmetricPrimitives;
     // Can be used to increase the radius of the robot when creating an escape trajectory.
     // Greater values (>1.0) will lead to a longer trajectory, smaller (<1.0) values to a short one.
     double mEscapeTrajRadiusFactor;
@@ -253,6 +327,9 @@ struct Config {
     // ARM MOTION PLANNING
     // defines the number and borders of the joints.  <low,high> in rad
     std::vector< MinMaxValue > mJointBorders; 
+    // Size (rad) of the joint-space voxels caching the results of the 
+    // ArmCollisionChecker, 0 checks each state.
+    double mArmValidityCacheResolution;
     
     void setJoints(int num, double lower_border=-M_PI, double upper_border=M_PI) {
         mJointBorders.empty();
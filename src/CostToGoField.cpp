@@ -0,0 +1,200 @@
+#include "CostToGoField.hpp"
+
+#include <cmath>
+
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+const int NEIGHBOUR_DX[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int NEIGHBOUR_DY[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+const double NEIGHBOUR_DIST[8] = {1.0, M_SQRT2, 1.0, M_SQRT2, 1.0, M_SQRT2, 1.0, M_SQRT2};
+}
+
+CostToGoField::CostToGoField() :
+        mCellSizeX(0),
+        mCellSizeY(0),
+        mGoalX(-1),
+        mGoalY(-1),
+        mClassCosts(),
+        mClasses(),
+        mCostToGo(),
+        mParent(),
+        mInvalidCells() {
+}
+
+bool CostToGoField::create(TravData const& trav_data, std::vector<double> const& class_costs,
+        int goal_x, int goal_y) {
+    clear();
+    mCellSizeX = trav_data.shape()[1];
+    mCellSizeY = trav_data.shape()[0];
+    if(goal_x < 0 || goal_x >= mCellSizeX || goal_y < 0 || goal_y >= mCellSizeY ||
+            class_costs.size() != NUM_CLASSES) {
+        return false;
+    }
+    mGoalX = goal_x;
+    mGoalY = goal_y;
+    mClassCosts = class_costs;
+    mClasses.assign(trav_data.origin(), trav_data.origin() + trav_data.num_elements());
+    mCostToGo.assign(mCellSizeX * mCellSizeY, std::numeric_limits<double>::infinity());
+    mParent.assign(mCellSizeX * mCellSizeY, -1);
+
+    // The goal keeps a cost of 0 even if it is not passable (no other cell
+    // reaches it then), its validity is checked by the planners.
+    Queue queue;
+    int goal_idx = goal_y * mCellSizeX + goal_x;
+    mCostToGo[goal_idx] = 0.0;
+    queue.push(QueueEntry(0.0, goal_idx));
+    propagate(queue);
+    return true;
+}
+
+bool CostToGoField::update(TravData const& trav_data, std::vector<double> const& class_costs,
+        std::vector<CellUpdate> const& cell_updates) {
+
+    if(empty() ||
+            (int)trav_data.shape()[1] != mCellSizeX ||
+            (int)trav_data.shape()[0] != mCellSizeY ||
+            class_costs != mClassCosts) {
+        return false;
+    }
+
+    // Cells which became more expensive invalidate all cells whose
+    // path to the goal passes them (their subtree), cheaper cells are propagated.
+    Queue queue;
+    mInvalidCells.clear();
+    std::vector<int> cheaper_cells;
+    std::vector<CellUpdate>::const_iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); ++it) {
+        int idx = it->y * mCellSizeX + it->x;
+        double old_cost = getCellCost(idx);
+        mClasses[idx] = it->klass;
+        double new_cost = getCellCost(idx);
+        if(new_cost > old_cost) {
+            if(std::isfinite(mCostToGo[idx])) {
+                mCostToGo[idx] = std::numeric_limits<double>::infinity();
+                mInvalidCells.push_back(idx);
+            }
+        } else if(new_cost < old_cost) {
+            cheaper_cells.push_back(idx);
+        }
+    }
+
+    // Collects the subtrees, the parent of a cell is always one of its neighbours.
+    for(unsigned int i = 0; i < mInvalidCells.size(); ++i) {
+        int idx = mInvalidCells[i];
+        int x = idx % mCellSizeX;
+        int y = idx / mCellSizeX;
+        for(int n = 0; n < 8; ++n) {
+            int nx = x + NEIGHBOUR_DX[n];
+            int ny = y + NEIGHBOUR_DY[n];
+            if(nx < 0 || nx >= mCellSizeX || ny < 0 || ny >= mCellSizeY) {
+                continue;
+            }
+            int n_idx = ny * mCellSizeX + nx;
+            if(mParent[n_idx] == idx && std::isfinite(mCostToGo[n_idx])) {
+                mCostToGo[n_idx] = std::numeric_limits<double>::infinity();
+                mInvalidCells.push_back(n_idx);
+            }
+        }
+    }
+
+    int goal_idx = mGoalY * mCellSizeX + mGoalX;
+    std::vector<int>::iterator it_idx = mInvalidCells.begin();
+    for(; it_idx != mInvalidCells.end(); ++it_idx) {
+        mParent[*it_idx] = -1;
+        if(*it_idx == goal_idx) {
+            mCostToGo[goal_idx] = 0.0;
+            queue.push(QueueEntry(0.0, goal_idx));
+        }
+    }
+    // The invalidated cells are seeded by their valid neighbours.
+    for(it_idx = mInvalidCells.begin(); it_idx != mInvalidCells.end(); ++it_idx) {
+        if(improveFromNeighbours(*it_idx)) {
+            queue.push(QueueEntry(mCostToGo[*it_idx], *it_idx));
+        }
+    }
+    // Cheaper cells can improve themselves and their neighbours.
+    for(it_idx = cheaper_cells.begin(); it_idx != cheaper_cells.end(); ++it_idx) {
+        improveFromNeighbours(*it_idx);
+        if(std::isfinite(mCostToGo[*it_idx])) {
+            queue.push(QueueEntry(mCostToGo[*it_idx], *it_idx));
+        }
+    }
+
+    LOG_DEBUG("Cost-to-go field repair: %zu invalidated, %zu cheaper cells",
+            mInvalidCells.size(), cheaper_cells.size());
+    propagate(queue);
+    return true;
+}
+
+// PRIVATE
+bool CostToGoField::improveFromNeighbours(int idx) {
+    if(!isPassable(idx)) {
+        return false;
+    }
+    int x = idx % mCellSizeX;
+    int y = idx / mCellSizeX;
+    double cell_cost = getCellCost(idx);
+    bool improved = false;
+    for(int n = 0; n < 8; ++n) {
+        int nx = x + NEIGHBOUR_DX[n];
+        int ny = y + NEIGHBOUR_DY[n];
+        if(nx < 0 || nx >= mCellSizeX || ny < 0 || ny >= mCellSizeY) {
+            continue;
+        }
+        int n_idx = ny * mCellSizeX + nx;
+        if(!std::isfinite(mCostToGo[n_idx]) || !isPassable(n_idx)) {
+            continue;
+        }
+        double cost = mCostToGo[n_idx] +
+                NEIGHBOUR_DIST[n] * (cell_cost + getCellCost(n_idx)) / 2.0;
+        if(cost < mCostToGo[idx]) {
+            mCostToGo[idx] = cost;
+            mParent[idx] = n_idx;
+            improved = true;
+        }
+    }
+    return improved;
+}
+
+void CostToGoField::propagate(Queue& queue) {
+    while(!queue.empty()) {
+        QueueEntry entry = queue.top();
+        queue.pop();
+        int idx = entry.second;
+        if(entry.first > mCostToGo[idx]) {
+            continue; // Outdated entry.
+        }
+
+        int x = idx % mCellSizeX;
+        int y = idx / mCellSizeX;
+        // An impassable goal has a cost of 0 for itself but no edges.
+        double cell_cost = getCellCost(idx);
+        if(cell_cost >= std::numeric_limits<double>::max()) {
+            continue;
+        }
+        for(int n = 0; n < 8; ++n) {
+            int nx = x + NEIGHBOUR_DX[n];
+            int ny = y + NEIGHBOUR_DY[n];
+            if(nx < 0 || nx >= mCellSizeX || ny < 0 || ny >= mCellSizeY) {
+                continue;
+            }
+            int n_idx = ny * mCellSizeX + nx;
+            if(!isPassable(n_idx)) {
+                continue;
+            }
+            double cost = entry.first +
+                    NEIGHBOUR_DIST[n] * (cell_cost + getCellCost(n_idx)) / 2.0;
+            if(cost < mCostToGo[n_idx]) {
+                mCostToGo[n_idx] = cost;
+                mParent[n_idx] = idx;
+                queue.push(QueueEntry(cost, n_idx));
+            }
+        }
+    }
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,126 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_COST_TO_GO_FIELD_HPP_
+#define _MOTION_PLANNING_LIBRARIES_COST_TO_GO_FIELD_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include <queue>
+#include <limits>
+
+#include "AbstractMotionPlanningLibrary.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Goal rooted 2D cost-to-go field of a traversability map (backward Dijkstra
+ * search with 8-connected cells). The cost of an edge between two neighboured
+ * cells is the mean cost of both cells times the length of the edge in cells.
+ * The costs of the traversability classes are passed by the user, so the
+ * units of the planning library can be used.
+ *
+ * The field does not depend on the start, so it can be reused for each
+ * replanning to the same goal. Map updates are repaired incrementally:
+ * The cells whose shortest path passes a more expensive cell are invalidated
+ * and searched again, cheaper cells are propagated.
+ */
+class CostToGoField {
+ public:
+    static const unsigned int NUM_CLASSES = 256;
+
+ private:
+    typedef std::pair<double, int> QueueEntry;
+    typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+            std::greater<QueueEntry> > Queue;
+
+    int mCellSizeX;
+    int mCellSizeY;
+    int mGoalX;
+    int mGoalY;
+    std::vector<double> mClassCosts;
+    std::vector<uint8_t> mClasses; // Class of each cell used by the field.
+    std::vector<double> mCostToGo;
+    std::vector<int> mParent; // Next cell towards the goal, -1 for the goal and unreachable cells.
+
+    // Buffers for the repair.
+    std::vector<int> mInvalidCells;
+
+ public:
+    CostToGoField();
+
+    /**
+     * (Re-)creates the complete field.
+     * \param class_costs Cost to traverse one cell for each of the NUM_CLASSES classes,
+     * infinity (or std::numeric_limits<double>::max()) for obstacles.
+     * \return False if the goal lies outside of the map.
+     */
+    bool create(TravData const& trav_data, std::vector<double> const& class_costs,
+            int goal_x, int goal_y);
+
+    /**
+     * Repairs the field using the changed cells. \a trav_data has to contain
+     * the new map already. If the size of the map or the class costs have changed
+     * (or the field has not been created yet) false is returned and create()
+     * has to be called instead.
+     */
+    bool update(TravData const& trav_data, std::vector<double> const& class_costs,
+            std::vector<CellUpdate> const& cell_updates);
+
+    inline bool empty() const {
+        return mCostToGo.empty();
+    }
+
+    inline void clear() {
+        mCostToGo.clear();
+        mParent.clear();
+        mClasses.clear();
+        mGoalX = mGoalY = -1;
+    }
+
+    inline bool hasGoal(int goal_x, int goal_y) const {
+        return !empty() && goal_x == mGoalX && goal_y == mGoalY;
+    }
+
+    inline int getGoalX() const {
+        return mGoalX;
+    }
+    
+    inline int getGoalY() const {
+        return mGoalY;
+    }
+
+    /**
+     * Returns the cost from the cell to the goal or infinity
+     * if the goal cannot be reached or the cell lies outside of the map.
+     */
+    inline double getCost(int x, int y) const {
+        if(x < 0 || x >= mCellSizeX || y < 0 || y >= mCellSizeY || empty()) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return mCostToGo[y * mCellSizeX + x];
+    }
+
+ private:
+    inline double getCellCost(int idx) const {
+        return mClassCosts[mClasses[idx]];
+    }
+
+    inline bool isPassable(int idx) const {
+        return getCellCost(idx) < std::numeric_limits<double>::max();
+    }
+
+    /**
+     * Calculates the best cost of the cell using its neighbours and
+     * stores it if it is lower than the current one.
+     * \return True if the cost has been improved.
+     */
+    bool improveFromNeighbours(int idx);
+
+    /**
+     * Dijkstra search starting with the cells within the queue.
+     */
+    void propagate(Queue& queue);
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_COST_TO_GO_FIELD_HPP_
@@ -1,40 +1,321 @@
 #ifndef _PLANNING_HELPERS_HPP_
 #define _PLANNING_HELPERS_HPP_
 
+#include <stdint.h>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
 #include <boost/shared_ptr.hpp>
 //#include <CGAL/Point_2.h>
 
 #include <envire/maps/TraversabilityGrid.hpp>
 
+#include "TravClassTable.hpp"
+#include "OccupancyBitmap.hpp"
+
 namespace motion_planning_libraries
 {
 
 typedef envire::TraversabilityGrid::ArrayType TravData;
+
+/**
+ * Cell offsets of a footprint for one discrete orientation 
+ * (structure of arrays, sorted row by row).
+ */
+struct FootprintStencil {
+    std::vector<int16_t> mOffsetsX;
+    std::vector<int16_t> mOffsetsY;
+    // Bounding box of the offsets, used to skip the border checks.
+    int mMinX, mMaxX, mMinY, mMaxY;
+    // Same cells as bit rows, see OccupancyBitmap::isFree().
+    FootprintMask mMask;
+    
+    FootprintStencil() : mOffsetsX(), mOffsetsY(), mMinX(0), mMaxX(0), mMinY(0), mMaxY(0), 
+            mMask() {
+    }
+};
+
+// Stencils of one footprint, one for each discrete orientation.
+typedef std::vector<FootprintStencil> FootprintStencils;
+
+/**
+ * Visits all grid cells which are crossed by the straight segment from 
+ * (x0, y0) to (x1, y1) in grid coordinates (Amanatides and Woo). For each cell 
+ * the fractions of the segment at which it is entered and left are available,
+ * so costs can be integrated exactly and states can be interpolated within the cell.
+ * \code
+ * GridTraversal traversal(x0, y0, x1, y1);
+ * do {
+ *     visit(traversal.getX(), traversal.getY(), traversal.getExit() - traversal.getEnter());
+ * } while(traversal.next());
+ * \endcode
+ */
+class GridTraversal {
+ private:
+    int mX, mY;
+    int mEndX, mEndY;
+    int mStepX, mStepY;
+    double mTMaxX, mTMaxY; // Fraction at which the next column / row is reached.
+    double mTDeltaX, mTDeltaY; // Fraction to traverse one column / row.
+    double mEnter, mExit;
+    int mNumCells;
+    int mIndex;
+    
+ public:
+    GridTraversal(double x0, double y0, double x1, double y1) : 
+            mX((int)std::floor(x0)), mY((int)std::floor(y0)),
+            mEndX((int)std::floor(x1)), mEndY((int)std::floor(y1)),
+            mStepX(x1 > x0 ? 1 : -1), mStepY(y1 > y0 ? 1 : -1),
+            mTMaxX(0.0), mTMaxY(0.0), mTDeltaX(0.0), mTDeltaY(0.0),
+            mEnter(0.0), mExit(1.0), 
+            mNumCells(std::abs(mEndX - mX) + std::abs(mEndY - mY) + 1),
+            mIndex(0) {
+        double dx = x1 - x0;
+        double dy = y1 - y0;
+        double inf = std::numeric_limits<double>::infinity();
+        mTDeltaX = dx != 0 ? std::fabs(1.0 / dx) : inf;
+        mTDeltaY = dy != 0 ? std::fabs(1.0 / dy) : inf;
+        mTMaxX = dx > 0 ? (mX + 1 - x0) / dx : (dx < 0 ? (x0 - mX) / -dx : inf);
+        mTMaxY = dy > 0 ? (mY + 1 - y0) / dy : (dy < 0 ? (y0 - mY) / -dy : inf);
+        if(mNumCells > 1) {
+            mExit = std::min(std::min(mTMaxX, mTMaxY), 1.0);
+        }
+    }
+    
+    /**
+     * Moves to the next crossed cell, returns false if the current 
+     * cell is the last one (contains the end of the segment).
+     */
+    inline bool next() {
+        if(mIndex + 1 >= mNumCells) {
+            return false;
+        }
+        // If the segment ends on a cell border the comparison can be decided
+        // by rounding errors, so an axis is not stepped beyond its end cell.
+        if(mY == mEndY || (mX != mEndX && mTMaxX < mTMaxY)) {
+            mX += mStepX;
+            mTMaxX += mTDeltaX;
+        } else {
+            mY += mStepY;
+            mTMaxY += mTDeltaY;
+        }
+        mIndex++;
+        mEnter = mExit;
+        mExit = isLast() ? 1.0 : std::min(std::min(mTMaxX, mTMaxY), 1.0);
+        return true;
+    }
+    
+    inline int getX() const {
+        return mX;
+    }
+    
+    inline int getY() const {
+        return mY;
+    }
+    
+    /**
+     * Fraction of the segment (0 to 1) at which the current cell is entered.
+     */
+    inline double getEnter() const {
+        return mEnter;
+    }
+    
+    /**
+     * Fraction of the segment (0 to 1) at which the current cell is left.
+     */
+    inline double getExit() const {
+        return mExit;
+    }
+    
+    inline int getIndex() const {
+        return mIndex;
+    }
+    
+    inline int getNumCells() const {
+        return mNumCells;
+    }
+    
+    inline bool isLast() const {
+        return mIndex + 1 == mNumCells;
+    }
+};
+
+/**
+ * Marks all cells (row-major, \a width x \a height) within a square of 
+ * \a radius cells around the marked cells. The rows and the columns are 
+ * dilated separately, so the costs do not depend on the radius.
+ */
+inline void dilateCells(std::vector<uint8_t>& cells, int width, int height, int radius) {
+    if(radius <= 0) {
+        return;
+    }
+    std::vector<uint8_t> rows(cells.size(), 0);
+    for(int pass = 0; pass < 2; ++pass) {
+        std::vector<uint8_t> const& in = pass == 0 ? cells : rows;
+        std::vector<uint8_t> out(cells.size(), 0);
+        int num_lines = pass == 0 ? height : width;
+        int num_cells = pass == 0 ? width : height;
+        int stride = pass == 0 ? 1 : width;
+        for(int line = 0; line < num_lines; ++line) {
+            size_t first = pass == 0 ? (size_t)line * width : (size_t)line;
+            int last_marked = -radius - 1;
+            for(int i = 0; i < num_cells; ++i) {
+                if(in[first + (size_t)i * stride]) {
+                    last_marked = i;
+                }
+                out[first + (size_t)i * stride] = i - last_marked <= radius;
+            }
+            last_marked = num_cells + radius;
+            for(int i = num_cells - 1; i >= 0; --i) {
+                if(in[first + (size_t)i * stride]) {
+                    last_marked = i;
+                }
+                if(last_marked - i <= radius) {
+                    out[first + (size_t)i * stride] = 1;
+                }
+            }
+        }
+        if(pass == 0) {
+            rows.swap(out);
+        } else {
+            cells.swap(out);
+        }
+    }
+}
     
 class GridCalculations {
  
  private:
+    enum FootprintType {
+        FOOTPRINT_NONE,
+        FOOTPRINT_RECTANGLE,
+        FOOTPRINT_CIRCLE,
+        FOOTPRINT_CIRCLE_OUTLINE
+    };
+    
+    // Describes a footprint, used as the key of the stencil cache.
+    struct FootprintKey {
+        FootprintType mType;
+        int mSizeX;
+        int mSizeY;
+        
+        FootprintKey(FootprintType type = FOOTPRINT_NONE, int size_x = 0, int size_y = 0) : 
+                mType(type), mSizeX(size_x), mSizeY(size_y) {
+        }
+        
+        bool operator==(FootprintKey const& other) const {
+            return mType == other.mType && mSizeX == other.mSizeX && mSizeY == other.mSizeY;
+        }
+        
+        bool operator<(FootprintKey const& other) const {
+            if(mType != other.mType) return mType < other.mType;
+            if(mSizeX != other.mSizeX) return mSizeX < other.mSizeX;
+            return mSizeY < other.mSizeY;
+        }
+    };
+    
+    typedef FootprintStencils Stencils;
+    
     envire::TraversabilityGrid* mpTravGrid;
     boost::shared_ptr<TravData> mpTravData;
+    boost::shared_ptr<TravClassTable> mpTravClassTable;
+    // Obstacle bits of mpTravData, used by the footprint checks if available.
+    boost::shared_ptr<OccupancyBitmap const> mpOccupancyBitmap;
     Eigen::Affine3d mFootprint2Grid;
     // Contains all coordinates within the local frame.
     std::vector< base::Vector3d > mFootprintLocal;
+    // Number of discrete orientations a stencil is created for.
+    unsigned int mNumStencilAngles;
+    // Stencils (one for each discrete orientation) of all used footprints.
+    std::map<FootprintKey, boost::shared_ptr<Stencils> > mStencilCache;
+    FootprintKey mCurrentFootprint;
+    boost::shared_ptr<Stencils> mpStencils;
+    // Pose set by setFootprintPoseInGrid().
+    int mFootprintX, mFootprintY, mFootprintTheta;
     
  public:    
  
     GridCalculations() : mpTravGrid(NULL),
             mpTravData(),
+            mpTravClassTable(),
+            mpOccupancyBitmap(),
             mFootprint2Grid(),
-            mFootprintLocal() {
+            mFootprintLocal(),
+            mNumStencilAngles(16),
+            mStencilCache(),
+            mCurrentFootprint(),
+            mpStencils(),
+            mFootprintX(0),
+            mFootprintY(0),
+            mFootprintTheta(0) {
     }
  
-    void setTravGrid(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data) {
+    /**
+     * If no class to cost lookup table is passed a new one is created 
+     * using the classes of \a trav_grid.
+     */
+    void setTravGrid(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data,
+            boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>()) {
         if(trav_grid == NULL) {
             LOG_WARN("setTravGrid: Received an empty traversability map");
         }
         
         mpTravGrid = trav_grid; 
         mpTravData = trav_data;
+        mpOccupancyBitmap.reset();
+        
+        if(trav_class_table == NULL && trav_grid != NULL) {
+            trav_class_table = boost::shared_ptr<TravClassTable>(
+                    new TravClassTable(trav_grid, Config()));
+        }
+        mpTravClassTable = trav_class_table;
+    }
+    
+    /**
+     * Sets the obstacle bits of the current map (created with its class table), 
+     * which are used by isValid() instead of the class bytes. Has to be set 
+     * again after each setTravGrid().
+     */
+    void setOccupancyBitmap(boost::shared_ptr<OccupancyBitmap const> occupancy_bitmap) {
+        mpOccupancyBitmap = occupancy_bitmap;
+    }
+    
+    /**
+     * Sets the number of discrete orientations (e.g. the 16 SBPL angles) 
+     * the footprint stencils are created for. Clears the stencil cache.
+     */
+    void setNumStencilAngles(unsigned int num_angles) {
+        if(num_angles == 0) {
+            LOG_WARN("At least one stencil angle is required");
+            num_angles = 1;
+        }
+        mNumStencilAngles = num_angles;
+        mStencilCache.clear();
+        mpStencils.reset();
+        if(mCurrentFootprint.mType != FOOTPRINT_NONE) {
+            selectStencils(mCurrentFootprint);
+        }
+    }
+    
+    inline unsigned int getNumStencilAngles() const {
+        return mNumStencilAngles;
+    }
+    
+    /**
+     * Returns the index of the stencil which matches the orientation \a theta (rad).
+     */
+    inline unsigned int getThetaIndex(double theta) const {
+        int index = (int)std::floor(theta / (2 * M_PI) * mNumStencilAngles + 0.5);
+        index %= (int)mNumStencilAngles;
+        if(index < 0) {
+            index += mNumStencilAngles;
+        }
+        return index;
     }
     
     void setFootprintRectangleInGrid(int rectangle_lenth_x, int rectangle_width_y) {
@@ -42,12 +323,18 @@ class GridCalculations {
             throw std::runtime_error("Trav Grid not set");
         }
         
+        FootprintKey key(FOOTPRINT_RECTANGLE, rectangle_lenth_x, rectangle_width_y);
+        if(mpStencils != NULL && key == mCurrentFootprint) {
+            return;
+        }
+        
         mFootprintLocal.clear();
         for(int y=-rectangle_width_y/2.0; y < std::ceil(rectangle_width_y/2.0); ++y) {
             for(int x=-rectangle_lenth_x/2.0; x < std::ceil(rectangle_lenth_x/2.0); ++x) {
                 mFootprintLocal.push_back(base::Vector3d(x,y,0));
             }
         }
+        selectStencils(key);
     }
     
     void setFootprintCircleInGrid(int radius_grid, bool  filled=true) {
@@ -55,6 +342,11 @@ class GridCalculations {
             throw std::runtime_error("Trav Grid not set");
         }
         
+        FootprintKey key(filled ? FOOTPRINT_CIRCLE : FOOTPRINT_CIRCLE_OUTLINE, radius_grid, radius_grid);
+        if(mpStencils != NULL && key == mCurrentFootprint) {
+            return;
+        }
+        
         mFootprintLocal.clear();
         
         if(filled) {
@@ -83,6 +375,7 @@ class GridCalculations {
                 vec = Eigen::AngleAxisd(rot, Eigen::Vector3d::UnitZ()) * vec;
             }
         }
+        selectStencils(key);
     }
     
     void setFootprintPoseInGrid(int footprint_x_grid, 
@@ -91,51 +384,104 @@ class GridCalculations {
         mFootprint2Grid.setIdentity();
         mFootprint2Grid.rotate(Eigen::AngleAxis<double>(footprint_theta_grid, base::Vector3d(0.0, 0.0, 1.0)));
         mFootprint2Grid.translation() = base::Vector3d(footprint_x_grid, footprint_y_grid, 0.0);   
+        mFootprintX = footprint_x_grid;
+        mFootprintY = footprint_y_grid;
+        mFootprintTheta = footprint_theta_grid;
     }
     
     /**
-     * Checks if the current footprint is valid. Some pixels within the rectangle
+     * Checks if the current footprint is valid at the pose set by 
+     * setFootprintPoseInGrid(). Some pixels within the rectangle
      * may not be checked. Problem?
      */
     bool isValid() {
+        return isValid(mFootprintX, mFootprintY, getThetaIndex(mFootprintTheta));
+    }
+    
+    /**
+     * Checks if the current footprint placed on cell (\a x, \a y) with the 
+     * discrete orientation \a theta_index (see getThetaIndex()) is valid, i.e. 
+     * lies within the grid and does not touch an obstacle.
+     */
+    bool isValid(int x, int y, unsigned int theta_index) const {
+        if(mpStencils == NULL || mFootprintLocal.empty()) {
+            throw std::runtime_error("No footprint has been set.");
+        }
+        return isValid(*mpStencils, x, y, theta_index);
+    }
+    
+    /**
+     * Returns the stencils of the current footprint. They stay valid if
+     * another footprint is set, so several footprints can be prepared 
+     * in advance and checked by the const isValid(stencils, x, y, theta_index),
+     * which can be called by several threads at the same time.
+     */
+    boost::shared_ptr<FootprintStencils const> getFootprintStencils() const {
+        if(mpStencils == NULL) {
+            throw std::runtime_error("No footprint has been set.");
+        }
+        return mpStencils;
+    }
+    
+    /**
+     * Like isValid(x, y, theta_index) but uses the passed stencils
+     * (see getFootprintStencils()) instead of the current footprint.
+     */
+    bool isValid(FootprintStencils const& stencils, int x, int y, unsigned int theta_index) const {
     
         if(mpTravGrid == NULL) {
             throw std::runtime_error("Trav Grid not set");
         }
         
-        if(mFootprintLocal.empty()) {
-            throw std::runtime_error("No footprint has been set.");
+        if(stencils.size() != mNumStencilAngles) {
+            throw std::runtime_error("Stencils do not match the number of stencil angles.");
         }
         
+        FootprintStencil const& stencil = stencils[theta_index % mNumStencilAngles];
+        
+        // Compares 64 cells of a row at once.
+        if(mpOccupancyBitmap != NULL) {
+            return mpOccupancyBitmap->isFree(stencil.mMask, x, y);
+        }
+        
+        TravClassTable const& table = *mpTravClassTable;
+        int size_x = mpTravData->shape()[1];
+        int size_y = mpTravData->shape()[0];
+        size_t num_cells = stencil.mOffsetsX.size();
+        const int16_t* offsets_x = stencil.mOffsetsX.empty() ? NULL : &stencil.mOffsetsX[0];
+        const int16_t* offsets_y = stencil.mOffsetsY.empty() ? NULL : &stencil.mOffsetsY[0];
+        
+        // Border checks are only required if the footprint exceeds the grid.
+        if(     x + stencil.mMinX >= 0 && x + stencil.mMaxX < size_x &&
+                y + stencil.mMinY >= 0 && y + stencil.mMaxY < size_y) {
+            const uint8_t* center_p = mpTravData->origin() + y * size_x + x;
+            for(size_t i=0; i<num_cells; ++i) {
+                if(table.isObstacle(center_p[offsets_y[i] * size_x + offsets_x[i]])) {
+                    LOG_DEBUG("State (%d,%d) is invalid (footprint lies on an obstacle)", x, y);
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        const uint8_t* data_p = mpTravData->origin();
         int fp_x = 0;
         int fp_y = 0;
-        base::Vector3d result;
-        uint8_t class_value = 0;
-        double driveability = 0;
-        
-        std::vector<base::Vector3d>::iterator it = mFootprintLocal.begin(); 
-        for(;it != mFootprintLocal.end(); ++it) {
+        for(size_t i=0; i<num_cells; ++i) {
+            fp_x = x + offsets_x[i];
+            fp_y = y + offsets_y[i];
             
-            // Transform to grid frame.
-            result = mFootprint2Grid * *it;
-            fp_x = result[0];
-            fp_y = result[1];
-             
             // Check borders.
-            if(     fp_x < 0 || fp_x >= (int)mpTravGrid->getCellSizeX() ||
-                    fp_y < 0 || fp_y >= (int)mpTravGrid->getCellSizeY()) {
-                LOG_DEBUG("State (%d,%d) is invalid (footprint (%4.2f,%4.2f) not within the grid)", 
-                        mFootprint2Grid.translation()[0], mFootprint2Grid.translation()[1], fp_x, fp_y);
+            if(fp_x < 0 || fp_x >= size_x || fp_y < 0 || fp_y >= size_y) {
+                LOG_DEBUG("State (%d,%d) is invalid (footprint (%d,%d) not within the grid)", 
+                        x, y, fp_x, fp_y);
                 return false;
             } 
             
             // Check obstacle.
-            class_value = (*mpTravData)[fp_y][fp_x];
-            driveability = (mpTravGrid->getTraversabilityClass(class_value)).getDrivability();
-        
-            if(driveability == 0.0) {
-                LOG_DEBUG("State (%d,%d) is invalid (footprint (%4.2f,%4.2f) lies on an obstacle)", 
-                        mFootprint2Grid.translation()[0], mFootprint2Grid.translation()[1], fp_x, fp_y);
+            if(table.isObstacle(data_p[fp_y * size_x + fp_x])) {
+                LOG_DEBUG("State (%d,%d) is invalid (footprint (%d,%d) lies on an obstacle)", 
+                        x, y, fp_x, fp_y);
                 return false;
             }  
         }
@@ -178,6 +524,65 @@ class GridCalculations {
             mpTravGrid->setProbability(1.0, fp_x, fp_y);
         }
     }
+    
+ private:
+    /**
+     * Uses the cached stencils of the footprint or creates them
+     * using the current mFootprintLocal.
+     */
+    void selectStencils(FootprintKey const& key) {
+        std::map<FootprintKey, boost::shared_ptr<Stencils> >::iterator it = mStencilCache.find(key);
+        if(it == mStencilCache.end()) {
+            it = mStencilCache.insert(std::make_pair(key, createStencils())).first;
+        }
+        mCurrentFootprint = key;
+        mpStencils = it->second;
+    }
+    
+    /**
+     * Rotates mFootprintLocal for each discrete orientation and stores the 
+     * resulting cells (without duplicates). The cells are truncated like 
+     * within setValue().
+     */
+    boost::shared_ptr<Stencils> createStencils() const {
+        boost::shared_ptr<Stencils> stencils(new Stencils(mNumStencilAngles));
+        std::set< std::pair<int, int> > cells; // (y,x) to sort row by row.
+        
+        for(unsigned int i=0; i<mNumStencilAngles; ++i) {
+            double theta = (2 * M_PI * i) / mNumStencilAngles;
+            double cos_theta = cos(theta);
+            double sin_theta = sin(theta);
+            
+            cells.clear();
+            std::vector<base::Vector3d>::const_iterator it = mFootprintLocal.begin(); 
+            for(;it != mFootprintLocal.end(); ++it) {
+                // Small epsilon prevents rounding errors of e.g. 90 degree.
+                int x = std::floor(cos_theta * (*it)[0] - sin_theta * (*it)[1] + 1e-9);
+                int y = std::floor(sin_theta * (*it)[0] + cos_theta * (*it)[1] + 1e-9);
+                cells.insert(std::make_pair(y, x));
+            }
+            
+            FootprintStencil& stencil = (*stencils)[i];
+            stencil.mOffsetsX.reserve(cells.size());
+            stencil.mOffsetsY.reserve(cells.size());
+            std::set< std::pair<int, int> >::iterator it_cell = cells.begin();
+            for(; it_cell != cells.end(); ++it_cell) {
+                stencil.mOffsetsX.push_back(it_cell->second);
+                stencil.mOffsetsY.push_back(it_cell->first);
+                if(it_cell == cells.begin()) {
+                    stencil.mMinX = stencil.mMaxX = it_cell->second;
+                    stencil.mMinY = stencil.mMaxY = it_cell->first;
+                } else {
+                    stencil.mMinX = std::min(stencil.mMinX, it_cell->second);
+                    stencil.mMaxX = std::max(stencil.mMaxX, it_cell->second);
+                    stencil.mMinY = std::min(stencil.mMinY, it_cell->first);
+                    stencil.mMaxY = std::max(stencil.mMaxY, it_cell->first);
+                }
+            }
+            OccupancyBitmap::createMask(stencil.mOffsetsX, stencil.mOffsetsY, stencil.mMask);
+        }
+        return stencils;
+    }
 };
 
 } // end namespace motion_planning_libraries
@@ -0,0 +1,781 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+#include <ompl/base/spaces/SE2StateSpace.h>
+
+#include <envire/core/Environment.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+
+#include <motion_planning_libraries/MotionPlanningLibraries.hpp>
+#include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/OccupancyBitmap.hpp>
+#include <motion_planning_libraries/TravClassTable.hpp>
+#include <motion_planning_libraries/TraceLog.hpp>
+#include <motion_planning_libraries/sbpl/SbplEnvXY.hpp>
+#include <motion_planning_libraries/sbpl/SbplMotionPrimitives.hpp>
+#include <motion_planning_libraries/sbpl/SbplSplineMotionPrimitives.hpp>
+#include <motion_planning_libraries/ompl/spaces/SherpaStateSpace.hpp>
+#include <motion_planning_libraries/ompl/validators/TravMapValidator.hpp>
+#include <motion_planning_libraries/ompl/objectives/TravGridObjective.hpp>
+
+/**
+ * Microbenchmarks of the planning kernels (map diff, SBPL map conversion,
+ * footprint checks, OMPL validators and objectives, motion primitives and
+ * the world/grid transformations) on reproducible random maps. The setup of
+ * a kernel is not measured. The number of iterations is increased until a
+ * repetition takes at least --min-time, the median of the repetitions is
+ * reported. The results are written as JSON using the schema of Google
+ * Benchmark, so its tools (compare.py) can be used as well. A previous
+ * result can be passed as --baseline: Each kernel is compared by its real
+ * time and the exit code is 2 if one is slower than --max-regression times
+ * the baseline.
+ *
+ * motion_planning_libraries_kernels [--filter <substring>] [--min-time <sec>]
+ *     [--repetitions <n>] [--seed <n>] [--output <file>]
+ *     [--baseline <file> [--max-regression <factor>]]
+ */
+
+using namespace motion_planning_libraries;
+namespace ob = ompl::base;
+
+namespace {
+
+static const double CELL_SIZE = 0.1;
+static const unsigned char CLASS_UNKNOWN = 0;
+static const unsigned char CLASS_OBSTACLE = 1;
+static const unsigned char CLASS_FREE = 2;
+static const unsigned char CLASS_ROUGH = 3;
+// Size of the maps used by all kernels but the map diff.
+static const int MAP_SIZE = 512;
+static const double OBSTACLE_RATIO = 0.05;
+// Number of prepared inputs (states, poses) the kernels cycle through.
+static const unsigned int NUM_INPUTS = 4096;
+
+struct KernelOptions {
+    std::string mFilter;
+    double mMinTime;
+    unsigned int mRepetitions;
+    unsigned int mSeed;
+    std::string mOutput;
+    std::string mBaseline;
+    double mMaxRegression;
+
+    KernelOptions() : mFilter(),
+            mMinTime(0.5),
+            mRepetitions(3),
+            mSeed(42),
+            mOutput(),
+            mBaseline(),
+            mMaxRegression(1.2) {
+    }
+};
+
+/**
+ * Executes the kernel \a iterations times.
+ */
+typedef std::function<void(uint64_t iterations)> KernelFunction;
+
+struct Kernel {
+    std::string mName;
+    // Processed items (cells, states) of a single iteration, used for the throughput.
+    uint64_t mItemsPerIteration;
+    // Creates the inputs and returns the measured function.
+    std::function<KernelFunction()> mSetup;
+};
+
+struct KernelResult {
+    std::string mName;
+    uint64_t mIterations;
+    double mRealTime; // ns per iteration, median of the repetitions
+    double mCpuTime; // ns per iteration
+    double mItemsPerSecond;
+};
+
+// Results of the kernels are accumulated here, so the calls cannot be removed.
+volatile double gSink = 0.0;
+
+/**
+ * Linear congruential generator, see Bench.cpp.
+ */
+class Random {
+ public:
+    Random(unsigned int seed) : mState(seed) {
+    }
+
+    unsigned int next() {
+        mState = mState * 1103515245u + 12345u;
+        return (mState >> 16) & 0x7fff;
+    }
+
+    int range(int min, int max) {
+        return min + (int)(next() % (unsigned int)(max - min + 1));
+    }
+
+    double uniform() {
+        return next() / 32768.0;
+    }
+
+ private:
+    unsigned int mState;
+};
+
+double now(clockid_t clock) {
+    struct timespec t;
+    clock_gettime(clock, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * Free cells with some rough cells and square obstacles covering about
+ * \a obstacle_ratio of the map.
+ */
+void generateMap(TravData& data, int size, double obstacle_ratio, Random& random) {
+    for(int y=0; y < size; ++y) {
+        for(int x=0; x < size; ++x) {
+            data[y][x] = random.uniform() < 0.1 ? CLASS_ROUGH : CLASS_FREE;
+        }
+    }
+    int num_squares = (int)(size * size * obstacle_ratio / 16);
+    for(int i=0; i < num_squares; ++i) {
+        int x0 = random.range(0, size - 4);
+        int y0 = random.range(0, size - 4);
+        for(int y=y0; y < y0 + 4; ++y) {
+            for(int x=x0; x < x0 + 4; ++x) {
+                data[y][x] = CLASS_OBSTACLE;
+            }
+        }
+    }
+}
+
+/**
+ * Map within its own environment, the environment is deleted together with the map.
+ */
+struct KernelMap {
+    boost::shared_ptr<envire::Environment> mpEnv;
+    envire::TraversabilityGrid* mpTravGrid;
+    boost::shared_ptr<TravData> mpTravData;
+    boost::shared_ptr<TravClassTable> mpTravClassTable;
+};
+
+KernelMap createMap(int size, unsigned int seed, Config const& config) {
+    KernelMap map;
+    map.mpEnv = boost::shared_ptr<envire::Environment>(new envire::Environment());
+    map.mpTravGrid = new envire::TraversabilityGrid(size, size, CELL_SIZE, CELL_SIZE);
+    map.mpTravGrid->setTraversabilityClass(CLASS_UNKNOWN, envire::TraversabilityClass(0.5));
+    map.mpTravGrid->setTraversabilityClass(CLASS_OBSTACLE, envire::TraversabilityClass(0.0));
+    map.mpTravGrid->setTraversabilityClass(CLASS_FREE, envire::TraversabilityClass(1.0));
+    map.mpTravGrid->setTraversabilityClass(CLASS_ROUGH, envire::TraversabilityClass(0.6));
+    map.mpTravGrid->setUniqueId("/trav_map");
+    map.mpEnv->attachItem(map.mpTravGrid);
+    envire::FrameNode* frame_node = new envire::FrameNode();
+    map.mpEnv->getRootNode()->addChild(frame_node);
+    map.mpTravGrid->setFrameNode(frame_node);
+
+    TravData& data = map.mpTravGrid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
+    Random random(seed);
+    generateMap(data, size, OBSTACLE_RATIO, random);
+    map.mpTravData = boost::shared_ptr<TravData>(new TravData(data));
+    map.mpTravClassTable = boost::shared_ptr<TravClassTable>(
+            new TravClassTable(map.mpTravGrid, config));
+    return map;
+}
+
+Config createConfig(enum PlanningLibraryType lib, enum EnvType env) {
+    Config conf;
+    conf.mPlanningLibType = lib;
+    conf.mEnvType = env;
+    conf.mPlanner = lib == LIB_SBPL ? ANYTIME_DSTAR : UNDEFINED_PLANNER;
+    conf.mMaxAllowedSampleDist = 1.0;
+    conf.mMobility.mSpeed = 0.8;
+    conf.mMobility.mTurningSpeed = 0.5;
+    conf.mMobility.mMultiplierForward = 1;
+    conf.mMobility.mMultiplierBackward = 2;
+    conf.mMobility.mMultiplierBackwardTurn = 4;
+    conf.mMobility.mMultiplierLateral = 0;
+    conf.mMobility.mMultiplierForwardTurn = 3;
+    conf.mMobility.mMultiplierPointTurn = 3;
+    conf.mMobility.mMinTurningRadius = 1.0;
+    conf.mFootprintRadiusMinMax = MinMaxValue(0.3, 0.3);
+    conf.mFootprintLengthMinMax = MinMaxValue(0.6, 0.6);
+    conf.mFootprintWidthMinMax = MinMaxValue(0.4, 0.4);
+    if(env == ENV_SHERPA) {
+        conf.mFootprintRadiusMinMax = MinMaxValue(0.3, 0.5);
+        conf.mFootprintLengthMinMax = MinMaxValue(0.0, 0.0);
+        conf.mFootprintWidthMinMax = MinMaxValue(0.0, 0.0);
+    }
+    conf.mNumFootprintClasses = 5;
+    conf.mNumIntermediatePoints = 4;
+    conf.mNumPrimPartition = 4;
+    conf.mPrimAccuracy = 0.15;
+    return conf;
+}
+
+std::string toString(double value) {
+    std::stringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+// KERNELS
+void addCollectCellUpdates(std::vector<Kernel>& kernels, KernelOptions const& options) {
+    int sizes[] = {256, 1024};
+    double change_ratios[] = {0.0, 0.01, 0.1, 1.0};
+    for(unsigned int s=0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        for(unsigned int c=0; c < sizeof(change_ratios) / sizeof(change_ratios[0]); ++c) {
+            int size = sizes[s];
+            double change_ratio = change_ratios[c];
+            unsigned int seed = options.mSeed;
+            Kernel kernel;
+            kernel.mName = "collect_cell_updates/" + toString(size) + "/" +
+                    toString(change_ratio * 100) + "%";
+            kernel.mItemsPerIteration = (uint64_t)size * size;
+            kernel.mSetup = [size, change_ratio, seed]() {
+                KernelMap map = createMap(size, seed, Config());
+                boost::shared_ptr<TravData> trav_new(new TravData(*map.mpTravData));
+                boost::shared_ptr<TravData> prob(new TravData(boost::extents[size][size]));
+                std::fill(prob->data(), prob->data() + prob->num_elements(), 255);
+                Random random(seed + 1);
+                for(int y=0; y < size; ++y) {
+                    for(int x=0; x < size; ++x) {
+                        if(random.uniform() < change_ratio) {
+                            (*trav_new)[y][x] = (*trav_new)[y][x] == CLASS_FREE ?
+                                    CLASS_ROUGH : CLASS_FREE;
+                        }
+                    }
+                }
+                boost::shared_ptr<std::vector<CellUpdate> > cell_updates(new std::vector<CellUpdate>());
+                boost::shared_ptr<std::vector<CellUpdateSpan> > spans(new std::vector<CellUpdateSpan>());
+                return KernelFunction([map, trav_new, prob, cell_updates, spans](uint64_t iterations) {
+                    for(uint64_t i=0; i < iterations; ++i) {
+                        cell_updates->clear();
+                        spans->clear();
+                        MotionPlanningLibraries::collectCellUpdates(*map.mpTravData, *prob,
+                                *trav_new, *prob, *map.mpTravClassTable, *cell_updates, *spans);
+                        gSink += cell_updates->size();
+                    }
+                });
+            };
+            kernels.push_back(kernel);
+        }
+    }
+}
+
+void addCreateSbplMap(std::vector<Kernel>& kernels, KernelOptions const& options) {
+    unsigned int seed = options.mSeed;
+    Kernel kernel;
+    kernel.mName = "sbpl_create_map/" + toString(MAP_SIZE);
+    kernel.mItemsPerIteration = (uint64_t)MAP_SIZE * MAP_SIZE;
+    kernel.mSetup = [seed]() {
+        Config config = createConfig(LIB_SBPL, ENV_XY);
+        KernelMap map = createMap(MAP_SIZE, seed, config);
+        boost::shared_ptr<SbplEnvXY> sbpl(new SbplEnvXY(config));
+        return KernelFunction([map, sbpl](uint64_t iterations) {
+            for(uint64_t i=0; i < iterations; ++i) {
+                sbpl->createSBPLMap(map.mpTravGrid, map.mpTravData);
+            }
+        });
+    };
+    kernels.push_back(kernel);
+}
+
+void addGridCalculations(std::vector<Kernel>& kernels, KernelOptions const& options) {
+    const char* footprints[] = {"circle", "rectangle"};
+    const char* layers[] = {"class_bytes", "bitmap"};
+    for(unsigned int f=0; f < 2; ++f) {
+        for(unsigned int l=0; l < 2; ++l) {
+            bool circle = f == 0;
+            bool bitmap = l == 1;
+            unsigned int seed = options.mSeed;
+            Kernel kernel;
+            kernel.mName = std::string("grid_calculations_is_valid/") + footprints[f] + "/" + layers[l];
+            kernel.mItemsPerIteration = 1;
+            kernel.mSetup = [circle, bitmap, seed]() {
+                KernelMap map = createMap(MAP_SIZE, seed, Config());
+                boost::shared_ptr<GridCalculations> calc(new GridCalculations());
+                calc->setTravGrid(map.mpTravGrid, map.mpTravData, map.mpTravClassTable);
+                if(bitmap) {
+                    boost::shared_ptr<OccupancyBitmap> occupancy_bitmap(new OccupancyBitmap());
+                    occupancy_bitmap->create(*map.mpTravData, *map.mpTravClassTable);
+                    calc->setOccupancyBitmap(occupancy_bitmap);
+                }
+                // 0.3 m radius, 0.6 x 0.4 m rectangle.
+                if(circle) {
+                    calc->setFootprintCircleInGrid(3);
+                } else {
+                    calc->setFootprintRectangleInGrid(6, 4);
+                }
+                boost::shared_ptr<std::vector<int> > poses(new std::vector<int>());
+                Random random(seed + 2);
+                for(unsigned int i=0; i < NUM_INPUTS; ++i) {
+                    poses->push_back(random.range(0, MAP_SIZE - 1));
+                    poses->push_back(random.range(0, MAP_SIZE - 1));
+                    poses->push_back(random.range(0, calc->getNumStencilAngles() - 1));
+                }
+                return KernelFunction([map, calc, poses](uint64_t iterations) {
+                    std::vector<int> const& p = *poses;
+                    unsigned int num_valid = 0;
+                    for(uint64_t i=0; i < iterations; ++i) {
+                        unsigned int k = 3 * (i % NUM_INPUTS);
+                        num_valid += calc->isValid(p[k], p[k+1], p[k+2]);
+                    }
+                    gSink += num_valid;
+                });
+            };
+            kernels.push_back(kernel);
+        }
+    }
+}
+
+/**
+ * State space of the OMPL environment with the bounds of the map.
+ */
+ob::StateSpacePtr createStateSpace(enum EnvType env, Config const& config, int size) {
+    ob::RealVectorBounds bounds(2);
+    bounds.setLow(0, 0);
+    bounds.setHigh(0, size);
+    bounds.setLow(1, 0);
+    bounds.setHigh(1, size);
+    switch(env) {
+        case ENV_XYTHETA: {
+            ob::SE2StateSpace* space = new ob::SE2StateSpace();
+            space->setBounds(bounds);
+            return ob::StateSpacePtr(space);
+        }
+        case ENV_SHERPA: {
+            SherpaStateSpace* space = new SherpaStateSpace(config);
+            space->setBounds(bounds);
+            return ob::StateSpacePtr(space);
+        }
+        default: {
+            ob::RealVectorStateSpace* space = new ob::RealVectorStateSpace(2);
+            space->setBounds(bounds);
+            return ob::StateSpacePtr(space);
+        }
+    }
+}
+
+/**
+ * Uniformly sampled states and a second state within \a max_offset
+ * cells of each, which is used as end of the motion.
+ */
+struct OmplInputs {
+    ob::SpaceInformationPtr mpSpaceInformation;
+    std::vector<ob::State*> mStates;
+    std::vector<ob::State*> mMotionEnds;
+
+    ~OmplInputs() {
+        for(unsigned int i=0; i < mStates.size(); ++i) {
+            mpSpaceInformation->freeState(mStates[i]);
+            mpSpaceInformation->freeState(mMotionEnds[i]);
+        }
+    }
+};
+
+void moveState(enum EnvType env, ob::State* state, double dx, double dy) {
+    switch(env) {
+        case ENV_XYTHETA: {
+            ob::SE2StateSpace::StateType* se2 = state->as<ob::SE2StateSpace::StateType>();
+            se2->setXY(se2->getX() + dx, se2->getY() + dy);
+            break;
+        }
+        case ENV_SHERPA: {
+            SherpaStateSpace::StateType* sherpa = state->as<SherpaStateSpace::StateType>();
+            sherpa->setXY(sherpa->getX() + dx, sherpa->getY() + dy);
+            break;
+        }
+        default: {
+            ob::RealVectorStateSpace::StateType* rv = state->as<ob::RealVectorStateSpace::StateType>();
+            rv->values[0] += dx;
+            rv->values[1] += dy;
+            break;
+        }
+    }
+}
+
+boost::shared_ptr<OmplInputs> createOmplInputs(ob::SpaceInformationPtr const& si,
+        enum EnvType env, unsigned int seed, double max_offset) {
+    boost::shared_ptr<OmplInputs> inputs(new OmplInputs());
+    inputs->mpSpaceInformation = si;
+    ob::StateSamplerPtr sampler = si->allocStateSampler();
+    Random random(seed);
+    for(unsigned int i=0; i < NUM_INPUTS; ++i) {
+        ob::State* state = si->allocState();
+        sampler->sampleUniform(state);
+        ob::State* end = si->allocState();
+        si->copyState(end, state);
+        moveState(env, end, (2 * random.uniform() - 1) * max_offset,
+                (2 * random.uniform() - 1) * max_offset);
+        si->enforceBounds(end);
+        inputs->mStates.push_back(state);
+        inputs->mMotionEnds.push_back(end);
+    }
+    return inputs;
+}
+
+void addOmplKernels(std::vector<Kernel>& kernels, KernelOptions const& options) {
+    enum EnvType envs[] = {ENV_XY, ENV_XYTHETA, ENV_SHERPA};
+    const char* env_names[] = {"xy", "xytheta", "sherpa"};
+    for(unsigned int e=0; e < 3; ++e) {
+        enum EnvType env = envs[e];
+        unsigned int seed = options.mSeed;
+        Kernel validator_kernel;
+        validator_kernel.mName = std::string("trav_map_validator_is_valid/") + env_names[e];
+        validator_kernel.mItemsPerIteration = 1;
+        validator_kernel.mSetup = [env, seed]() {
+            Config config = createConfig(LIB_OMPL, env);
+            KernelMap map = createMap(MAP_SIZE, seed, config);
+            ob::SpaceInformationPtr si(new ob::SpaceInformation(
+                    createStateSpace(env, config, MAP_SIZE)));
+            boost::shared_ptr<TravMapValidator> validator(TravMapValidator::create(
+                    si, map.mpTravGrid, map.mpTravData, config, map.mpTravClassTable));
+            boost::shared_ptr<OmplInputs> inputs = createOmplInputs(si, env, seed + 3, 0.0);
+            return KernelFunction([map, validator, inputs](uint64_t iterations) {
+                unsigned int num_valid = 0;
+                for(uint64_t i=0; i < iterations; ++i) {
+                    num_valid += validator->isValid(inputs->mStates[i % NUM_INPUTS]);
+                }
+                gSink += num_valid;
+            });
+        };
+        kernels.push_back(validator_kernel);
+
+        Kernel objective_kernel;
+        objective_kernel.mName = std::string("trav_grid_objective_motion_cost/") + env_names[e];
+        objective_kernel.mItemsPerIteration = 1;
+        objective_kernel.mSetup = [env, seed]() {
+            Config config = createConfig(LIB_OMPL, env);
+            KernelMap map = createMap(MAP_SIZE, seed, config);
+            ob::SpaceInformationPtr si(new ob::SpaceInformation(
+                    createStateSpace(env, config, MAP_SIZE)));
+            boost::shared_ptr<TravGridObjective> objective(TravGridObjective::create(
+                    si, true, map.mpTravGrid, map.mpTravData, config, map.mpTravClassTable));
+            // Motions of up to one meter (Config::mMaxAllowedSampleDist of the benchmarks).
+            boost::shared_ptr<OmplInputs> inputs = createOmplInputs(si, env, seed + 4,
+                    1.0 / CELL_SIZE);
+            return KernelFunction([map, objective, inputs](uint64_t iterations) {
+                double cost = 0.0;
+                for(uint64_t i=0; i < iterations; ++i) {
+                    unsigned int k = i % NUM_INPUTS;
+#if OMPL_VERSION_VALUE > 1000000
+                    cost += objective->motionCost(inputs->mStates[k], inputs->mMotionEnds[k]).value();
+#else
+                    cost += objective->motionCost(inputs->mStates[k], inputs->mMotionEnds[k]).v;
+#endif
+                }
+                gSink += cost;
+            });
+        };
+        kernels.push_back(objective_kernel);
+    }
+}
+
+void addMotionPrimitives(std::vector<Kernel>& kernels, KernelOptions const& options) {
+    Kernel kernel;
+    kernel.mName = "sbpl_motion_primitives_create";
+    kernel.mItemsPerIteration = 1;
+    kernel.mSetup = []() {
+        Config config = createConfig(LIB_SBPL, ENV_XYTHETA);
+        MotionPrimitivesConfig prim_config(config, MAP_SIZE, MAP_SIZE, CELL_SIZE);
+        return KernelFunction([prim_config](uint64_t iterations) {
+            for(uint64_t i=0; i < iterations; ++i) {
+                SbplMotionPrimitives prims(prim_config);
+                prims.createPrimitives();
+                gSink += prims.getNumTablePrimitives();
+            }
+        });
+    };
+    kernels.push_back(kernel);
+
+    // The constructor generates the primitives.
+    unsigned int threads[] = {1, 0};
+    for(unsigned int t=0; t < 2; ++t) {
+        unsigned int num_threads = threads[t];
+        Kernel spline_kernel;
+        spline_kernel.mName = std::string("sbpl_spline_primitives_generate/") +
+                (num_threads == 0 ? "all_cores" : "single_thread");
+        spline_kernel.mItemsPerIteration = 1;
+        spline_kernel.mSetup = [num_threads]() {
+            SplinePrimitivesConfig spline_config;
+            spline_config.gridSize = CELL_SIZE;
+            spline_config.numThreads = num_threads;
+            return KernelFunction([spline_config](uint64_t iterations) {
+                for(uint64_t i=0; i < iterations; ++i) {
+                    SbplSplineMotionPrimitives prims(spline_config);
+                    gSink += prims.getPrimitiveForAngle(0).size();
+                }
+            });
+        };
+        kernels.push_back(spline_kernel);
+    }
+}
+
+void addTransformations(std::vector<Kernel>& kernels, KernelOptions const& options) {
+    for(unsigned int d=0; d < 2; ++d) {
+        bool to_grid = d == 0;
+        unsigned int seed = options.mSeed;
+        Kernel kernel;
+        kernel.mName = to_grid ? "world2grid" : "grid2world";
+        kernel.mItemsPerIteration = 1;
+        kernel.mSetup = [to_grid, seed]() {
+            Config config = createConfig(LIB_SBPL, ENV_XY);
+            KernelMap map = createMap(MAP_SIZE, seed, config);
+            boost::shared_ptr<MotionPlanningLibraries> mpl(new MotionPlanningLibraries(config));
+            boost::shared_ptr<std::vector<base::samples::RigidBodyState> > poses(
+                    new std::vector<base::samples::RigidBodyState>());
+            Random random(seed + 5);
+            double extent = to_grid ? MAP_SIZE * CELL_SIZE : MAP_SIZE;
+            for(unsigned int i=0; i < NUM_INPUTS; ++i) {
+                base::samples::RigidBodyState pose;
+                pose.setPose(base::Pose(base::Position(random.uniform() * extent,
+                        random.uniform() * extent, 0), Eigen::Quaterniond(
+                        Eigen::AngleAxisd(random.uniform() * 2 * M_PI, Eigen::Vector3d::UnitZ()))));
+                poses->push_back(pose);
+            }
+            return KernelFunction([map, mpl, poses, to_grid](uint64_t iterations) {
+                base::samples::RigidBodyState result;
+                unsigned int num_converted = 0;
+                for(uint64_t i=0; i < iterations; ++i) {
+                    base::samples::RigidBodyState const& pose = (*poses)[i % NUM_INPUTS];
+                    if(to_grid) {
+                        num_converted += MotionPlanningLibraries::world2grid(map.mpTravGrid, pose, result);
+                    } else {
+                        num_converted += mpl->grid2world(map.mpTravGrid, pose, result);
+                    }
+                }
+                gSink += num_converted;
+            });
+        };
+        kernels.push_back(kernel);
+    }
+}
+
+// MEASUREMENT
+/**
+ * Increases the number of iterations until a run takes at least the min
+ * time and measures the repetitions using this number.
+ */
+KernelResult measure(Kernel const& kernel, KernelOptions const& options) {
+    KernelFunction function = kernel.mSetup();
+    uint64_t iterations = 1;
+    while(true) {
+        double start = now(CLOCK_MONOTONIC);
+        function(iterations);
+        double elapsed = now(CLOCK_MONOTONIC) - start;
+        if(elapsed >= options.mMinTime || iterations >= (uint64_t)1e9) {
+            break;
+        }
+        // Aims slightly above the min time, at most ten times as many iterations.
+        double factor = elapsed > 0 ? 1.4 * options.mMinTime / elapsed : 10.0;
+        iterations = std::max(iterations + 1, (uint64_t)(iterations * std::min(factor, 10.0)));
+    }
+
+    std::vector<std::pair<double, double> > times; // real, cpu (ns per iteration)
+    for(unsigned int r=0; r < std::max(1u, options.mRepetitions); ++r) {
+        double start = now(CLOCK_MONOTONIC);
+        double cpu_start = now(CLOCK_PROCESS_CPUTIME_ID);
+        function(iterations);
+        double cpu = now(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+        double real = now(CLOCK_MONOTONIC) - start;
+        times.push_back(std::make_pair(real * 1e9 / iterations, cpu * 1e9 / iterations));
+    }
+    std::sort(times.begin(), times.end());
+
+    KernelResult result;
+    result.mName = kernel.mName;
+    result.mIterations = iterations;
+    result.mRealTime = times[times.size() / 2].first;
+    result.mCpuTime = times[times.size() / 2].second;
+    result.mItemsPerSecond = kernel.mItemsPerIteration * 1e9 / result.mRealTime;
+    return result;
+}
+
+/**
+ * One benchmark per line, readBaseline() depends on it.
+ */
+void writeJson(std::ostream& os, std::vector<KernelResult> const& results,
+        KernelOptions const& options) {
+    char date[64];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&t));
+    char host_name[256];
+    if(gethostname(host_name, sizeof(host_name)) != 0) {
+        host_name[0] = '\0';
+    }
+    os << "{" << std::endl;
+    os << "  \"context\": {\"date\": \"" << date << "\", "
+            << "\"host_name\": \"" << host_name << "\", "
+            << "\"executable\": \"motion_planning_libraries_kernels\", "
+            << "\"num_cpus\": " << sysconf(_SC_NPROCESSORS_ONLN) << ", "
+            << "\"min_time\": " << options.mMinTime << ", "
+            << "\"repetitions\": " << options.mRepetitions << ", "
+            << "\"seed\": " << options.mSeed << ", "
+            << "\"mpl_trace_min_level\": " << MPL_TRACE_MIN_LEVEL << ", "
+#ifdef NDEBUG
+            << "\"library_build_type\": \"release\"},"
+#else
+            << "\"library_build_type\": \"debug\"},"
+#endif
+            << std::endl;
+    os << "  \"benchmarks\": [" << std::endl;
+    for(unsigned int i=0; i < results.size(); ++i) {
+        KernelResult const& r = results[i];
+        os << "    {\"name\": \"" << r.mName << "\", "
+                << "\"run_name\": \"" << r.mName << "\", "
+                << "\"run_type\": \"iteration\", "
+                << "\"repetitions\": " << options.mRepetitions << ", "
+                << "\"threads\": 1, "
+                << "\"iterations\": " << r.mIterations << ", "
+                << "\"real_time\": " << r.mRealTime << ", "
+                << "\"cpu_time\": " << r.mCpuTime << ", "
+                << "\"time_unit\": \"ns\", "
+                << "\"items_per_second\": " << r.mItemsPerSecond << "}"
+                << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    os << "  ]" << std::endl;
+    os << "}" << std::endl;
+}
+
+/**
+ * Reads name and real time of the benchmarks written by writeJson().
+ */
+bool readBaseline(std::string const& path, std::map<std::string, double>& real_times) {
+    std::ifstream file(path.c_str());
+    if(!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    const std::string name_key = "\"name\": \"";
+    const std::string time_key = "\"real_time\": ";
+    while(std::getline(file, line)) {
+        size_t name_pos = line.find(name_key);
+        size_t time_pos = line.find(time_key);
+        if(name_pos == std::string::npos || time_pos == std::string::npos) {
+            continue;
+        }
+        name_pos += name_key.size();
+        size_t name_end = line.find('"', name_pos);
+        if(name_end == std::string::npos) {
+            continue;
+        }
+        real_times[line.substr(name_pos, name_end - name_pos)] =
+                atof(line.c_str() + time_pos + time_key.size());
+    }
+    return true;
+}
+
+/**
+ * \return False if a kernel is slower than the allowed regression.
+ */
+bool compareWithBaseline(std::vector<KernelResult> const& results,
+        std::map<std::string, double> const& baseline, double max_regression) {
+    bool passed = true;
+    for(unsigned int i=0; i < results.size(); ++i) {
+        std::map<std::string, double>::const_iterator it = baseline.find(results[i].mName);
+        if(it == baseline.end() || it->second <= 0) {
+            std::cerr << results[i].mName << ": not in the baseline" << std::endl;
+            continue;
+        }
+        double ratio = results[i].mRealTime / it->second;
+        bool regression = ratio > max_regression;
+        passed = passed && !regression;
+        fprintf(stderr, "%-50s %12.1f ns -> %12.1f ns (%+6.1f%%)%s\n", results[i].mName.c_str(),
+                it->second, results[i].mRealTime, (ratio - 1.0) * 100,
+                regression ? " REGRESSION" : "");
+    }
+    return passed;
+}
+
+bool parseOptions(int argc, char** argv, KernelOptions& options) {
+    for(int i=1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(arg == "--filter" && has_value) {
+            options.mFilter = argv[++i];
+        } else if(arg == "--min-time" && has_value) {
+            options.mMinTime = atof(argv[++i]);
+        } else if(arg == "--repetitions" && has_value) {
+            options.mRepetitions = atoi(argv[++i]);
+        } else if(arg == "--seed" && has_value) {
+            options.mSeed = atoi(argv[++i]);
+        } else if(arg == "--output" && has_value) {
+            options.mOutput = argv[++i];
+        } else if(arg == "--baseline" && has_value) {
+            options.mBaseline = argv[++i];
+        } else if(arg == "--max-regression" && has_value) {
+            options.mMaxRegression = atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <sec>] "
+                    "[--repetitions <n>] [--seed <n>] [--output <file>] "
+                    "[--baseline <file> [--max-regression <factor>]]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv)
+{
+    KernelOptions options;
+    if(!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if(!options.mBaseline.empty() && !readBaseline(options.mBaseline, baseline)) {
+        std::cerr << "Baseline " << options.mBaseline << " could not be read" << std::endl;
+        return 1;
+    }
+
+    std::vector<Kernel> kernels;
+    addCollectCellUpdates(kernels, options);
+    addCreateSbplMap(kernels, options);
+    addGridCalculations(kernels, options);
+    addOmplKernels(kernels, options);
+    addMotionPrimitives(kernels, options);
+    addTransformations(kernels, options);
+
+    std::vector<KernelResult> results;
+    for(unsigned int i=0; i < kernels.size(); ++i) {
+        if(kernels[i].mName.find(options.mFilter) == std::string::npos) {
+            continue;
+        }
+        std::cerr << "[" << i+1 << "/" << kernels.size() << "] " << kernels[i].mName << std::endl;
+        results.push_back(measure(kernels[i], options));
+    }
+
+    std::ofstream file;
+    if(!options.mOutput.empty()) {
+        file.open(options.mOutput.c_str());
+        if(!file.is_open()) {
+            std::cerr << "Output file " << options.mOutput << " could not be opened" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& os = file.is_open() ? file : std::cout;
+    writeJson(os, results, options);
+
+    if(!baseline.empty() && !compareWithBaseline(results, baseline, options.mMaxRegression)) {
+        return 2;
+    }
+    return 0;
+}
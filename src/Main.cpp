@@ -3,15 +3,47 @@
 
 #include <motion_planning_libraries/MotionPlanningLibraries.hpp>
 #include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/PlanningProblem.hpp>
 #include <motion_planning_libraries/sbpl/SbplMotionPrimitives.hpp>
 
 #include <envire/core/Environment.hpp>
 #include <envire/maps/TraversabilityGrid.hpp>
 
+/**
+ * Replays a stored planning problem (see PlanningProblem) with its own configuration.
+ */
+int replayProblem(std::string const& path, double max_time)
+{
+    using namespace motion_planning_libraries;
+
+    PlanningProblem problem;
+    if(!problem.load(path)) {
+        std::cout << path << " could not be loaded" << std::endl;
+        return 1;
+    }
+    MotionPlanningLibraries mpl(problem.getConfig());
+    double cost = 0;
+    if(!mpl.setProblem(problem) || !mpl.plan(max_time, cost)) {
+        std::cout << "Problem " << path << " could not be solved" << std::endl;
+        return 1;
+    }
+    std::cout << "Problem " << path << " solved, cost " << cost << std::endl;
+    mpl.printPathInWorld();
+    return 0;
+}
+
+/**
+ * motion_planning_libraries_bin [<problem file> [<max time sec>]]
+ * Without arguments a SBPL XYTHETA example is planned.
+ */
 int main(int argc, char** argv)
 {
     using namespace motion_planning_libraries;
 
+    if(argc > 1) {
+        return replayProblem(argv[1], argc > 2 ? atof(argv[2]) : 10.0);
+    }
+
     Config conf;
     conf.mPlanningLibType = motion_planning_libraries::PlanningLibraryType::LIB_SBPL;
     conf.mEnvType = motion_planning_libraries::ENV_XYTHETA;
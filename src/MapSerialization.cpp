@@ -0,0 +1,87 @@
+#include "MapSerialization.hpp"
+
+namespace motion_planning_libraries
+{
+
+bool MapFileGeometry::fromTravGrid(envire::TraversabilityGrid const* trav_grid) {
+    if(trav_grid->getEnvironment() == NULL) {
+        return false;
+    }
+    mCellSizeX = trav_grid->getCellSizeX();
+    mCellSizeY = trav_grid->getCellSizeY();
+    mScaleX = trav_grid->getScaleX();
+    mScaleY = trav_grid->getScaleY();
+    mOffsetX = trav_grid->getOffsetX();
+    mOffsetY = trav_grid->getOffsetY();
+    Eigen::Affine3d local2world = trav_grid->getEnvironment()->relativeTransform(
+            trav_grid->getFrameNode(), trav_grid->getEnvironment()->getRootNode());
+    memcpy(mLocal2World, local2world.matrix().data(), sizeof(mLocal2World));
+    for(unsigned int i = 0; i < TravClassTable::NUM_CLASSES; ++i) {
+        mDriveability[i] = trav_grid->getTraversabilityClass((uint8_t)i).getDrivability();
+    }
+    return true;
+}
+
+envire::TraversabilityGrid* MapFileGeometry::createTravGrid(envire::Environment* env,
+        std::string const& map_id) const {
+    envire::TraversabilityGrid* trav = new envire::TraversabilityGrid(
+            mCellSizeX, mCellSizeY, mScaleX, mScaleY, mOffsetX, mOffsetY);
+    trav->setUniqueId(map_id);
+    env->attachItem(trav);
+    envire::FrameNode* frame_node = new envire::FrameNode();
+    env->getRootNode()->addChild(frame_node);
+    trav->setFrameNode(frame_node);
+    applyTo(trav);
+    return trav;
+}
+
+void MapFileGeometry::applyTo(envire::TraversabilityGrid* trav_grid) const {
+    for(unsigned int i = 0; i < TravClassTable::NUM_CLASSES; ++i) {
+        trav_grid->setTraversabilityClass(i, envire::TraversabilityClass(mDriveability[i]));
+    }
+    Eigen::Affine3d local2world;
+    memcpy(local2world.matrix().data(), mLocal2World, sizeof(mLocal2World));
+    trav_grid->getFrameNode()->setTransform(local2world);
+}
+
+void StateFileData::fromState(State const& state) {
+    memset(this, 0, sizeof(StateFileData));
+    mStateType = (int32_t)state.mStateType;
+    mNumJoints = state.mJointAngles.size();
+    mFootprintRadius = state.mFootprintRadius;
+    if(state.mStateType == STATE_POSE) {
+        for(int i = 0; i < 3; ++i) {
+            mPosition[i] = state.mPose.position[i];
+        }
+        mOrientation[0] = state.mPose.orientation.x();
+        mOrientation[1] = state.mPose.orientation.y();
+        mOrientation[2] = state.mPose.orientation.z();
+        mOrientation[3] = state.mPose.orientation.w();
+    }
+}
+
+State StateFileData::toState(const double* joint_angles) const {
+    State state;
+    switch(mStateType) {
+        case STATE_POSE: {
+            base::samples::RigidBodyState rbs;
+            rbs.setPose(base::Pose(
+                    base::Position(mPosition[0], mPosition[1], mPosition[2]),
+                    base::Orientation(mOrientation[3], mOrientation[0],
+                            mOrientation[1], mOrientation[2])));
+            state = State(rbs, mFootprintRadius);
+            break;
+        }
+        case STATE_ARM: {
+            state = State(std::vector<double>(joint_angles, joint_angles + mNumJoints));
+            state.mFootprintRadius = mFootprintRadius;
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return state;
+}
+
+} // end namespace motion_planning_libraries
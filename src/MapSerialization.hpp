@@ -0,0 +1,229 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_MAP_SERIALIZATION_HPP_
+#define _MOTION_PLANNING_LIBRARIES_MAP_SERIALIZATION_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <envire/core/Environment.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+
+#include "Config.hpp"
+#include "State.hpp"
+#include "TravClassTable.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Building blocks of the binary files (PlanningProblem, PlanningRecorder).
+ * All blocks use the native byte order, the files are not meant to be
+ * exchanged between different architectures.
+ */
+
+/**
+ * Size, scale, offset, frame (within the world) and the class driveabilities of a map.
+ */
+struct MapFileGeometry {
+    uint32_t mCellSizeX, mCellSizeY;
+    double mScaleX, mScaleY;
+    double mOffsetX, mOffsetY;
+    // Frame of the map within the world (column-major 4x4 matrix).
+    double mLocal2World[16];
+    double mDriveability[TravClassTable::NUM_CLASSES];
+
+    inline uint64_t getNumCells() const {
+        return (uint64_t)mCellSizeX * mCellSizeY;
+    }
+
+    /**
+     * \return False if the map is not part of an environment.
+     */
+    bool fromTravGrid(envire::TraversabilityGrid const* trav_grid);
+
+    /**
+     * Creates a map without band contents and attaches it as \a map_id to
+     * \a env using its own frame node below the root.
+     */
+    envire::TraversabilityGrid* createTravGrid(envire::Environment* env,
+            std::string const& map_id) const;
+
+    /**
+     * Updates the frame and the classes of a map created by createTravGrid().
+     */
+    void applyTo(envire::TraversabilityGrid* trav_grid) const;
+};
+
+/**
+ * Start or goal state, the joint angles are stored separately.
+ */
+struct StateFileData {
+    int32_t mStateType;
+    uint32_t mNumJoints;
+    double mPosition[3];
+    double mOrientation[4]; // x, y, z, w
+    double mFootprintRadius;
+
+    void fromState(State const& state);
+    State toState(const double* joint_angles) const;
+};
+
+/**
+ * Appends the fields to a buffer, see serializeConfig().
+ */
+class ConfigWriter {
+ public:
+    std::vector<char> mBuffer;
+
+    template <class T>
+    void field(T const& value) {
+        const char* data = reinterpret_cast<const char*>(&value);
+        mBuffer.insert(mBuffer.end(), data, data + sizeof(T));
+    }
+
+    void field(std::string const& value) {
+        field((uint32_t)value.size());
+        mBuffer.insert(mBuffer.end(), value.begin(), value.end());
+    }
+
+    void field(std::vector<MinMaxValue> const& values) {
+        field((uint32_t)values.size());
+        std::vector<MinMaxValue>::const_iterator it = values.begin();
+        for(; it != values.end(); ++it) {
+            field(it->first);
+            field(it->second);
+        }
+    }
+};
+
+/**
+ * Reads the fields from a buffer, see serializeConfig(). If the
+ * buffer is too short isValid() returns false.
+ */
+class ConfigReader {
+ public:
+    ConfigReader(const char* data, size_t size) : mpData(data), mSize(size), mPos(0), mValid(true) {
+    }
+
+    template <class T>
+    void field(T& value) {
+        if(!available(sizeof(T))) {
+            return;
+        }
+        memcpy(&value, mpData + mPos, sizeof(T));
+        mPos += sizeof(T);
+    }
+
+    void field(std::string& value) {
+        uint32_t size = 0;
+        field(size);
+        if(!available(size)) {
+            return;
+        }
+        value.assign(mpData + mPos, size);
+        mPos += size;
+    }
+
+    void field(std::vector<MinMaxValue>& values) {
+        uint32_t size = 0;
+        field(size);
+        values.clear();
+        for(uint32_t i = 0; i < size && mValid; ++i) {
+            MinMaxValue value;
+            field(value.first);
+            field(value.second);
+            values.push_back(value);
+        }
+    }
+
+    inline bool isValid() const {
+        return mValid;
+    }
+
+ private:
+    bool available(size_t size) {
+        if(!mValid || mPos + size > mSize) {
+            mValid = false;
+        }
+        return mValid;
+    }
+
+    const char* mpData;
+    size_t mSize;
+    size_t mPos;
+    bool mValid;
+};
+
+// Has to be increased if serializeConfig() is changed.
+const uint32_t CONFIG_SERIALIZATION_VERSION = 9;
+
+/**
+ * Single field list for writing and reading, new Config members have to be
+ * added here and CONFIG_SERIALIZATION_VERSION has to be increased.
+ */
+template <class Archive, class ConfigType>
+void serializeConfig(Archive& ar, ConfigType& config) {
+    ar.field(config.mPlanningLibType);
+    ar.field(config.mEnvType);
+    ar.field(config.mPlanner);
+    ar.field(config.mSearchUntilFirstSolution);
+    ar.field(config.mReplanning.mReplanDuringEachUpdate);
+    ar.field(config.mReplanning.mReplanOnNewStartPose);
+    ar.field(config.mReplanning.mReplanOnNewGoalPose);
+    ar.field(config.mReplanning.mReplanOnNewMap);
+    ar.field(config.mReplanning.mReplanOnlyIfPathAffected);
+    ar.field(config.mReplanning.mReplanMinDistStartGoal);
+    ar.field(config.mNumBatchThreads);
+    ar.field(config.mShiftScrollingMap);
+    ar.field(config.mPostProcessPath);
+    ar.field(config.mEndToEndDeadline);
+    ar.field(config.mRecordFile);
+    ar.field(config.mRecordMaxSize);
+    ar.field(config.mRandomSeed);
+    ar.field(config.mMobility.mSpeed);
+    ar.field(config.mMobility.mTurningSpeed);
+    ar.field(config.mMobility.mMinTurningRadius);
+    ar.field(config.mMobility.mMultiplierForward);
+    ar.field(config.mMobility.mMultiplierBackward);
+    ar.field(config.mMobility.mMultiplierLateral);
+    ar.field(config.mMobility.mMultiplierForwardTurn);
+    ar.field(config.mMobility.mMultiplierBackwardTurn);
+    ar.field(config.mMobility.mMultiplierPointTurn);
+    ar.field(config.mMobility.mMultiplierLateralCurve);
+    ar.field(config.mFootprintRadiusMinMax.first);
+    ar.field(config.mFootprintRadiusMinMax.second);
+    ar.field(config.mFootprintLengthMinMax.first);
+    ar.field(config.mFootprintLengthMinMax.second);
+    ar.field(config.mFootprintWidthMinMax.first);
+    ar.field(config.mFootprintWidthMinMax.second);
+    ar.field(config.mNumFootprintClasses);
+    ar.field(config.mTimeToAdaptFootprint);
+    ar.field(config.mAdaptFootprintPenalty);
+    ar.field(config.mMaxAllowedSampleDist);
+    ar.field(config.mUseObstacleDistanceMap);
+    ar.field(config.mLazyCollisionChecking);
+    ar.field(config.mNumParallelPlanners);
+    ar.field(config.mUseCostToGoField);
+    ar.field(config.mOmplWarmStart);
+    ar.field(config.mSBPLEnvFile);
+    ar.field(config.mSBPLMotionPrimitivesFile);
+    ar.field(config.mSBPLMotionPrimitivesCacheDir);
+    ar.field(config.mSBPLForwardSearch);
+    ar.field(config.mSBPLCoarseFactor);
+    ar.field(config.mSBPLCorridorWidth);
+    ar.field(config.mSBPLDeferUpdateDist);
+    ar.field(config.mSBPLInflateObstacles);
+    ar.field(config.mNumIntermediatePoints);
+    ar.field(config.mNumPrimPartition);
+    ar.field(config.mPrimAccuracy);
+    ar.field(config.mSymmetricPrimitives);
+    ar.field(config.mEscapeTrajRadiusFactor);
+    ar.field(config.mJointBorders);
+    ar.field(config.mArmValidityCacheResolution);
+}
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_MAP_SERIALIZATION_HPP_
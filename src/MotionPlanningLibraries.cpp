@@ -1,6 +1,14 @@
 #include "MotionPlanningLibraries.hpp"
 
+#include <string.h>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include <base/Time.hpp>
+
 #include "Helpers.hpp"
+#include "TraceLog.hpp"
 
 #include <motion_planning_libraries/sbpl/SbplEnvXY.hpp>
 #include <motion_planning_libraries/sbpl/SbplEnvXYTHETA.hpp>
@@ -12,19 +20,62 @@
 namespace motion_planning_libraries
 {
 
+namespace {
+// Class of the inflated cells within the cost field map, the SBPL costs
+// do not exceed TravClassTable::SBPL_MAX_COST + 1.
+const uint8_t COST_FIELD_BLOCKED = 255;
+// Distance in meter between the points of a trajectory which are checked for the escape trajectory.
+const double ESCAPE_SAMPLE_DIST = 0.1;
+// Time in seconds which is at least passed to solve() by a plan() call 
+// with an overrun deadline (Config::mEndToEndDeadline).
+const double MIN_SOLVE_TIME = 0.005;
+}
+
 // PUBLIC
 MotionPlanningLibraries::MotionPlanningLibraries(Config config) : 
         mConfig(config),
         mpTravGrid(NULL), 
         mpTravData(),
-        mpLastTravGrid(NULL),
+        mpProbData(),
+        mpLastTravData(),
+        mpLastProbData(),
+        mpTravClassTable(),
+        mpSharedMap(),
+        mCellUpdates(),
+        mCellUpdateSpans(),
+        mGrid2World(Eigen::Affine3d::Identity()),
+        mGrid2WorldValid(false),
+        mLocal2World(Eigen::Affine3d::Identity()),
+        mWorld2Local(Eigen::Affine3d::Identity()),
         mStartState(), mGoalState(), 
         mStartStateGrid(), mGoalStateGrid(), 
         mPlannedPathInWorld(),
+        mPathBuffer(),
+        mPathCells(),
+        mPathCellsPending(false),
+        mTrajectoriesValid(false),
+        mTrajectoriesInWorld(),
+        mTrajectorySamples(),
+        mEscapeDistanceMap(),
+        mpSharedEscapeDistanceMap(),
+        mPathPostProcessor(config),
+        mCostField(),
+        mCostFieldMap(),
+        mCostFieldDistanceMap(),
         mReplanRequired(false),
         mNewGoalReceived(false),
         mLostX(0.0),
         mLostY(0.0),
+        mGoalCandidates(),
+        mAsyncThread(),
+        mAsyncCancel(false),
+        mAsyncRunning(false),
+        mAsyncMutex(),
+        mpLatestSolution(),
+        mStatistics(),
+        mpRecorder(),
+        mRecordCellUpdates(),
+        mRecordCellUpdateSpans(),
         mError(MPL_ERR_NONE) {
             
     // Do some checks.
@@ -36,60 +87,15 @@ MotionPlanningLibraries::MotionPlanningLibraries(Config config) :
         std::isnan(mConfig.mFootprintWidthMinMax.first) &&
         std::isnan(mConfig.mFootprintWidthMinMax.second)) {
         LOG_ERROR("No footprint available, either a radius or width/length have to be defined");
-        throw new std::runtime_error("No footprint has been defined");
+        throw std::runtime_error("No footprint has been defined");
     }
 
     // Creates the requested planning library.  
-    switch(config.mPlanningLibType) {
-        case LIB_SBPL: {
-            switch(config.mEnvType) {
-                case ENV_XY: {
-                    mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>
-                            (new SbplEnvXY(config));    
-                    break;
-                }
-                case ENV_XYTHETA: {
-                    mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>
-                            (new SbplEnvXYTHETA(config)); 
-                    break;
-                }
-                default: {
-                    LOG_ERROR("Environment is not available in SBPL");
-                    throw new std::runtime_error("Environment not available in SBPL");
-                }
-            }
-            break;    
-        }    
-        case LIB_OMPL: {
-            switch(config.mEnvType) {
-                case ENV_XY: {
-                    mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>
-                            (new OmplEnvXY(config));    
-                    break;
-                }
-                case ENV_XYTHETA: {
-                    mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>
-                            (new OmplEnvXYTHETA(config));    
-                    break;
-                }
-                case ENV_ARM: {
-                    mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>
-                            (new OmplEnvARM(config));    
-                    break;
-                }
-                case ENV_SHERPA: {
-                    mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>
-                            (new OmplEnvSHERPA(config));    
-                    break;
-                }
-                //mpPlanningLib = boost::shared_ptr<AbstractMotionPlanningLibrary>(new Ompl(config));
-                default: {
-                    LOG_ERROR("Environment is not available in OMPL");
-                    throw new std::runtime_error("Environment not available in OMPL");
-                }
-            }
-            break;
-        }
+    mpPlanningLib = createPlanningLibrary(mConfig);
+    
+    if(!mConfig.mRecordFile.empty()) {
+        mpRecorder = boost::shared_ptr<PlanningRecorder>(new PlanningRecorder(mConfig));
+        LOG_INFO("Calls are recorded to %s", mConfig.mRecordFile.c_str());
     }
     
     // Currently the arm environment will be initialized just once.
@@ -103,21 +109,94 @@ MotionPlanningLibraries::MotionPlanningLibraries(Config config) :
 }
 
 MotionPlanningLibraries::~MotionPlanningLibraries() {
+    cancelAsync();
 }
 
+// The public calls are recorded (Config::mRecordFile), setTravGrid() sets
+// the old start and goal again using the internal methods.
 bool MotionPlanningLibraries::setTravGrid(envire::Environment* env, std::string trav_map_id) {
+    base::Time start_t = base::Time::now();
+    struct MapUpdateInfo update;
+    bool map_set = setTravGridInternal(env, trav_map_id, update);
+    if(mpRecorder != NULL && update.mpTravGrid != NULL) {
+        recordMap(update, map_set, (base::Time::now() - start_t).toSeconds());
+    }
+    return map_set;
+}
 
-    if(mpPlanningLib == NULL) {
-        LOG_WARN("Planning library has not been allocated yet");
+bool MotionPlanningLibraries::setTravGrid(boost::shared_ptr<SharedMap> shared_map) {
+    if(shared_map == NULL || shared_map->getTravGrid() == NULL) {
+        LOG_WARN("Shared map does not contain a traversability map");
         return false;
     }
+    base::Time start_t = base::Time::now();
+    struct MapUpdateInfo update;
+    mpSharedMap = shared_map;
+    bool map_set = setTravGridInternal(shared_map->getTravGrid(), shared_map.get(), update);
+    if(mpRecorder != NULL && update.mpTravGrid != NULL) {
+        recordMap(update, map_set, (base::Time::now() - start_t).toSeconds());
+    }
+    return map_set;
+}
+
+bool MotionPlanningLibraries::setStartState(struct State new_state) {
+    base::Time start_t = base::Time::now();
+    bool state_set = setStartStateInternal(new_state);
+    if(mpRecorder != NULL) {
+        mpRecorder->recordState(RECORD_START, new_state, 0, state_set, mError,
+                (base::Time::now() - start_t).toSeconds());
+        recordKeyframeIfRequired();
+    }
+    return state_set;
+}
+
+bool MotionPlanningLibraries::setGoalState(struct State new_state, bool reset) {
+    base::Time start_t = base::Time::now();
+    bool state_set = setGoalStateInternal(new_state, reset);
+    if(mpRecorder != NULL) {
+        mpRecorder->recordState(RECORD_GOAL, new_state, reset ? RECORD_FLAG_RESET : 0,
+                state_set, mError, (base::Time::now() - start_t).toSeconds());
+        recordKeyframeIfRequired();
+    }
+    return state_set;
+}
+
+bool MotionPlanningLibraries::plan(double max_time, double& cost) {
+    base::Time start_t = base::Time::now();
+    bool solved = planInternal(max_time, cost);
+    mStatistics.mPlanTime = (base::Time::now() - start_t).toSeconds();
+    mStatistics.mNumTraceRecords = TraceLog::getInstance().getNumRecords();
+    mStatistics.mNumTraceDropped = TraceLog::getInstance().getNumDropped();
+    if(mpRecorder != NULL) {
+        mpRecorder->recordPlan(max_time, solved ? cost : nan(""), solved, mError,
+                mStatistics.mPlanTime);
+        recordKeyframeIfRequired();
+    }
+    return solved;
+}
+
+bool MotionPlanningLibraries::setTravGridInternal(envire::Environment* env, 
+        std::string trav_map_id, struct MapUpdateInfo& update) {
     envire::TraversabilityGrid* trav_grid = extractTravGrid(env, trav_map_id);
     if(trav_grid == NULL) {
         LOG_WARN("Traversability map could not be extracted");
         return false;
     } 
+    mpSharedMap.reset();
+    return setTravGridInternal(trav_grid, NULL, update);
+}
+
+bool MotionPlanningLibraries::setTravGridInternal(envire::TraversabilityGrid* trav_grid, 
+        SharedMap* shared_map, struct MapUpdateInfo& update) {
+    // The planning library must not be modified during an asynchronous planning.
+    cancelAsync();
+
+    if(mpPlanningLib == NULL) {
+        LOG_WARN("Planning library has not been allocated yet");
+        return false;
+    }
     
-    LOG_INFO("Received Trav Map: Number of cells (%d, %d), cell size in meter (%4.2f, %4.2f), offset (%4.2f, %4.2f)", 
+    MPL_TRACE_INFO("Received Trav Map: Number of cells (%d, %d), cell size in meter (%4.2f, %4.2f), offset (%4.2f, %4.2f)", 
             trav_grid->getCellSizeX(), trav_grid->getCellSizeY(), 
             trav_grid->getScaleX(), trav_grid->getScaleY(), 
             trav_grid->getOffsetX(), trav_grid->getOffsetY());
@@ -131,45 +210,133 @@ bool MotionPlanningLibraries::setTravGrid(envire::Environment* env, std::string
     
     // If the map size has not changed, partial updates are possible.
     bool different_map_size = true;
-    if(mpLastTravGrid != NULL) {
-        different_map_size = mpTravGrid->getWidth() != mpLastTravGrid->getWidth() ||
-            mpTravGrid->getHeight() != mpLastTravGrid->getHeight();
-        LOG_INFO("Trav map sizes are different: %s", different_map_size ? "true" : "false");
+    if(mpTravData != NULL) {
+        different_map_size = mpTravData->shape()[0] != trav_grid->getCellSizeY() ||
+            mpTravData->shape()[1] != trav_grid->getCellSizeX();
+        MPL_TRACE_INFO("Trav map sizes are different: %d", different_map_size);
     }
     
-    std::vector<CellUpdate> cell_updates;
+    // Copies the two relevant bands of the new map into the buffers of the 
+    // previous-but-one map and swaps them afterwards. So the last snapshots 
+    // still contain the previous map which is used for partial update testing.
+    // The snapshots of a shared map are used directly, the previous ones are 
+    // kept, so the shared map does not overwrite them.
+    base::Time start_t = base::Time::now();
+    if(shared_map != NULL) {
+        mpLastTravData = mpTravData;
+        mpLastProbData = mpProbData;
+        mpTravData = shared_map->getTravData();
+        mpProbData = shared_map->getProbData();
+    } else {
+        copyToSnapshot(trav_grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY), 
+                mpLastTravData);
+        copyToSnapshot(trav_grid->getGridData(envire::TraversabilityGrid::PROBABILITY), 
+                mpLastProbData);
+        mpTravData.swap(mpLastTravData);
+        mpProbData.swap(mpLastProbData);
+    }
+    mStatistics.mMapCopyTime = (base::Time::now() - start_t).toSeconds();
+    update.mpTravGrid = trav_grid;
+    
+    // The traversability classes may change with each map, so the lookup table 
+    // is rebuilt and shared with the planning library.
+    if(shared_map != NULL) {
+        mpTravClassTable = shared_map->getTravClassTable(mConfig);
+    } else {
+        mpTravClassTable = boost::shared_ptr<TravClassTable>(new TravClassTable(trav_grid, mConfig));
+    }
+    mpPlanningLib->setTravClassTable(mpTravClassTable);
+    mpPlanningLib->setTravGrid(trav_grid, mpTravData);
+    
+    mCellUpdates.clear();
+    mCellUpdateSpans.clear();
     // Tests if partialUpdates are supported by the planning library (empty vector should return true).
-    bool partial_update_implemented = mpPlanningLib->partialMapUpdate(cell_updates);
+    bool partial_update_implemented = mpPlanningLib->partialMapUpdate(mCellUpdates);
     bool partial_update_successful = false;
+    
+    // A scrolling map is shifted within the planning library, only the 
+    // exposed and the changed cells have to be applied.
+    Eigen::Affine3d local2world = getLocal2World(trav_grid);
+    Eigen::Affine3d grid2world = getGrid2World(trav_grid, local2world);
+    int shift_x = 0, shift_y = 0;
+    if(!different_map_size && mConfig.mShiftScrollingMap && 
+            getMapShift(grid2world, shift_x, shift_y) && (shift_x != 0 || shift_y != 0)) {
+        start_t = base::Time::now();
+        collectMapDiff(shared_map, shift_x, shift_y);
+        mStatistics.mCellDiffTime = (base::Time::now() - start_t).toSeconds();
+        mStatistics.mNumCellUpdates = mCellUpdates.size();
+        
+        start_t = base::Time::now();
+        partial_update_successful = mpPlanningLib->shiftMap(shift_x, shift_y, mCellUpdates);
+        mStatistics.mPartialUpdateTime = (base::Time::now() - start_t).toSeconds();
+        if(partial_update_successful) {
+            MPL_TRACE_INFO("Map has been shifted by (%d, %d) cells", shift_x, shift_y);
+            update.mSpansValid = true;
+            update.mShiftX = shift_x;
+            update.mShiftY = shift_y;
+        } else {
+            LOG_INFO("Map shift is not supported, the map is updated cell by cell");
+            mCellUpdates.clear();
+            mCellUpdateSpans.clear();
+        }
+    }
+    
     // Execute the partial update.
-    if(!different_map_size && partial_update_implemented) {
-        collectCellUpdates(mpLastTravGrid, mpTravGrid, cell_updates);
-        partial_update_successful = mpPlanningLib->partialMapUpdate(cell_updates);
+    if(!partial_update_successful && !different_map_size && partial_update_implemented) {
+        start_t = base::Time::now();
+        collectMapDiff(shared_map, 0, 0);
+        mStatistics.mCellDiffTime = (base::Time::now() - start_t).toSeconds();
+        mStatistics.mNumCellUpdates = mCellUpdates.size();
+        
+        start_t = base::Time::now();
+        partial_update_successful = mpPlanningLib->partialMapUpdate(mCellUpdates);
+        mStatistics.mPartialUpdateTime = (base::Time::now() - start_t).toSeconds();
         if(!partial_update_successful) {
              LOG_WARN("A complete initialization will be executed, a partial update failed");
+             mCellUpdateSpans.clear();
+        } else {
+            update.mSpansValid = true;
         }
     }
     
-    mpTravGrid = trav_grid;
-    // Creates a copy of the new grid data.
-    mpTravData = boost::shared_ptr<TravData>(new TravData(
-            trav_grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY)));
-    
-    // Stores last trav map for partial update testing.
-    if(mpLastTravGrid != NULL) {
-        delete mpLastTravGrid;
-        mpLastTravGrid = NULL;
+    // The path cells belong to the previous grid.
+    if(!update.mSpansValid || update.mShiftX != 0 || update.mShiftY != 0 ||
+            !mGrid2WorldValid || !mGrid2World.isApprox(grid2world)) {
+        mPathCells.clear();
+        mPathCellsPending = false;
     }
-    mpLastTravGrid = new envire::TraversabilityGrid(*mpTravGrid);
-    //envire::TraversabilityGrid grid = *mpTravGrid;
     
+    mpTravGrid = trav_grid;
+    mGrid2World = grid2world;
+    mGrid2WorldValid = true;
+    mLocal2World = local2world;
+    mWorld2Local = local2world.inverse();
+    mStatistics.mPartialUpdate = partial_update_successful;
+    
+    // The clearance of the escape trajectory is only maintained once it has been used,
+    // otherwise it is recreated by the next escape request. A shared one is
+    // requested again.
+    mpSharedEscapeDistanceMap.reset();
+    if(!mEscapeDistanceMap.empty()) {
+        bool updated = update.mSpansValid && update.mShiftX == 0 && update.mShiftY == 0 &&
+                mEscapeDistanceMap.update(*mpTravData, *mpTravClassTable, mCellUpdates);
+        if(!updated) {
+            mEscapeDistanceMap = ObstacleDistanceMap();
+        }
+    }
     
     // Reinitialize the complete planning environment.
     // Will be used if the partial update has not been implemented or could not be executed.
-    if(!partial_update_successful && !mpPlanningLib->initialize(mpTravGrid, mpTravData)) {
-        LOG_WARN("Initialization (navigation) failed"); 
-        mError = MPL_ERR_INITIALIZE_MAP;
-        return false;
+    if(!partial_update_successful) {
+        start_t = base::Time::now();
+        bool initialized = mpPlanningLib->initialize(mpTravGrid, mpTravData);
+        mStatistics.mInitializeTime = (base::Time::now() - start_t).toSeconds();
+        mpPlanningLib->fillStatistics(mStatistics);
+        if(!initialized) {
+            LOG_WARN("Initialization (navigation) failed"); 
+            mError = MPL_ERR_INITIALIZE_MAP;
+            return false;
+        }
     }
     
     // Reset current start and goal state within the new environment if they are valid!
@@ -177,7 +344,7 @@ bool MotionPlanningLibraries::setTravGrid(envire::Environment* env, std::string
     // the old start and goal pose have to be transformed into the grid again.
     // The boolean in setGoalState() prevents an unwanted replanning.
     if(mStartState.hasValidPosition() && mGoalState.hasValidPosition()) {
-        if(!setStartState(mStartState) || !setGoalState(mGoalState, true)) {
+        if(!setStartStateInternal(mStartState) || !setGoalStateInternal(mGoalState, true)) {
             LOG_ERROR("Old start and goal pose could not be transformed into the new environment");
             mError = MPL_ERR_SET_START_GOAL;
             return false;
@@ -191,13 +358,23 @@ bool MotionPlanningLibraries::setTravGrid(envire::Environment* env, std::string
         
         // Replanning without valid start/goal is not necessary.
         if(mConfig.mReplanning.mReplanOnNewMap) {
-            mReplanRequired = true;
+            if(mPathCellsPending) {
+                updatePathCells();
+            }
+            if(mConfig.mReplanning.mReplanOnlyIfPathAffected && !mPathCells.empty() &&
+                    !isPathAffected(mCellUpdates)) {
+                MPL_TRACE_INFO("%d changed cells do not touch the current path, replanning is not required",
+                        mCellUpdates.size());
+            } else {
+                mReplanRequired = true;
+            }
         }
     }
     return true;
 }
 
-bool MotionPlanningLibraries::setStartState(struct State new_state) {
+bool MotionPlanningLibraries::setStartStateInternal(struct State new_state) {
+    cancelAsync();
     if(mpPlanningLib == NULL) {
         LOG_WARN("Planning library has not been allocated yet");
         return false;
@@ -222,7 +399,7 @@ bool MotionPlanningLibraries::setStartState(struct State new_state) {
             
             // Start
             base::samples::RigidBodyState new_grid;
-            if(!world2grid(mpTravGrid, new_state.getPose(), new_grid)) {
+            if(!world2grid(mpTravGrid, mWorld2Local, new_state.getPose(), new_grid, NULL, NULL)) {
                 LOG_WARN("Start pose could not be transformed into the grid");
                 return false;
             }
@@ -247,7 +424,10 @@ bool MotionPlanningLibraries::setStartState(struct State new_state) {
         goal_state_grid = mStartStateGrid;
     }
     
-    if(!mpPlanningLib->setStartGoal(mStartStateGrid, goal_state_grid)) {
+    base::Time start_t = base::Time::now();
+    bool start_goal_set = mpPlanningLib->setStartGoal(mStartStateGrid, goal_state_grid);
+    mStatistics.mSetStartGoalTime = (base::Time::now() - start_t).toSeconds();
+    if(!start_goal_set) {
             LOG_WARN("Start/goal state could not be set");
             mError = MPL_ERR_SET_START_GOAL;
             return false;
@@ -261,13 +441,48 @@ bool MotionPlanningLibraries::setStartState(struct State new_state) {
     return true;
 }
 
-bool MotionPlanningLibraries::setGoalState(struct State new_state, bool reset) {
+bool MotionPlanningLibraries::setGoalStateInternal(struct State new_state, bool reset) {
+    cancelAsync();
     if(mpPlanningLib == NULL) {
         LOG_WARN("Planning library has not been allocated yet");
         return false;
     }
     
-    switch (new_state.getStateType()) {
+    struct GoalCandidate goal;
+    if(!convertGoal(new_state, goal)) {
+        return false;
+    }
+    setGoalCandidate(goal);
+    
+    // If required create dummy start state (a goal copy).
+    State start_state_grid;
+    if(startStateAvailable()) {
+        start_state_grid = mStartStateGrid;
+    } else {
+        start_state_grid = mGoalStateGrid;
+    }
+    
+    base::Time start_t = base::Time::now();
+    bool start_goal_set = mpPlanningLib->setStartGoal(start_state_grid, mGoalStateGrid);
+    mStatistics.mSetStartGoalTime = (base::Time::now() - start_t).toSeconds();
+    if(!start_goal_set) {
+            LOG_WARN("Start/goal state could not be set");
+            mError = MPL_ERR_SET_START_GOAL;
+            return false;
+    }
+    
+    if(!reset) {
+        if(mConfig.mReplanning.mReplanOnNewGoalPose) {
+            mReplanRequired = true;
+        }  
+        mNewGoalReceived = true;
+    }
+        
+    return true;
+}
+
+bool MotionPlanningLibraries::convertGoal(struct State goal_state, struct GoalCandidate& goal) {
+    switch (goal_state.getStateType()) {
         case STATE_EMPTY: {
             LOG_WARN("States contain no valid values and could not be set");
             return false;
@@ -278,51 +493,55 @@ bool MotionPlanningLibraries::setGoalState(struct State new_state, bool reset) {
                 return false;
             }
             
-            if(!new_state.mPose.hasValidPosition()) {
+            if(!goal_state.mPose.hasValidPosition()) {
                 LOG_WARN("Received goal pose does not contain a valid position");
             }
             
-            // Start
             base::samples::RigidBodyState new_grid;
-            if(!world2grid(mpTravGrid, new_state.getPose(), new_grid, &mLostX, &mLostY)) {
+            if(!world2grid(mpTravGrid, mWorld2Local, goal_state.getPose(), new_grid, 
+                    &goal.mLostX, &goal.mLostY)) {
                 LOG_WARN("Goal pose could not be transformed into the grid");
                 return false;
             }
-            mGoalState = new_state; 
-            mGoalStateGrid = new_state;
-            mGoalStateGrid.mPose = new_grid;
-            //State(new_grid, new_state.getFootprintRadius()); 
-            //mGoalStateGrid.mSpeed = new_state.mSpeed;
+            goal.mGoalState = goal_state; 
+            goal.mGoalStateGrid = goal_state;
+            goal.mGoalStateGrid.mPose = new_grid;
             break;
         }
         case STATE_ARM: {
-            mGoalState = mGoalStateGrid = new_state;
+            goal.mGoalState = goal.mGoalStateGrid = goal_state;
+            goal.mLostX = mLostX;
+            goal.mLostY = mLostY;
             break;
         }
     }
-    
-    // If required create dummy start state (a goal copy).
-    State start_state_grid;
-    if(startStateAvailable()) {
-        start_state_grid = mStartStateGrid;
-    } else {
-        start_state_grid = mGoalStateGrid;
-    }
-    
-    if(!mpPlanningLib->setStartGoal(start_state_grid, mGoalStateGrid)) {
-            LOG_WARN("Start/goal state could not be set");
-            mError = MPL_ERR_SET_START_GOAL;
-            return false;
+    return true;
+}
+
+void MotionPlanningLibraries::setGoalCandidate(struct GoalCandidate const& goal) {
+    mGoalState = goal.mGoalState;
+    mGoalStateGrid = goal.mGoalStateGrid;
+    mLostX = goal.mLostX;
+    mLostY = goal.mLostY;
+}
+
+bool MotionPlanningLibraries::storeProblem(std::string const& path) {
+    if(!travGridAvailable()) {
+        LOG_WARN("Planning problem cannot be stored without a traversability map");
+        return false;
     }
-    
-    if(!reset) {
-        if(mConfig.mReplanning.mReplanOnNewGoalPose) {
-            mReplanRequired = true;
-        }  
-        mNewGoalReceived = true;
+    return PlanningProblem::store(path, mpTravGrid, mStartState, mGoalState, mConfig,
+            mpTravData.get(), mpProbData.get());
+}
+
+bool MotionPlanningLibraries::setProblem(PlanningProblem& problem) {
+    if(!problem.isLoaded()) {
+        LOG_WARN("Planning problem has not been loaded");
+        return false;
     }
-        
-    return true;
+    return setTravGrid(problem.getEnvironment(), PlanningProblem::TRAV_MAP_ID) &&
+            setStartState(problem.getStartState()) &&
+            setGoalState(problem.getGoalState());
 }
 
 bool MotionPlanningLibraries::allInputsAvailable(enum MplErrors& err) {
@@ -362,14 +581,14 @@ bool MotionPlanningLibraries::replanningRequired() {
     double dist = mStartState.dist(mGoalState);
     if(dist < mConfig.mReplanning.mReplanMinDistStartGoal &&
             !mNewGoalReceived) {
-        LOG_INFO("Distance %4.2f to goal prevents replanning, a new goal is required", dist);
+        MPL_TRACE_INFO("Distance %4.2f to goal prevents replanning, a new goal is required", dist);
         ret = false;
     }
     
     if(ret) {
-        LOG_INFO("Replanning required");
+        MPL_TRACE_INFO("Replanning required");
     } else {
-        LOG_INFO("Replanning not required");
+        MPL_TRACE_INFO("Replanning not required");
     }
     
     return ret;
@@ -381,7 +600,9 @@ bool MotionPlanningLibraries::foundFinalSolution()
 }
 
 
-bool MotionPlanningLibraries::plan(double max_time, double& cost) {
+bool MotionPlanningLibraries::planInternal(double max_time, double& cost) {
+    base::Time plan_start_t = base::Time::now();
+    cancelAsync();
     
     if(mpPlanningLib == NULL) {
         LOG_WARN("Planning library has not been allocated yet");
@@ -415,10 +636,32 @@ bool MotionPlanningLibraries::plan(double max_time, double& cost) {
     }
     
     // Planning
-    LOG_INFO("Planning from \n%s (Grid %s) \nto \n%s (Grid %s)", 
-        mStartState.getString().c_str(), mStartStateGrid.getString().c_str(),
-        mGoalState.getString().c_str(), mGoalStateGrid.getString().c_str());    
-    bool solved = mpPlanningLib->solve(max_time);
+    MPL_TRACE_INFO("Planning from (%4.2f, %4.2f, yaw %4.2f) (grid (%4.2f, %4.2f)) "
+            "to (%4.2f, %4.2f, yaw %4.2f) (grid (%4.2f, %4.2f))",
+            mStartState.mPose.position[0], mStartState.mPose.position[1], mStartState.mPose.getYaw(),
+            mStartStateGrid.mPose.position[0], mStartStateGrid.mPose.position[1],
+            mGoalState.mPose.position[0], mGoalState.mPose.position[1], mGoalState.mPose.getYaw(),
+            mGoalStateGrid.mPose.position[0], mGoalStateGrid.mPose.position[1]);
+    // The phases after solve() are expected to take as long as during the last call.
+    double solve_time = max_time;
+    if(mConfig.mEndToEndDeadline) {
+        double post_solve_time = mStatistics.mFillPathTime + mStatistics.mWorldConversionTime + 
+                (mConfig.mPostProcessPath ? mStatistics.mPostProcessTime : 0.0);
+        solve_time = max_time - (base::Time::now() - plan_start_t).toSeconds() - post_solve_time;
+        if(solve_time < MIN_SOLVE_TIME) {
+            LOG_WARN("Only %4.3f sec of %4.3f sec remain for solving, %4.3f sec are used", 
+                    solve_time, max_time, MIN_SOLVE_TIME);
+            solve_time = MIN_SOLVE_TIME;
+        }
+    }
+    mStatistics.mSolveTimeBudget = solve_time;
+    
+    base::Time start_t = base::Time::now();
+    mPathCells.clear();
+    mPathCellsPending = false;
+    bool solved = mpPlanningLib->solve(solve_time);
+    mStatistics.mSolveTime = (base::Time::now() - start_t).toSeconds();
+    mpPlanningLib->fillStatistics(mStatistics);
     mReplanRequired = false;
     mNewGoalReceived = false;
     
@@ -429,44 +672,73 @@ bool MotionPlanningLibraries::plan(double max_time, double& cost) {
     }
 
     // Solution found.
-    LOG_INFO("Solution found");
+    MPL_TRACE_INFO("Solution found");
+    
+    // planToGoals(): The path is converted using the reached goal.
+    if(!mGoalCandidates.empty()) {
+        int reached = mpPlanningLib->getReachedGoal();
+        if(reached < 0 || reached >= (int)mGoalCandidates.size()) {
+            LOG_WARN("Reached goal is unknown");
+            mError = MPL_ERR_UNDEFINED;
+            return false;
+        }
+        setGoalCandidate(mGoalCandidates[reached]);
+    }
     
     // Request costs if available, otherwise nan is returned.
     cost = mpPlanningLib->getCost();
     
-    // By default grid coordinates are expected.
-    std::vector<State> planned_path;
+    // By default grid coordinates are expected. The buffer keeps its 
+    // capacity, so a path of a similar length does not allocate again.
+    mPathBuffer.clear();
     bool pos_defined_in_local_grid = false;
     
-    mpPlanningLib->fillPath(planned_path, pos_defined_in_local_grid);
+    start_t = base::Time::now();
+    mpPlanningLib->fillPath(mPathBuffer, pos_defined_in_local_grid);
+    mStatistics.mFillPathTime = (base::Time::now() - start_t).toSeconds();
     
-    if(planned_path.size() == 0) {
+    if(mPathBuffer.size() == 0) {
         LOG_WARN("Planned path does not contain any states!");
         mError = MPL_ERR_UNDEFINED;
         return false;
     }
     
-    // Convert path from grid or grid-local to world.
-    mPlannedPathInWorld.clear();
-    std::vector<State>::iterator it = planned_path.begin();
-    base::samples::RigidBodyState rbs_world;
-    for(; it != planned_path.end(); it++) {
-        if(pos_defined_in_local_grid) {
-            gridlocal2world(mpTravGrid, it->getPose(), rbs_world);
-        } else {
-            grid2world(mpTravGrid, it->getPose(), rbs_world);
+    bool deadline_passed = mConfig.mEndToEndDeadline && 
+            (base::Time::now() - plan_start_t).toSeconds() >= max_time;
+    if(mConfig.mPostProcessPath && deadline_passed) {
+        LOG_WARN("Deadline has been passed, the path is not post-processed");
+    } else if(mConfig.mPostProcessPath) {
+        start_t = base::Time::now();
+        mPathPostProcessor.setTravGrid(mpTravGrid, mpTravData, mpTravClassTable);
+        // The cost of the planning library is scaled by the change of the traversal time.
+        if(mPathPostProcessor.process(mPathBuffer, pos_defined_in_local_grid) && !std::isnan(cost)) {
+            cost *= mPathPostProcessor.getCostRatio();
         }
-        it->setPose(rbs_world);
-        mPlannedPathInWorld.push_back(*it);
+        mStatistics.mPostProcessTime = (base::Time::now() - start_t).toSeconds();
     }
     
+    // Convert path from grid or grid-local to world.
+    start_t = base::Time::now();
+    convertPathToWorld(mpTravGrid, mLocal2World, pos_defined_in_local_grid, 
+            mLostX, mLostY, mPathBuffer);
+    // The previous path becomes the buffer of the next query.
+    mPlannedPathInWorld.swap(mPathBuffer);
+    invalidateTrajectories();
+    // The path cells are only needed by the next map update.
+    if(mConfig.mEndToEndDeadline && (base::Time::now() - plan_start_t).toSeconds() >= max_time) {
+        mPathCellsPending = true;
+    } else {
+        updatePathCells();
+    }
+    mStatistics.mWorldConversionTime = (base::Time::now() - start_t).toSeconds();
+    
     // Calculate distance between goal pose and end of trajectory.
     // Currently with OMPL the trajectory may not reach the goal pose.
     if(mPlannedPathInWorld.size() > 0) {
         base::samples::RigidBodyState end_pose_trajectory = (mPlannedPathInWorld.end()-1)->mPose;
         double dist = (end_pose_trajectory.position - mGoalState.getPose().position).head(2).norm();
         double max_allowed_dist = 0.2;
-        LOG_INFO("Distance end of trajectory to goal position in world: %4.2f", dist);
+        MPL_TRACE_INFO("Distance end of trajectory to goal position in world: %4.2f", dist);
         if(dist > max_allowed_dist) {
             LOG_WARN("Goal position could only be reached imprecisely (>%4.2f m)", max_allowed_dist);
             mError = MPL_ERR_GOAL_COULD_ONLY_BE_REACHED_IMPRECISELY;
@@ -478,29 +750,294 @@ bool MotionPlanningLibraries::plan(double max_time, double& cost) {
     return true;
 }
 
+bool MotionPlanningLibraries::planToGoals(std::vector<struct State> const& goals,
+        double max_time, double& cost, int& goal_index) {
+    cancelAsync();
+    goal_index = -1;
+    
+    if(mpPlanningLib == NULL) {
+        LOG_WARN("Planning library has not been allocated yet");
+        return false;
+    }
+    
+    if(goals.empty()) {
+        LOG_WARN("No goals have been passed");
+        mError = MPL_ERR_MISSING_GOAL;
+        return false;
+    }
+    
+    std::vector<struct GoalCandidate> candidates(goals.size());
+    std::vector<struct State> goals_grid(goals.size());
+    for(unsigned int i=0; i < goals.size(); ++i) {
+        if(!convertGoal(goals[i], candidates[i])) {
+            mError = MPL_ERR_SET_START_GOAL;
+            return false;
+        }
+        goals_grid[i] = candidates[i].mGoalStateGrid;
+    }
+    
+    bool solved = false;
+    if(goals.size() > 1 && startStateAvailable() && 
+            mpPlanningLib->setStartGoals(mStartStateGrid, goals_grid)) {
+        LOG_INFO("Plan to %zu goals within a single query", goals.size());
+        setGoalCandidate(candidates[0]);
+        mGoalCandidates = candidates;
+        mReplanRequired = true;
+        mNewGoalReceived = true;
+        solved = planInternal(max_time, cost);
+        if(solved) {
+            goal_index = mpPlanningLib->getReachedGoal();
+        }
+        mGoalCandidates.clear();
+        // The following queries and map updates only regard the reached goal.
+        if(!mpPlanningLib->setStartGoal(mStartStateGrid, mGoalStateGrid)) {
+            LOG_WARN("Reached goal could not be set");
+        }
+    } else {
+        LOG_INFO("Plan to %zu goals one after another", goals.size());
+        double time_per_goal = max_time / goals.size();
+        double best_cost = nan("");
+        std::vector<State> best_path;
+        for(unsigned int i=0; i < candidates.size(); ++i) {
+            if(!setGoalStateInternal(goals[i], false)) {
+                continue;
+            }
+            mReplanRequired = true;
+            double goal_cost = nan("");
+            if(!planInternal(time_per_goal, goal_cost)) {
+                continue;
+            }
+            // Without costs the first solution is kept. The replaced path is
+            // overwritten by the next query, so it is exchanged instead of copied.
+            if(goal_index < 0 || goal_cost < best_cost) {
+                goal_index = i;
+                best_cost = goal_cost;
+                best_path.swap(mPlannedPathInWorld);
+            }
+        }
+        solved = goal_index >= 0;
+        if(solved) {
+            mPlannedPathInWorld.swap(best_path);
+            if(goal_index != (int)candidates.size() - 1) {
+                setGoalStateInternal(goals[goal_index], true);
+                invalidateTrajectories();
+                updatePathCells();
+            }
+            cost = best_cost;
+            mError = MPL_ERR_NONE;
+        } else {
+            mError = MPL_ERR_PLANNING_FAILED;
+        }
+    }
+    
+    if(mpRecorder != NULL) {
+        mpRecorder->recordState(RECORD_GOAL, mGoalState, RECORD_FLAG_RESET, 
+                solved, mError, 0.0);
+        mpRecorder->recordPlan(max_time, solved ? cost : nan(""), solved, mError, 0.0);
+        recordKeyframeIfRequired();
+    }
+    return solved;
+}
+
+bool MotionPlanningLibraries::planBatch(std::vector<struct State> const& goals, 
+        double max_time,
+        std::vector<struct BatchResult>& results) {
+    
+    results.clear();
+    
+    if(mConfig.mEnvType == ENV_ARM) {
+        LOG_WARN("Batch planning is only available for robot navigation");
+        return false;
+    }
+    
+    if(!travGridAvailable() || !startStateAvailable()) {
+        LOG_WARN("Batch planning requires a traversability map and a start state");
+        return false;
+    }
+    
+    if(max_time <= 0) {
+        LOG_WARN("Max allowed planning time must exceed 0, set to 1");
+        max_time = 1.0;
+    }
+    
+    results.resize(goals.size());
+    for(unsigned int i=0; i < goals.size(); ++i) {
+        results[i].mGoalState = goals[i];
+    }
+    
+    unsigned int num_threads = mConfig.mNumBatchThreads;
+    if(num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, (unsigned int)goals.size());
+    
+    LOG_INFO("Plan to %zu goals using %u threads", goals.size(), num_threads);
+    
+    size_t next_goal = 0;
+    std::mutex mutex;
+    std::vector<std::thread> workers;
+    for(unsigned int i=0; i < num_threads; ++i) {
+        workers.push_back(std::thread(&MotionPlanningLibraries::planBatchWorker, this,
+                std::cref(goals), max_time, std::ref(results), 
+                std::ref(next_goal), std::ref(mutex)));
+    }
+    for(unsigned int i=0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    
+    int num_solved = 0;
+    for(unsigned int i=0; i < results.size(); ++i) {
+        // Goals which have not been taken because no worker could create 
+        // its planning library.
+        if(!results[i].mSolved && results[i].mError == MPL_ERR_NONE) {
+            results[i].mError = MPL_ERR_INITIALIZE_MAP;
+        }
+        num_solved += results[i].mSolved ? 1 : 0;
+    }
+    LOG_INFO("Batch planning solved %d of %zu goals", num_solved, results.size());
+    return true;
+}
+
+bool MotionPlanningLibraries::planAsync(double max_time, double step_time, 
+        AnytimeSolutionCallback callback) {
+    
+    cancelAsync();
+    
+    if(mpPlanningLib == NULL) {
+        LOG_WARN("Planning library has not been allocated yet");
+        return false;
+    }
+    
+    if(max_time <= 0) {
+        LOG_WARN("Max allowed planning time must exceed 0, set to 1");
+        max_time = 1.0;
+    }
+    
+    if(step_time <= 0 || step_time > max_time) {
+        step_time = max_time;
+    }
+    
+    if(!allInputsAvailable(mError)){
+        return false;
+    }
+    
+    if(!replanningRequired()) { 
+        mError = MPL_ERR_REPLANNING_NOT_REQUIRED;
+        return false;
+    }
+    
+    mError = mpPlanningLib->isStartGoalValid();
+    if(mError != MPL_ERR_NONE) {
+        mReplanRequired = false;
+        return false;
+    }
+    mReplanRequired = false;
+    mNewGoalReceived = false;
+    mPathCells.clear();
+    mPathCellsPending = false;
+    
+    {
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        mpLatestSolution.reset();
+    }
+    
+    LOG_INFO("Start asynchronous planning for %4.2f sec (steps of %4.2f sec)", max_time, step_time);
+    mAsyncCancel = false;
+    mAsyncRunning = true;
+    mAsyncThread = std::thread(&MotionPlanningLibraries::planAsyncLoop, this, 
+            max_time, step_time, callback);
+    return true;
+}
+
+void MotionPlanningLibraries::cancelAsync() {
+    if(!mAsyncThread.joinable()) {
+        return;
+    }
+    
+    mAsyncCancel = true;
+    mAsyncThread.join();
+    
+    boost::shared_ptr<const struct AnytimeSolution> solution;
+    {
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        solution = mpLatestSolution;
+    }
+    
+    if(solution != NULL) {
+        mPlannedPathInWorld = solution->mPathInWorld;
+        invalidateTrajectories();
+        updatePathCells();
+    } else {
+        LOG_WARN("Asynchronous planning did not find a solution");
+        mError = MPL_ERR_PLANNING_FAILED;
+    }
+}
+
+bool MotionPlanningLibraries::getLatestSolution(struct AnytimeSolution& solution) {
+    // A planning thread which has finished on its own is joined here, so the result
+    // is applied as the current path as well (not possible from within the callback).
+    if(!mAsyncRunning && mAsyncThread.joinable() && 
+            mAsyncThread.get_id() != std::this_thread::get_id()) {
+        cancelAsync();
+    }
+    
+    boost::shared_ptr<const struct AnytimeSolution> latest;
+    {
+        std::lock_guard<std::mutex> lock(mAsyncMutex);
+        latest = mpLatestSolution;
+    }
+    
+    if(latest == NULL) {
+        return false;
+    }
+    solution = *latest;
+    return true;
+}
+
 std::vector<struct State> MotionPlanningLibraries::getStatesInWorld() {
     return mPlannedPathInWorld;
 }
 
+void MotionPlanningLibraries::getStatesInWorld(std::vector<struct State>& states) const {
+    // Assigning reuses the elements and the capacity of the passed vector.
+    states = mPlannedPathInWorld;
+}
+
 std::vector<base::Waypoint> MotionPlanningLibraries::getPathInWorld() {
     std::vector<base::Waypoint> path;
-    std::vector<State>::iterator it = mPlannedPathInWorld.begin();
-    base::Waypoint waypoint;
-    for(;it != mPlannedPathInWorld.end(); it++) {
-        waypoint.position = it->getPose().position;
-        waypoint.heading = it->getPose().getYaw();
-        path.push_back(waypoint);  
-    }
+    getPathInWorld(path);
     return path;
 }
 
+void MotionPlanningLibraries::getPathInWorld(std::vector<base::Waypoint>& path) const {
+    path.resize(mPlannedPathInWorld.size());
+    std::vector<State>::const_iterator it = mPlannedPathInWorld.begin();
+    std::vector<base::Waypoint>::iterator it_waypoint = path.begin();
+    for(;it != mPlannedPathInWorld.end(); ++it, ++it_waypoint) {
+        *it_waypoint = base::Waypoint();
+        it_waypoint->position = it->mPose.position;
+        it_waypoint->heading = it->mPose.getYaw();
+    }
+}
+
 std::vector<base::Trajectory> MotionPlanningLibraries::getTrajectoryInWorld() {
+    if(!mTrajectoriesValid) {
+        buildTrajectories();
+    }
+    return mTrajectoriesInWorld;
+}
+
+void MotionPlanningLibraries::buildTrajectories() {
     
-    std::vector<base::Trajectory> trajectories;
+    // An invalid path stays invalid until the path changes.
+    mTrajectoriesValid = true;
+    mTrajectoriesInWorld.clear();
+    mTrajectorySamples.clear();
+    std::vector<base::Trajectory>& trajectories = mTrajectoriesInWorld;
     
     if(mConfig.mMobility.mSpeed == 0) {
         LOG_WARN("No speed has been defined within the mobility struct, trajectory will be empty");
-        return trajectories;
+        return;
     }
    
     double use_this_speed = 0.0;
@@ -512,7 +1049,7 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getTrajectoryInWorld() {
     last_position[0] = last_position[1] = last_position[2] = nan("");
      
     std::vector<State>::iterator it = mPlannedPathInWorld.begin();  
-    LOG_DEBUG("mPlannedPathInWorld size %d", mPlannedPathInWorld.size()); 
+    MPL_TRACE_DEBUG("mPlannedPathInWorld size %d", mPlannedPathInWorld.size());
     for(;it != mPlannedPathInWorld.end(); it++) {
         if(!std::isnan(it->mSpeed)) {
             use_this_speed = it->mSpeed;
@@ -536,13 +1073,14 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getTrajectoryInWorld() {
             if((use_this_speed != last_speed) || it+1 == mPlannedPathInWorld.end()) {
                 base::Trajectory trajectory;
                 trajectory.speed = last_speed;
-                LOG_DEBUG("Adds trajectory with speed %4.2f, path contains %d coordinates",
+                MPL_TRACE_DEBUG("Adds trajectory with speed %4.2f, path contains %d coordinates",
                         last_speed, path.size());
                 try {
                     trajectory.spline.interpolate(path, parameters, coord_types);
                 } catch (std::runtime_error& e) {
                     LOG_ERROR("Spline exception: %s", e.what());
-                    return std::vector<base::Trajectory>();
+                    trajectories.clear();
+                    return;
                 }
                 trajectories.push_back(trajectory);
                 path.clear();
@@ -574,8 +1112,22 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getTrajectoryInWorld() {
         }
         trajectories.push_back(trajectory);
     }
-    */      
-    return trajectories;
+    */
+    
+    // Samples used by the escape trajectory, extracted from the end to the start.
+    mTrajectorySamples.resize(trajectories.size());
+    for(unsigned int i=0; i < trajectories.size(); ++i) {
+        base::geometry::Spline<3> const& spline = trajectories[i].spline;
+        double division = spline.getCurveLength() / ESCAPE_SAMPLE_DIST;
+        if(division < 2) {
+            division = 2; // Divides each spline at least into two pieces (each spline requires at least two points).
+        }
+        double stepSize = (spline.getEndParam() - spline.getStartParam()) / division;
+        MPL_TRACE_DEBUG("Spline %d: Start %4.2f End %4.2f Step %4.2f", i, spline.getStartParam(), spline.getEndParam(), stepSize);
+        for(double p = spline.getEndParam(); p >= spline.getStartParam(); p -= stepSize ) { 
+            mTrajectorySamples[i].push_back(spline.getPoint(p));
+        }
+    }
 }
 
 std::vector<base::Trajectory> MotionPlanningLibraries::getEscapeTrajectoryInWorld() {
@@ -590,24 +1142,30 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getEscapeTrajectoryInWorl
         return std::vector<base::Trajectory>();
     }
     
-    std::vector<base::Trajectory> trajectories = getTrajectoryInWorld();
+    if(!mTrajectoriesValid) {
+        buildTrajectories();
+    }
+    std::vector<base::Trajectory> const& trajectories = mTrajectoriesInWorld;
     std::vector<base::Trajectory> inverted_trajectories;
-    GridCalculations grid_calc;
-    grid_calc.setTravGrid(mpTravGrid, mpTravData);
     double max_radius = mConfig.getMaxRadius();
     double min_cell_size = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
     double robot_max_radius_in_grid =   max_radius / min_cell_size; 
-    // Checks all cells within the radius.. can be very expensive.
     // Footprint radius is increased a little bit to add some extra safety distance.
     robot_max_radius_in_grid *= mConfig.mEscapeTrajRadiusFactor;
-    /// \todo "Could use false here, so that just the center and the border of the circle are used."
-    grid_calc.setFootprintCircleInGrid(robot_max_radius_in_grid, true);
-    LOG_DEBUG("Robot max radius %4.2f, min cell size %4.2f, robot max radius in grid %4.2f\n", 
+    unsigned int radius_grid = (unsigned int)robot_max_radius_in_grid;
+    MPL_TRACE_DEBUG("Robot max radius %4.2f, min cell size %4.2f, robot max radius in grid %4.2f", 
             max_radius, min_cell_size, robot_max_radius_in_grid);
     
+    // Each point is checked with a single lookup of the clearance. The distance
+    // map of a shared map can only be used if it belongs to the applied map.
+    if(mpSharedMap != NULL && mpSharedMap->getTravData() == mpTravData) {
+        mpSharedEscapeDistanceMap = mpSharedMap->getDistanceMap(radius_grid + 1);
+    } else if(mEscapeDistanceMap.empty() || mEscapeDistanceMap.getMaxDist() != radius_grid + 1) {
+        mEscapeDistanceMap.create(*mpTravData, *mpTravClassTable, radius_grid + 1);
+    }
+    
     bool free_point_found = false;
-    base::samples::RigidBodyState rbs_world, rbs_grid;
-    rbs_world.orientation.setIdentity();
+    base::Vector3d free_point;
     
     if(trajectories.size() == 0) {
         LOG_ERROR("Trajectories size is 0, escape trajectory could not be created");
@@ -615,45 +1173,44 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getEscapeTrajectoryInWorl
     }
     
     for(int i=(int)(trajectories.size())-1; i>=0; i--) {
-        LOG_DEBUG("Trajectory %u", i);
+        MPL_TRACE_DEBUG("Trajectory %u", i);
         double inverted_speed = -trajectories[i].speed; // Invert speed.
-        base::geometry::Spline<3> spline = trajectories[i].spline;
-        
-        // Creates a point every 0.1m.
-        double dist = 0.1;
-        double division = spline.getCurveLength() / dist;
-        if(division < 2) {
-            division = 2; // Divides each spline at least into two pieces (each spline requires at least two points).
+        // Points of the spline from end to start.
+        std::vector<base::Vector3d> const& samples = mTrajectorySamples[i];
+        if(samples.size() < 2) {
+            continue;
         }
-        double stepSize = (spline.getEndParam() - spline.getStartParam()) / division;
-        std::vector<base::Vector3d> inverted_points;
-        std::vector<base::geometry::SplineBase::CoordinateType> coord_types;
-        base::Vector3d point;
-        LOG_DEBUG("Spline %d: Start %4.2f End %4.2f Step %4.2f", i, spline.getStartParam(), spline.getEndParam(), stepSize);
         
-        // Extract points from spline from end to start.
-        for(double p = spline.getEndParam(); p >= spline.getStartParam(); p -= stepSize ) { 
-            point = spline.getPoint(p);
-            inverted_points.push_back(point);
-            coord_types.push_back(base::geometry::SplineBase::ORDINARY_POINT);
-            LOG_DEBUG("Adds point (%4.2f, %4.2f) to the escape trajectory", point[0], point[1]);
-            // Stops if the first point does not lie on an obstacle anymore.
-            // Transforms to the grid and uses the max radius of the system.
-            rbs_world.position = point;
-            world2grid(mpTravGrid, rbs_world, rbs_grid, NULL, NULL); 
-            grid_calc.setFootprintPoseInGrid(rbs_grid.position[0], rbs_grid.position[1], 0);
-            try {
-                free_point_found = grid_calc.isValid();
-                LOG_DEBUG("Free point found: %s", free_point_found ? "true" : "false");
-            } catch (std::runtime_error& e) {
-                LOG_ERROR("Exception in isValid: %s, escape trajectory cannot be created", e.what());
-                return std::vector<base::Trajectory>();
-            }
-            if(free_point_found && inverted_points.size() >= 2) {
-                LOG_DEBUG("Free point found and at least two inverted points are available");
-                break;
+        // Searches the first free point (the end point excluded, each spline 
+        // requires at least two points): The step size is doubled until a free 
+        // point has been found, the last occupied point before is searched by 
+        // bisection afterwards (assumes that the obstacle is left only once).
+        size_t occupied = 0;
+        size_t candidate = 1;
+        while(candidate < samples.size() - 1 && !isEscapePointFree(samples[candidate], radius_grid)) {
+            occupied = candidate;
+            candidate = std::min(2 * candidate, samples.size() - 1);
+        }
+        size_t num_points = samples.size();
+        if(isEscapePointFree(samples[candidate], radius_grid)) {
+            while(candidate - occupied > 1) {
+                size_t mid = occupied + (candidate - occupied) / 2;
+                if(isEscapePointFree(samples[mid], radius_grid)) {
+                    candidate = mid;
+                } else {
+                    occupied = mid;
+                }
             }
+            free_point_found = true;
+            free_point = samples[candidate];
+            num_points = candidate + 1;
         }
+        MPL_TRACE_DEBUG("Spline %d: %d of %d points are used for the escape trajectory", 
+                i, num_points, samples.size());
+        
+        std::vector<base::Vector3d> inverted_points(samples.begin(), samples.begin() + num_points);
+        std::vector<base::geometry::SplineBase::CoordinateType> coord_types(num_points,
+                base::geometry::SplineBase::ORDINARY_POINT);
         base::Trajectory inverted_trajectory;
         try {
             inverted_trajectory.speed = inverted_speed;
@@ -670,7 +1227,7 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getEscapeTrajectoryInWorl
     }
     if(free_point_found) {
         LOG_INFO("Escape trajectory contains %d splines\n", inverted_trajectories.size());
-        LOG_INFO("First safe point is at %4.2f %4.2f\n", rbs_world.position[0], rbs_world.position[1]);
+        LOG_INFO("First safe point is at %4.2f %4.2f\n", free_point[0], free_point[1]);
         //return inverted_trajectories;
     } else {
         LOG_INFO("Escape trajectory could NOT be found, empty trajectory will be returned");
@@ -681,6 +1238,151 @@ std::vector<base::Trajectory> MotionPlanningLibraries::getEscapeTrajectoryInWorl
     return inverted_trajectories;
 }
 
+bool MotionPlanningLibraries::computeCostField(struct State start, std::vector<float>& costs,
+        bool inflate_obstacles) {
+    costs.clear();
+    
+    if(!travGridAvailable() || mpTravClassTable == NULL) {
+        LOG_WARN("A traversability map is required to compute the cost field");
+        return false;
+    }
+    
+    if(start.getStateType() != STATE_POSE) {
+        LOG_WARN("The cost field requires a start pose");
+        mError = MPL_ERR_WRONG_STATE_TYPE;
+        return false;
+    }
+    
+    base::samples::RigidBodyState start_grid;
+    if(!world2grid(mpTravGrid, mWorld2Local, start.getPose(), start_grid, NULL, NULL)) {
+        LOG_WARN("Start pose could not be transformed into the grid");
+        return false;
+    }
+    int start_x = (int)start_grid.position[0];
+    int start_y = (int)start_grid.position[1];
+    
+    TravData const& trav_data = *mpTravData;
+    int size_x = trav_data.shape()[1];
+    int size_y = trav_data.shape()[0];
+    
+    unsigned int radius_grid = 0;
+    if(inflate_obstacles) {
+        double min_cell_size = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+        radius_grid = (unsigned int)std::ceil(mConfig.getMaxRadius() / min_cell_size);
+        mCostFieldDistanceMap.create(trav_data, *mpTravClassTable, radius_grid + 1);
+    }
+    
+    // Same costs and obstacle threshold as the cost-to-go field of the 
+    // SBPL environment.
+    std::vector<double> class_costs(CostToGoField::NUM_CLASSES, 
+            std::numeric_limits<double>::max());
+    double cellsize_mm = mpTravGrid->getScaleX() * 1000.0;
+    for(unsigned int i = 0; i < TravClassTable::SBPL_MAX_COST; ++i) {
+        class_costs[i] = (i + 1) * cellsize_mm;
+    }
+    
+    // The SBPL cost map is built from the current map, the cells which 
+    // differ from the previous one are used to repair the field.
+    bool map_valid = (int)mCostFieldMap.shape()[1] == size_x && 
+            (int)mCostFieldMap.shape()[0] == size_y;
+    if(!map_valid) {
+        mCostFieldMap.resize(boost::extents[size_y][size_x]);
+    }
+    std::vector<CellUpdate> cell_updates;
+    for(int y = 0; y < size_y; ++y) {
+        for(int x = 0; x < size_x; ++x) {
+            uint8_t klass = mpTravClassTable->getSbplCost(trav_data[y][x]);
+            if(inflate_obstacles && !mCostFieldDistanceMap.isFree(x, y, radius_grid)) {
+                klass = COST_FIELD_BLOCKED;
+            }
+            if(map_valid && mCostFieldMap[y][x] != klass) {
+                cell_updates.push_back(CellUpdate(x, y, klass, 0.0, 0.0));
+            }
+            mCostFieldMap[y][x] = klass;
+        }
+    }
+    
+    base::Time start_t = base::Time::now();
+    if(map_valid && mCostField.hasGoal(start_x, start_y) && 
+            mCostField.update(mCostFieldMap, class_costs, cell_updates)) {
+        LOG_DEBUG("Cost field repaired at %zu cells", cell_updates.size());
+    } else if(!mCostField.create(mCostFieldMap, class_costs, start_x, start_y)) {
+        LOG_WARN("Start pose lies outside of the map, cost field could not be created");
+        return false;
+    }
+    LOG_INFO("Cost field computed within %4.2f sec", 
+            (base::Time::now() - start_t).toSeconds());
+    
+    costs.resize(size_x * size_y);
+    std::vector<float>::iterator it = costs.begin();
+    for(int y = 0; y < size_y; ++y) {
+        for(int x = 0; x < size_x; ++x, ++it) {
+            *it = (float)mCostField.getCost(x, y);
+        }
+    }
+    return true;
+}
+
+bool MotionPlanningLibraries::isEscapePointFree(base::Vector3d const& point, 
+        unsigned int radius_grid) {
+    base::samples::RigidBodyState rbs_world, rbs_grid;
+    rbs_world.position = point;
+    rbs_world.orientation.setIdentity();
+    world2grid(mpTravGrid, mWorld2Local, rbs_world, rbs_grid, NULL, NULL);
+    // Uses the cell (truncated) like the footprint checks.
+    ObstacleDistanceMap const& distance_map = mpSharedEscapeDistanceMap != NULL ? 
+            *mpSharedEscapeDistanceMap : mEscapeDistanceMap;
+    return distance_map.isFree((int)rbs_grid.position[0], (int)rbs_grid.position[1], 
+            radius_grid);
+}
+
+void MotionPlanningLibraries::updatePathCells() {
+    mPathCells.clear();
+    mPathCellsPending = false;
+    if(!mConfig.mReplanning.mReplanOnlyIfPathAffected || !mGrid2WorldValid || 
+            mpTravGrid == NULL || mpTravData == NULL || mPlannedPathInWorld.empty()) {
+        return;
+    }
+    
+    int width = mpTravData->shape()[1];
+    int height = mpTravData->shape()[0];
+    mPathCells.assign((size_t)width * height, 0);
+    
+    // Cells crossed by the segments between the states.
+    Eigen::Affine3d world2grid = mGrid2World.inverse();
+    base::Vector3d last = world2grid * mPlannedPathInWorld.front().getPose().position;
+    std::vector<State>::const_iterator it = mPlannedPathInWorld.begin();
+    for(; it != mPlannedPathInWorld.end(); ++it) {
+        base::Vector3d pos = world2grid * it->getPose().position;
+        GridTraversal traversal(last[0], last[1], pos[0], pos[1]);
+        do {
+            if(traversal.getX() >= 0 && traversal.getX() < width && 
+                    traversal.getY() >= 0 && traversal.getY() < height) {
+                mPathCells[(size_t)traversal.getY() * width + traversal.getX()] = 1;
+            }
+        } while(traversal.next());
+        last = pos;
+    }
+    
+    // The square around the crossed cells contains the footprint of each orientation.
+    double min_scale = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+    dilateCells(mPathCells, width, height, (int)std::ceil(mConfig.getMaxRadius() / min_scale));
+}
+
+bool MotionPlanningLibraries::isPathAffected(std::vector<CellUpdate> const& cell_updates) const {
+    if(mPathCells.size() != mpTravData->num_elements()) {
+        return true;
+    }
+    int width = mpTravData->shape()[1];
+    std::vector<CellUpdate>::const_iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); ++it) {
+        if(mPathCells[(size_t)it->y * width + it->x]) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void MotionPlanningLibraries::printPathInWorld() {
     std::vector<base::Waypoint> waypoints = getPathInWorld();
     std::vector<base::Waypoint>::iterator it = waypoints.begin();
@@ -746,6 +1448,17 @@ bool MotionPlanningLibraries::getSbplMotionPrimitives(struct SbplMotionPrimitive
     }
 }
 
+bool MotionPlanningLibraries::setArmCollisionChecker(
+        boost::shared_ptr<ArmCollisionChecker const> checker) {
+    cancelAsync();
+    if(mpPlanningLib == NULL || !mpPlanningLib->setArmCollisionChecker(checker)) {
+        LOG_WARN("The planning library does not support arm collision checks");
+        return false;
+    }
+    mReplanRequired = true;
+    return true;
+}
+
 bool MotionPlanningLibraries::world2grid(envire::TraversabilityGrid const* trav,
         base::samples::RigidBodyState const& world_pose, 
         base::samples::RigidBodyState& grid_pose,
@@ -757,11 +1470,21 @@ bool MotionPlanningLibraries::world2grid(envire::TraversabilityGrid const* trav,
         return false;
     }
 
-    // Transforms from world to local.
-    base::samples::RigidBodyState local_pose;
     Eigen::Affine3d world2local = trav->getEnvironment()->relativeTransform(
             trav->getEnvironment()->getRootNode(),
             trav->getFrameNode());
+    return world2grid(trav, world2local, world_pose, grid_pose, lost_x, lost_y);
+}
+
+bool MotionPlanningLibraries::world2grid(envire::TraversabilityGrid const* trav,
+        Eigen::Affine3d const& world2local,
+        base::samples::RigidBodyState const& world_pose, 
+        base::samples::RigidBodyState& grid_pose,
+        double* lost_x,
+        double* lost_y) {
+
+    // Transforms from world to local.
+    base::samples::RigidBodyState local_pose;
     local_pose.setTransform(world2local * world_pose.getTransform());
     
     // Calculate and set grid coordinates (and orientation).
@@ -795,6 +1518,80 @@ bool MotionPlanningLibraries::world2grid(envire::TraversabilityGrid const* trav,
 bool MotionPlanningLibraries::grid2world(envire::TraversabilityGrid const* trav,
         base::samples::RigidBodyState const& grid_pose,
         base::samples::RigidBodyState& world_pose) {
+    // Readds discretization error based on the set goal pose.
+    return grid2world(trav, grid_pose, mLostX, mLostY, world_pose);
+}
+
+bool MotionPlanningLibraries::gridlocal2world(envire::TraversabilityGrid const* trav,
+        base::samples::RigidBodyState const& grid_local_pose,
+        base::samples::RigidBodyState& world_pose) {
+    // Readds discretization error based on the set goal pose.
+    return gridlocal2world(trav, grid_local_pose, mLostX, mLostY, world_pose);
+}
+
+// PRIVATE
+boost::shared_ptr<AbstractMotionPlanningLibrary> MotionPlanningLibraries::createPlanningLibrary(
+        Config config) {
+    
+    boost::shared_ptr<AbstractMotionPlanningLibrary> planning_lib;
+    switch(config.mPlanningLibType) {
+        case LIB_SBPL: {
+            switch(config.mEnvType) {
+                case ENV_XY: {
+                    planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>
+                            (new SbplEnvXY(config));    
+                    break;
+                }
+                case ENV_XYTHETA: {
+                    planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>
+                            (new SbplEnvXYTHETA(config)); 
+                    break;
+                }
+                default: {
+                    LOG_ERROR("Environment is not available in SBPL");
+                    throw std::runtime_error("Environment not available in SBPL");
+                }
+            }
+            break;    
+        }    
+        case LIB_OMPL: {
+            switch(config.mEnvType) {
+                case ENV_XY: {
+                    planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>
+                            (new OmplEnvXY(config));    
+                    break;
+                }
+                case ENV_XYTHETA: {
+                    planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>
+                            (new OmplEnvXYTHETA(config));    
+                    break;
+                }
+                case ENV_ARM: {
+                    planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>
+                            (new OmplEnvARM(config));    
+                    break;
+                }
+                case ENV_SHERPA: {
+                    planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>
+                            (new OmplEnvSHERPA(config));    
+                    break;
+                }
+                //planning_lib = boost::shared_ptr<AbstractMotionPlanningLibrary>(new Ompl(config));
+                default: {
+                    LOG_ERROR("Environment is not available in OMPL");
+                    throw std::runtime_error("Environment not available in OMPL");
+                }
+            }
+            break;
+        }
+    }
+    return planning_lib;
+}
+
+bool MotionPlanningLibraries::grid2world(envire::TraversabilityGrid const* trav,
+        base::samples::RigidBodyState const& grid_pose,
+        double lost_x, double lost_y,
+        base::samples::RigidBodyState& world_pose) {
         
     if(trav == NULL) {
         LOG_WARN("grid2world transformation requires a traversability map");
@@ -810,9 +1607,9 @@ bool MotionPlanningLibraries::grid2world(envire::TraversabilityGrid const* trav,
     x_local = x_grid * trav->getScaleX() + trav->getOffsetX();
     y_local = y_grid * trav->getScaleY() + trav->getOffsetY();
     
-    // Readds discretization error based on the set goal pose.
-    x_local += mLostX;
-    y_local += mLostY;
+    // Readds the discretization error.
+    x_local += lost_x;
+    y_local += lost_y;
 
     base::samples::RigidBodyState local_pose = grid_pose;
     local_pose.position[0] = x_local;
@@ -830,6 +1627,7 @@ bool MotionPlanningLibraries::grid2world(envire::TraversabilityGrid const* trav,
 
 bool MotionPlanningLibraries::gridlocal2world(envire::TraversabilityGrid const* trav,
         base::samples::RigidBodyState const& grid_local_pose,
+        double lost_x, double lost_y,
         base::samples::RigidBodyState& world_pose) {
         
     if(trav == NULL) {
@@ -843,9 +1641,9 @@ bool MotionPlanningLibraries::gridlocal2world(envire::TraversabilityGrid const*
     grid_local_pose_tmp.position[0] += trav->getOffsetX();
     grid_local_pose_tmp.position[1] += trav->getOffsetY();
     
-    // Readds discretization error based on the set goal pose.
-    grid_local_pose_tmp.position[0] += mLostX;
-    grid_local_pose_tmp.position[1] += mLostY;
+    // Readds the discretization error.
+    grid_local_pose_tmp.position[0] += lost_x;
+    grid_local_pose_tmp.position[1] += lost_y;
         
     // Transformation LOCAL2WOLRD
     Eigen::Affine3d local2world = trav->getEnvironment()->relativeTransform(
@@ -856,7 +1654,180 @@ bool MotionPlanningLibraries::gridlocal2world(envire::TraversabilityGrid const*
     return true;
 }
 
-// PRIVATE
+void MotionPlanningLibraries::planAsyncLoop(double max_time, double step_time, 
+        AnytimeSolutionCallback callback) {
+    
+    base::Time start_time = base::Time::now();
+    double best_cost = std::numeric_limits<double>::infinity();
+    double best_epsilon = std::numeric_limits<double>::infinity();
+    unsigned int number = 0;
+    
+    while(!mAsyncCancel) {
+        double planning_time = (base::Time::now() - start_time).toSeconds();
+        if(planning_time >= max_time) {
+            break;
+        }
+        
+        bool solved = false;
+        try {
+            solved = mpPlanningLib->solve(std::min(step_time, max_time - planning_time));
+        } catch (std::exception& e) {
+            LOG_ERROR("Asynchronous planning failed: %s", e.what());
+            break;
+        }
+        if(!solved) {
+            continue;
+        }
+        
+        // Only improved solutions are published.
+        double cost = mpPlanningLib->getCost();
+        double epsilon = mpPlanningLib->getEpsilon();
+        if(number == 0 || cost < best_cost || epsilon < best_epsilon) {
+            boost::shared_ptr<struct AnytimeSolution> solution(new AnytimeSolution());
+            bool pos_defined_in_local_grid = false;
+            mpPlanningLib->fillPath(solution->mPathInWorld, pos_defined_in_local_grid);
+            if(solution->mPathInWorld.size() > 0) {
+                convertPathToWorld(mpTravGrid, mLocal2World, pos_defined_in_local_grid, 
+                        mLostX, mLostY, solution->mPathInWorld);
+                solution->mCost = cost;
+                solution->mEpsilon = epsilon;
+                solution->mPlanningTime = (base::Time::now() - start_time).toSeconds();
+                solution->mNumber = ++number;
+                if(!std::isnan(cost)) {
+                    best_cost = cost;
+                }
+                if(!std::isnan(epsilon)) {
+                    best_epsilon = epsilon;
+                }
+                LOG_INFO("Publish solution %d after %4.2f sec, cost %4.2f, epsilon %4.2f", 
+                        number, solution->mPlanningTime, cost, epsilon);
+                {
+                    std::lock_guard<std::mutex> lock(mAsyncMutex);
+                    mpLatestSolution = solution;
+                }
+                if(callback) {
+                    callback(*solution);
+                }
+            }
+        }
+        
+        if(mConfig.mSearchUntilFirstSolution || epsilon == 1.0) {
+            break;
+        }
+    }
+    mAsyncRunning = false;
+}
+
+void MotionPlanningLibraries::convertPathToWorld(envire::TraversabilityGrid const* trav,
+        Eigen::Affine3d const& local2world,
+        bool pos_defined_in_local_grid,
+        double lost_x, double lost_y,
+        std::vector<struct State>& path) {
+    
+    // Single transformation of grid2world() or gridlocal2world(): Grid positions 
+    // are scaled and placed on z = 0, grid-local positions are only shifted.
+    Eigen::Affine3d grid2local = Eigen::Affine3d::Identity();
+    if(!pos_defined_in_local_grid) {
+        grid2local.linear().diagonal() << trav->getScaleX(), trav->getScaleY(), 0.0;
+    }
+    grid2local.translation() << trav->getOffsetX() + lost_x, trav->getOffsetY() + lost_y, 0.0;
+    Eigen::Affine3d grid2world = local2world * grid2local;
+    Eigen::Quaterniond rotation(local2world.linear());
+    
+    Eigen::Matrix3Xd positions(3, path.size());
+    for(unsigned int i = 0; i < path.size(); ++i) {
+        positions.col(i) = path[i].mPose.position;
+    }
+    positions = (grid2world.linear() * positions).colwise() + grid2world.translation();
+    
+    base::samples::RigidBodyState rbs_world;
+    for(unsigned int i = 0; i < path.size(); ++i) {
+        rbs_world.position = positions.col(i);
+        rbs_world.orientation = rotation * path[i].mPose.orientation;
+        path[i].setPose(rbs_world);
+    }
+}
+
+void MotionPlanningLibraries::planBatchWorker(std::vector<struct State> const& goals, 
+        double max_time,
+        std::vector<struct BatchResult>& results,
+        size_t& next_goal, std::mutex& mutex) {
+    
+    // The map data and the lookup table are shared read-only by all workers.
+    boost::shared_ptr<AbstractMotionPlanningLibrary> planning_lib;
+    try {
+        planning_lib = createPlanningLibrary(mConfig);
+    } catch (std::exception& e) {
+        // The goals are taken by the remaining workers, planBatch() marks the 
+        // goals which have not been taken at all.
+        LOG_ERROR("Batch worker could not create its planning library: %s", e.what());
+        return;
+    }
+    planning_lib->setTravClassTable(mpTravClassTable);
+    planning_lib->setTravGrid(mpTravGrid, mpTravData);
+    
+    while(true) {
+        size_t goal_id = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(next_goal >= goals.size()) {
+                return;
+            }
+            goal_id = next_goal++;
+        }
+        
+        struct BatchResult& result = results[goal_id];
+        try {
+            base::samples::RigidBodyState grid_pose;
+            double lost_x = 0.0, lost_y = 0.0;
+            if(goals[goal_id].getStateType() != STATE_POSE || 
+                    !world2grid(mpTravGrid, mWorld2Local, goals[goal_id].getPose(), grid_pose, 
+                            &lost_x, &lost_y)) {
+                LOG_WARN("Batch goal %zu could not be transformed into the grid", goal_id);
+                result.mError = MPL_ERR_SET_START_GOAL;
+                continue;
+            }
+            State goal_state_grid = goals[goal_id];
+            goal_state_grid.mPose = grid_pose;
+            
+            // Each goal starts with a new search.
+            if(!planning_lib->initialize(mpTravGrid, mpTravData)) {
+                result.mError = MPL_ERR_INITIALIZE_MAP;
+                continue;
+            }
+            if(!planning_lib->setStartGoal(mStartStateGrid, goal_state_grid)) {
+                result.mError = MPL_ERR_SET_START_GOAL;
+                continue;
+            }
+            result.mError = planning_lib->isStartGoalValid();
+            if(result.mError != MPL_ERR_NONE) {
+                continue;
+            }
+            if(!planning_lib->solve(max_time)) {
+                result.mError = MPL_ERR_PLANNING_FAILED;
+                continue;
+            }
+            
+            std::vector<State> planned_path;
+            bool pos_defined_in_local_grid = false;
+            planning_lib->fillPath(planned_path, pos_defined_in_local_grid);
+            if(planned_path.size() == 0) {
+                result.mError = MPL_ERR_UNDEFINED;
+                continue;
+            }
+            
+            convertPathToWorld(mpTravGrid, mLocal2World, pos_defined_in_local_grid, 
+                    lost_x, lost_y, planned_path);
+            result.mPathInWorld.swap(planned_path);
+            result.mCost = planning_lib->getCost();
+            result.mSolved = true;
+        } catch (std::exception& e) {
+            LOG_ERROR("Batch goal %zu failed: %s", goal_id, e.what());
+            result.mError = MPL_ERR_UNDEFINED;
+        }
+    }
+}
+
 envire::TraversabilityGrid* MotionPlanningLibraries::extractTravGrid(envire::Environment* env, 
         std::string trav_map_id) {
     typedef envire::TraversabilityGrid e_trav;
@@ -881,52 +1852,199 @@ envire::TraversabilityGrid* MotionPlanningLibraries::extractTravGrid(envire::Env
     }
 }
 
-void MotionPlanningLibraries::collectCellUpdates( envire::TraversabilityGrid* old_map,
-        envire::TraversabilityGrid* new_map,
-        std::vector<CellUpdate>& cell_updates) {
+void MotionPlanningLibraries::copyToSnapshot(TravData const& band, 
+        boost::shared_ptr<TravData>& snapshot) {
+    
+    bool reusable = snapshot != NULL && snapshot.unique() &&
+            snapshot->shape()[0] == band.shape()[0] &&
+            snapshot->shape()[1] == band.shape()[1];
     
-    assert(old_map->getCellSizeX() == new_map->getCellSizeX());
-    assert(old_map->getCellSizeY() == new_map->getCellSizeY());
+    if(reusable) {
+        // Same shape, so both arrays are contiguous blocks of the same size.
+        memcpy(snapshot->data(), band.data(), band.num_elements() * sizeof(uint8_t));
+    } else {
+        snapshot = boost::shared_ptr<TravData>(new TravData(band));
+    }
+}
+
+void MotionPlanningLibraries::collectCellUpdates(TravData const& trav_old, 
+        TravData const& prob_old,
+        TravData const& trav_new, 
+        TravData const& prob_new,
+        TravClassTable const& trav_class_table,
+        std::vector<CellUpdate>& cell_updates,
+        std::vector<CellUpdateSpan>& cell_update_spans,
+        int shift_x, int shift_y) {
+    
+    assert(trav_old.num_elements() == trav_new.num_elements());
+    assert(prob_old.num_elements() == prob_new.num_elements());
+    assert(trav_new.num_elements() == prob_new.num_elements());
 
     base::Time start_t = base::Time::now();
     
-    int cell_counter = 0;
-    int cell_counter_same = 0;
+    const size_t size_y = trav_new.shape()[0];
+    const size_t size_x = trav_new.shape()[1];
+    const size_t word_size = sizeof(uint64_t);
+    
+    size_t cell_counter = 0;
     double driveability = 0.0;
     double probability = 0.0;
+    uint64_t trav_old_w = 0, trav_new_w = 0, prob_old_w = 0, prob_new_w = 0;
     
-    envire::Grid<uint8_t>::ArrayType& trav_old = old_map->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
-    envire::Grid<uint8_t>::ArrayType& prob_old = old_map->getGridData(envire::TraversabilityGrid::PROBABILITY);
-    envire::Grid<uint8_t>::ArrayType& trav_new = new_map->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
-    envire::Grid<uint8_t>::ArrayType& prob_new = new_map->getGridData(envire::TraversabilityGrid::PROBABILITY);
-    
-    uint8_t* trav_old_p = trav_old.origin();
-    uint8_t* prob_old_p = prob_old.origin();
-    uint8_t* trav_new_p = trav_new.origin();
-    uint8_t* prob_new_p = prob_new.origin();
+    // Range of the new cells which have a counterpart within the old map.
+    const int y_old_begin = std::max(0, -shift_y);
+    const int y_old_end = std::min((int)size_y, (int)size_y - shift_y);
+    const size_t x_old_begin = std::max(0, -shift_x);
+    const size_t x_old_end = std::max(0, std::min((int)size_x, (int)size_x - shift_x));
     
     // TODO Probability relevant? Currently not used as double.
-    for(unsigned int y=0; y < new_map->getCellSizeY(); ++y) {
-        for(unsigned int x=0; x < new_map->getCellSizeX(); ++x) {
-            if(*trav_old_p != *trav_new_p || *prob_old_p != *prob_new_p) {
-                driveability = new_map->getTraversabilityClass(*trav_new_p).getDrivability();
+    for(size_t y=0; y < size_y; ++y) {
+        // The old rows are shifted, so the old pointers are indexed with x + shift_x.
+        bool row_exposed = (int)y < y_old_begin || (int)y >= y_old_end;
+        size_t y_old = row_exposed ? y : y + shift_y;
+        const uint8_t* trav_old_p = trav_old.data() + y_old * size_x;
+        const uint8_t* prob_old_p = prob_old.data() + y_old * size_x;
+        const uint8_t* trav_new_p = trav_new.data() + y * size_x;
+        const uint8_t* prob_new_p = prob_new.data() + y * size_x;
+        
+        bool span_open = false;
+        size_t span_begin = 0;
+        size_t x = 0;
+        while(x < size_x) {
+            bool exposed = row_exposed || x < x_old_begin || x >= x_old_end;
+            // Skips blocks of unchanged cells. memcpy is used to avoid unaligned 
+            // access and is reduced to a single load by the compiler.
+            if(!span_open && !exposed && x + word_size <= x_old_end) {
+                memcpy(&trav_old_w, trav_old_p + x + shift_x, word_size);
+                memcpy(&trav_new_w, trav_new_p + x, word_size);
+                memcpy(&prob_old_w, prob_old_p + x + shift_x, word_size);
+                memcpy(&prob_new_w, prob_new_p + x, word_size);
+                if(((trav_old_w ^ trav_new_w) | (prob_old_w ^ prob_new_w)) == 0) {
+                    x += word_size;
+                    continue;
+                }
+            }
+            
+            if(exposed || trav_old_p[x + shift_x] != trav_new_p[x] || 
+                    prob_old_p[x + shift_x] != prob_new_p[x]) {
+                driveability = trav_class_table.getDriveability(trav_new_p[x]);
                 // Does the same conversion which is done in TraversabilityGrid.
-                probability = ((double)*prob_new_p) /std::numeric_limits< uint8_t >::max();
-                cell_updates.push_back(CellUpdate(x, y, *trav_new_p, probability, driveability));
+                probability = ((double)prob_new_p[x]) /std::numeric_limits< uint8_t >::max();
+                cell_updates.push_back(CellUpdate(x, y, trav_new_p[x], probability, driveability));
                 cell_counter++;
-            } else {
-                cell_counter_same++;
+                if(!span_open) {
+                    span_open = true;
+                    span_begin = x;
+                }
+            } else if(span_open) {
+                cell_update_spans.push_back(CellUpdateSpan(y, span_begin, x));
+                span_open = false;
             }
-            trav_old_p++;
-            prob_old_p++;
-            trav_new_p++;
-            prob_new_p++;
+            x++;
+        }
+        if(span_open) {
+            cell_update_spans.push_back(CellUpdateSpan(y, span_begin, size_x));
         }
     }
     
-    LOG_INFO("%d different cells collected within %4.4f sec.", cell_counter, 
+    MPL_TRACE_INFO("%d different cells (%d row spans, %d unchanged cells) collected within %4.4f sec.", 
+            cell_counter, cell_update_spans.size(), trav_new.num_elements() - cell_counter,
             (base::Time::now() - start_t).toSeconds());
-    LOG_INFO("Number of unchanged cells %d", cell_counter_same);
+}
+
+void MotionPlanningLibraries::collectMapDiff(SharedMap const* shared_map, int shift_x, int shift_y) {
+    // The diff of the shared map is valid if this planner has applied its previous revision.
+    if(shared_map != NULL && shared_map->isDiffValid() && 
+            shared_map->getLastTravData() == mpLastTravData) {
+        int shared_shift_x = 0, shared_shift_y = 0;
+        shared_map->getShift(shared_shift_x, shared_shift_y);
+        if(shared_shift_x == shift_x && shared_shift_y == shift_y) {
+            mCellUpdates = shared_map->getCellUpdates();
+            mCellUpdateSpans = shared_map->getCellUpdateSpans();
+            return;
+        }
+    }
+    collectCellUpdates(*mpLastTravData, *mpLastProbData, *mpTravData, *mpProbData,
+            *mpTravClassTable, mCellUpdates, mCellUpdateSpans, shift_x, shift_y);
+}
+
+Eigen::Affine3d MotionPlanningLibraries::getLocal2World(envire::TraversabilityGrid const* trav) {
+    return trav->getEnvironment()->relativeTransform(
+        trav->getFrameNode(),
+        trav->getEnvironment()->getRootNode());
+}
+
+Eigen::Affine3d MotionPlanningLibraries::getGrid2World(envire::TraversabilityGrid const* trav,
+        Eigen::Affine3d const& local2world) {
+    // Transformation GRID2LOCAL, see grid2world().
+    Eigen::Affine3d grid2local = Eigen::Affine3d::Identity();
+    grid2local.linear().diagonal() << trav->getScaleX(), trav->getScaleY(), 1.0;
+    grid2local.translation() << trav->getOffsetX(), trav->getOffsetY(), 0.0;
+    return local2world * grid2local;
+}
+
+bool MotionPlanningLibraries::getMapShift(Eigen::Affine3d const& grid2world, 
+        int& shift_x, int& shift_y) const {
+    if(!mGrid2WorldValid) {
+        return false;
+    }
+    return getMapShift(mGrid2World, grid2world, shift_x, shift_y);
+}
+
+bool MotionPlanningLibraries::getMapShift(Eigen::Affine3d const& old_grid2world, 
+        Eigen::Affine3d const& grid2world, int& shift_x, int& shift_y) {
+    // Transformation from the new to the old grid coordinates, has to be a 
+    // translation by whole cells within the grid plane.
+    Eigen::Affine3d new2old = old_grid2world.inverse() * grid2world;
+    if(!new2old.linear().isApprox(Eigen::Matrix3d::Identity(), 1e-6)) {
+        return false;
+    }
+    Eigen::Vector3d t = new2old.translation();
+    shift_x = (int)std::floor(t.x() + 0.5);
+    shift_y = (int)std::floor(t.y() + 0.5);
+    return std::fabs(t.x() - shift_x) < 1e-3 && std::fabs(t.y() - shift_y) < 1e-3 &&
+            std::fabs(t.z()) < 1e-3;
+}
+
+void MotionPlanningLibraries::recordMap(struct MapUpdateInfo const& update, bool success, 
+        double duration) {
+    std::vector<CellUpdateSpan> const* spans = NULL;
+    int shift_x = 0, shift_y = 0;
+    if(update.mSpansValid) {
+        spans = &mCellUpdateSpans;
+        shift_x = update.mShiftX;
+        shift_y = update.mShiftY;
+    } else if(mpRecorder->hasMap() && mpLastTravData != NULL && mpTravClassTable != NULL &&
+            mpLastTravData->num_elements() == mpTravData->num_elements()) {
+        // The map has been reinitialized, the diff is only collected for the recording.
+        mRecordCellUpdates.clear();
+        mRecordCellUpdateSpans.clear();
+        collectCellUpdates(*mpLastTravData, *mpLastProbData, *mpTravData, *mpProbData,
+                *mpTravClassTable, mRecordCellUpdates, mRecordCellUpdateSpans);
+        spans = &mRecordCellUpdateSpans;
+    }
+    mpRecorder->recordMap(update.mpTravGrid, *mpTravData, *mpProbData, spans, 
+            shift_x, shift_y, 0, success, mError, duration);
+    recordKeyframeIfRequired();
+}
+
+void MotionPlanningLibraries::recordKeyframeIfRequired() {
+    if(!mpRecorder->isSegmentFull()) {
+        return;
+    }
+    mpRecorder->startSegment();
+    if(mpTravGrid != NULL && mpTravData != NULL) {
+        mpRecorder->recordMap(mpTravGrid, *mpTravData, *mpProbData, NULL, 0, 0, 
+                RECORD_FLAG_KEYFRAME, true, MPL_ERR_NONE, 0.0);
+    }
+    if(startStateAvailable()) {
+        mpRecorder->recordState(RECORD_START, mStartState, RECORD_FLAG_KEYFRAME, 
+                true, MPL_ERR_NONE, 0.0);
+    }
+    if(goalStateAvailable()) {
+        mpRecorder->recordState(RECORD_GOAL, mGoalState, RECORD_FLAG_KEYFRAME, 
+                true, MPL_ERR_NONE, 0.0);
+    }
 }
 
 } // namespace motion_planning_libraries
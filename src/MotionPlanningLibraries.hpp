@@ -1,6 +1,12 @@
 #ifndef _MOTION_PLANNING_LIBRARIES_HPP_
 #define _MOTION_PLANNING_LIBRARIES_HPP_
 
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+
 #include <base/samples/RigidBodyState.hpp>
 #include <base/Waypoint.hpp>
 #include <base/Trajectory.hpp>
@@ -10,12 +16,58 @@
 #include "Config.hpp"
 #include "State.hpp"
 #include "AbstractMotionPlanningLibrary.hpp"
+#include "ArmCollisionChecker.hpp"
+#include "PlanningStatistics.hpp"
+#include "PathPostProcessor.hpp"
+#include "ObstacleDistanceMap.hpp"
+#include "CostToGoField.hpp"
+#include "PlanningProblem.hpp"
+#include "PlanningRecorder.hpp"
+#include "SharedMap.hpp"
 
 namespace motion_planning_libraries
 {
 
 typedef envire::TraversabilityGrid::ArrayType TravData;
+
+/**
+ * Result of a single goal of MotionPlanningLibraries::planBatch().
+ */
+struct BatchResult {
+    struct State mGoalState; // Pose in world coordinates.
+    bool mSolved;
+    double mCost; // nan if the planning library does not provide costs.
+    enum MplErrors mError;
+    std::vector<struct State> mPathInWorld;
+    
+    BatchResult() : mGoalState(), 
+            mSolved(false), 
+            mCost(nan("")), 
+            mError(MPL_ERR_NONE), 
+            mPathInWorld() {
+    }
+};
     
+/**
+ * Solution published by the asynchronous planning, see MotionPlanningLibraries::planAsync().
+ */
+struct AnytimeSolution {
+    std::vector<struct State> mPathInWorld;
+    double mCost; // nan if the planning library does not provide costs.
+    double mEpsilon; // nan if the planning library does not provide a suboptimality bound.
+    double mPlanningTime; // Seconds since the start of the asynchronous planning.
+    unsigned int mNumber; // Counts the published solutions, starting with 1.
+    
+    AnytimeSolution() : mPathInWorld(), 
+            mCost(nan("")), 
+            mEpsilon(nan("")), 
+            mPlanningTime(0.0), 
+            mNumber(0) {
+    }
+};
+
+typedef std::function<void (struct AnytimeSolution const&)> AnytimeSolutionCallback;
+
 /**
  * \mainpage MPL - Motion Planning Libraries
  * \section Introduction
@@ -72,8 +124,9 @@ typedef envire::TraversabilityGrid::ArrayType TravData;
  * The planner tries to maximise the footprint for a safe stand, just shrinks it 
  * for narrow passages. This is a first test implementation for body embedded planning which
  * will be extended in the future.
- * - ENV_ARM: In general OMPL is used for manipulation / arm movement. This has been integrated
- * just for testing. For a meaningful use a robot model and octomaps have to be integrated into MPL.
+ * - ENV_ARM: In general OMPL is used for manipulation / arm movement. The collisions are
+ * checked by an ArmCollisionChecker passed by the user (setArmCollisionChecker()), e.g. a 
+ * robot model checked against an octomap. Without a checker only the joint borders are regarded.
  * 
  * \subsection spbl SBPL Search-Based Planning
  * SBPL is a library mainly used for orientation based navigation within a discrete map supporting powerful
@@ -100,6 +153,12 @@ typedef envire::TraversabilityGrid::ArrayType TravData;
  * | ---------------- | ----------- |
  * | mPlanningLibType | Defines the planning library, see motion_planning_libraries::PlanningLibraryType |
  * | mEnvType         | Defines the environment, see motion_planning_libraries::EnvType | 
+ * | mShiftScrollingMap | (optional) A map which is translated by whole cells (scrolling local map) is shifted within the SBPL environments instead of being reinitialized. |
+ * | mPostProcessPath | (optional) The path found by plan() is shortened by collision free shortcuts and its corners are smoothed using mMobility.mMinTurningRadius. |
+ * | mEndToEndDeadline | (optional) The max_time of plan() includes the preparation, the path extraction and the conversion, solve() gets the remaining time. |
+ * | mRecordFile      | (optional) setTravGrid() (as cell diff), setStartState(), setGoalState() and plan() are recorded with their durations, motion_planning_libraries_replay repeats them. |
+ * | mRecordMaxSize   | Max size (bytes) of the recording, two segments of half the size are used as a ring. |
+ * | mRandomSeed      | (optional, OMPL) Fixed seed of the random number generator, used for reproducible replays. |
  * \subsection OMPL
  * | Environment | Parameter              | Description |
  * | ----------- | ---------------------- | ----------- |
@@ -109,7 +168,12 @@ typedef envire::TraversabilityGrid::ArrayType TravData;
  * |             | mNumFootprintClasses   | To reduce the plannign dimension the footprint radius is descretized. |
  * |             | mTimeToAdaptFootprint  | Time to change the system from min to max footprint. |
  * |             | mAdaptFootprintPenalty | Additional costs which are added if the footprint changes between two states. | 
+ * |             | mNumParallelPlanners   | Number of planners executed in parallel (ENV_XY as well), their solutions are hybridized. |
+ * |             | mUseCostToGoField      | (optional, all but ENV_ARM) The 2D cost-to-go of the goal is used as cost heuristic, e.g. by informed planners. |
+ * |             | mLazyCollisionChecking | (optional, ENV_XY, ENV_SHERPA and ENV_ARM) Lazy planners, the edges are checked along the crossed grid cells (ENV_ARM: along the joint-space motion) when they become part of a candidate solution. |
+ * |             | mOmplWarmStart         | (optional, ENV_XY, ENV_SHERPA and ENV_ARM) The still valid rest of the previous solution is reused after a new start, goal or map. |
  * | ENV_ARM     | mJointBorders          | Borders of the arm joints. |
+ * |             | mArmValidityCacheResolution | (optional) Voxel size in rad of the joint-space cache of the collision checks (setArmCollisionChecker()). |
  * \subsection SBPL
  * | Environment | Parameter | Description |
  * | ----------- | ------------------------- | ----------- |
@@ -117,11 +181,18 @@ typedef envire::TraversabilityGrid::ArrayType TravData;
  * | ENV_XYTHETA | mMobilty                  | Speeds are used together with the multipliers for the cost calculation. In addition the multipliers are used to activates the movement types (>0). mMinTurnignRadius takes care that the curve primitives are driveable for the system. | 
  * |             | mSBPLEnvFile              | (optional) Allows to load an SBPL environment instead of using the Envire traversability map. | 
  * |             | mSBPLMotionPrimitivesFile | (optional) Allows to use an existing SBPL primitive file instead of creating one based on the mMobility parameters. |
+ * |             | mSBPLMotionPrimitivesCacheDir | (optional) Directory to store the generated primitives as mprim files. Generated primitives are passed to SBPL without a file. |
  * |             | mFootprintLengthMinMax    | The max value is used to define the robot length in SBPL. |
  * |             | mFootprintWidthMinMax     | The max value is used to define the robot width in SBPL. |
  * |             | mNumIntermediatePoints    | Sets the number of intermediate points which are added to each primitive to create smoother trajectories. |
  * |             | mNumPrimPartition         | Defines how much primitive for each movement type should be created. More primitives will optimize the result but increase the planning time. |
  * |             | mPrimAccuracy             | Defines how close a primitive has to reach a discrete end position. If this parameter is reduced towards 0, the discretization error will be reduced but the length of the primitives will be increased and the overall number of primitive for each movement type could also be reduced. | 
+ * |             | mSymmetricPrimitives      | Generates the primitives of the first octant of start angles only and derives the other angles by rotation and reflection, which is faster and keeps the primitives of all angles consistent. |
+ * |             | mSBPLCoarseFactor         | (optional) Plans a 2D path on a grid downsampled by this factor first and restricts the search to a corridor around it. Reduces expansions and memory on large maps. |
+ * |             | mSBPLCorridorWidth        | Distance in meter to each side of the coarse path which belongs to the corridor. |
+ * |             | mSBPLDeferUpdateDist      | (optional) Partial map updates farther than this distance in meter from the last path are applied only once they could affect the solution. |
+ * |             | mSBPLInflateObstacles     | (optional, ENV_XY) Inflates the obstacles by the maximal footprint radius, so the 2D paths keep the footprint free. |
+ * |             | mUseCostToGoField         | (optional) A goal rooted 2D Dijkstra field is used as goal heuristic. It is kept while the goal does not change and repaired incrementally by partial map updates. |
  * 
  * \section TODOs
  * \todo "Adds method to remove obstacles within the start pose."
@@ -137,21 +208,99 @@ typedef envire::TraversabilityGrid::ArrayType TravData;
  */
 class MotionPlanningLibraries
 {   
+    /**
+     * Goal in world and grid coordinates with its discretization error.
+     */
+    struct GoalCandidate {
+        struct State mGoalState;
+        struct State mGoalStateGrid;
+        double mLostX, mLostY;
+        
+        GoalCandidate() : mGoalState(), mGoalStateGrid(), mLostX(0.0), mLostY(0.0) {
+        }
+    };
+    
     Config mConfig;
     
     boost::shared_ptr<AbstractMotionPlanningLibrary> mpPlanningLib;
     
     envire::TraversabilityGrid* mpTravGrid;
+    // Snapshot of the traversability band of the current map. This buffer is
+    // shared (read-only) with the planning library.
     boost::shared_ptr<TravData> mpTravData;
-    // Receives a copy of each trav grid, which is used for partial update testing.
-    envire::TraversabilityGrid* mpLastTravGrid;
+    // Snapshot of the probability band of the current map.
+    boost::shared_ptr<TravData> mpProbData;
+    // Snapshots of the previous map, used for partial update testing.
+    // Both buffers are swapped with the current ones and reused for the next map.
+    boost::shared_ptr<TravData> mpLastTravData;
+    boost::shared_ptr<TravData> mpLastProbData;
+    // Class to cost lookup table of the current map.
+    boost::shared_ptr<TravClassTable> mpTravClassTable;
+    // Provides the snapshots, the diff and the class table if the map has been 
+    // set by setTravGrid(shared_map), NULL otherwise.
+    boost::shared_ptr<SharedMap> mpSharedMap;
+    // Results of the last cell diff, kept as members to reuse their capacity.
+    std::vector<CellUpdate> mCellUpdates;
+    std::vector<CellUpdateSpan> mCellUpdateSpans;
+    // Transformation from grid coordinates to world of the current map, 
+    // used to detect scrolling maps (Config::mShiftScrollingMap).
+    Eigen::Affine3d mGrid2World;
+    bool mGrid2WorldValid;
+    // Frame of the current map within the world (and its inverse), cached 
+    // by setTravGridInternal() for the conversions of the states.
+    Eigen::Affine3d mLocal2World;
+    Eigen::Affine3d mWorld2Local;
     struct State mStartState, mGoalState; // Pose in world coordinates.
     struct State mStartStateGrid, mGoalStateGrid;
     std::vector<State> mPlannedPathInWorld; // Pose in world coordinates.
+    // Filled by planInternal() and exchanged with mPlannedPathInWorld, so the 
+    // capacity of both is reused by the following queries.
+    std::vector<State> mPathBuffer;
+    // Cells of the current map (row-major) swept by the footprint along 
+    // mPlannedPathInWorld, empty if unknown (Config::Replanning::mReplanOnlyIfPathAffected).
+    std::vector<uint8_t> mPathCells;
+    // The path cells have been skipped by a plan() at its deadline and are 
+    // computed by the next map update (Config::mEndToEndDeadline).
+    bool mPathCellsPending;
+    // Trajectories of mPlannedPathInWorld, built by the first request after the 
+    // path has been changed (see buildTrajectories()).
+    bool mTrajectoriesValid;
+    std::vector<base::Trajectory> mTrajectoriesInWorld;
+    // Points of each trajectory every 0.1 m from its end to its start (escape trajectory).
+    std::vector< std::vector<base::Vector3d> > mTrajectorySamples;
+    // Clearance of the current map used by the escape trajectory. Created by the
+    // first escape request and updated by the following partial map updates.
+    // With a shared map its distance map is used instead (mpSharedEscapeDistanceMap).
+    ObstacleDistanceMap mEscapeDistanceMap;
+    boost::shared_ptr<ObstacleDistanceMap const> mpSharedEscapeDistanceMap;
+    PathPostProcessor mPathPostProcessor; // Config::mPostProcessPath
+    // computeCostField(): Dijkstra field rooted at the last start cell on 
+    // mCostFieldMap, the SBPL costs of each cell (obstacle class 
+    // COST_FIELD_BLOCKED for inflated obstacles).
+    CostToGoField mCostField;
+    TravData mCostFieldMap;
+    ObstacleDistanceMap mCostFieldDistanceMap;
     bool mReplanRequired;
     bool mNewGoalReceived;
     double mLostX; // Used to trac discretization error.
     double mLostY;
+    // Goals of planToGoals() if they are planned within a single query, 
+    // empty otherwise. planInternal() sets the reached one as current goal.
+    std::vector<struct GoalCandidate> mGoalCandidates;
+    // Asynchronous planning.
+    std::thread mAsyncThread;
+    std::atomic<bool> mAsyncCancel;
+    std::atomic<bool> mAsyncRunning;
+    std::mutex mAsyncMutex; // Protects mpLatestSolution.
+    boost::shared_ptr<const struct AnytimeSolution> mpLatestSolution;
+    
+    struct PlanningStatistics mStatistics;
+    
+    // Records the calls if Config::mRecordFile is set.
+    boost::shared_ptr<PlanningRecorder> mpRecorder;
+    // Diff collected only for the recording if the map has been reinitialized.
+    std::vector<CellUpdate> mRecordCellUpdates;
+    std::vector<CellUpdateSpan> mRecordCellUpdateSpans;
     
  public: 
     enum MplErrors mError; 
@@ -168,6 +317,16 @@ class MotionPlanningLibraries
      */
     bool setTravGrid(envire::Environment* env, std::string trav_map_id);
     
+    /**
+     * Applies the current map of \a shared_map, which has to be called after
+     * each SharedMap::setTravGrid(). Instead of copying and comparing the map 
+     * itself the planner uses the snapshots, the diff and the class table of 
+     * the shared map, so several planners (e.g. of different robots) can 
+     * work on a single copy of the map. If revisions of the shared map have 
+     * been skipped, the diff is collected against the previously applied map.
+     */
+    bool setTravGrid(boost::shared_ptr<SharedMap> shared_map);
+    
     inline bool travGridAvailable() {
         return mpTravGrid != NULL;
     }
@@ -196,6 +355,21 @@ class MotionPlanningLibraries
         return (mGoalState.mStateType != STATE_EMPTY);
     }
     
+    /**
+     * Stores the current map (the snapshot used for planning), start, goal and
+     * configuration as a binary planning problem, see PlanningProblem.
+     * Can be used to log planning requests which are replayed offline.
+     */
+    bool storeProblem(std::string const& path);
+    
+    /**
+     * Sets map, start and goal of a loaded planning problem. The configuration
+     * of the problem is not applied, it has to be passed to the constructor.
+     * The map refers to the environment of \a problem, so it has to stay
+     * loaded as long as this map is used.
+     */
+    bool setProblem(PlanningProblem& problem);
+    
     /**
      * Checks if the trav map, start pose and goal pose are available.
      * The trav map is required to set start and goal.
@@ -226,18 +400,102 @@ class MotionPlanningLibraries
      * false will be returned and the error state will be set accordingly. 
      * isPlanningRequired() can be used before planning to check whether a
      * replanning is necessary. 
+     * If Config::mEndToEndDeadline is set \a max_time covers the complete call,
+     * otherwise only solve().
      */
     bool plan(double max_time, double& cost); 
     
+    /**
+     * Plans from the current start state to each of the passed goals (world coordinates)
+     * on the current map, e.g. to request cost estimates for several candidate goals.
+     * The goals are distributed to Config::mNumBatchThreads worker threads,
+     * each of them using its own planning library instance which shares the 
+     * read-only map data with all the other ones. The planning library of this
+     * object and the current path are not modified.
+     * \param max_time Planning time in seconds for each goal.
+     * \param results Contains one result for each goal (same order).
+     * \return False if the batch could not be started (missing map or start state
+     * or arm planning), the success of each goal is stored within its result.
+     */
+    bool planBatch(std::vector<struct State> const& goals, double max_time,
+            std::vector<struct BatchResult>& results);
+    
+    /**
+     * Plans from the current start state to the cheapest of the passed goals
+     * (world coordinates), e.g. to reach any of several viewpoints or docking poses.
+     * If the planning library supports several goals within a single query
+     * (AbstractMotionPlanningLibrary::setStartGoals()) one search is executed, 
+     * otherwise the goals are planned one after another sharing \a max_time 
+     * and the cheapest solution is kept. Afterwards the reached goal is the 
+     * current goal and its path the current path.
+     * \param goal_index Index of the reached goal, -1 if no goal has been reached.
+     * \return False if no goal could be reached, see getError().
+     */
+    bool planToGoals(std::vector<struct State> const& goals, double max_time,
+            double& cost, int& goal_index);
+    
+    /**
+     * Like plan() but solve() is executed on a background thread in steps
+     * of \a step_time seconds for at most \a max_time seconds. Each improved solution 
+     * (lower cost or epsilon) is stored as the latest solution and passed to the 
+     * callback (called on the planning thread, should return quickly).
+     * The planning stops after the first solution if Config::mSearchUntilFirstSolution
+     * is set, if an epsilon of 1.0 has been reached, if the time is over or if 
+     * cancelAsync() is called. A running asynchronous planning is cancelled by all 
+     * the methods which change the planning problem (map, start, goal, plan()).
+     * While it is running only getLatestSolution(), isPlanningAsync() and 
+     * cancelAsync() should be used.
+     * \return False if the planning could not be started, see getError().
+     */
+    bool planAsync(double max_time, double step_time, 
+            AnytimeSolutionCallback callback = AnytimeSolutionCallback());
+    
+    /**
+     * Stops the asynchronous planning and waits for the planning thread. 
+     * Afterwards the latest solution is available as the current path 
+     * (getStatesInWorld(), getTrajectoryInWorld()...).
+     */
+    void cancelAsync();
+    
+    inline bool isPlanningAsync() const {
+        return mAsyncRunning;
+    }
+    
+    /**
+     * Copies the latest solution of the asynchronous planning. If the planning
+     * has finished on its own the planning thread is joined and the solution is
+     * applied like in cancelAsync().
+     * \return False if no solution has been published yet.
+     */
+    bool getLatestSolution(struct AnytimeSolution& solution);
+    
     /**
      * Like getStates() but with world coordinates.
      */
     std::vector<struct State> getStatesInWorld();
     
+    /**
+     * Copies the states into \a states, which keeps its capacity. If the same
+     * vector is passed after each query no allocation is required as long as 
+     * the paths do not get longer.
+     */
+    void getStatesInWorld(std::vector<struct State>& states) const;
+    
+    /**
+     * Current path without copying it, valid until the next query 
+     * or the next map update.
+     */
+    inline std::vector<struct State> const& getStatesInWorldRef() const {
+        return mPlannedPathInWorld;
+    }
+    
     // POSE SPECIFIC METHODS.
     /** Returns the path stored in mPath as a list of waypoints. */
     std::vector<base::Waypoint> getPathInWorld();
     
+    /** Like getPathInWorld(), reuses the capacity of \a path. */
+    void getPathInWorld(std::vector<base::Waypoint>& path) const;
+    
     /** 
      * Returns the path stored in mPath as a trajectory (spline). 
      * If the speed parameter is set it will be used, otherwise
@@ -261,6 +519,21 @@ class MotionPlanningLibraries
      */
     std::vector<base::Trajectory> getEscapeTrajectoryInWorld();
     
+    /**
+     * Travel costs from \a start (world coordinates) to each cell of the current
+     * map, e.g. for exploration or task allocation. A single Dijkstra search 
+     * (8-connected cells) is executed on the SBPL costs of the cells 
+     * (see Sbpl::createSBPLMap()) using the units of the SBPL environments. 
+     * If the start cell is the same as within the last call, the previous 
+     * field is reused and only repaired at the cells whose costs have changed.
+     * \param costs Row-major costs (index y * cell_size_x + x) aligned with the
+     * traversability map, infinity for unreachable cells.
+     * \param inflate_obstacles If set, cells within Config::getMaxRadius() 
+     * of an obstacle or the map border are regarded as obstacles.
+     */
+    bool computeCostField(struct State start, std::vector<float>& costs, 
+            bool inflate_obstacles = false);
+    
     /** Prints the current path to the console. */
     void printPathInWorld();
     
@@ -286,6 +559,31 @@ class MotionPlanningLibraries
     
     bool getSbplMotionPrimitives(struct SbplMotionPrimitives& prims);
     
+    /**
+     * ENV_ARM: Sets the collision backend which is used to check the arm states,
+     * a replanning is required afterwards. Environment changes are reported 
+     * by ArmCollisionChecker::getEnvironmentRevision().
+     * \return False if the planning library does not support collision checks.
+     */
+    bool setArmCollisionChecker(boost::shared_ptr<ArmCollisionChecker const> checker);
+    
+    /**
+     * Returns the row spans of the cells which have been changed by the 
+     * last partial map update. Empty if the last map has been completely reinitialized.
+     */
+    inline std::vector<CellUpdateSpan> const& getCellUpdateSpans() const {
+        return mCellUpdateSpans;
+    }
+    
+    /**
+     * Timings and counters of the last setTravGrid(), setStartState(), setGoalState()
+     * and plan() calls, e.g. to be published by a task. Not updated by 
+     * planBatch() and planAsync().
+     */
+    inline struct PlanningStatistics const& getStatistics() const {
+        return mStatistics;
+    }
+    
     /**
      * Converts the world pose to grid coordinates including the transformed orientation.
      */        
@@ -311,22 +609,208 @@ class MotionPlanningLibraries
         base::samples::RigidBodyState const& grid_local_pose,
         base::samples::RigidBodyState& world_pose);
     
+    /**
+     * Collects different cells regarding the klass and the probability.
+     * The size of all snapshots have to be the same. The driveability of the
+     * changed cells is taken from \a trav_class_table.
+     * Unchanged blocks of eight cells are skipped using word comparisons. 
+     * In addition to the cell updates the changed row spans are collected.
+     * If the map has been shifted, the new cell (x, y) is compared with the old
+     * cell (x + shift_x, y + shift_y), cells without an old counterpart are always collected.
+     * Used by SharedMap and the kernel benchmarks as well.
+     */
+    static void collectCellUpdates(TravData const& trav_old, TravData const& prob_old,
+            TravData const& trav_new, TravData const& prob_new,
+            TravClassTable const& trav_class_table,
+            std::vector<CellUpdate>& cell_updates,
+            std::vector<CellUpdateSpan>& cell_update_spans,
+            int shift_x = 0, int shift_y = 0);
+    
  private:
+    /**
+     * Describes how a map has been applied by setTravGridInternal().
+     */
+    struct MapUpdateInfo {
+        // Map whose bands have been copied to the snapshots, NULL if the
+        // call failed before.
+        envire::TraversabilityGrid* mpTravGrid;
+        // mCellUpdateSpans contain the diff to the previous snapshots.
+        bool mSpansValid;
+        int mShiftX, mShiftY;
+        
+        MapUpdateInfo() : mpTravGrid(NULL), mSpansValid(false), mShiftX(0), mShiftY(0) {
+        }
+    };
+    
+    /**
+     * Implementations of the public calls without recording.
+     */
+    bool setTravGridInternal(envire::Environment* env, std::string trav_map_id,
+            struct MapUpdateInfo& update);
+    /**
+     * Applies \a trav_grid, the snapshots, the diff and the class table
+     * are taken from \a shared_map if it is not NULL.
+     */
+    bool setTravGridInternal(envire::TraversabilityGrid* trav_grid, 
+            SharedMap* shared_map, struct MapUpdateInfo& update);
+    bool setStartStateInternal(struct State new_state);
+    bool setGoalStateInternal(struct State new_state, bool reset);
+    bool planInternal(double max_time, double& cost);
+    
+    /**
+     * Converts the goal to the grid without passing it to the planning library.
+     */
+    bool convertGoal(struct State goal_state, struct GoalCandidate& goal);
+    
+    /**
+     * Sets mGoalState, mGoalStateGrid and the discretization error.
+     */
+    void setGoalCandidate(struct GoalCandidate const& goal);
+    
+    /**
+     * Records the current snapshots, as diff if the previous map of the
+     * recording has the same size.
+     */
+    void recordMap(struct MapUpdateInfo const& update, bool success, double duration);
+    
+    /**
+     * Starts a new segment of the recording if the current one is full
+     * and records the current map, start and goal as its keyframe.
+     */
+    void recordKeyframeIfRequired();
+    
+    /**
+     * Creates mTrajectoriesInWorld and mTrajectorySamples from mPlannedPathInWorld.
+     */
+    void buildTrajectories();
+    
+    /**
+     * Returns true if the circle with \a radius_grid around the world \a point
+     * is free, uses mEscapeDistanceMap.
+     */
+    bool isEscapePointFree(base::Vector3d const& point, unsigned int radius_grid);
+    
+    /**
+     * Marks the cells of the current map within Config::getMaxRadius() of 
+     * mPlannedPathInWorld, see mPathCells.
+     */
+    void updatePathCells();
+    
+    /**
+     * Returns true if one of the cell updates lies on mPathCells.
+     */
+    bool isPathAffected(std::vector<CellUpdate> const& cell_updates) const;
+    
+    /**
+     * Has to be called if mPlannedPathInWorld has been changed.
+     */
+    inline void invalidateTrajectories() {
+        mTrajectoriesValid = false;
+    }
+    
+    /**
+     * Creates the planning library requested within \a config.
+     * Throws a std::runtime_error if the environment is not available.
+     */
+    static boost::shared_ptr<AbstractMotionPlanningLibrary> createPlanningLibrary(Config config);
+    
+    /**
+     * Processes the goals of planBatch() using its own planning library
+     * until all goals have been taken. \a next_goal is protected by \a mutex.
+     */
+    void planBatchWorker(std::vector<struct State> const& goals, double max_time,
+            std::vector<struct BatchResult>& results,
+            size_t& next_goal, std::mutex& mutex);
+    
+    /**
+     * Executed by the planning thread of planAsync().
+     */
+    void planAsyncLoop(double max_time, double step_time, 
+            AnytimeSolutionCallback callback);
+    
+    /**
+     * Converts the path filled by the planning library to world coordinates,
+     * all positions are transformed at once using the frame \a local2world of the map.
+     */
+    static void convertPathToWorld(envire::TraversabilityGrid const* trav,
+            Eigen::Affine3d const& local2world,
+            bool pos_defined_in_local_grid,
+            double lost_x, double lost_y,
+            std::vector<struct State>& path);
+    
+    /**
+     * world2grid() using the passed inverse frame \a world2local of the map 
+     * instead of requesting it from the environment.
+     */
+    static bool world2grid(envire::TraversabilityGrid const* trav,
+            Eigen::Affine3d const& world2local,
+            base::samples::RigidBodyState const& world_pose, 
+            base::samples::RigidBodyState& grid_pose,
+            double* lost_x, double* lost_y);
+    
+    /**
+     * Transformations of grid2world() and gridlocal2world() using the passed 
+     * discretization error instead of the one of the current goal pose.
+     */
+    static bool grid2world(envire::TraversabilityGrid const* trav,
+            base::samples::RigidBodyState const& grid_pose, 
+            double lost_x, double lost_y,
+            base::samples::RigidBodyState& world_pose);
+    
+    static bool gridlocal2world(envire::TraversabilityGrid const* trav,
+            base::samples::RigidBodyState const& grid_local_pose,
+            double lost_x, double lost_y,
+            base::samples::RigidBodyState& world_pose);
+    
     /**
      * Extracts the traversability map \a trav_map_id from the passed environment.
      * If the id is not available, the first traversability map will be used.
      */
-    envire::TraversabilityGrid* extractTravGrid(envire::Environment* env, 
+    static envire::TraversabilityGrid* extractTravGrid(envire::Environment* env, 
             std::string trav_map_id);
     
     /**
-     * Collects different cells regarding the klass and the probability.
-     * The size of both maps have to be the same.
-     * TODO Currently 
+     * Copies the passed band into the snapshot buffer \a snapshot.
+     * The buffer is reused if it has the same shape and if it is not
+     * referenced anywhere else (e.g. by a planning library), otherwise
+     * a new buffer is allocated.
+     */
+    static void copyToSnapshot(TravData const& band, 
+            boost::shared_ptr<TravData>& snapshot);
+    
+    /**
+     * Transformation from the frame of the map to the world frame.
+     */
+    static Eigen::Affine3d getLocal2World(envire::TraversabilityGrid const* trav);
+    
+    /**
+     * Transformation from grid coordinates (cell indices) to the world frame.
+     */
+    static Eigen::Affine3d getGrid2World(envire::TraversabilityGrid const* trav, 
+            Eigen::Affine3d const& local2world);
+    
+    /**
+     * Returns true if the map with the transformation \a grid2world is a 
+     * translation of the current map by whole cells. The new cell (x, y) 
+     * covers the current cell (x + shift_x, y + shift_y).
+     */
+    bool getMapShift(Eigen::Affine3d const& grid2world, int& shift_x, int& shift_y) const;
+    
+    /**
+     * Like getMapShift() but compares with the map \a old_grid2world.
      */
-    void collectCellUpdates( envire::TraversabilityGrid* old_map, 
-            envire::TraversabilityGrid* new_map,
-            std::vector<CellUpdate>& cell_updates);
+    static bool getMapShift(Eigen::Affine3d const& old_grid2world, 
+            Eigen::Affine3d const& grid2world, int& shift_x, int& shift_y);
+    
+    /**
+     * Fills mCellUpdates and mCellUpdateSpans with the diff of the last to the
+     * current snapshots. The diff of \a shared_map is copied if it 
+     * refers to the same snapshots and uses the same shift.
+     */
+    void collectMapDiff(SharedMap const* shared_map, int shift_x, int shift_y);
+    
+    // Uses the private helpers to ingest the maps.
+    friend class SharedMap;
 };
 
 } // end namespace motion_planning_libraries
@@ -0,0 +1,177 @@
+#include "ObstacleDistanceMap.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+ObstacleDistanceMap::ObstacleDistanceMap() :
+        mCellSizeX(0),
+        mCellSizeY(0),
+        mMaxDist(0),
+        mMaxSquaredDist(0),
+        mSquaredDist(),
+        mColumnDist(),
+        mRowDist(),
+        mEnvelopeVertices(),
+        mEnvelopeBorders() {
+}
+
+void ObstacleDistanceMap::create(TravData const& trav_data,
+        TravClassTable const& trav_class_table,
+        unsigned int max_dist) {
+    mCellSizeX = trav_data.shape()[1];
+    mCellSizeY = trav_data.shape()[0];
+    mMaxDist = max_dist;
+    mMaxSquaredDist = max_dist * max_dist;
+    mSquaredDist.assign(mCellSizeX * mCellSizeY, mMaxSquaredDist);
+
+    calculate(trav_data, trav_class_table,
+            0, mCellSizeX, 0, mCellSizeY,
+            0, mCellSizeX, 0, mCellSizeY);
+}
+
+bool ObstacleDistanceMap::update(TravData const& trav_data,
+        TravClassTable const& trav_class_table,
+        std::vector<CellUpdate> const& cell_updates) {
+
+    if(mSquaredDist.empty() ||
+            (int)trav_data.shape()[1] != mCellSizeX ||
+            (int)trav_data.shape()[0] != mCellSizeY) {
+        return false;
+    }
+
+    // Only cells which became an obstacle or are not an obstacle anymore
+    // influence the distances. Obstacle cells are the only ones with a distance of 0.
+    int x_min = mCellSizeX, x_max = -1;
+    int y_min = mCellSizeY, y_max = -1;
+    std::vector<CellUpdate>::const_iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); ++it) {
+        bool was_obstacle = mSquaredDist[it->y * mCellSizeX + it->x] == 0;
+        if(was_obstacle == trav_class_table.isObstacle(it->klass)) {
+            continue;
+        }
+        x_min = std::min(x_min, (int)it->x);
+        x_max = std::max(x_max, (int)it->x);
+        y_min = std::min(y_min, (int)it->y);
+        y_max = std::max(y_max, (int)it->y);
+    }
+
+    if(x_max < 0) { // No obstacle has been added or removed.
+        return true;
+    }
+
+    // Distances (capped at mMaxDist) within the changed area extended by mMaxDist
+    // can change, their closest obstacles lie within the area extended by 2 * mMaxDist.
+    int dist = mMaxDist;
+    int x_store_begin = std::max(0, x_min - dist);
+    int x_store_end = std::min(mCellSizeX, x_max + 1 + dist);
+    int y_store_begin = std::max(0, y_min - dist);
+    int y_store_end = std::min(mCellSizeY, y_max + 1 + dist);
+
+    calculate(trav_data, trav_class_table,
+            std::max(0, x_store_begin - dist), std::min(mCellSizeX, x_store_end + dist),
+            std::max(0, y_store_begin - dist), std::min(mCellSizeY, y_store_end + dist),
+            x_store_begin, x_store_end, y_store_begin, y_store_end);
+
+    LOG_DEBUG("Obstacle distance map has been updated within (%d,%d) - (%d,%d)",
+            x_store_begin, y_store_begin, x_store_end, y_store_end);
+    return true;
+}
+
+// PRIVATE
+void ObstacleDistanceMap::calculate(TravData const& trav_data,
+        TravClassTable const& trav_class_table,
+        int x_begin, int x_end, int y_begin, int y_end,
+        int x_store_begin, int x_store_end, int y_store_begin, int y_store_end) {
+
+    const uint32_t INF = std::numeric_limits<uint32_t>::max();
+    int width = x_end - x_begin;
+    int height = y_end - y_begin;
+
+    if(width <= 0 || height <= 0) {
+        return;
+    }
+
+    // Squared distance to the closest obstacle within the same column.
+    mColumnDist.assign(width * height, INF);
+    for(int x = 0; x < width; ++x) {
+        int last_obstacle = -1;
+        for(int y = 0; y < height; ++y) {
+            if(trav_class_table.isObstacle(trav_data[y_begin + y][x_begin + x])) {
+                last_obstacle = y;
+            }
+            if(last_obstacle >= 0) {
+                uint32_t d = y - last_obstacle;
+                mColumnDist[y * width + x] = d * d;
+            }
+        }
+        last_obstacle = -1;
+        for(int y = height - 1; y >= 0; --y) {
+            if(mColumnDist[y * width + x] == 0) {
+                last_obstacle = y;
+            }
+            if(last_obstacle >= 0) {
+                uint32_t d = last_obstacle - y;
+                mColumnDist[y * width + x] = std::min(mColumnDist[y * width + x], d * d);
+            }
+        }
+    }
+
+    // Lower envelope of the parabolas of each row
+    // (Felzenszwalb and Huttenlocher, Distance Transforms of Sampled Functions).
+    mRowDist.resize(width);
+    mEnvelopeVertices.resize(width);
+    mEnvelopeBorders.resize(width + 1);
+    for(int y = std::max(y_begin, y_store_begin); y < std::min(y_end, y_store_end); ++y) {
+        uint32_t* f = &mColumnDist[(y - y_begin) * width];
+        int k = -1;
+        for(int q = 0; q < width; ++q) {
+            if(f[q] == INF) {
+                continue;
+            }
+            double s = 0.0;
+            while(k >= 0) {
+                int v = mEnvelopeVertices[k];
+                s = (((double)f[q] + (double)q * q) - ((double)f[v] + (double)v * v)) / (2.0 * (q - v));
+                if(s > mEnvelopeBorders[k]) {
+                    break;
+                }
+                k--;
+            }
+            k++;
+            mEnvelopeVertices[k] = q;
+            mEnvelopeBorders[k] = (k == 0) ? -std::numeric_limits<double>::infinity() : s;
+            mEnvelopeBorders[k + 1] = std::numeric_limits<double>::infinity();
+        }
+
+        if(k < 0) {
+            std::fill(mRowDist.begin(), mRowDist.end(), INF);
+        } else {
+            int j = 0;
+            for(int q = 0; q < width; ++q) {
+                while(mEnvelopeBorders[j + 1] < q) {
+                    j++;
+                }
+                int v = mEnvelopeVertices[j];
+                mRowDist[q] = (q - v) * (q - v) + f[v];
+            }
+        }
+
+        // Stores the results regarding the area outside of the map as obstacles.
+        uint32_t* dist_p = &mSquaredDist[y * mCellSizeX];
+        uint32_t border_y = std::min(y + 1, mCellSizeY - y);
+        border_y *= border_y;
+        for(int x = std::max(x_begin, x_store_begin); x < std::min(x_end, x_store_end); ++x) {
+            uint32_t border_x = std::min(x + 1, mCellSizeX - x);
+            border_x *= border_x;
+            dist_p[x] = std::min(std::min(mRowDist[x - x_begin], mMaxSquaredDist),
+                    std::min(border_x, border_y));
+        }
+    }
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,97 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_OBSTACLE_DISTANCE_MAP_HPP_
+#define _MOTION_PLANNING_LIBRARIES_OBSTACLE_DISTANCE_MAP_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+#include "AbstractMotionPlanningLibrary.hpp"
+#include "TravClassTable.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Euclidean distance transform of the obstacle layer of a traversability map.
+ * Contains for each cell the squared distance (in grid cells) to the closest
+ * obstacle cell. The area outside of the map is regarded as an obstacle.
+ * The distances are capped at \a max_dist, so a partial map update only has
+ * to recalculate the area around the changed cells.
+ *
+ * Allows to check a circular footprint with a single lookup: A footprint
+ * with the radius r (r < max_dist) placed on cell (x,y) is valid if
+ * getSquaredDist(x,y) > r*r.
+ */
+class ObstacleDistanceMap {
+ private:
+    int mCellSizeX;
+    int mCellSizeY;
+    unsigned int mMaxDist;
+    uint32_t mMaxSquaredDist;
+    std::vector<uint32_t> mSquaredDist;
+
+    // Buffers for the distance transform.
+    std::vector<uint32_t> mColumnDist;
+    std::vector<uint32_t> mRowDist;
+    std::vector<int> mEnvelopeVertices;
+    std::vector<double> mEnvelopeBorders;
+
+ public:
+    ObstacleDistanceMap();
+
+    /**
+     * (Re-)creates the complete distance map.
+     * \param max_dist Distances in cells which are greater or equal will be set to \a max_dist.
+     */
+    void create(TravData const& trav_data, TravClassTable const& trav_class_table,
+            unsigned int max_dist);
+
+    /**
+     * Recalculates the area which can be influenced by the changed cells.
+     * \a trav_data has to contain the new map already. If the size of the map
+     * has changed (or the distance map has not been created yet) false is returned
+     * and create() has to be called instead.
+     */
+    bool update(TravData const& trav_data, TravClassTable const& trav_class_table,
+            std::vector<CellUpdate> const& cell_updates);
+
+    inline bool empty() const {
+        return mSquaredDist.empty();
+    }
+
+    inline unsigned int getMaxDist() const {
+        return mMaxDist;
+    }
+
+    /**
+     * Returns the capped squared distance of the cell to the closest obstacle
+     * or 0 if the cell lies outside of the map.
+     */
+    inline uint32_t getSquaredDist(int x, int y) const {
+        if(x < 0 || x >= mCellSizeX || y < 0 || y >= mCellSizeY) {
+            return 0;
+        }
+        return mSquaredDist[y * mCellSizeX + x];
+    }
+
+    /**
+     * Returns true if no obstacle lies within the circle (\a radius in grid cells)
+     * around the cell. \a radius has to be smaller than getMaxDist().
+     */
+    inline bool isFree(int x, int y, unsigned int radius) const {
+        return getSquaredDist(x, y) > radius * radius;
+    }
+
+ private:
+    /**
+     * Calculates the distance transform of the area [x_begin, x_end) x [y_begin, y_end)
+     * using only the obstacles within this area and the borders of the map and
+     * stores the results of the area [x_store_begin, x_store_end) x [y_store_begin, y_store_end).
+     */
+    void calculate(TravData const& trav_data, TravClassTable const& trav_class_table,
+            int x_begin, int x_end, int y_begin, int y_end,
+            int x_store_begin, int x_store_end, int y_store_begin, int y_store_end);
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_OBSTACLE_DISTANCE_MAP_HPP_
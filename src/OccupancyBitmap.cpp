@@ -0,0 +1,88 @@
+#include "OccupancyBitmap.hpp"
+
+#include <algorithm>
+
+namespace motion_planning_libraries
+{
+
+OccupancyBitmap::OccupancyBitmap() :
+        mCellSizeX(0),
+        mCellSizeY(0),
+        mWordsPerRow(0),
+        mNumTileRows(0),
+        mBits() {
+}
+
+void OccupancyBitmap::create(TravData const& trav_data, TravClassTable const& trav_class_table) {
+    mCellSizeX = trav_data.shape()[1];
+    mCellSizeY = trav_data.shape()[0];
+    mWordsPerRow = (mCellSizeX + 63) / 64 + 1;
+    mNumTileRows = (mCellSizeY + TILE_ROWS - 1) / TILE_ROWS;
+    mBits.assign((size_t)mWordsPerRow * mNumTileRows * TILE_ROWS, 0);
+
+    for(int y = 0; y < mCellSizeY; ++y) {
+        const uint8_t* data_p = trav_data.data() + (size_t)y * mCellSizeX;
+        uint64_t* row_p = &mBits[getWordIndex(0, y)];
+        for(int x = 0; x < mCellSizeX; ++x) {
+            if(trav_class_table.isObstacle(data_p[x])) {
+                row_p[(size_t)(x >> 6) * TILE_ROWS] |= (uint64_t)1 << (x & 63);
+            }
+        }
+    }
+}
+
+bool OccupancyBitmap::update(TravData const& trav_data, TravClassTable const& trav_class_table,
+        std::vector<CellUpdate> const& cell_updates) {
+    if(mBits.empty() || mCellSizeX != (int)trav_data.shape()[1] ||
+            mCellSizeY != (int)trav_data.shape()[0]) {
+        return false;
+    }
+    std::vector<CellUpdate>::const_iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); ++it) {
+        uint64_t& word = mBits[getWordIndex(it->x >> 6, it->y)];
+        uint64_t bit = (uint64_t)1 << (it->x & 63);
+        if(trav_class_table.isObstacle(it->klass)) {
+            word |= bit;
+        } else {
+            word &= ~bit;
+        }
+    }
+    return true;
+}
+
+void OccupancyBitmap::createMask(std::vector<int16_t> const& offsets_x,
+        std::vector<int16_t> const& offsets_y, FootprintMask& mask) {
+    mask = FootprintMask();
+    if(offsets_x.empty() || offsets_x.size() != offsets_y.size()) {
+        return;
+    }
+    mask.mMinX = *std::min_element(offsets_x.begin(), offsets_x.end());
+    mask.mMaxX = *std::max_element(offsets_x.begin(), offsets_x.end());
+    mask.mMinY = *std::min_element(offsets_y.begin(), offsets_y.end());
+    mask.mMaxY = *std::max_element(offsets_y.begin(), offsets_y.end());
+    mask.mWordsPerRow = (mask.mMaxX - mask.mMinX) / 64 + 1;
+    mask.mWords.assign((size_t)mask.mWordsPerRow * (mask.mMaxY - mask.mMinY + 1), 0);
+    for(size_t i = 0; i < offsets_x.size(); ++i) {
+        int bit = offsets_x[i] - mask.mMinX;
+        mask.mWords[(size_t)(offsets_y[i] - mask.mMinY) * mask.mWordsPerRow + bit / 64] |=
+                (uint64_t)1 << (bit % 64);
+    }
+}
+
+// PRIVATE
+bool OccupancyBitmap::isFreeAtBorder(FootprintMask const& mask, int x, int y) const {
+    int num_rows = mask.mMaxY - mask.mMinY + 1;
+    for(int r = 0; r < num_rows; ++r) {
+        for(int w = 0; w < mask.mWordsPerRow; ++w) {
+            uint64_t bits = mask.mWords[(size_t)r * mask.mWordsPerRow + w];
+            for(int i = 0; bits != 0; ++i, bits >>= 1) {
+                if((bits & 1) && isObstacle(x + mask.mMinX + 64 * w + i, y + mask.mMinY + r)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,144 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_OCCUPANCY_BITMAP_HPP_
+#define _MOTION_PLANNING_LIBRARIES_OCCUPANCY_BITMAP_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+#include "AbstractMotionPlanningLibrary.hpp"
+#include "TravClassTable.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Cells of a footprint as rows of bits: Bit i of word w within row r
+ * stands for the offset (mMinX + 64 * w + i, mMinY + r).
+ */
+struct FootprintMask {
+    int mMinX, mMaxX, mMinY, mMaxY;
+    int mWordsPerRow;
+    std::vector<uint64_t> mWords;
+
+    FootprintMask() : mMinX(0), mMaxX(0), mMinY(0), mMaxY(0), mWordsPerRow(0), mWords() {
+    }
+
+    inline bool empty() const {
+        return mWords.empty();
+    }
+};
+
+/**
+ * Obstacle layer of a traversability map with one bit per cell (set for
+ * a driveability of 0). A footprint check reads 64 cells of a row with a
+ * single load and compares them with the FootprintMask by an AND, so only
+ * an eighth of the memory of the class bytes is touched and the class table
+ * is not involved.
+ *
+ * The words are stored in tiles of 64 x TILE_ROWS cells: The words of
+ * consecutive rows within a tile are adjacent, so the rows of a footprint
+ * share their cache lines instead of loading a line for each map row.
+ */
+class OccupancyBitmap {
+ public:
+    static const int TILE_ROWS = 64;
+
+ private:
+    int mCellSizeX;
+    int mCellSizeY;
+    // Number of word columns, one more than required so 64 bits starting
+    // at any cell of a row can be read without a border check.
+    int mWordsPerRow;
+    int mNumTileRows;
+    std::vector<uint64_t> mBits;
+
+ public:
+    OccupancyBitmap();
+
+    /**
+     * (Re-)creates the complete bitmap.
+     */
+    void create(TravData const& trav_data, TravClassTable const& trav_class_table);
+
+    /**
+     * Sets the bits of the changed cells. If the size of the map has changed
+     * (or the bitmap has not been created yet) false is returned and
+     * create() has to be called instead.
+     */
+    bool update(TravData const& trav_data, TravClassTable const& trav_class_table,
+            std::vector<CellUpdate> const& cell_updates);
+
+    inline bool empty() const {
+        return mBits.empty();
+    }
+
+    /**
+     * Cells outside of the map are regarded as obstacles.
+     */
+    inline bool isObstacle(int x, int y) const {
+        if(x < 0 || x >= mCellSizeX || y < 0 || y >= mCellSizeY) {
+            return true;
+        }
+        return (mBits[getWordIndex(x >> 6, y)] >> (x & 63)) & 1;
+    }
+
+    /**
+     * Returns true if the footprint placed on cell (\a x, \a y) lies within
+     * the map and does not touch an obstacle.
+     */
+    inline bool isFree(FootprintMask const& mask, int x, int y) const {
+        int x_begin = x + mask.mMinX;
+        int y_begin = y + mask.mMinY;
+        if(x_begin < 0 || x + mask.mMaxX >= mCellSizeX ||
+                y_begin < 0 || y + mask.mMaxY >= mCellSizeY) {
+            return isFreeAtBorder(mask, x, y);
+        }
+        const uint64_t* mask_p = mask.mWords.empty() ? NULL : &mask.mWords[0];
+        int num_rows = mask.mMaxY - mask.mMinY + 1;
+        for(int r = 0; r < num_rows; ++r) {
+            const uint64_t* row_p = &mBits[getWordIndex(0, y_begin + r)];
+            for(int w = 0; w < mask.mWordsPerRow; ++w, ++mask_p) {
+                if(*mask_p != 0 && (getBits(row_p, x_begin + 64 * w) & *mask_p) != 0) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Converts the cell offsets of a footprint (see FootprintStencil).
+     */
+    static void createMask(std::vector<int16_t> const& offsets_x,
+            std::vector<int16_t> const& offsets_y, FootprintMask& mask);
+
+ private:
+    /**
+     * Index of the word \a word_x (cells 64 * word_x to 64 * word_x + 63) of row \a y.
+     */
+    inline size_t getWordIndex(int word_x, int y) const {
+        return ((size_t)(y / TILE_ROWS) * mWordsPerRow + word_x) * TILE_ROWS + y % TILE_ROWS;
+    }
+
+    /**
+     * 64 bits of a row starting at cell \a x (bit 0), \a row_p points to
+     * the first word of the row. The words of a row are TILE_ROWS apart.
+     */
+    static inline uint64_t getBits(const uint64_t* row_p, int x) {
+        const uint64_t* word_p = row_p + (size_t)(x >> 6) * TILE_ROWS;
+        int shift = x & 63;
+        if(shift == 0) {
+            return *word_p;
+        }
+        return (word_p[0] >> shift) | (word_p[TILE_ROWS] << (64 - shift));
+    }
+
+    /**
+     * Checks the cells of the mask one by one, used if its bounding box
+     * exceeds the map.
+     */
+    bool isFreeAtBorder(FootprintMask const& mask, int x, int y) const;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_OCCUPANCY_BITMAP_HPP_
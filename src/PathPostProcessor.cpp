@@ -0,0 +1,406 @@
+#include "PathPostProcessor.hpp"
+
+#include <cmath>
+
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+// Corners with a smaller change of direction (rad) are not smoothed.
+const double MIN_CORNER_ANGLE = 0.017;
+// Max distance (grid cells) of a state to the connection of its neighbours to be removed.
+const double COLLINEAR_TOLERANCE = 1e-3;
+
+enum MotionCategory {
+    MOTION_FORWARD,
+    MOTION_BACKWARD,
+    MOTION_FIXED // Point turns and lateral movements are not changed.
+};
+
+MotionCategory getMotionCategory(enum MovementType mov_type) {
+    switch(mov_type) {
+        case MOV_UNDEFINED:
+        case MOV_FORWARD:
+        case MOV_FORWARD_TURN:
+            return MOTION_FORWARD;
+        case MOV_BACKWARD:
+        case MOV_BACKWARD_TURN:
+            return MOTION_BACKWARD;
+        default:
+            return MOTION_FIXED;
+    }
+}
+
+/**
+ * Change of direction (rad) at \a b, 0 if a segment is degenerated.
+ * \a cross is positive for left turns.
+ */
+double getCornerAngle(Eigen::Vector2d const& a, Eigen::Vector2d const& b,
+        Eigen::Vector2d const& c, double& cross) {
+    double l1 = (b - a).norm();
+    double l2 = (c - b).norm();
+    cross = 0.0;
+    if(l1 < COLLINEAR_TOLERANCE || l2 < COLLINEAR_TOLERANCE) {
+        return 0.0;
+    }
+    Eigen::Vector2d u1 = (b - a) / l1;
+    Eigen::Vector2d u2 = (c - b) / l2;
+    cross = u1.x() * u2.y() - u1.y() * u2.x();
+    return std::atan2(std::fabs(cross), u1.dot(u2));
+}
+
+/**
+ * Part of the segment of length \a length which is available for the arc
+ * requiring \a required, \a required_other is required by the corner at its other end.
+ */
+double getTangentShare(double length, double required, double required_other) {
+    double sum = required + required_other;
+    if(sum <= length || sum <= 0) {
+        return required;
+    }
+    return length * required / sum;
+}
+}
+
+PathPostProcessor::PathPostProcessor(Config config) :
+        mConfig(config),
+        mpTravGrid(NULL),
+        mpTravData(),
+        mpTravClassTable(),
+        mGridCalc(),
+        mpFootprintStencils(),
+        mMinTurningRadiusGrid(0.0),
+        mReachability(),
+        mResult(),
+        mTangentLengths(),
+        mCostRatio(1.0) {
+}
+
+void PathPostProcessor::setTravGrid(envire::TraversabilityGrid* trav_grid,
+        boost::shared_ptr<TravData> trav_data,
+        boost::shared_ptr<TravClassTable> trav_class_table) {
+    if(trav_class_table == NULL && trav_grid != NULL) {
+        trav_class_table = boost::shared_ptr<TravClassTable>(
+                new TravClassTable(trav_grid, mConfig));
+    }
+    mpTravGrid = trav_grid;
+    mpTravData = trav_data;
+    mpTravClassTable = trav_class_table;
+    mpFootprintStencils.reset();
+    mMinTurningRadiusGrid = 0.0;
+    mReachability = TurningReachability();
+    if(trav_grid == NULL) {
+        return;
+    }
+    mGridCalc.setTravGrid(trav_grid, trav_data, trav_class_table);
+
+    // Same as TravMapValidator: The smaller scale checks a larger area.
+    double min_scale = std::min(trav_grid->getScaleX(), trav_grid->getScaleY());
+    int radius_grid = (int)std::ceil(mConfig.getMaxRadius() / min_scale);
+    if(mConfig.mEnvType != ENV_XY && radius_grid > 0) {
+        mGridCalc.setFootprintCircleInGrid(radius_grid);
+        mpFootprintStencils = mGridCalc.getFootprintStencils();
+    }
+    mMinTurningRadiusGrid = mConfig.mMobility.mMinTurningRadius / min_scale;
+    if(mConfig.mEnvType == ENV_XYTHETA) {
+        mReachability = TurningReachability(mMinTurningRadiusGrid);
+    }
+}
+
+bool PathPostProcessor::process(std::vector<State>& path, bool pos_defined_in_local_grid) {
+    mCostRatio = 1.0;
+    if(mpTravGrid == NULL || mpTravData == NULL) {
+        LOG_WARN("Path cannot be post-processed without a traversability map");
+        return false;
+    }
+    if(mConfig.mEnvType == ENV_ARM) {
+        return false;
+    }
+    if(path.size() < 3) {
+        return true;
+    }
+
+    size_t num_states = path.size();
+    double scale_x = pos_defined_in_local_grid ? mpTravGrid->getScaleX() : 1.0;
+    double scale_y = pos_defined_in_local_grid ? mpTravGrid->getScaleY() : 1.0;
+
+    // Speed and movement type are only assigned to the first state of a
+    // motion, the following states inherit them (see getTrajectoryInWorld()).
+    double speed = nan("");
+    enum MovementType mov_type = MOV_UNDEFINED;
+    std::vector<State>::iterator it = path.begin();
+    for(; it != path.end(); ++it) {
+        it->mPose.position[0] /= scale_x;
+        it->mPose.position[1] /= scale_y;
+        if(std::isnan(it->mSpeed)) {
+            it->mSpeed = speed;
+        }
+        if(it->mMovType == MOV_UNDEFINED) {
+            it->mMovType = mov_type;
+        }
+        speed = it->mSpeed;
+        mov_type = it->mMovType;
+    }
+    double original_cost = getPathCost(path);
+
+    // Collinear states.
+    mResult.clear();
+    mResult.push_back(path.front());
+    for(size_t i = 1; i + 1 < path.size(); ++i) {
+        if(!isCollinear(mResult.back(), path[i], path[i+1])) {
+            mResult.push_back(path[i]);
+        }
+    }
+    mResult.push_back(path.back());
+    path.swap(mResult);
+
+    // Shortcuts within each part with the same motion.
+    mResult.clear();
+    size_t begin = 0;
+    for(size_t i = 1; i <= path.size(); ++i) {
+        if(i == path.size() || !sameMotion(path[i-1], path[i])) {
+            shortcut(path, begin, i);
+            begin = i;
+        }
+    }
+    path.swap(mResult);
+    updateHeadings(path);
+
+    if(mMinTurningRadiusGrid > 0) {
+        smoothCorners(path);
+        path.swap(mResult);
+    }
+
+    double cost = getPathCost(path);
+    if(original_cost > 0 && std::isfinite(original_cost) && std::isfinite(cost)) {
+        mCostRatio = cost / original_cost;
+    }
+
+    for(it = path.begin(); it != path.end(); ++it) {
+        it->mPose.position[0] *= scale_x;
+        it->mPose.position[1] *= scale_y;
+    }
+    LOG_INFO("Post-processing: %zu states reduced to %zu states, cost ratio %4.2f", 
+            num_states, path.size(), mCostRatio);
+    return true;
+}
+
+bool PathPostProcessor::isSegmentValid(double x0, double y0, double x1, double y1) const {
+    GridTraversal traversal(x0, y0, x1, y1);
+    do {
+        if(!isCellValid(traversal.getX(), traversal.getY())) {
+            return false;
+        }
+    } while(traversal.next());
+    return true;
+}
+
+double PathPostProcessor::getPathCost(std::vector<State> const& path) const {
+    int width = mpTravData->shape()[1];
+    int height = mpTravData->shape()[0];
+    double cost = 0.0;
+    for(size_t i = 1; i < path.size(); ++i) {
+        double x0 = path[i-1].mPose.position[0], y0 = path[i-1].mPose.position[1];
+        double x1 = path[i].mPose.position[0], y1 = path[i].mPose.position[1];
+        double length = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+        GridTraversal traversal(x0, y0, x1, y1);
+        do {
+            int x = traversal.getX();
+            int y = traversal.getY();
+            if(x < 0 || x >= width || y < 0 || y >= height) {
+                continue;
+            }
+            cost += (traversal.getExit() - traversal.getEnter()) * length *
+                    mpTravClassTable->getOmplCost((*mpTravData)[y][x]);
+        } while(traversal.next());
+    }
+    return cost;
+}
+
+// PRIVATE
+bool PathPostProcessor::isCellValid(int x, int y) const {
+    if(mpFootprintStencils != NULL) {
+        // The circle does not depend on the orientation.
+        return mGridCalc.isValid(*mpFootprintStencils, x, y, 0);
+    }
+    if(x < 0 || x >= (int)mpTravData->shape()[1] || y < 0 || y >= (int)mpTravData->shape()[0]) {
+        return false;
+    }
+    return !mpTravClassTable->isObstacle((*mpTravData)[y][x]);
+}
+
+bool PathPostProcessor::sameMotion(State const& s0, State const& s1) {
+    MotionCategory category = getMotionCategory(s0.mMovType);
+    if(category == MOTION_FIXED || category != getMotionCategory(s1.mMovType)) {
+        return false;
+    }
+    return s0.mSpeed == s1.mSpeed || (std::isnan(s0.mSpeed) && std::isnan(s1.mSpeed));
+}
+
+bool PathPostProcessor::isCollinear(State const& s0, State const& s1, State const& s2) {
+    if(!sameMotion(s0, s1) || !sameMotion(s1, s2)) {
+        return false;
+    }
+    Eigen::Vector2d a = s0.mPose.position.head<2>();
+    Eigen::Vector2d b = s1.mPose.position.head<2>();
+    Eigen::Vector2d c = s2.mPose.position.head<2>();
+    Eigen::Vector2d ac = c - a;
+    double length = ac.norm();
+    if(length < COLLINEAR_TOLERANCE) {
+        return false;
+    }
+    Eigen::Vector2d ab = b - a;
+    double proj = ab.dot(ac) / length;
+    double dist = std::fabs(ac.x() * ab.y() - ac.y() * ab.x()) / length;
+    return dist < COLLINEAR_TOLERANCE && proj >= 0 && proj <= length;
+}
+
+bool PathPostProcessor::isReachable(State const& s0, State const& s1) const {
+    if(mReachability.getMinTurningRadius() <= 0) {
+        return true;
+    }
+    // Driving backward from s0 to s1 is the reverse of driving forward from s1 to s0.
+    State const& from = getMotionCategory(s0.mMovType) == MOTION_BACKWARD ? s1 : s0;
+    State const& to = &from == &s0 ? s1 : s0;
+    return mReachability.isReachable(from.mPose.position[0], from.mPose.position[1],
+            from.mPose.getYaw(), to.mPose.position[0], to.mPose.position[1], to.mPose.getYaw());
+}
+
+void PathPostProcessor::shortcut(std::vector<State> const& path, size_t begin, size_t end) {
+    size_t i = begin;
+    mResult.push_back(path[i]);
+    while(i + 1 < end) {
+        // Extends the connection as long as it is collision free.
+        size_t j = i + 1;
+        while(j + 1 < end && isReachable(path[i], path[j+1]) && isSegmentValid(
+                path[i].mPose.position[0], path[i].mPose.position[1],
+                path[j+1].mPose.position[0], path[j+1].mPose.position[1])) {
+            j++;
+        }
+        mResult.push_back(path[j]);
+        i = j;
+    }
+}
+
+void PathPostProcessor::updateHeadings(std::vector<State>& path) {
+    for(size_t i = 1; i + 1 < path.size(); ++i) {
+        if(!sameMotion(path[i-1], path[i]) || !sameMotion(path[i], path[i+1])) {
+            continue;
+        }
+        Eigen::Vector2d dir = (path[i+1].mPose.position - path[i].mPose.position).head<2>();
+        if(dir.norm() < COLLINEAR_TOLERANCE) {
+            continue;
+        }
+        double heading = std::atan2(dir.y(), dir.x());
+        if(getMotionCategory(path[i].mMovType) == MOTION_BACKWARD) {
+            heading += M_PI;
+        }
+        path[i].mPose.orientation = Eigen::AngleAxisd(heading, Eigen::Vector3d::UnitZ());
+    }
+}
+
+void PathPostProcessor::smoothCorners(std::vector<State> const& path) {
+    // Tangent length each corner requires for an arc with the min turning radius.
+    size_t num_states = path.size();
+    mTangentLengths.assign(num_states, 0.0);
+    double cross = 0.0;
+    for(size_t i = 1; i + 1 < num_states; ++i) {
+        if(!sameMotion(path[i-1], path[i]) || !sameMotion(path[i], path[i+1])) {
+            continue;
+        }
+        double alpha = getCornerAngle(path[i-1].mPose.position.head<2>(),
+                path[i].mPose.position.head<2>(), path[i+1].mPose.position.head<2>(), cross);
+        if(alpha >= MIN_CORNER_ANGLE) {
+            mTangentLengths[i] = mMinTurningRadiusGrid * std::tan(alpha / 2.0);
+        }
+    }
+
+    mResult.clear();
+    mResult.push_back(path.front());
+    std::vector<State> arc;
+    int num_arcs = 0;
+    int num_tightened = 0;
+    for(size_t i = 1; i + 1 < num_states; ++i) {
+        double required = mTangentLengths[i];
+        arc.clear();
+        if(required > 0) {
+            // Both segments are shared with the neighboured corners.
+            double l1 = (path[i].mPose.position - path[i-1].mPose.position).head<2>().norm();
+            double l2 = (path[i+1].mPose.position - path[i].mPose.position).head<2>().norm();
+            double tangent_length = std::min(
+                    getTangentShare(l1, required, mTangentLengths[i-1]),
+                    getTangentShare(l2, required, mTangentLengths[i+1]));
+            if(tangent_length >= COLLINEAR_TOLERANCE &&
+                    createArc(path[i-1], path[i], path[i+1], tangent_length, arc)) {
+                // An arc using a complete segment ends on the neighboured state.
+                std::vector<State>::iterator arc_begin = arc.begin();
+                std::vector<State>::iterator arc_end = arc.end();
+                if((arc_begin->mPose.position - mResult.back().mPose.position).head<2>().norm() < 
+                        COLLINEAR_TOLERANCE) {
+                    ++arc_begin;
+                }
+                if((arc.back().mPose.position - path[i+1].mPose.position).head<2>().norm() < 
+                        COLLINEAR_TOLERANCE) {
+                    --arc_end;
+                }
+                mResult.insert(mResult.end(), arc_begin, arc_end);
+                num_arcs++;
+                num_tightened += tangent_length < required ? 1 : 0;
+                continue;
+            }
+        }
+        mResult.push_back(path[i]);
+    }
+    mResult.push_back(path.back());
+    LOG_DEBUG("%d corners have been replaced by arcs, %d of them below the min turning radius", 
+            num_arcs, num_tightened);
+}
+
+bool PathPostProcessor::createArc(State const& s0, State const& s1, State const& s2,
+        double tangent_length, std::vector<State>& arc) const {
+    Eigen::Vector2d a = s0.mPose.position.head<2>();
+    Eigen::Vector2d b = s1.mPose.position.head<2>();
+    Eigen::Vector2d c = s2.mPose.position.head<2>();
+    double cross = 0.0;
+    double alpha = getCornerAngle(a, b, c, cross);
+    if(alpha < MIN_CORNER_ANGLE) {
+        return false;
+    }
+    Eigen::Vector2d u1 = (b - a).normalized();
+
+    double t = tangent_length;
+    double r = t / std::tan(alpha / 2.0);
+    double side = cross > 0 ? 1.0 : -1.0;
+    Eigen::Vector2d p_start = b - t * u1;
+    Eigen::Vector2d center = p_start + side * r * Eigen::Vector2d(-u1.y(), u1.x());
+    double angle_start = std::atan2(p_start.y() - center.y(), p_start.x() - center.x());
+    double heading_start = std::atan2(u1.y(), u1.x());
+    if(getMotionCategory(s1.mMovType) == MOTION_BACKWARD) {
+        heading_start += M_PI;
+    }
+    int num_segments = std::max(2, (int)std::ceil(r * alpha));
+
+    Eigen::Vector2d last = p_start;
+    for(int k = 0; k <= num_segments; ++k) {
+        double delta = side * alpha * k / (double)num_segments;
+        Eigen::Vector2d p = center + r * Eigen::Vector2d(
+                std::cos(angle_start + delta), std::sin(angle_start + delta));
+        if(k > 0 && !isSegmentValid(last.x(), last.y(), p.x(), p.y())) {
+            return false;
+        }
+        last = p;
+
+        State state = s1;
+        state.mPose.position[0] = p.x();
+        state.mPose.position[1] = p.y();
+        // Like updateHeadings() the orientation follows the path in all environments.
+        state.mPose.orientation = Eigen::AngleAxisd(heading_start + delta,
+                Eigen::Vector3d::UnitZ());
+        arc.push_back(state);
+    }
+    return true;
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,138 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_PATH_POST_PROCESSOR_HPP_
+#define _MOTION_PLANNING_LIBRARIES_PATH_POST_PROCESSOR_HPP_
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Config.hpp"
+#include "State.hpp"
+#include "Helpers.hpp"
+#include "TurningReachability.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Simplifies and smoothes a planned path within the grid before it is
+ * converted to the world frame (Config::mPostProcessPath):
+ * - Collinear states are removed.
+ * - Shortcuts: Starting from each kept state the path is connected to the
+ *   farthest following state whose straight connection is collision free.
+ *   In ENV_XYTHETA the following state has to be reachable with
+ *   Config::mMobility.mMinTurningRadius as well (TurningReachability).
+ * - The orientations of the kept states are set along their new segments.
+ * - Corners are replaced by circular arcs with Config::mMobility.mMinTurningRadius.
+ *   A segment which is too short for the arcs at both of its ends is split in
+ *   proportion to their requirements, these corners get the largest radius which
+ *   fits. Corners whose arc is not collision free are kept.
+ *
+ * The robot is checked as a circle with Config::getMaxRadius() (ENV_XY as a
+ * point) using the footprint stencils of GridCalculations. States with a
+ * different speed or movement type (e.g. backward motions) are never merged,
+ * the states at these changes are kept.
+ */
+class PathPostProcessor {
+ private:
+    Config mConfig;
+    envire::TraversabilityGrid* mpTravGrid;
+    boost::shared_ptr<TravData> mpTravData;
+    boost::shared_ptr<TravClassTable> mpTravClassTable;
+    GridCalculations mGridCalc;
+    // Empty if the robot is checked as a point.
+    boost::shared_ptr<FootprintStencils const> mpFootprintStencils;
+    double mMinTurningRadiusGrid;
+    // Accepts all shortcuts if the orientations are not regarded.
+    TurningReachability mReachability;
+
+    // Buffer of the processed path, kept to reuse its capacity.
+    std::vector<State> mResult;
+    // Tangent length of the arc of each corner, buffer of smoothCorners().
+    std::vector<double> mTangentLengths;
+    // Cost of the processed path relative to the original path, see getCostRatio().
+    double mCostRatio;
+
+ public:
+    PathPostProcessor(Config config = Config());
+
+    void setTravGrid(envire::TraversabilityGrid* trav_grid,
+            boost::shared_ptr<TravData> trav_data,
+            boost::shared_ptr<TravClassTable> trav_class_table);
+
+    /**
+     * Processes the path in place. The positions are expected in grid
+     * coordinates or, if \a pos_defined_in_local_grid is set, in meters
+     * relative to the grid origin (see AbstractMotionPlanningLibrary::fillPath()).
+     * \return False if no map has been set or the environment is not supported
+     * (ENV_ARM), the path is not changed then.
+     */
+    bool process(std::vector<State>& path, bool pos_defined_in_local_grid);
+
+    /**
+     * Checks all cells which are touched by the straight connection
+     * (grid coordinates) with the footprint.
+     */
+    bool isSegmentValid(double x0, double y0, double x1, double y1) const;
+
+    /**
+     * Time to traverse the path (grid coordinates) with full speed using 
+     * the OMPL costs of the crossed cells.
+     */
+    double getPathCost(std::vector<State> const& path) const;
+
+    /**
+     * getPathCost() of the last processed path divided by the cost of the 
+     * original path, 1 if the path has not been changed. Used to scale the 
+     * cost reported by the planning library.
+     */
+    inline double getCostRatio() const {
+        return mCostRatio;
+    }
+
+ private:
+    bool isCellValid(int x, int y) const;
+
+    /**
+     * States with a different speed or movement type belong to different
+     * trajectories and must not be merged.
+     */
+    static bool sameMotion(State const& s0, State const& s1);
+
+    static bool isCollinear(State const& s0, State const& s1, State const& s2);
+
+    /**
+     * Whether \a s1 can be reached from \a s0 with the orientations of both
+     * states, backward motions are checked in reverse.
+     */
+    bool isReachable(State const& s0, State const& s1) const;
+
+    /**
+     * Appends the shortcut states of [\a begin, \a end) to mResult,
+     * \a end - 1 is always kept.
+     */
+    void shortcut(std::vector<State> const& path, size_t begin, size_t end);
+
+    /**
+     * Orients each state along its following segment (reversed for backward
+     * motions), start and goal and the states at a change of the motion are kept.
+     */
+    static void updateHeadings(std::vector<State>& path);
+
+    /**
+     * Replaces the corners of \a path which cannot be driven with
+     * mMinTurningRadiusGrid by arcs, the result is stored in mResult.
+     */
+    void smoothCorners(std::vector<State> const& path);
+
+    /**
+     * Appends the arc replacing the corner \a s1 to \a arc, the arc touches
+     * both segments at \a tangent_length from the corner.
+     * \return False if the arc is not collision free.
+     */
+    bool createArc(State const& s0, State const& s1, State const& s2,
+            double tangent_length, std::vector<State>& arc) const;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_PATH_POST_PROCESSOR_HPP_
@@ -0,0 +1,244 @@
+#include "PlanningProblem.hpp"
+
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <base-logging/Logging.hpp>
+
+#include "MapSerialization.hpp"
+
+namespace motion_planning_libraries
+{
+
+namespace {
+// Alignment of the sections within the file.
+const uint64_t SECTION_ALIGNMENT = 64;
+
+inline uint64_t alignSection(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+}
+
+struct ProblemFileHeader {
+    char mMagic[8];
+    uint32_t mVersion;
+    uint32_t mHeaderSize;
+    uint32_t mConfigVersion;
+    struct MapFileGeometry mGeometry;
+    struct StateFileData mStart, mGoal;
+    // Byte offsets from the beginning of the file.
+    uint64_t mConfigOffset, mConfigSize;
+    uint64_t mJointsOffset; // Joint angles of start followed by the ones of goal.
+    uint64_t mTravOffset, mProbOffset;
+    uint64_t mFileSize;
+};
+
+const char PlanningProblem::MAGIC[8] = {'M', 'P', 'L', 'P', 'R', 'O', 'B', '\0'};
+const std::string PlanningProblem::TRAV_MAP_ID = "/trav_map";
+
+PlanningProblem::PlanningProblem() :
+        mpMapping(NULL),
+        mMappingSize(0),
+        mpHeader(NULL),
+        mConfig(),
+        mStartState(),
+        mGoalState(),
+        mpEnvironment(NULL) {
+}
+
+PlanningProblem::~PlanningProblem() {
+    unload();
+}
+
+bool PlanningProblem::store(std::string const& path, envire::TraversabilityGrid* trav_grid,
+        State const& start, State const& goal, Config const& config,
+        TravData const* trav_data, TravData const* prob_data) {
+    ProblemFileHeader header;
+    memset(&header, 0, sizeof(header));
+    if(trav_grid == NULL || !header.mGeometry.fromTravGrid(trav_grid)) {
+        LOG_WARN("Planning problem requires a traversability map which is part of an environment");
+        return false;
+    }
+    memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+    header.mVersion = VERSION;
+    header.mHeaderSize = sizeof(ProblemFileHeader);
+    header.mConfigVersion = CONFIG_SERIALIZATION_VERSION;
+    header.mStart.fromState(start);
+    header.mGoal.fromState(goal);
+
+    ConfigWriter writer;
+    serializeConfig(writer, config);
+
+    uint64_t num_cells = header.mGeometry.getNumCells();
+    header.mConfigOffset = alignSection(sizeof(ProblemFileHeader));
+    header.mConfigSize = writer.mBuffer.size();
+    header.mJointsOffset = alignSection(header.mConfigOffset + header.mConfigSize);
+    uint64_t joints_size = (start.mJointAngles.size() + goal.mJointAngles.size()) * sizeof(double);
+    header.mTravOffset = alignSection(header.mJointsOffset + joints_size);
+    header.mProbOffset = alignSection(header.mTravOffset + num_cells);
+    header.mFileSize = header.mProbOffset + num_cells;
+
+    if(trav_data == NULL) {
+        trav_data = &trav_grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
+    }
+    if(prob_data == NULL) {
+        prob_data = &trav_grid->getGridData(envire::TraversabilityGrid::PROBABILITY);
+    }
+    if(trav_data->num_elements() != num_cells || prob_data->num_elements() != num_cells) {
+        LOG_WARN("Bands of the planning problem do not match the size of the map");
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << path << "." << getpid() << ".tmp";
+    std::string tmp_path = ss.str();
+    std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) {
+        LOG_WARN("Planning problem file %s could not be created", tmp_path.c_str());
+        return false;
+    }
+    // Writes the sections at their offsets, the gaps are filled with zeros.
+    std::vector<char> padding(SECTION_ALIGNMENT, 0);
+    uint64_t pos = 0;
+    #define MPL_WRITE_SECTION(offset, data, size) \
+        file.write(&padding[0], (offset) - pos); \
+        file.write((const char*)(data), (size)); \
+        pos = (offset) + (size);
+    MPL_WRITE_SECTION(0, &header, sizeof(header));
+    MPL_WRITE_SECTION(header.mConfigOffset, writer.mBuffer.data(), header.mConfigSize);
+    MPL_WRITE_SECTION(header.mJointsOffset, start.mJointAngles.data(),
+            start.mJointAngles.size() * sizeof(double));
+    MPL_WRITE_SECTION(pos, goal.mJointAngles.data(), goal.mJointAngles.size() * sizeof(double));
+    MPL_WRITE_SECTION(header.mTravOffset, trav_data->data(), num_cells);
+    MPL_WRITE_SECTION(header.mProbOffset, prob_data->data(), num_cells);
+    #undef MPL_WRITE_SECTION
+    file.close();
+
+    if(file.fail() || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOG_WARN("Planning problem could not be written to %s", path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    LOG_INFO("Planning problem (%d x %d cells) has been stored to %s",
+            header.mGeometry.mCellSizeX, header.mGeometry.mCellSizeY, path.c_str());
+    return true;
+}
+
+bool PlanningProblem::load(std::string const& path) {
+    unload();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        LOG_WARN("Planning problem file %s could not be opened", path.c_str());
+        return false;
+    }
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)sizeof(ProblemFileHeader)) {
+        LOG_WARN("%s is not a planning problem file", path.c_str());
+        close(fd);
+        return false;
+    }
+    size_t size = file_stat.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced.
+    close(fd);
+    if(mapping == MAP_FAILED) {
+        LOG_WARN("Planning problem file %s could not be mapped", path.c_str());
+        return false;
+    }
+    mpMapping = mapping;
+    mMappingSize = size;
+
+    ProblemFileHeader const* header = static_cast<ProblemFileHeader const*>(mapping);
+    uint64_t num_cells = header->mGeometry.getNumCells();
+    uint64_t joints_size = ((uint64_t)header->mStart.mNumJoints + header->mGoal.mNumJoints) * sizeof(double);
+    if(memcmp(header->mMagic, MAGIC, sizeof(MAGIC)) != 0 || header->mVersion != VERSION ||
+            header->mConfigVersion != CONFIG_SERIALIZATION_VERSION ||
+            header->mHeaderSize != sizeof(ProblemFileHeader) || header->mFileSize != size ||
+            header->mConfigOffset + header->mConfigSize > size ||
+            header->mJointsOffset + joints_size > size ||
+            header->mTravOffset + num_cells > size || header->mProbOffset + num_cells > size) {
+        LOG_WARN("%s is not a planning problem file of version %d", path.c_str(), VERSION);
+        unload();
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(mapping);
+    ConfigReader reader(data + header->mConfigOffset, header->mConfigSize);
+    Config config;
+    serializeConfig(reader, config);
+    if(!reader.isValid()) {
+        LOG_WARN("Config section of %s is incomplete", path.c_str());
+        unload();
+        return false;
+    }
+
+    const double* joints = reinterpret_cast<const double*>(data + header->mJointsOffset);
+    mConfig = config;
+    mStartState = header->mStart.toState(joints);
+    mGoalState = header->mGoal.toState(joints + header->mStart.mNumJoints);
+    mpHeader = header;
+    return true;
+}
+
+void PlanningProblem::unload() {
+    delete mpEnvironment;
+    mpEnvironment = NULL;
+    if(mpMapping != NULL) {
+        munmap(mpMapping, mMappingSize);
+    }
+    mpMapping = NULL;
+    mMappingSize = 0;
+    mpHeader = NULL;
+    mConfig = Config();
+    mStartState = State();
+    mGoalState = State();
+}
+
+size_t PlanningProblem::getCellSizeX() const {
+    return mpHeader != NULL ? mpHeader->mGeometry.mCellSizeX : 0;
+}
+
+size_t PlanningProblem::getCellSizeY() const {
+    return mpHeader != NULL ? mpHeader->mGeometry.mCellSizeY : 0;
+}
+
+TravDataView PlanningProblem::getTravData() const {
+    const uint8_t* data = static_cast<const uint8_t*>(mpMapping) + (mpHeader != NULL ? mpHeader->mTravOffset : 0);
+    return TravDataView(data, boost::extents[getCellSizeY()][getCellSizeX()]);
+}
+
+TravDataView PlanningProblem::getProbData() const {
+    const uint8_t* data = static_cast<const uint8_t*>(mpMapping) + (mpHeader != NULL ? mpHeader->mProbOffset : 0);
+    return TravDataView(data, boost::extents[getCellSizeY()][getCellSizeX()]);
+}
+
+envire::Environment* PlanningProblem::getEnvironment() {
+    if(mpHeader == NULL) {
+        return NULL;
+    }
+    if(mpEnvironment != NULL) {
+        return mpEnvironment;
+    }
+
+    envire::Environment* env = new envire::Environment();
+    envire::TraversabilityGrid* trav = mpHeader->mGeometry.createTravGrid(env, TRAV_MAP_ID);
+    // Same shape, so the bands are contiguous blocks of the same size.
+    size_t num_cells = mpHeader->mGeometry.getNumCells();
+    memcpy(trav->getGridData(envire::TraversabilityGrid::TRAVERSABILITY).data(),
+            getTravData().data(), num_cells);
+    memcpy(trav->getGridData(envire::TraversabilityGrid::PROBABILITY).data(),
+            getProbData().data(), num_cells);
+    mpEnvironment = env;
+    return mpEnvironment;
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,121 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_PLANNING_PROBLEM_HPP_
+#define _MOTION_PLANNING_LIBRARIES_PLANNING_PROBLEM_HPP_
+
+#include <stdint.h>
+#include <string>
+
+#include <boost/multi_array.hpp>
+
+#include <envire/core/Environment.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+
+#include "Config.hpp"
+#include "State.hpp"
+
+namespace motion_planning_libraries
+{
+
+typedef envire::TraversabilityGrid::ArrayType TravData;
+
+// Read-only band within the mapped file, indexed like TravData ([y][x]).
+typedef boost::const_multi_array_ref<uint8_t, 2> TravDataView;
+
+struct ProblemFileHeader;
+
+/**
+ * Binary planning problem: traversability map (size, scale, offset, frame,
+ * class driveabilities, traversability and probability band), start, goal
+ * and the Config. Used to log planning requests and to replay them offline
+ * without an Envire environment file (motion_planning_libraries_bench --problem,
+ * motion_planning_libraries_bin <file>).
+ *
+ * The file is mapped read-only (mmap), only the header and the small config
+ * section are read, the bands are accessed in place. The layout uses the native
+ * byte order: ProblemFileHeader, config section, joint angles of start and
+ * goal, traversability and probability band (row-major, 64 byte aligned).
+ */
+class PlanningProblem {
+ public:
+    static const char MAGIC[8];
+    // Has to be increased if the header is changed, the config section has its
+    // own version (CONFIG_SERIALIZATION_VERSION).
+    static const uint32_t VERSION = 1;
+    // Id of the traversability map within getEnvironment().
+    static const std::string TRAV_MAP_ID;
+
+    PlanningProblem();
+
+    /**
+     * Unmaps the file, the environment is deleted.
+     */
+    ~PlanningProblem();
+
+    /**
+     * Stores the map \a trav_grid (its environment is used for the frame),
+     * start, goal (world frame) and \a config to \a path. The file is written
+     * to a temporary file first, so a reader never maps an incomplete file.
+     * \param trav_data, prob_data Bands to store instead of the ones of \a trav_grid
+     * (e.g. the snapshots of MotionPlanningLibraries), same shape required.
+     */
+    static bool store(std::string const& path, envire::TraversabilityGrid* trav_grid,
+            State const& start, State const& goal, Config const& config,
+            TravData const* trav_data = NULL, TravData const* prob_data = NULL);
+
+    /**
+     * Maps the file and reads header, config, start and goal.
+     * \return False if the file could not be mapped or is not a
+     * planning problem of this version.
+     */
+    bool load(std::string const& path);
+
+    void unload();
+
+    inline bool isLoaded() const {
+        return mpHeader != NULL;
+    }
+
+    inline Config const& getConfig() const {
+        return mConfig;
+    }
+
+    inline State const& getStartState() const {
+        return mStartState;
+    }
+
+    inline State const& getGoalState() const {
+        return mGoalState;
+    }
+
+    size_t getCellSizeX() const;
+    size_t getCellSizeY() const;
+
+    /**
+     * Views of the mapped bands, valid until unload().
+     */
+    TravDataView getTravData() const;
+    TravDataView getProbData() const;
+
+    /**
+     * Creates (once) an environment containing the map as TRAV_MAP_ID, which
+     * can be passed to MotionPlanningLibraries::setTravGrid(). Envire owns
+     * its bands, so both are copied with a single memcpy each.
+     * The environment is owned by the problem and valid until unload().
+     */
+    envire::Environment* getEnvironment();
+
+ private:
+    // Not copyable, owns the mapping.
+    PlanningProblem(PlanningProblem const&);
+    PlanningProblem& operator=(PlanningProblem const&);
+
+    void* mpMapping;
+    size_t mMappingSize;
+    ProblemFileHeader const* mpHeader;
+    Config mConfig;
+    State mStartState, mGoalState;
+    envire::Environment* mpEnvironment;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_PLANNING_PROBLEM_HPP_
@@ -0,0 +1,248 @@
+#include "PlanningRecorder.hpp"
+
+#include <string.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include <base/Time.hpp>
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+struct RecordFileHeader {
+    char mMagic[8];
+    uint32_t mVersion;
+    uint32_t mConfigVersion;
+};
+
+// The segments are not made smaller than this (bytes).
+const uint64_t MIN_SEGMENT_SIZE = 1024 * 1024;
+// Records are padded to this alignment, so headers and payloads can be accessed in place.
+const uint64_t RECORD_ALIGNMENT = 8;
+
+inline uint64_t alignRecord(uint64_t size) {
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+}
+
+const char PlanningRecorder::MAGIC[8] = {'M', 'P', 'L', 'R', 'E', 'C', '\0', '\0'};
+
+PlanningRecorder::PlanningRecorder(Config const& config) :
+        mPath(config.mRecordFile),
+        mConfig(config),
+        mFile(),
+        mMaxSegmentSize(std::max<uint64_t>(config.mRecordMaxSize / 2, MIN_SEGMENT_SIZE)),
+        mSegmentSize(0),
+        mSequence(0),
+        mHasMap(false),
+        mBuffer() {
+    startSegment();
+}
+
+void PlanningRecorder::startSegment() {
+    if(mFile.is_open()) {
+        mFile.close();
+    }
+    // An existing segment becomes the oldest one.
+    std::string oldest_path = mPath + ".1";
+    rename(mPath.c_str(), oldest_path.c_str());
+
+    mFile.open(mPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!mFile.is_open()) {
+        LOG_WARN("Recording file %s could not be created, calls are not recorded", mPath.c_str());
+        return;
+    }
+    mSegmentSize = 0;
+    mHasMap = false;
+
+    RecordFileHeader file_header;
+    memset(&file_header, 0, sizeof(file_header));
+    memcpy(file_header.mMagic, MAGIC, sizeof(MAGIC));
+    file_header.mVersion = VERSION;
+    file_header.mConfigVersion = CONFIG_SERIALIZATION_VERSION;
+    write(&file_header, sizeof(file_header));
+
+    ConfigWriter writer;
+    serializeConfig(writer, mConfig);
+    writeHeader(RECORD_CONFIG, 0, writer.mBuffer.size(), true, 0, 0.0);
+    write(writer.mBuffer.data(), writer.mBuffer.size());
+    finishRecord();
+}
+
+void PlanningRecorder::recordMap(envire::TraversabilityGrid const* trav_grid,
+        TravData const& trav, TravData const& prob,
+        std::vector<CellUpdateSpan> const* spans, int shift_x, int shift_y,
+        uint32_t flags, bool success, int error, double duration) {
+    if(!isOpen()) {
+        return;
+    }
+    MapRecordData data;
+    memset(&data, 0, sizeof(data));
+    if(!data.mGeometry.fromTravGrid(trav_grid)) {
+        return;
+    }
+    // The size of the snapshots is used, the map may have been changed since.
+    data.mGeometry.mCellSizeX = trav.shape()[1];
+    data.mGeometry.mCellSizeY = trav.shape()[0];
+    uint64_t num_cells = trav.num_elements();
+
+    if(spans == NULL || !mHasMap) {
+        data.mFull = 1;
+        writeHeader(RECORD_MAP, flags, sizeof(data) + 2 * num_cells, success, error, duration);
+        write(&data, sizeof(data));
+        write(trav.data(), num_cells);
+        write(prob.data(), num_cells);
+    } else {
+        data.mShiftX = shift_x;
+        data.mShiftY = shift_y;
+        data.mNumSpans = spans->size();
+        // Spans followed by the traversability and the probability values.
+        uint64_t num_values = 0;
+        mBuffer.clear();
+        std::vector<CellUpdateSpan>::const_iterator it = spans->begin();
+        for(; it != spans->end(); ++it) {
+            uint32_t span[3] = {(uint32_t)it->mY, (uint32_t)it->mXBegin, (uint32_t)it->mXEnd};
+            const char* span_p = reinterpret_cast<const char*>(span);
+            mBuffer.insert(mBuffer.end(), span_p, span_p + sizeof(span));
+            num_values += it->mXEnd - it->mXBegin;
+        }
+        const TravData* bands[2] = {&trav, &prob};
+        for(int b = 0; b < 2; ++b) {
+            for(it = spans->begin(); it != spans->end(); ++it) {
+                const char* row = reinterpret_cast<const char*>(bands[b]->data()) +
+                        it->mY * data.mGeometry.mCellSizeX;
+                mBuffer.insert(mBuffer.end(), row + it->mXBegin, row + it->mXEnd);
+            }
+        }
+        writeHeader(RECORD_MAP, flags, sizeof(data) + mBuffer.size(), success, error, duration);
+        write(&data, sizeof(data));
+        write(mBuffer.data(), mBuffer.size());
+        LOG_DEBUG("Map recorded as %zu spans (%llu cells)", spans->size(), (unsigned long long)num_values);
+    }
+    mHasMap = true;
+    finishRecord();
+}
+
+void PlanningRecorder::recordState(enum RecordType type, State const& state,
+        uint32_t flags, bool success, int error, double duration) {
+    if(!isOpen()) {
+        return;
+    }
+    StateFileData data;
+    data.fromState(state);
+    size_t joints_size = state.mJointAngles.size() * sizeof(double);
+    writeHeader(type, flags, sizeof(data) + joints_size, success, error, duration);
+    write(&data, sizeof(data));
+    write(state.mJointAngles.data(), joints_size);
+    finishRecord();
+}
+
+void PlanningRecorder::recordPlan(double max_time, double cost, bool success, int error,
+        double duration) {
+    if(!isOpen()) {
+        return;
+    }
+    PlanRecordData data;
+    data.mMaxTime = max_time;
+    data.mCost = cost;
+    writeHeader(RECORD_PLAN, 0, sizeof(data), success, error, duration);
+    write(&data, sizeof(data));
+    finishRecord();
+}
+
+// PRIVATE
+void PlanningRecorder::writeHeader(uint32_t type, uint32_t flags, uint64_t payload_size,
+        bool success, int error, double duration) {
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mType = type;
+    header.mFlags = flags;
+    header.mPayloadSize = payload_size;
+    header.mSequence = mSequence++;
+    header.mTimestamp = base::Time::now().toMicroseconds();
+    header.mDuration = duration;
+    header.mError = error;
+    header.mSuccess = success ? 1 : 0;
+    write(&header, sizeof(header));
+}
+
+void PlanningRecorder::write(const void* data, size_t size) {
+    mFile.write(static_cast<const char*>(data), size);
+    mSegmentSize += size;
+}
+
+void PlanningRecorder::finishRecord() {
+    // The file header has a size of 16 bytes, so the segment size is the file offset.
+    static const char padding[RECORD_ALIGNMENT] = {0};
+    write(padding, alignRecord(mSegmentSize) - mSegmentSize);
+    mFile.flush();
+    if(mFile.fail()) {
+        LOG_WARN("Recording file %s could not be written, recording stopped", mPath.c_str());
+        mFile.close();
+    }
+}
+
+RecordReader::RecordReader() : mData(), mPos(0), mConfig() {
+}
+
+bool RecordReader::open(std::string const& path) {
+    // std::vector allocates with the alignment of the fundamental types (>= 8 bytes).
+    mData.clear();
+    mPos = 0;
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if(!file.is_open()) {
+        return false;
+    }
+    mData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    RecordFileHeader file_header;
+    if(mData.size() < sizeof(file_header)) {
+        LOG_WARN("%s is not a recording", path.c_str());
+        return false;
+    }
+    memcpy(&file_header, mData.data(), sizeof(file_header));
+    if(memcmp(file_header.mMagic, PlanningRecorder::MAGIC, sizeof(file_header.mMagic)) != 0 ||
+            file_header.mVersion != PlanningRecorder::VERSION ||
+            file_header.mConfigVersion != CONFIG_SERIALIZATION_VERSION) {
+        LOG_WARN("%s is not a recording of version %u", path.c_str(), PlanningRecorder::VERSION);
+        return false;
+    }
+    mPos = sizeof(file_header);
+
+    RecordHeader const* header = NULL;
+    const char* payload = NULL;
+    if(!next(header, payload) || header->mType != RECORD_CONFIG) {
+        LOG_WARN("%s does not start with a configuration", path.c_str());
+        return false;
+    }
+    ConfigReader reader(payload, header->mPayloadSize);
+    Config config;
+    serializeConfig(reader, config);
+    if(!reader.isValid()) {
+        LOG_WARN("Configuration of %s is incomplete", path.c_str());
+        return false;
+    }
+    mConfig = config;
+    return true;
+}
+
+bool RecordReader::next(RecordHeader const*& header, const char*& payload) {
+    if(mPos + sizeof(RecordHeader) > mData.size()) {
+        return false;
+    }
+    RecordHeader const* record = reinterpret_cast<RecordHeader const*>(&mData[mPos]);
+    uint64_t record_size = sizeof(RecordHeader) + alignRecord(record->mPayloadSize);
+    if(mPos + record_size > mData.size()) {
+        return false;
+    }
+    header = record;
+    payload = &mData[mPos] + sizeof(RecordHeader);
+    mPos += record_size;
+    return true;
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,168 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_PLANNING_RECORDER_HPP_
+#define _MOTION_PLANNING_LIBRARIES_PLANNING_RECORDER_HPP_
+
+#include <stdint.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Config.hpp"
+#include "State.hpp"
+#include "AbstractMotionPlanningLibrary.hpp"
+#include "MapSerialization.hpp"
+
+namespace motion_planning_libraries
+{
+
+enum RecordType {
+    RECORD_CONFIG, // Serialized Config, first record of each segment.
+    RECORD_MAP, // setTravGrid(), MapRecordData followed by the bands or the changed spans.
+    RECORD_START, // setStartState(), StateFileData followed by the joint angles.
+    RECORD_GOAL, // setGoalState(), same as RECORD_START.
+    RECORD_PLAN // plan(), PlanRecordData.
+};
+
+enum RecordFlags {
+    // The record restores the state at the beginning of a segment, it is not a call.
+    RECORD_FLAG_KEYFRAME = 1,
+    // setGoalState() has been called with reset.
+    RECORD_FLAG_RESET = 2
+};
+
+struct RecordHeader {
+    uint32_t mType;
+    uint32_t mFlags;
+    uint64_t mPayloadSize;
+    uint64_t mSequence; // Number of the call within the recording session.
+    int64_t mTimestamp; // Microseconds, end of the call.
+    double mDuration; // Duration (sec) of the call.
+    int32_t mError; // MotionPlanningLibraries::getError() after the call.
+    uint32_t mSuccess; // Return value of the call.
+};
+
+/**
+ * A full map contains both bands (row-major). Otherwise it is a diff to the previous
+ * map record: the previous bands are shifted first (the new cell (x, y) takes the
+ * old cell (x + mShiftX, y + mShiftY)), then the spans (mNumSpans times y, x_begin,
+ * x_end as uint32_t) are overwritten with the following traversability
+ * and afterwards the probability values of all spans.
+ */
+struct MapRecordData {
+    struct MapFileGeometry mGeometry;
+    uint32_t mFull;
+    int32_t mShiftX, mShiftY;
+    uint32_t mNumSpans;
+};
+
+struct PlanRecordData {
+    double mMaxTime;
+    double mCost;
+};
+
+/**
+ * Records the calls of MotionPlanningLibraries (Config::mRecordFile).
+ * The recording is a ring of two segments: If the current segment (the file itself)
+ * exceeds half of Config::mRecordMaxSize, it is renamed to <file>.1 (replacing the
+ * oldest segment) and a new segment is started. Each segment starts with the Config
+ * and a keyframe (full map, start and goal), so it can be replayed on its own.
+ * Each record is flushed, a crash only loses the record written at that moment.
+ */
+class PlanningRecorder {
+ public:
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+
+    /**
+     * Opens Config::mRecordFile, an existing recording becomes the oldest segment.
+     */
+    PlanningRecorder(Config const& config);
+
+    inline bool isOpen() const {
+        return mFile.is_open();
+    }
+
+    /**
+     * Whether a map has been recorded within the current segment, so the next
+     * map can be recorded as a diff.
+     */
+    inline bool hasMap() const {
+        return mHasMap;
+    }
+
+    /**
+     * Returns true if the segment exceeds its size, startSegment() and
+     * a keyframe have to follow.
+     */
+    inline bool isSegmentFull() const {
+        return mSegmentSize >= mMaxSegmentSize;
+    }
+
+    /**
+     * Moves the current segment to <file>.1 and starts a new one.
+     */
+    void startSegment();
+
+    /**
+     * Records the map \a trav_grid with the snapshot bands \a trav and \a prob.
+     * If \a spans is NULL the full map is stored, otherwise the changed spans
+     * (collected with \a shift_x, \a shift_y).
+     */
+    void recordMap(envire::TraversabilityGrid const* trav_grid,
+            TravData const& trav, TravData const& prob,
+            std::vector<CellUpdateSpan> const* spans, int shift_x, int shift_y,
+            uint32_t flags, bool success, int error, double duration);
+
+    void recordState(enum RecordType type, State const& state,
+            uint32_t flags, bool success, int error, double duration);
+
+    void recordPlan(double max_time, double cost, bool success, int error, double duration);
+
+ private:
+    void writeHeader(uint32_t type, uint32_t flags, uint64_t payload_size,
+            bool success, int error, double duration);
+    void write(const void* data, size_t size);
+    void finishRecord();
+
+    std::string mPath;
+    Config mConfig;
+    std::ofstream mFile;
+    uint64_t mMaxSegmentSize;
+    uint64_t mSegmentSize;
+    uint64_t mSequence;
+    bool mHasMap;
+    std::vector<char> mBuffer; // Span contents, kept to reuse its capacity.
+};
+
+/**
+ * Reads the records of a single segment.
+ */
+class RecordReader {
+ public:
+    RecordReader();
+
+    /**
+     * Reads the complete segment and its config.
+     * \return False if the file could not be read or is no recording of this version.
+     */
+    bool open(std::string const& path);
+
+    inline Config const& getConfig() const {
+        return mConfig;
+    }
+
+    /**
+     * Returns the next complete record, an incomplete record at the end
+     * (e.g. written during a crash) is ignored.
+     */
+    bool next(RecordHeader const*& header, const char*& payload);
+
+ private:
+    std::vector<char> mData;
+    size_t mPos;
+    Config mConfig;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_PLANNING_RECORDER_HPP_
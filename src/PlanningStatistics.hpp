@@ -0,0 +1,71 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_PLANNING_STATISTICS_HPP_
+#define _MOTION_PLANNING_LIBRARIES_PLANNING_STATISTICS_HPP_
+
+#include <stdint.h>
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Timings (sec) and counters of the last execution of each phase,
+ * filled by MotionPlanningLibraries and returned by getStatistics().
+ * Phases which have not been executed during the last call keep their
+ * previous values, the counters of the planning libraries are reset
+ * with each solve().
+ */
+struct PlanningStatistics {
+    // setTravGrid()
+    double mMapCopyTime; // Copying the bands of the new map into the snapshots.
+    double mCellDiffTime; // Collecting the changed cells.
+    double mPartialUpdateTime;
+    double mInitializeTime; // Complete (re-)initialization, includes mPrimitiveGenerationTime.
+    double mPrimitiveGenerationTime; // Reported by the planning library (SBPL XYTHETA).
+    unsigned int mNumCellUpdates;
+    bool mPartialUpdate; // Whether the last map has been applied by a partial update.
+
+    // setStartState(), setGoalState()
+    double mSetStartGoalTime;
+
+    // plan()
+    double mPlanTime; // Complete call.
+    double mSolveTimeBudget; // Time passed to solve(), see Config::mEndToEndDeadline.
+    double mSolveTime;
+    double mFillPathTime;
+    double mPostProcessTime; // Config::mPostProcessPath
+    double mWorldConversionTime;
+
+    // Reported by the planning library for the last solve(), 0 if not available.
+    uint64_t mNumExpansions; // SBPL: expanded states, OMPL: vertices of the planner trees.
+    uint64_t mNumValidityChecks;
+    uint64_t mNumCostEvaluations;
+
+    // Process-wide counters of TraceLog, set by plan(). Dropped records 
+    // indicate a too verbose runtime level.
+    uint64_t mNumTraceRecords;
+    uint64_t mNumTraceDropped;
+
+    PlanningStatistics() : mMapCopyTime(0.0),
+            mCellDiffTime(0.0),
+            mPartialUpdateTime(0.0),
+            mInitializeTime(0.0),
+            mPrimitiveGenerationTime(0.0),
+            mNumCellUpdates(0),
+            mPartialUpdate(false),
+            mSetStartGoalTime(0.0),
+            mPlanTime(0.0),
+            mSolveTimeBudget(0.0),
+            mSolveTime(0.0),
+            mFillPathTime(0.0),
+            mPostProcessTime(0.0),
+            mWorldConversionTime(0.0),
+            mNumExpansions(0),
+            mNumValidityChecks(0),
+            mNumCostEvaluations(0),
+            mNumTraceRecords(0),
+            mNumTraceDropped(0) {
+    }
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_PLANNING_STATISTICS_HPP_
@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <base/Time.hpp>
+
+#include <motion_planning_libraries/MotionPlanningLibraries.hpp>
+#include <motion_planning_libraries/PlanningRecorder.hpp>
+
+#include <envire/core/Environment.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+
+/**
+ * Replays a recording of MotionPlanningLibraries (Config::mRecordFile): The
+ * oldest segment (<file>.1) and the current one (<file>) are executed in this
+ * order with the recorded configuration, each segment with its own
+ * MotionPlanningLibraries. The maps are rebuilt from the recorded diffs.
+ * For each call the recorded and the replayed duration and result are written
+ * as CSV, a summary for each call type is written to stderr.
+ * Use Config::mRandomSeed to get deterministic OMPL replays.
+ *
+ * motion_planning_libraries_replay <file> [--output <file>]
+ */
+
+using namespace motion_planning_libraries;
+
+namespace {
+
+const std::string MAP_ID = "/trav_map";
+const char* CallString[] = {"config", "set_trav_grid", "set_start_state", "set_goal_state", "plan"};
+
+struct CallSummary {
+    unsigned int mNumCalls;
+    unsigned int mNumDifferentResults;
+    double mRecordedSum, mRecordedMax;
+    double mReplaySum, mReplayMax;
+
+    CallSummary() : mNumCalls(0), mNumDifferentResults(0),
+            mRecordedSum(0.0), mRecordedMax(0.0), mReplaySum(0.0), mReplayMax(0.0) {
+    }
+
+    void add(double recorded, double replay, bool same_result) {
+        mNumCalls++;
+        mNumDifferentResults += same_result ? 0 : 1;
+        mRecordedSum += recorded;
+        mRecordedMax = std::max(mRecordedMax, recorded);
+        mReplaySum += replay;
+        mReplayMax = std::max(mReplayMax, replay);
+    }
+};
+
+/**
+ * State of the replay of a single segment.
+ */
+class SegmentReplay {
+ public:
+    SegmentReplay(Config const& config) : mpMpl(), mpEnv(NULL), mpTravGrid(NULL),
+            mShiftBuffer() {
+        Config replay_config = config;
+        replay_config.mRecordFile.clear();
+        mpMpl = boost::shared_ptr<MotionPlanningLibraries>(
+                new MotionPlanningLibraries(replay_config));
+    }
+
+    ~SegmentReplay() {
+        mpMpl.reset();
+        delete mpEnv;
+    }
+
+    /**
+     * Executes the call of the record, \a duration is the duration of the call itself.
+     * \return False if the record is invalid.
+     */
+    bool execute(RecordHeader const& header, const char* payload,
+            bool& success, double& cost, double& duration) {
+        success = false;
+        cost = nan("");
+        duration = 0.0;
+        base::Time start_t;
+        switch(header.mType) {
+            case RECORD_MAP: {
+                envire::Environment* old_env = NULL;
+                if(!applyMap(header, payload, old_env)) {
+                    return false;
+                }
+                start_t = base::Time::now();
+                success = mpMpl->setTravGrid(mpEnv, MAP_ID);
+                duration = (base::Time::now() - start_t).toSeconds();
+                // The planning library does not refer to the old map anymore.
+                delete old_env;
+                return true;
+            }
+            case RECORD_START:
+            case RECORD_GOAL: {
+                StateFileData const* data = reinterpret_cast<StateFileData const*>(payload);
+                if(header.mPayloadSize < sizeof(StateFileData) ||
+                        header.mPayloadSize < sizeof(StateFileData) + data->mNumJoints * sizeof(double)) {
+                    return false;
+                }
+                State state = data->toState(
+                        reinterpret_cast<const double*>(payload + sizeof(StateFileData)));
+                start_t = base::Time::now();
+                if(header.mType == RECORD_START) {
+                    success = mpMpl->setStartState(state);
+                } else {
+                    success = mpMpl->setGoalState(state, header.mFlags & RECORD_FLAG_RESET);
+                }
+                duration = (base::Time::now() - start_t).toSeconds();
+                return true;
+            }
+            case RECORD_PLAN: {
+                if(header.mPayloadSize < sizeof(PlanRecordData)) {
+                    return false;
+                }
+                PlanRecordData const* data = reinterpret_cast<PlanRecordData const*>(payload);
+                start_t = base::Time::now();
+                success = mpMpl->plan(data->mMaxTime, cost);
+                duration = (base::Time::now() - start_t).toSeconds();
+                if(!success) {
+                    cost = nan("");
+                }
+                return true;
+            }
+            default: {
+                return false;
+            }
+        }
+    }
+
+ private:
+    /**
+     * Rebuilds the recorded map, a map with a new size gets a new environment
+     * which replaces the current one (returned as \a old_env).
+     */
+    bool applyMap(RecordHeader const& header, const char* payload, envire::Environment*& old_env) {
+        if(header.mPayloadSize < sizeof(MapRecordData)) {
+            return false;
+        }
+        MapRecordData const* data = reinterpret_cast<MapRecordData const*>(payload);
+        const uint8_t* values = reinterpret_cast<const uint8_t*>(payload + sizeof(MapRecordData));
+        uint64_t values_size = header.mPayloadSize - sizeof(MapRecordData);
+        uint64_t num_cells = data->mGeometry.getNumCells();
+        bool same_size = mpTravGrid != NULL &&
+                mpTravGrid->getCellSizeX() == data->mGeometry.mCellSizeX &&
+                mpTravGrid->getCellSizeY() == data->mGeometry.mCellSizeY;
+
+        if(data->mFull) {
+            if(values_size < 2 * num_cells) {
+                return false;
+            }
+            if(same_size) {
+                data->mGeometry.applyTo(mpTravGrid);
+            } else {
+                old_env = mpEnv;
+                mpEnv = new envire::Environment();
+                mpTravGrid = data->mGeometry.createTravGrid(mpEnv, MAP_ID);
+            }
+            memcpy(getBand(envire::TraversabilityGrid::TRAVERSABILITY), values, num_cells);
+            memcpy(getBand(envire::TraversabilityGrid::PROBABILITY), values + num_cells, num_cells);
+            return true;
+        }
+
+        // Diff to the previous map.
+        const uint32_t* spans = reinterpret_cast<const uint32_t*>(values);
+        uint64_t spans_size = (uint64_t)data->mNumSpans * 3 * sizeof(uint32_t);
+        if(!same_size || values_size < spans_size) {
+            return false;
+        }
+        uint64_t num_values = 0;
+        for(uint32_t s = 0; s < data->mNumSpans; ++s) {
+            const uint32_t* span = spans + 3 * s;
+            if(span[0] >= data->mGeometry.mCellSizeY || span[1] > span[2] ||
+                    span[2] > data->mGeometry.mCellSizeX) {
+                return false;
+            }
+            num_values += span[2] - span[1];
+        }
+        if(values_size < spans_size + 2 * num_values) {
+            return false;
+        }
+        data->mGeometry.applyTo(mpTravGrid);
+
+        const uint8_t* span_values = values + spans_size;
+        uint8_t* bands[2] = {
+                getBand(envire::TraversabilityGrid::TRAVERSABILITY),
+                getBand(envire::TraversabilityGrid::PROBABILITY)};
+        for(int b = 0; b < 2; ++b) {
+            shiftBand(bands[b], data->mShiftX, data->mShiftY);
+            for(uint32_t s = 0; s < data->mNumSpans; ++s) {
+                const uint32_t* span = spans + 3 * s;
+                size_t length = span[2] - span[1];
+                memcpy(bands[b] + span[0] * data->mGeometry.mCellSizeX + span[1],
+                        span_values, length);
+                span_values += length;
+            }
+        }
+        return true;
+    }
+
+    uint8_t* getBand(std::string const& band) {
+        return mpTravGrid->getGridData(band).data();
+    }
+
+    /**
+     * The new cell (x, y) takes the old cell (x + shift_x, y + shift_y), cells without
+     * an old counterpart are part of the recorded spans.
+     */
+    void shiftBand(uint8_t* band, int shift_x, int shift_y) {
+        if(shift_x == 0 && shift_y == 0) {
+            return;
+        }
+        int size_x = mpTravGrid->getCellSizeX();
+        int size_y = mpTravGrid->getCellSizeY();
+        mShiftBuffer.assign(band, band + size_x * size_y);
+        int x_begin = std::max(0, -shift_x);
+        int x_end = std::min(size_x, size_x - shift_x);
+        for(int y = std::max(0, -shift_y); y < std::min(size_y, size_y - shift_y); ++y) {
+            if(x_begin < x_end) {
+                memcpy(band + y * size_x + x_begin,
+                        &mShiftBuffer[(y + shift_y) * size_x + x_begin + shift_x], x_end - x_begin);
+            }
+        }
+    }
+
+    boost::shared_ptr<MotionPlanningLibraries> mpMpl;
+    envire::Environment* mpEnv;
+    envire::TraversabilityGrid* mpTravGrid;
+    std::vector<uint8_t> mShiftBuffer;
+};
+
+std::string toString(double value) {
+    if(std::isnan(value)) {
+        return "nan";
+    }
+    std::stringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+/**
+ * Replays a single segment, the calls are appended to \a os.
+ * \return False if the segment could not be read.
+ */
+bool replaySegment(std::string const& path, std::ostream& os, CallSummary* summaries) {
+    RecordReader reader;
+    if(!reader.open(path)) {
+        return false;
+    }
+    std::cerr << "Replaying " << path << std::endl;
+    SegmentReplay replay(reader.getConfig());
+
+    RecordHeader const* header = NULL;
+    const char* payload = NULL;
+    while(reader.next(header, payload)) {
+        bool success = false;
+        double cost = nan("");
+        double duration = 0.0;
+        if(!replay.execute(*header, payload, success, cost, duration)) {
+            std::cerr << "Record " << header->mSequence << " is invalid and has been skipped" << std::endl;
+            continue;
+        }
+        if(header->mFlags & RECORD_FLAG_KEYFRAME) {
+            continue;
+        }
+        double recorded_cost = nan("");
+        if(header->mType == RECORD_PLAN) {
+            recorded_cost = reinterpret_cast<PlanRecordData const*>(payload)->mCost;
+        }
+        bool recorded_success = header->mSuccess != 0;
+        summaries[header->mType].add(header->mDuration, duration, recorded_success == success);
+        os << header->mSequence << "," << CallString[header->mType] << ","
+                << toString(header->mDuration) << "," << toString(duration) << ","
+                << (recorded_success ? 1 : 0) << "," << (success ? 1 : 0) << ","
+                << toString(recorded_cost) << "," << toString(cost) << std::endl;
+    }
+    return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    std::string output;
+    for(int i=1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if(path.empty() && arg[0] != '-') {
+            path = arg;
+        } else {
+            path.clear();
+            break;
+        }
+    }
+    if(path.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <file> [--output <file>]" << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if(!output.empty()) {
+        file.open(output.c_str());
+        if(!file.is_open()) {
+            std::cerr << "Output file " << output << " could not be opened" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& os = file.is_open() ? file : std::cout;
+    os << "sequence,call,recorded_duration,replay_duration,recorded_success,replay_success,"
+            "recorded_cost,replay_cost" << std::endl;
+
+    CallSummary summaries[RECORD_PLAN + 1];
+    bool oldest_replayed = replaySegment(path + ".1", os, summaries);
+    if(!replaySegment(path, os, summaries) && !oldest_replayed) {
+        std::cerr << path << " could not be replayed" << std::endl;
+        return 1;
+    }
+
+    for(int type = RECORD_MAP; type <= RECORD_PLAN; ++type) {
+        CallSummary const& s = summaries[type];
+        if(s.mNumCalls == 0) {
+            continue;
+        }
+        std::cerr << CallString[type] << ": " << s.mNumCalls << " calls, recorded mean "
+                << s.mRecordedSum / s.mNumCalls << " sec (max " << s.mRecordedMax
+                << "), replay mean " << s.mReplaySum / s.mNumCalls << " sec (max "
+                << s.mReplayMax << "), " << s.mNumDifferentResults << " different results"
+                << std::endl;
+    }
+    return 0;
+}
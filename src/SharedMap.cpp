@@ -0,0 +1,131 @@
+#include "SharedMap.hpp"
+
+#include <base/Time.hpp>
+#include <base-logging/Logging.hpp>
+
+#include "MotionPlanningLibraries.hpp"
+
+namespace motion_planning_libraries
+{
+
+// PUBLIC
+SharedMap::SharedMap() : mpTravGrid(NULL),
+        mRevision(0),
+        mpTravData(),
+        mpProbData(),
+        mpLastTravData(),
+        mpLastProbData(),
+        mGrid2World(Eigen::Affine3d::Identity()),
+        mGrid2WorldValid(false),
+        mDiffValid(false),
+        mShiftX(0),
+        mShiftY(0),
+        mCellUpdates(),
+        mCellUpdateSpans(),
+        mBaseClassTable(),
+        mTravClassTables(),
+        mDistanceMaps() {
+}
+
+bool SharedMap::setTravGrid(envire::Environment* env, std::string trav_map_id) {
+    envire::TraversabilityGrid* trav_grid =
+            MotionPlanningLibraries::extractTravGrid(env, trav_map_id);
+    if(trav_grid == NULL) {
+        LOG_WARN("Traversability map could not be extracted");
+        return false;
+    }
+    if(trav_grid->getSizeX() < 1 || trav_grid->getSizeY() < 1) {
+        LOG_ERROR("Size of the extracted map is incorrect (%4.2f, %4.2f)",
+                trav_grid->getSizeX(), trav_grid->getSizeY());
+        return false;
+    }
+
+    bool same_map_size = mpTravData != NULL &&
+            mpTravData->shape()[0] == trav_grid->getCellSizeY() &&
+            mpTravData->shape()[1] == trav_grid->getCellSizeX();
+
+    // The previous snapshots are only overwritten if no planner refers to them.
+    base::Time start_t = base::Time::now();
+    MotionPlanningLibraries::copyToSnapshot(
+            trav_grid->getGridData(envire::TraversabilityGrid::TRAVERSABILITY), mpLastTravData);
+    MotionPlanningLibraries::copyToSnapshot(
+            trav_grid->getGridData(envire::TraversabilityGrid::PROBABILITY), mpLastProbData);
+    mpTravData.swap(mpLastTravData);
+    mpProbData.swap(mpLastProbData);
+    mpTravGrid = trav_grid;
+    mRevision++;
+
+    mBaseClassTable.update(trav_grid, Config());
+    mTravClassTables.clear();
+
+    // The diff is collected for the planners once, shifted if the map is a
+    // translation of the previous one (Config::mShiftScrollingMap).
+    Eigen::Affine3d grid2world = MotionPlanningLibraries::getGrid2World(trav_grid,
+            MotionPlanningLibraries::getLocal2World(trav_grid));
+    mCellUpdates.clear();
+    mCellUpdateSpans.clear();
+    mShiftX = 0;
+    mShiftY = 0;
+    mDiffValid = same_map_size;
+    if(mDiffValid) {
+        if(!mGrid2WorldValid || !MotionPlanningLibraries::getMapShift(
+                mGrid2World, grid2world, mShiftX, mShiftY)) {
+            mShiftX = 0;
+            mShiftY = 0;
+        }
+        MotionPlanningLibraries::collectCellUpdates(*mpLastTravData, *mpLastProbData,
+                *mpTravData, *mpProbData, mBaseClassTable, mCellUpdates, mCellUpdateSpans,
+                mShiftX, mShiftY);
+    }
+    mGrid2World = grid2world;
+    mGrid2WorldValid = true;
+
+    updateDistanceMaps();
+    LOG_INFO("Shared map revision %d received within %4.4f sec",
+            (int)mRevision, (base::Time::now() - start_t).toSeconds());
+    return true;
+}
+
+boost::shared_ptr<TravClassTable> SharedMap::getTravClassTable(Config const& config) {
+    if(mpTravGrid == NULL) {
+        return boost::shared_ptr<TravClassTable>();
+    }
+    boost::shared_ptr<TravClassTable>& table = mTravClassTables[config.mMobility.mSpeed];
+    if(table == NULL) {
+        table = boost::shared_ptr<TravClassTable>(new TravClassTable(mpTravGrid, config));
+    }
+    return table;
+}
+
+boost::shared_ptr<ObstacleDistanceMap const> SharedMap::getDistanceMap(unsigned int max_dist) {
+    if(mpTravData == NULL) {
+        return boost::shared_ptr<ObstacleDistanceMap const>();
+    }
+    boost::shared_ptr<ObstacleDistanceMap>& distance_map = mDistanceMaps[max_dist];
+    if(distance_map == NULL) {
+        distance_map = boost::shared_ptr<ObstacleDistanceMap>(new ObstacleDistanceMap());
+        distance_map->create(*mpTravData, mBaseClassTable, max_dist);
+    }
+    return distance_map;
+}
+
+// PRIVATE
+void SharedMap::updateDistanceMaps() {
+    std::map<unsigned int, boost::shared_ptr<ObstacleDistanceMap> >::iterator it =
+            mDistanceMaps.begin();
+    bool incremental = mDiffValid && mShiftX == 0 && mShiftY == 0;
+    for(; it != mDistanceMaps.end(); ++it) {
+        // A planner still uses the map of the previous snapshot.
+        if(!it->second.unique()) {
+            it->second = boost::shared_ptr<ObstacleDistanceMap>(incremental ?
+                    new ObstacleDistanceMap(*it->second) : new ObstacleDistanceMap());
+        }
+        bool updated = incremental &&
+                it->second->update(*mpTravData, mBaseClassTable, mCellUpdates);
+        if(!updated) {
+            it->second->create(*mpTravData, mBaseClassTable, it->first);
+        }
+    }
+}
+
+} // end namespace motion_planning_libraries
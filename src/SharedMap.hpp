@@ -0,0 +1,150 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_SHARED_MAP_HPP_
+#define _MOTION_PLANNING_LIBRARIES_SHARED_MAP_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <Eigen/Geometry>
+
+#include <envire/Environment.hpp>
+#include <envire/maps/TraversabilityGrid.hpp>
+
+#include "Config.hpp"
+#include "AbstractMotionPlanningLibrary.hpp"
+#include "ObstacleDistanceMap.hpp"
+#include "TravClassTable.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * A single ingested traversability map and its derived layers, shared by
+ * several MotionPlanningLibraries instances which plan on the same map with
+ * different configurations (mobility, footprint).
+ * Each map is received once by setTravGrid(): The two bands are copied into
+ * snapshots and the diff to the previous map is collected. The planners
+ * attached by MotionPlanningLibraries::setTravGrid(shared_map) use the
+ * snapshots directly and reuse the diff for their partial updates.
+ *
+ * Snapshots and layers are copy-on-write: A buffer is only overwritten if no
+ * planner references it anymore, otherwise a new one is allocated. So the
+ * memory grows with the number of distinct layers (class tables of different
+ * speeds, distance maps of different footprints) instead of the number of
+ * planners. The shared map and its planners have to be used by the same thread.
+ */
+class SharedMap {
+ private:
+    envire::TraversabilityGrid* mpTravGrid;
+    // Increased by each received map.
+    uint64_t mRevision;
+    boost::shared_ptr<TravData> mpTravData;
+    boost::shared_ptr<TravData> mpProbData;
+    // Snapshots of the previous map, the new map is copied into them if
+    // they are not referenced by a planner anymore.
+    boost::shared_ptr<TravData> mpLastTravData;
+    boost::shared_ptr<TravData> mpLastProbData;
+    Eigen::Affine3d mGrid2World;
+    bool mGrid2WorldValid;
+    // Diff of the current to the previous snapshots, see isDiffValid().
+    bool mDiffValid;
+    int mShiftX, mShiftY;
+    std::vector<CellUpdate> mCellUpdates;
+    std::vector<CellUpdateSpan> mCellUpdateSpans;
+    // Only the driveability and the obstacles are used, they do not
+    // depend on the configuration.
+    TravClassTable mBaseClassTable;
+    // Class tables of the current map keyed by Mobility::mSpeed, the only
+    // parameter of the configuration used by the table.
+    std::map<double, boost::shared_ptr<TravClassTable> > mTravClassTables;
+    // Distance maps keyed by their max distance (cells).
+    std::map<unsigned int, boost::shared_ptr<ObstacleDistanceMap> > mDistanceMaps;
+
+ public:
+    SharedMap();
+
+    /**
+     * Copies the map \a trav_map_id (or the first traversability map) of
+     * \a env, collects the diff to the previous map and updates the
+     * distance maps. The attached planners apply it with
+     * MotionPlanningLibraries::setTravGrid(shared_map).
+     */
+    bool setTravGrid(envire::Environment* env, std::string trav_map_id);
+
+    inline envire::TraversabilityGrid* getTravGrid() const {
+        return mpTravGrid;
+    }
+
+    inline uint64_t getRevision() const {
+        return mRevision;
+    }
+
+    /**
+     * Snapshots of the current map, they are not modified anymore.
+     */
+    inline boost::shared_ptr<TravData> const& getTravData() const {
+        return mpTravData;
+    }
+
+    inline boost::shared_ptr<TravData> const& getProbData() const {
+        return mpProbData;
+    }
+
+    /**
+     * Snapshot of the previous map, the diff refers to it.
+     */
+    inline boost::shared_ptr<TravData> const& getLastTravData() const {
+        return mpLastTravData;
+    }
+
+    /**
+     * Returns true if the previous map has the same size, in this case
+     * getCellUpdates() contains the changed cells. If the map has been
+     * translated by whole cells the new cell (x, y) has been compared with
+     * the old one (x + shift_x, y + shift_y) and the exposed cells are included.
+     */
+    inline bool isDiffValid() const {
+        return mDiffValid;
+    }
+
+    inline void getShift(int& shift_x, int& shift_y) const {
+        shift_x = mShiftX;
+        shift_y = mShiftY;
+    }
+
+    inline std::vector<CellUpdate> const& getCellUpdates() const {
+        return mCellUpdates;
+    }
+
+    inline std::vector<CellUpdateSpan> const& getCellUpdateSpans() const {
+        return mCellUpdateSpans;
+    }
+
+    /**
+     * Class table of the current map for the passed configuration, shared
+     * by all configurations with the same speed.
+     */
+    boost::shared_ptr<TravClassTable> getTravClassTable(Config const& config);
+
+    /**
+     * Distance map of the current map with the distances capped at \a max_dist
+     * (e.g. the footprint radius in cells plus one). It is created by the first
+     * request and updated by the following maps.
+     */
+    boost::shared_ptr<ObstacleDistanceMap const> getDistanceMap(unsigned int max_dist);
+
+ private:
+    /**
+     * Updates the distance maps after a new map has been received, a
+     * referenced distance map is copied first.
+     */
+    void updateDistanceMaps();
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_SHARED_MAP_HPP_
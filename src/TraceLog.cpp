@@ -0,0 +1,202 @@
+#include "TraceLog.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+
+TraceLevel getEnvLevel() {
+    const char* level = getenv("BASE_LOG_LEVEL");
+    if(level == NULL) {
+        return TRACE_WARN;
+    }
+    if(strcmp(level, "DEBUG") == 0) {
+        return TRACE_DEBUG;
+    } else if(strcmp(level, "INFO") == 0) {
+        return TRACE_INFO;
+    } else if(strcmp(level, "ERROR") == 0 || strcmp(level, "FATAL") == 0) {
+        return TRACE_NONE;
+    }
+    return TRACE_WARN;
+}
+
+} // end anonymous namespace
+
+const unsigned int TraceLog::CAPACITY;
+const unsigned int TraceLog::DRAIN_PERIOD_MS;
+
+// PUBLIC
+TraceLog& TraceLog::getInstance() {
+    static TraceLog trace_log;
+    return trace_log;
+}
+
+TraceLog::~TraceLog() {
+    mStop.store(true);
+    if(mDrainThread.joinable()) {
+        mDrainThread.join();
+    }
+    // Records pushed after the last drain cycle are written as well.
+    flush();
+}
+
+void TraceLog::flush() {
+    std::lock_guard<std::mutex> lock(mDrainMutex);
+    TraceRecord record;
+    std::string text;
+    while(pop(record)) {
+        write(record, text);
+    }
+}
+
+void TraceLog::format(TraceRecord const& record, std::string& text) {
+    text.clear();
+    unsigned int arg = 0;
+    char spec[32];
+    char buffer[64];
+    const char* p = record.mFormat;
+    while(*p != '\0') {
+        if(*p != '%') {
+            text.push_back(*p++);
+            continue;
+        }
+        if(p[1] == '%') {
+            text.push_back('%');
+            p += 2;
+            continue;
+        }
+        // Flags, width and precision are kept, length modifiers are replaced.
+        size_t len = 0;
+        spec[len++] = *p++;
+        while(*p != '\0' && strchr("-+ #0123456789.", *p) != NULL && len < sizeof(spec) - 4) {
+            spec[len++] = *p++;
+        }
+        while(*p != '\0' && strchr("hlLqjzt", *p) != NULL) {
+            ++p;
+        }
+        char conversion = *p;
+        if(conversion == '\0') {
+            break;
+        }
+        ++p;
+        if(arg >= record.mNumArgs) {
+            text.append("?");
+            continue;
+        }
+        TraceArg const& value = record.mArgs[arg++];
+        if(strchr("diouxXc", conversion) != NULL) {
+            spec[len++] = 'l';
+            spec[len++] = 'l';
+            spec[len++] = conversion == 'c' ? 'd' : conversion;
+            spec[len] = '\0';
+            long long number = value.mIsDouble ? (long long)value.mDouble : value.mInt;
+            snprintf(buffer, sizeof(buffer), spec, number);
+        } else if(strchr("fFeEgGaA", conversion) != NULL) {
+            spec[len++] = conversion;
+            spec[len] = '\0';
+            double number = value.mIsDouble ? value.mDouble : (double)value.mInt;
+            snprintf(buffer, sizeof(buffer), spec, number);
+        } else {
+            snprintf(buffer, sizeof(buffer), "?");
+        }
+        text.append(buffer);
+    }
+}
+
+// PRIVATE
+TraceLog::TraceLog() : mEnqueuePos(0),
+        mDequeuePos(0),
+        mNumRecords(0),
+        mNumDropped(0),
+        mLevel(getEnvLevel()),
+        mStop(false),
+        mDrainMutex(),
+        mDrainThread() {
+    for(unsigned int i = 0; i < CAPACITY; ++i) {
+        mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+    mDrainThread = std::thread(&TraceLog::drainLoop, this);
+}
+
+void TraceLog::push(TraceRecord const& record) {
+    mNumRecords.fetch_add(1, std::memory_order_relaxed);
+    uint64_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = NULL;
+    while(true) {
+        slot = &mSlots[pos & (CAPACITY - 1)];
+        uint64_t sequence = slot->mSequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)sequence - (int64_t)pos;
+        if(diff == 0) {
+            if(mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            // Not drained yet.
+            mNumDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->mRecord = record;
+    slot->mSequence.store(pos + 1, std::memory_order_release);
+}
+
+bool TraceLog::pop(TraceRecord& record) {
+    uint64_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    Slot* slot = NULL;
+    while(true) {
+        slot = &mSlots[pos & (CAPACITY - 1)];
+        uint64_t sequence = slot->mSequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)sequence - (int64_t)(pos + 1);
+        if(diff == 0) {
+            if(mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            return false;
+        } else {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    record = slot->mRecord;
+    slot->mSequence.store(pos + CAPACITY, std::memory_order_release);
+    return true;
+}
+
+void TraceLog::drainLoop() {
+    while(!mStop.load()) {
+        flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_PERIOD_MS));
+    }
+}
+
+void TraceLog::write(TraceRecord const& record, std::string& text) {
+    format(record, text);
+    const char* file = strrchr(record.mFile, '/');
+    file = file != NULL ? file + 1 : record.mFile;
+    switch(record.mLevel) {
+        case TRACE_DEBUG: {
+            LOG_DEBUG("%s (%s:%d)", text.c_str(), file, record.mLine);
+            break;
+        }
+        case TRACE_INFO: {
+            LOG_INFO("%s (%s:%d)", text.c_str(), file, record.mLine);
+            break;
+        }
+        default: {
+            LOG_WARN("%s (%s:%d)", text.c_str(), file, record.mLine);
+            break;
+        }
+    }
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,239 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_TRACE_LOG_HPP_
+#define _MOTION_PLANNING_LIBRARIES_TRACE_LOG_HPP_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <base/Time.hpp>
+
+// Trace calls below this level are removed at compile time
+// (0 debug, 1 info, 2 warnings, 3 none), set by the CMake cache variable of the same name.
+#ifndef MPL_TRACE_MIN_LEVEL
+#define MPL_TRACE_MIN_LEVEL 0
+#endif
+
+#define MPL_TRACE(LEVEL, ...) \
+    do { \
+        ::motion_planning_libraries::TraceLog& trace_log_ = \
+                ::motion_planning_libraries::TraceLog::getInstance(); \
+        if(trace_log_.isEnabled(LEVEL)) { \
+            trace_log_.record(LEVEL, __FILE__, __LINE__, __VA_ARGS__); \
+        } \
+    } while(0)
+
+#if MPL_TRACE_MIN_LEVEL <= 0
+#define MPL_TRACE_DEBUG(...) MPL_TRACE(::motion_planning_libraries::TRACE_DEBUG, __VA_ARGS__)
+#else
+#define MPL_TRACE_DEBUG(...) do {} while(0)
+#endif
+
+#if MPL_TRACE_MIN_LEVEL <= 1
+#define MPL_TRACE_INFO(...) MPL_TRACE(::motion_planning_libraries::TRACE_INFO, __VA_ARGS__)
+#else
+#define MPL_TRACE_INFO(...) do {} while(0)
+#endif
+
+#if MPL_TRACE_MIN_LEVEL <= 2
+#define MPL_TRACE_WARN(...) MPL_TRACE(::motion_planning_libraries::TRACE_WARN, __VA_ARGS__)
+#else
+#define MPL_TRACE_WARN(...) do {} while(0)
+#endif
+
+namespace motion_planning_libraries
+{
+
+enum TraceLevel {
+    TRACE_DEBUG = 0,
+    TRACE_INFO,
+    TRACE_WARN,
+    TRACE_NONE
+};
+
+/**
+ * Numeric argument of a trace record. Strings are not supported, they
+ * could be gone before the record is formatted.
+ */
+struct TraceArg {
+    bool mIsDouble;
+    union {
+        int64_t mInt;
+        double mDouble;
+    };
+};
+
+inline TraceArg makeTraceArg(double value) {
+    TraceArg arg;
+    arg.mIsDouble = true;
+    arg.mDouble = value;
+    return arg;
+}
+
+inline TraceArg makeTraceArg(long long value) {
+    TraceArg arg;
+    arg.mIsDouble = false;
+    arg.mInt = value;
+    return arg;
+}
+
+inline TraceArg makeTraceArg(int value) {
+    return makeTraceArg((long long)value);
+}
+
+inline TraceArg makeTraceArg(unsigned int value) {
+    return makeTraceArg((long long)value);
+}
+
+inline TraceArg makeTraceArg(long value) {
+    return makeTraceArg((long long)value);
+}
+
+inline TraceArg makeTraceArg(unsigned long value) {
+    return makeTraceArg((long long)value);
+}
+
+inline TraceArg makeTraceArg(unsigned long long value) {
+    return makeTraceArg((long long)value);
+}
+
+struct TraceRecord {
+    static const unsigned int MAX_ARGS = 10;
+
+    int64_t mTimeMicroseconds;
+    // String literals of the call (format, __FILE__).
+    const char* mFormat;
+    const char* mFile;
+    int mLine;
+    uint8_t mLevel;
+    uint8_t mNumArgs;
+    TraceArg mArgs[MAX_ARGS];
+};
+
+/**
+ * Logging for the planning hot paths (validity checks, map updates, plan()),
+ * used by the MPL_TRACE_* macros. A call only copies its printf format (a
+ * literal) and its numeric arguments into a bounded lock-free ring buffer,
+ * which can be filled by several threads. A background thread drains the
+ * buffer every DRAIN_PERIOD_MS, formats the records and passes them to
+ * base-logging. If the buffer is full the record is dropped and counted.
+ *
+ * The runtime level is initialized from BASE_LOG_LEVEL (TRACE_WARN if it
+ * is not set), records below it are discarded before anything is copied.
+ * Calls below MPL_TRACE_MIN_LEVEL are not compiled at all.
+ */
+class TraceLog {
+ public:
+    static const unsigned int CAPACITY = 1024; // Has to be a power of two.
+    static const unsigned int DRAIN_PERIOD_MS = 20;
+
+ private:
+    struct Slot {
+        std::atomic<uint64_t> mSequence;
+        TraceRecord mRecord;
+    };
+
+    Slot mSlots[CAPACITY];
+    std::atomic<uint64_t> mEnqueuePos;
+    std::atomic<uint64_t> mDequeuePos;
+    std::atomic<uint64_t> mNumRecords;
+    std::atomic<uint64_t> mNumDropped;
+    std::atomic<int> mLevel;
+    std::atomic<bool> mStop;
+    // Serializes the drain thread and flush().
+    std::mutex mDrainMutex;
+    std::thread mDrainThread;
+
+ public:
+    /**
+     * Process-wide instance, the drain thread is started by the first call.
+     */
+    static TraceLog& getInstance();
+
+    /**
+     * Stops the drain thread and writes the remaining records.
+     */
+    ~TraceLog();
+
+    inline bool isEnabled(TraceLevel level) const {
+        return (int)level >= mLevel.load(std::memory_order_relaxed);
+    }
+
+    inline void setLevel(TraceLevel level) {
+        mLevel.store(level, std::memory_order_relaxed);
+    }
+
+    /**
+     * Adds a record, \a format has to be a string literal with integer
+     * (d, i, u, x, ...) and floating point (f, e, g, ...) conversions only.
+     */
+    template <class... Args>
+    void record(TraceLevel level, const char* file, int line, const char* format, Args... args) {
+        static_assert(sizeof...(Args) <= TraceRecord::MAX_ARGS, "Too many trace arguments");
+        TraceRecord record;
+        record.mTimeMicroseconds = base::Time::now().toMicroseconds();
+        record.mFormat = format;
+        record.mFile = file;
+        record.mLine = line;
+        record.mLevel = level;
+        record.mNumArgs = sizeof...(Args);
+        setArgs(record.mArgs, args...);
+        push(record);
+    }
+
+    /**
+     * Writes all buffered records within the calling thread.
+     */
+    void flush();
+
+    /**
+     * Number of records added since the start of the process.
+     */
+    inline uint64_t getNumRecords() const {
+        return mNumRecords.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of records dropped because the buffer has been full.
+     */
+    inline uint64_t getNumDropped() const {
+        return mNumDropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Formats the record: Every conversion is applied to the next stored
+     * argument, which is converted to the type required by the conversion.
+     */
+    static void format(TraceRecord const& record, std::string& text);
+
+ private:
+    TraceLog();
+    TraceLog(TraceLog const&);
+    TraceLog& operator=(TraceLog const&);
+
+    static inline void setArgs(TraceArg* args) {
+    }
+
+    template <class T, class... Args>
+    static inline void setArgs(TraceArg* args, T first, Args... rest) {
+        *args = makeTraceArg(first);
+        setArgs(args + 1, rest...);
+    }
+
+    /**
+     * Bounded multi-producer multi-consumer queue, the record is dropped if it is full.
+     */
+    void push(TraceRecord const& record);
+
+    bool pop(TraceRecord& record);
+
+    void drainLoop();
+
+    void write(TraceRecord const& record, std::string& text);
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_TRACE_LOG_HPP_
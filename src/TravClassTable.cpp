@@ -0,0 +1,42 @@
+#include "TravClassTable.hpp"
+
+#include <limits>
+
+namespace motion_planning_libraries
+{
+
+TravClassTable::TravClassTable() {
+}
+
+TravClassTable::TravClassTable(envire::TraversabilityGrid const* trav_grid, 
+        Config const& config) {
+    update(trav_grid, config);
+}
+
+void TravClassTable::update(envire::TraversabilityGrid const* trav_grid, 
+        Config const& config) {
+    
+    double speed = config.mMobility.mSpeed;
+    double scale = trav_grid->getScaleX();
+    
+    for(unsigned int i=0; i<NUM_CLASSES; ++i) {
+        TravClassCosts& costs = mClasses[i];
+        costs.mDriveability = trav_grid->getTraversabilityClass((uint8_t)i).getDrivability();
+        costs.mObstacle = (costs.mDriveability == 0.0);
+        costs.mSbplCost = driveability2sbpl_cost(costs.mDriveability);
+        
+        // Time to traverse the cell. Driveability of 1.0 means, that the cell can
+        // be traversed with full speed.
+        if(costs.mObstacle || speed == 0) {
+            costs.mOmplCost = std::numeric_limits<double>::max();
+        } else {
+            costs.mOmplCost = (scale / speed) / costs.mDriveability;
+        }
+    }
+}
+
+unsigned char TravClassTable::driveability2sbpl_cost(double driveability) {
+    return SBPL_MAX_COST - (int)(driveability * (double)SBPL_MAX_COST) + 1.0;
+}
+
+} // namespace motion_planning_libraries
@@ -0,0 +1,94 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_TRAV_CLASS_TABLE_HPP_
+#define _MOTION_PLANNING_LIBRARIES_TRAV_CLASS_TABLE_HPP_
+
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <envire/maps/TraversabilityGrid.hpp>
+
+#include "Config.hpp"
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Costs of a single traversability class which are used by the planning libraries.
+ */
+struct TravClassCosts {
+    double mDriveability;
+    // Driveability 0.0 to 1.0 mapped to SBPL_MAX_COST + 1 to 1.
+    unsigned char mSbplCost;
+    // Time in seconds to traverse a cell with full speed, 
+    // std::numeric_limits<double>::max() for obstacles.
+    double mOmplCost;
+    // Driveability of 0.0.
+    bool mObstacle;
+    
+    TravClassCosts() : mDriveability(0.0), mSbplCost(0), mOmplCost(0.0), mObstacle(true) {
+    }
+};
+
+/**
+ * Lookup table which maps each of the 256 possible class values of a 
+ * traversability map to its driveability and costs. It is built once 
+ * for each received map (MotionPlanningLibraries::setTravGrid) and shared 
+ * by all planning libraries, so the per cell queries are reduced to
+ * a single byte-indexed load instead of requesting the traversability 
+ * class from the map.
+ */
+class TravClassTable {
+ public:
+    // Driveability 0.0 to 1.0 will be mapped to SBPL_MAX_COST + 1 to 1 
+    // with obstacle threshold of SBPL_MAX_COST + 1.
+    static const unsigned char SBPL_MAX_COST = 20;
+    static const unsigned int NUM_CLASSES = 256;
+    
+ private:
+    TravClassCosts mClasses[NUM_CLASSES];
+    
+ public:
+    TravClassTable();
+    
+    /**
+     * Creates a table using the classes of the passed traversability map.
+     */
+    TravClassTable(envire::TraversabilityGrid const* trav_grid, Config const& config);
+    
+    /**
+     * Fills the table using the traversability classes of \a trav_grid.
+     * The scale of the map and the speed of the system are used to calculate
+     * the OMPL costs.
+     */
+    void update(envire::TraversabilityGrid const* trav_grid, Config const& config);
+    
+    inline TravClassCosts const& operator[](uint8_t class_value) const {
+        return mClasses[class_value];
+    }
+    
+    inline double getDriveability(uint8_t class_value) const {
+        return mClasses[class_value].mDriveability;
+    }
+    
+    inline unsigned char getSbplCost(uint8_t class_value) const {
+        return mClasses[class_value].mSbplCost;
+    }
+    
+    inline double getOmplCost(uint8_t class_value) const {
+        return mClasses[class_value].mOmplCost;
+    }
+    
+    inline bool isObstacle(uint8_t class_value) const {
+        return mClasses[class_value].mObstacle;
+    }
+    
+    /**
+     * Driveability 0.0 to 1.0 is mapped to costs SBPL_MAX_COST + 1 to 1 
+     * (+1 because costs of 0 should be avoided).
+     */
+    static unsigned char driveability2sbpl_cost(double driveability);
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_TRAV_CLASS_TABLE_HPP_
@@ -0,0 +1,195 @@
+#include "TurningReachability.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+const int TABLE_SIZE_XY = 2 * TurningReachability::TABLE_EXTENT *
+        TurningReachability::TABLE_CELLS_PER_RADIUS + 1;
+// Tolerance (turning radii or rad) of the length comparison and of the Dubins words,
+// a pure arc or straight segment must not be rejected because of rounding errors.
+const double LENGTH_TOLERANCE = 1e-9;
+
+inline double mod2pi(double angle) {
+    double v = std::fmod(angle, 2.0 * M_PI);
+    v = v < 0 ? v + 2.0 * M_PI : v;
+    return v > 2.0 * M_PI - LENGTH_TOLERANCE ? 0.0 : v;
+}
+
+std::vector<float> createTable(bool allow_backward,
+        double (*get_length)(double, double, double, bool)) {
+    std::vector<float> table((size_t)TABLE_SIZE_XY * TABLE_SIZE_XY *
+            TurningReachability::TABLE_NUM_ANGLES);
+    size_t i = 0;
+    for(int a = 0; a < TurningReachability::TABLE_NUM_ANGLES; ++a) {
+        double yaw = a * 2.0 * M_PI / TurningReachability::TABLE_NUM_ANGLES;
+        for(int iy = 0; iy < TABLE_SIZE_XY; ++iy) {
+            double y = (iy - TurningReachability::TABLE_EXTENT *
+                    TurningReachability::TABLE_CELLS_PER_RADIUS) /
+                    (double)TurningReachability::TABLE_CELLS_PER_RADIUS;
+            for(int ix = 0; ix < TABLE_SIZE_XY; ++ix, ++i) {
+                double x = (ix - TurningReachability::TABLE_EXTENT *
+                        TurningReachability::TABLE_CELLS_PER_RADIUS) /
+                        (double)TurningReachability::TABLE_CELLS_PER_RADIUS;
+                table[i] = get_length(x, y, yaw, allow_backward);
+            }
+        }
+    }
+    return table;
+}
+}
+
+TurningReachability::TurningReachability(double min_turning_radius, bool allow_backward,
+        double max_length_factor, bool use_table) :
+        mMinTurningRadius(min_turning_radius),
+        mAllowBackward(allow_backward),
+        mMaxLengthFactor(max_length_factor),
+        mUseTable(use_table),
+        mpTable(NULL) {
+    if(mUseTable && mMinTurningRadius > 0) {
+        mpTable = &getTable(mAllowBackward);
+    }
+}
+
+bool TurningReachability::isReachable(double x0, double y0, double yaw0,
+        double x1, double y1, double yaw1) const {
+    if(mMinTurningRadius <= 0) {
+        return true;
+    }
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double dist = std::sqrt(dx * dx + dy * dy) / mMinTurningRadius;
+
+    // Relative pose in units of the turning radius.
+    double c = std::cos(yaw0);
+    double s = std::sin(yaw0);
+    double x = (c * dx + s * dy) / mMinTurningRadius;
+    double y = (-s * dx + c * dy) / mMinTurningRadius;
+    double yaw = mod2pi(yaw1 - yaw0);
+
+    double length = 0.0;
+    int ix = (int)std::floor(x * TABLE_CELLS_PER_RADIUS + 0.5) + TABLE_EXTENT * TABLE_CELLS_PER_RADIUS;
+    int iy = (int)std::floor(y * TABLE_CELLS_PER_RADIUS + 0.5) + TABLE_EXTENT * TABLE_CELLS_PER_RADIUS;
+    if(mpTable != NULL && ix >= 0 && ix < TABLE_SIZE_XY && iy >= 0 && iy < TABLE_SIZE_XY) {
+        int a = (int)std::floor(yaw * TABLE_NUM_ANGLES / (2.0 * M_PI) + 0.5) % TABLE_NUM_ANGLES;
+        length = (*mpTable)[((size_t)a * TABLE_SIZE_XY + iy) * TABLE_SIZE_XY + ix];
+    } else {
+        length = getNormalizedLength(x, y, yaw, mAllowBackward);
+    }
+    return length <= mMaxLengthFactor * dist + LENGTH_TOLERANCE;
+}
+
+double TurningReachability::getPathLength(double x0, double y0, double yaw0,
+        double x1, double y1, double yaw1) const {
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    if(mMinTurningRadius <= 0) {
+        return std::sqrt(dx * dx + dy * dy);
+    }
+    double c = std::cos(yaw0);
+    double s = std::sin(yaw0);
+    return mMinTurningRadius * getNormalizedLength(
+            (c * dx + s * dy) / mMinTurningRadius,
+            (-s * dx + c * dy) / mMinTurningRadius,
+            yaw1 - yaw0, mAllowBackward);
+}
+
+double TurningReachability::getDubinsLength(double x, double y, double yaw) {
+    // Shkel and Lumelsky, Classification of the Dubins set.
+    double d = std::sqrt(x * x + y * y);
+    double phi = d > 0 ? std::atan2(y, x) : 0.0;
+    double a = mod2pi(-phi);
+    double b = mod2pi(yaw - phi);
+    double sa = std::sin(a), ca = std::cos(a);
+    double sb = std::sin(b), cb = std::cos(b);
+    double cab = std::cos(a - b);
+    double best = std::numeric_limits<double>::infinity();
+    double tmp = 0.0, p = 0.0, t = 0.0, q = 0.0;
+
+    // LSL
+    tmp = 2.0 + d * d - 2.0 * cab + 2.0 * d * (sa - sb);
+    if(tmp > -LENGTH_TOLERANCE) {
+        tmp = std::max(tmp, 0.0);
+        double theta = std::atan2(cb - ca, d + sa - sb);
+        t = mod2pi(-a + theta);
+        p = std::sqrt(tmp);
+        q = mod2pi(b - theta);
+        best = std::min(best, t + p + q);
+    }
+    // RSR
+    tmp = 2.0 + d * d - 2.0 * cab + 2.0 * d * (sb - sa);
+    if(tmp > -LENGTH_TOLERANCE) {
+        tmp = std::max(tmp, 0.0);
+        double theta = std::atan2(ca - cb, d - sa + sb);
+        t = mod2pi(a - theta);
+        p = std::sqrt(tmp);
+        q = mod2pi(-b + theta);
+        best = std::min(best, t + p + q);
+    }
+    // LSR
+    tmp = -2.0 + d * d + 2.0 * cab + 2.0 * d * (sa + sb);
+    if(tmp > -LENGTH_TOLERANCE) {
+        tmp = std::max(tmp, 0.0);
+        p = std::sqrt(tmp);
+        double theta = std::atan2(-ca - cb, d + sa + sb) - std::atan2(-2.0, p);
+        t = mod2pi(-a + theta);
+        q = mod2pi(-b + theta);
+        best = std::min(best, t + p + q);
+    }
+    // RSL
+    tmp = -2.0 + d * d + 2.0 * cab - 2.0 * d * (sa + sb);
+    if(tmp > -LENGTH_TOLERANCE) {
+        tmp = std::max(tmp, 0.0);
+        p = std::sqrt(tmp);
+        double theta = std::atan2(ca + cb, d - sa - sb) - std::atan2(2.0, p);
+        t = mod2pi(a - theta);
+        q = mod2pi(b - theta);
+        best = std::min(best, t + p + q);
+    }
+    // RLR
+    tmp = (6.0 - d * d + 2.0 * cab + 2.0 * d * (sa - sb)) / 8.0;
+    if(std::fabs(tmp) < 1.0 + LENGTH_TOLERANCE) {
+        tmp = std::max(-1.0, std::min(1.0, tmp));
+        p = mod2pi(2.0 * M_PI - std::acos(tmp));
+        t = mod2pi(a - std::atan2(ca - cb, d - sa + sb) + p / 2.0);
+        q = mod2pi(a - b - t + p);
+        best = std::min(best, t + p + q);
+    }
+    // LRL
+    tmp = (6.0 - d * d + 2.0 * cab + 2.0 * d * (sb - sa)) / 8.0;
+    if(std::fabs(tmp) < 1.0 + LENGTH_TOLERANCE) {
+        tmp = std::max(-1.0, std::min(1.0, tmp));
+        p = mod2pi(2.0 * M_PI - std::acos(tmp));
+        t = mod2pi(-a - std::atan2(ca - cb, d + sa - sb) + p / 2.0);
+        q = mod2pi(b - a - t + p);
+        best = std::min(best, t + p + q);
+    }
+    return best;
+}
+
+// PRIVATE
+double TurningReachability::getNormalizedLength(double x, double y, double yaw,
+        bool allow_backward) {
+    double length = getDubinsLength(x, y, yaw);
+    if(allow_backward) {
+        // Backward Dubins path: Forward path of the start pose turned by pi.
+        length = std::min(length, getDubinsLength(-x, -y, yaw));
+    }
+    return length;
+}
+
+std::vector<float> const& TurningReachability::getTable(bool allow_backward) {
+    // Thread-safe initialization of the local statics.
+    if(allow_backward) {
+        static const std::vector<float> backward_table = createTable(true, &getNormalizedLength);
+        return backward_table;
+    }
+    static const std::vector<float> forward_table = createTable(false, &getNormalizedLength);
+    return forward_table;
+}
+
+} // end namespace motion_planning_libraries
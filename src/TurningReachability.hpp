@@ -0,0 +1,85 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_TURNING_REACHABILITY_HPP_
+#define _MOTION_PLANNING_LIBRARIES_TURNING_REACHABILITY_HPP_
+
+#include <vector>
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Kinematic feasibility of a motion between two SE2 poses for a system with
+ * a minimal turning radius. The shortest Dubins path (forward, or if
+ * backward motions are allowed the shorter one of the forward and the backward
+ * Dubins path) is compared to the straight distance: The motion is regarded as
+ * feasible if the path is at most \a max_length_factor times longer, so poses
+ * which would require loops or sharp turns are rejected.
+ *
+ * The path lengths of the relative poses within TABLE_EXTENT turning radii
+ * are precomputed (in units of the turning radius, so the table is shared by
+ * all instances) and looked up with the resolution of the table. Poses
+ * farther away are calculated directly.
+ */
+class TurningReachability {
+ public:
+    // Extent (turning radii) of the table in x and y around the start pose.
+    static const int TABLE_EXTENT = 4;
+    // Number of cells per turning radius.
+    static const int TABLE_CELLS_PER_RADIUS = 8;
+    static const int TABLE_NUM_ANGLES = 72;
+
+ private:
+    double mMinTurningRadius;
+    bool mAllowBackward;
+    double mMaxLengthFactor;
+    bool mUseTable;
+    // Normalized path lengths, see getTable().
+    std::vector<float> const* mpTable;
+
+ public:
+    /**
+     * \param min_turning_radius In the units of the poses, a radius of 0
+     * accepts all motions.
+     */
+    TurningReachability(double min_turning_radius = 0.0, bool allow_backward = false,
+            double max_length_factor = 1.5, bool use_table = true);
+
+    inline double getMinTurningRadius() const {
+        return mMinTurningRadius;
+    }
+
+    /**
+     * Returns true if the pose (\a x1, \a y1, \a yaw1) can be reached from
+     * (\a x0, \a y0, \a yaw0) without an extensive detour.
+     */
+    bool isReachable(double x0, double y0, double yaw0,
+            double x1, double y1, double yaw1) const;
+
+    /**
+     * Length of the shortest path (Dubins, see above) between the poses,
+     * calculated without the table.
+     */
+    double getPathLength(double x0, double y0, double yaw0,
+            double x1, double y1, double yaw1) const;
+
+    /**
+     * Length of the shortest forward Dubins path from (0, 0, 0) to
+     * (\a x, \a y, \a yaw) in units of the turning radius.
+     */
+    static double getDubinsLength(double x, double y, double yaw);
+
+ private:
+    /**
+     * Normalized path length of the relative pose (start pose at the origin).
+     */
+    static double getNormalizedLength(double x, double y, double yaw, bool allow_backward);
+
+    /**
+     * Lookup table of the normalized lengths (x, y and yaw index, x fastest),
+     * created at the first call.
+     */
+    static std::vector<float> const& getTable(bool allow_backward);
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_TURNING_REACHABILITY_HPP_
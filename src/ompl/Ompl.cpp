@@ -1,26 +1,264 @@
 #include "Ompl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include <base/Time.hpp>
+
+#include <ompl/util/RandomNumbers.h>
 #include <ompl/geometric/PathGeometric.h>
+#include <ompl/base/PlannerData.h>
+#include <ompl/base/goals/GoalState.h>
+#include <ompl/base/goals/GoalStates.h>
+#include <ompl/base/objectives/MultiOptimizationObjective.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/geometric/planners/rrt/LazyRRT.h>
+#if OMPL_VERSION_VALUE >= 1001000
+#include <ompl/geometric/planners/prm/LazyPRMstar.h>
+#else
+#include <ompl/geometric/planners/rrt/RRTstar.h>
+#endif
+
+#include <motion_planning_libraries/ompl/validators/TravMapValidator.hpp>
+#include <motion_planning_libraries/ompl/objectives/TravGridObjective.hpp>
+#include <motion_planning_libraries/ompl/spaces/SherpaStateSpace.hpp>
 
 namespace motion_planning_libraries
 {    
+
+namespace {
+    
+double getPathCost(ompl::base::PathPtr const& path, ompl::base::OptimizationObjectivePtr const& objective) {
+#if OMPL_VERSION_VALUE > 1000000
+    return path->cost(objective).value();
+#else
+    return path->cost(objective).v;
+#endif
+}
+
+} // end anonymous namespace
     
 // PUBLIC
 Ompl::Ompl(Config config) : AbstractMotionPlanningLibrary(config) {
+    // The seed only has an effect before the first random number generator
+    // of the process has been created, so it is set once.
+    static bool seed_set = false;
+    if(config.mRandomSeed != 0 && !seed_set) {
+        ompl::RNG::setSeed(config.mRandomSeed);
+        seed_set = true;
+        LOG_INFO("OMPL random seed set to %u", config.mRandomSeed);
+    }
 }
 
 bool Ompl::solve(double time) {
-    ompl::base::PlannerStatus solved = mpPlanner->solve(time);
+    if(mpTravMapValidator != NULL) {
+        static_cast<TravMapValidator*>(mpTravMapValidator.get())->resetNumChecks();
+    }
+    if(mpTravGridObjective != NULL) {
+        static_cast<TravGridObjective*>(mpTravGridObjective.get())->resetNumEvaluations();
+    }
+    
+    ompl::base::PathPtr warm_start_path;
+    if(mConfig.mOmplWarmStart) {
+        warm_start_path = createWarmStartPath();
+    }
+    
+    ompl::base::PathPtr path;
+    if(warm_start_path != NULL && mConfig.mSearchUntilFirstSolution) {
+        LOG_INFO("Previous solution is still valid, the planner is not executed");
+        path = warm_start_path;
+    } else {
+        ompl::base::PlannerStatus solved;
+        if(mpParallelPlan != NULL) {
+            // Stops if one planner has been terminated with a solution and
+            // hybridizes the paths of all planners.
+            solved = mpParallelPlan->solve(time, 1, mParallelPlanners.size() + 1, true);
+        } else {
+            solved = mpPlanner->solve(time);
+        }
+        if(solved) {
+            path = mpProblemDefinition->getSolutionPath();
+        }
+        
+        if(warm_start_path != NULL) {
+            if(path == NULL) {
+                LOG_INFO("No solution found, the previous solution is used");
+                path = warm_start_path;
+            } else if(mpProblemDefinition->hasOptimizationObjective()) {
+                ompl::base::OptimizationObjectivePtr objective = 
+                        mpProblemDefinition->getOptimizationObjective();
+                if(getPathCost(warm_start_path, objective) < getPathCost(path, objective)) {
+                    LOG_INFO("The previous solution is cheaper than the new one and is used");
+                    path = warm_start_path;
+                }
+            }
+        }
+    }
+    
+    if(path == NULL) {
+        return false;
+    }
+    mpPathInGridOmpl = path;
+    mpWarmStartPath = path;
+    mpWarmStartGoal = mpProblemDefinition->getGoal();
+    mpWarmStartSpaceInformation = mpSpaceInformation;
+    // Allows to recognize improved solutions.
+    if(mpProblemDefinition->hasOptimizationObjective()) {
+        mPathCost = getPathCost(mpPathInGridOmpl, mpProblemDefinition->getOptimizationObjective());
+    }
+    return true;
+}
 
-    if (solved)
-    {
-        mpPathInGridOmpl = mpProblemDefinition->getSolutionPath();
+bool Ompl::setStartGoals(struct State start_state, std::vector<struct State> const& goal_states) {
+    if(goal_states.empty() || mpProblemDefinition == NULL) {
+        return false;
+    }
+    
+    // The nearest goal gives the lowest cost threshold.
+    size_t nearest = 0;
+    double min_dist = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < goal_states.size(); ++i) {
+        double dist = (goal_states[i].mPose.position - start_state.mPose.position).head(2).norm();
+        if(dist < min_dist) {
+            min_dist = dist;
+            nearest = i;
+        }
+    }
+    if(!setStartGoal(start_state, goal_states[nearest])) {
+        return false;
+    }
+    if(goal_states.size() == 1) {
         return true;
-    } else {
+    }
+    
+    // ENV_XYTHETA only creates the control space information.
+    ompl::base::GoalStates* goals = new ompl::base::GoalStates(mpProblemDefinition->getSpaceInformation());
+    ompl::base::GoalPtr goals_ptr(goals);
+    ompl::base::ScopedState<> goal_ompl(mpStateSpace);
+    for(size_t i = 0; i < goal_states.size(); ++i) {
+        if(!toOmplState(goal_states[i], goal_ompl)) {
+            LOG_WARN("Goal %zu cannot be converted to the OMPL state space", i);
+            return false;
+        }
+        goals->addState(goal_ompl);
+    }
+    if(mpCostToGoField != NULL) {
+        mpCostToGoField->clear();
+    }
+    mpProblemDefinition->setGoal(goals_ptr);
+    LOG_INFO("%zu goals have been set", goal_states.size());
+    return true;
+}
+
+int Ompl::getReachedGoal() {
+    if(mpPathInGridOmpl == NULL || mpProblemDefinition == NULL) {
+        return -1;
+    }
+    ompl::base::GoalStates const* goals = 
+            dynamic_cast<ompl::base::GoalStates const*>(mpProblemDefinition->getGoal().get());
+    if(goals == NULL) {
+        return 0;
+    }
+    std::vector<ompl::base::State*> const& path_states = getPathStates();
+    if(path_states.empty() || !goals->hasStates()) {
+        return -1;
+    }
+    ompl::base::SpaceInformationPtr const& si = mpProblemDefinition->getSpaceInformation();
+    int reached = 0;
+    double min_dist = std::numeric_limits<double>::max();
+    for(unsigned int i = 0; i < goals->getStateCount(); ++i) {
+        double dist = si->distance(path_states.back(), goals->getState(i));
+        if(dist < min_dist) {
+            min_dist = dist;
+            reached = i;
+        }
+    }
+    return reached;
+}
+
+void Ompl::fillStatistics(struct PlanningStatistics& statistics) {
+    if(mpTravMapValidator != NULL) {
+        statistics.mNumValidityChecks = 
+                static_cast<TravMapValidator*>(mpTravMapValidator.get())->getNumChecks();
+    }
+    if(mpTravGridObjective != NULL) {
+        statistics.mNumCostEvaluations = 
+                static_cast<TravGridObjective*>(mpTravGridObjective.get())->getNumEvaluations();
+    }
+    
+    // OMPL does not count expansions, the size of the trees is used instead.
+    statistics.mNumExpansions = 0;
+    std::vector<ompl::base::PlannerPtr> planners(1, mpPlanner);
+    planners.insert(planners.end(), mParallelPlanners.begin(), mParallelPlanners.end());
+    for(unsigned int p = 0; p < planners.size(); ++p) {
+        if(planners[p] == NULL) {
+            continue;
+        }
+        ompl::base::PlannerData data(planners[p]->getSpaceInformation());
+        planners[p]->getPlannerData(data);
+        statistics.mNumExpansions += data.numVertices();
+    }
+}
+
+bool Ompl::partialMapUpdate(std::vector<CellUpdate>& cell_updates) {
+    if(cell_updates.size() == 0) {
+        return true;
+    }
+    
+    if(mpPlanner == NULL || mpTravMapValidator == NULL || mpTravGridObjective == NULL ||
+            mpTravGrid == NULL || mpTravData == NULL) {
+        LOG_WARN("OMPL environment has not been initialized yet, partial update not possible");
         return false;
     }
+    
+    // The validator and the objective have been created by the environment, 
+    // the smart pointer types differ between the OMPL versions.
+    TravMapValidator* validator = static_cast<TravMapValidator*>(mpTravMapValidator.get());
+    TravGridObjective* objective = static_cast<TravGridObjective*>(mpTravGridObjective.get());
+    validator->partialMapUpdate(mpTravGrid, mpTravData, mpTravClassTable, cell_updates);
+    objective->setTravGrid(mpTravGrid, mpTravData, mpTravClassTable);
+    
+    if(mpCostToGoField != NULL && !mpCostToGoField->empty()) {
+        std::vector<double> class_costs;
+        getCostToGoClassCosts(class_costs);
+        if(!mpCostToGoField->update(*mpTravData, class_costs, cell_updates)) {
+            mpCostToGoField->create(*mpTravData, class_costs, 
+                    mpCostToGoField->getGoalX(), mpCostToGoField->getGoalY());
+        }
+    }
+    
+    // Validity and costs of the states only depend on the cells covered by their footprint.
+    int radius = 0;
+    if(mConfig.mEnvType != ENV_XY) {
+        double max_fp = std::max(mConfig.mFootprintRadiusMinMax.first, mConfig.mFootprintRadiusMinMax.second);
+        double min_scale = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+        radius = (int)std::ceil(max_fp / min_scale);
+    }
+    
+    if(isPlannerDataAffected(cell_updates, radius)) {
+        // OMPL does not allow to remove single motions from the planners,
+        // so the tree is cleared but all the objects are kept.
+        LOG_INFO("Map update affects the planner tree, the tree will be cleared");
+        mpPlanner->clear();
+        std::vector<ompl::base::PlannerPtr>::iterator it = mParallelPlanners.begin();
+        for(; it != mParallelPlanners.end(); ++it) {
+            (*it)->clear();
+        }
+        if(mpParallelPlan != NULL) {
+            mpParallelPlan->clearHybridizationPaths();
+        }
+        mpProblemDefinition->clearSolutionPaths();
+        mpPathInGridOmpl.reset();
+    } else {
+        LOG_INFO("Map update does not affect the planner tree, the tree is kept");
+    }
+    return true;
 }
 
-std::vector<ompl::base::State*> Ompl::getPathStates()
+std::vector<ompl::base::State*> const& Ompl::getPathStates()
 {
 #if OMPL_VERSION_VALUE < 1001000
     // Downcast from Path to PathGeometric is valid.
@@ -35,4 +273,296 @@ std::vector<ompl::base::State*> Ompl::getPathStates()
 #endif
 }
 
+bool Ompl::toOmplState(struct State state, ompl::base::ScopedState<>& ompl_state) {
+    return false;
+}
+
+ompl::base::PlannerPtr Ompl::allocatePlanner() {
+    return ompl::base::PlannerPtr();
+}
+
+ompl::base::PlannerPtr Ompl::allocateLazyPlanner() {
+    ompl::base::PlannerPtr planner;
+    if(mConfig.mSearchUntilFirstSolution) {
+        planner = ompl::base::PlannerPtr(new ompl::geometric::LazyRRT(mpSpaceInformation));
+    } else {
+#if OMPL_VERSION_VALUE >= 1001000
+        planner = ompl::base::PlannerPtr(new ompl::geometric::LazyPRMstar(mpSpaceInformation));
+#else
+        planner = ompl::base::PlannerPtr(new ompl::geometric::RRTstar(mpSpaceInformation));
+        planner->params().setParam("delay_collision_checking", "1");
+#endif
+    }
+    
+    // Allows to configure the max allowed dist between two samples.
+    if(mConfig.mMaxAllowedSampleDist > 0 && !std::isnan(mConfig.mMaxAllowedSampleDist) &&
+            planner->params().hasParam("range")) {
+        std::stringstream ss;
+        ss << mConfig.mMaxAllowedSampleDist;
+        planner->params().setParam("range", ss.str());
+    }
+    return planner;
+}
+
+void Ompl::setupParallelPlanning() {
+    mpParallelPlan.reset();
+    mParallelPlanners.clear();
+    
+    if(mConfig.mNumParallelPlanners < 2) {
+        return;
+    }
+    
+    mpParallelPlan = boost::shared_ptr<ompl::tools::ParallelPlan>(
+            new ompl::tools::ParallelPlan(mpProblemDefinition));
+    mpParallelPlan->addPlanner(mpPlanner);
+    for(unsigned int i = 1; i < mConfig.mNumParallelPlanners; ++i) {
+        ompl::base::PlannerPtr planner = allocatePlanner();
+        if(planner == NULL) {
+            LOG_WARN("Parallel planning is not supported by this environment");
+            break;
+        }
+        planner->setProblemDefinition(mpProblemDefinition);
+        planner->setup();
+        mpParallelPlan->addPlanner(planner);
+        mParallelPlanners.push_back(planner);
+    }
+    
+    if(mParallelPlanners.empty()) {
+        mpParallelPlan.reset();
+    } else {
+        LOG_INFO("%zu planners will be executed in parallel", mParallelPlanners.size() + 1);
+    }
+}
+
+bool Ompl::getGridPosition(const ompl::base::State* state, double& x, double& y) const {
+    switch(mConfig.mEnvType) {
+        case ENV_XY: {
+            const ompl::base::RealVectorStateSpace::StateType* state_rv = 
+                    state->as<ompl::base::RealVectorStateSpace::StateType>();
+            x = state_rv->values[0];
+            y = state_rv->values[1];
+            return true;
+        }
+        case ENV_XYTHETA: {
+            const ompl::base::SE2StateSpace::StateType* state_se2 = 
+                    state->as<ompl::base::SE2StateSpace::StateType>();
+            x = state_se2->getX();
+            y = state_se2->getY();
+            return true;
+        }
+        case ENV_SHERPA: {
+            const SherpaStateSpace::StateType* state_sherpa = 
+                    state->as<SherpaStateSpace::StateType>();
+            x = state_sherpa->getX();
+            y = state_sherpa->getY();
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+ompl::base::PathPtr Ompl::createWarmStartPath() const {
+    // Start, goal and map are unchanged, the planner continues with its tree.
+    if(mpWarmStartPath == NULL || mpWarmStartSpaceInformation != mpSpaceInformation ||
+            (mpPathInGridOmpl == mpWarmStartPath && 
+            mpProblemDefinition->getGoal() == mpWarmStartGoal)) {
+        return ompl::base::PathPtr();
+    }
+    // Control paths (ENV_XYTHETA) cannot be reconnected to a new start.
+    ompl::geometric::PathGeometric const* last_path = 
+            dynamic_cast<ompl::geometric::PathGeometric const*>(mpWarmStartPath.get());
+    ompl::base::Goal const* goal = mpProblemDefinition->getGoal().get();
+    if(last_path == NULL || last_path->getStateCount() == 0 || goal == NULL ||
+            mpProblemDefinition->getStartStateCount() == 0) {
+        return ompl::base::PathPtr();
+    }
+    
+    std::vector<ompl::base::State*> const& last_states = last_path->getStates();
+    const ompl::base::State* start = mpProblemDefinition->getStartState(0);
+    size_t nearest = 0;
+    double min_dist = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < last_states.size(); ++i) {
+        double dist = mpSpaceInformation->distance(start, last_states[i]);
+        if(dist < min_dist) {
+            min_dist = dist;
+            nearest = i;
+        }
+    }
+    
+    ompl::geometric::PathGeometric* path = new ompl::geometric::PathGeometric(mpSpaceInformation);
+    ompl::base::PathPtr path_ptr(path);
+    path->append(start);
+    // The nearest state is skipped if the start lies already behind it.
+    if(nearest + 1 < last_states.size() && 
+            mpSpaceInformation->checkMotion(start, last_states[nearest + 1])) {
+        nearest++;
+    }
+    for(size_t i = nearest; i < last_states.size(); ++i) {
+        path->append(last_states[i]);
+    }
+    
+    const ompl::base::State* end = last_states.back();
+    if(!goal->isSatisfied(end)) {
+        const ompl::base::State* goal_state = NULL;
+        ompl::base::GoalState const* single_goal = 
+                dynamic_cast<ompl::base::GoalState const*>(goal);
+        ompl::base::GoalStates const* goals = 
+                dynamic_cast<ompl::base::GoalStates const*>(goal);
+        if(single_goal != NULL) {
+            goal_state = single_goal->getState();
+        } else if(goals != NULL) {
+            min_dist = std::numeric_limits<double>::max();
+            for(unsigned int i = 0; i < goals->getStateCount(); ++i) {
+                double dist = mpSpaceInformation->distance(end, goals->getState(i));
+                if(dist < min_dist) {
+                    min_dist = dist;
+                    goal_state = goals->getState(i);
+                }
+            }
+        }
+        if(goal_state == NULL) {
+            return ompl::base::PathPtr();
+        }
+        path->append(goal_state);
+    }
+    
+    // Validity of all states and motions within the current map.
+    if(!path->check()) {
+        LOG_DEBUG("Previous solution is not valid anymore, no warm start");
+        return ompl::base::PathPtr();
+    }
+    LOG_INFO("Previous solution is still valid and used as warm start (%zu states)", 
+            path->getStateCount());
+    return path_ptr;
+}
+
+bool Ompl::isPlannerDataAffected(std::vector<CellUpdate> const& cell_updates, int radius) const {
+    if(cell_updates.empty()) {
+        return false;
+    }
+    
+    // Summed area table of the changed cells, allows to test each vertex 
+    // and edge (bounding box) with four lookups. It only covers the bounding box 
+    // of the changed cells, the tested boxes are clipped to it, so the costs 
+    // depend on the extent of the update instead of the size of the map.
+    int box_x = mpTravData->shape()[1], box_y = mpTravData->shape()[0];
+    int box_x_end = 0, box_y_end = 0;
+    std::vector<CellUpdate>::const_iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); ++it) {
+        box_x = std::min(box_x, (int)it->x);
+        box_y = std::min(box_y, (int)it->y);
+        box_x_end = std::max(box_x_end, (int)it->x + 1);
+        box_y_end = std::max(box_y_end, (int)it->y + 1);
+    }
+    int width = box_x_end - box_x;
+    int height = box_y_end - box_y;
+    std::vector<int> sums((width + 1) * (height + 1), 0);
+    for(it = cell_updates.begin(); it != cell_updates.end(); ++it) {
+        sums[((int)it->y - box_y + 1) * (width + 1) + (int)it->x - box_x + 1] = 1;
+    }
+    for(int y = 1; y <= height; ++y) {
+        for(int x = 1; x <= width; ++x) {
+            sums[y * (width + 1) + x] += sums[(y - 1) * (width + 1) + x] + 
+                    sums[y * (width + 1) + x - 1] - sums[(y - 1) * (width + 1) + x - 1];
+        }
+    }
+    
+    std::vector<ompl::base::PlannerPtr> planners(1, mpPlanner);
+    planners.insert(planners.end(), mParallelPlanners.begin(), mParallelPlanners.end());
+    
+    double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    std::vector<unsigned int> edges;
+    for(unsigned int p = 0; p < planners.size(); ++p) {
+        ompl::base::PlannerData data(planners[p]->getSpaceInformation());
+        planners[p]->getPlannerData(data);
+    
+        for(unsigned int i = 0; i < data.numVertices(); ++i) {
+            if(!getGridPosition(data.getVertex(i).getState(), x1, y1)) {
+                return true;
+            }
+            // Each vertex is tested together with its outgoing edges.
+            edges.clear();
+            data.getEdges(i, edges);
+            edges.push_back(i);
+            for(unsigned int e = 0; e < edges.size(); ++e) {
+                getGridPosition(data.getVertex(edges[e]).getState(), x2, y2);
+                // Propagated (control) motions may leave the bounding box of their 
+                // end states, for turns less than 180 degrees by at most half its diagonal.
+                int margin = radius;
+                if(mConfig.mEnvType == ENV_XYTHETA) {
+                    margin += (int)std::ceil(0.5 * std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)));
+                }
+                // Box relative to the summed area table.
+                int x_begin = std::max(0, (int)std::floor(std::min(x1, x2)) - margin - box_x);
+                int x_end = std::min(width, (int)std::floor(std::max(x1, x2)) + margin + 1 - box_x);
+                int y_begin = std::max(0, (int)std::floor(std::min(y1, y2)) - margin - box_y);
+                int y_end = std::min(height, (int)std::floor(std::max(y1, y2)) + margin + 1 - box_y);
+                if(x_begin >= x_end || y_begin >= y_end) {
+                    continue;
+                }
+                int num_changed = sums[y_end * (width + 1) + x_end] - sums[y_begin * (width + 1) + x_end] - 
+                        sums[y_end * (width + 1) + x_begin] + sums[y_begin * (width + 1) + x_begin];
+                if(num_changed > 0) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void Ompl::updateCostToGoField(double goal_x, double goal_y) {
+    if(!mConfig.mUseCostToGoField || mpTravGridObjective == NULL || mpTravData == NULL) {
+        return;
+    }
+    
+    if(mpCostToGoField == NULL) {
+        mpCostToGoField = boost::shared_ptr<CostToGoField>(new CostToGoField());
+        static_cast<TravGridObjective*>(mpTravGridObjective.get())->setCostToGoField(mpCostToGoField);
+        ompl::base::MultiOptimizationObjective* multi_objective = 
+                dynamic_cast<ompl::base::MultiOptimizationObjective*>(mpMultiOptimization.get());
+        if(multi_objective != NULL) {
+            multi_objective->setCostToGoHeuristic(
+                    [multi_objective](const ompl::base::State* state, const ompl::base::Goal* goal) {
+                double cost = 0.0;
+                for(unsigned int i = 0; i < multi_objective->getObjectiveCount(); ++i) {
+#if OMPL_VERSION_VALUE > 1000000
+                    cost += multi_objective->getObjectiveWeight(i) * 
+                            multi_objective->getObjective(i)->costToGo(state, goal).value();
+#else
+                    cost += multi_objective->getObjectiveWeight(i) * 
+                            multi_objective->getObjective(i)->costToGo(state, goal).v;
+#endif
+                }
+                return ompl::base::Cost(cost);
+            });
+        }
+    }
+    
+    int x = (int)goal_x;
+    int y = (int)goal_y;
+    if(mpCostToGoField->hasGoal(x, y)) {
+        LOG_DEBUG("Goal cell has not changed, cost-to-go field is reused");
+        return;
+    }
+    std::vector<double> class_costs;
+    getCostToGoClassCosts(class_costs);
+    base::Time start_t = base::Time::now();
+    if(!mpCostToGoField->create(*mpTravData, class_costs, x, y)) {
+        LOG_WARN("Cost-to-go field could not be created, no heuristic is used");
+        return;
+    }
+    LOG_INFO("Cost-to-go field created within %4.2f sec", 
+            (base::Time::now() - start_t).toSeconds());
+}
+
+void Ompl::getCostToGoClassCosts(std::vector<double>& class_costs) const {
+    class_costs.resize(CostToGoField::NUM_CLASSES);
+    for(unsigned int i = 0; i < CostToGoField::NUM_CLASSES; ++i) {
+        class_costs[i] = mpTravClassTable->getOmplCost(i);
+    }
+}
+
 } // namespace motion_planning_libraries
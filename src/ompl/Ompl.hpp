@@ -3,10 +3,14 @@
 
 #include <ompl/base/StateSpace.h>
 #include <ompl/base/ProblemDefinition.h>
+#include <ompl/base/ScopedState.h>
 #include <ompl/base/OptimizationObjective.h>
 #include <ompl/base/Planner.h>
+#include <ompl/base/StateValidityChecker.h>
+#include <ompl/tools/multiplan/ParallelPlan.h>
 
 #include <motion_planning_libraries/AbstractMotionPlanningLibrary.hpp>
+#include <motion_planning_libraries/CostToGoField.hpp>
 
 namespace motion_planning_libraries
 {
@@ -19,7 +23,6 @@ namespace motion_planning_libraries
  * 
  * \todo "For XYTHETA: A steering angle of 0.04 matches a turning velocity of 45° per sec.
  *      Higher values allows nearly every turning. Why? Something to do with step size?"
- * \todo "Add collision checking for arm movement."
  */
 class Ompl : public AbstractMotionPlanningLibrary
 {
@@ -30,6 +33,20 @@ class Ompl : public AbstractMotionPlanningLibrary
     ompl::base::PlannerPtr mpPlanner;
     ompl::base::OptimizationObjectivePtr mpMultiOptimization;
     ompl::base::PathPtr mpPathInGridOmpl;
+    // Have to be created by the environments (TravMapValidator and TravGridObjective).
+    ompl::base::StateValidityCheckerPtr mpTravMapValidator;
+    ompl::base::OptimizationObjectivePtr mpTravGridObjective;
+    // Used if Config::mNumParallelPlanners > 1, runs mpPlanner and the additional planners.
+    boost::shared_ptr<ompl::tools::ParallelPlan> mpParallelPlan;
+    std::vector<ompl::base::PlannerPtr> mParallelPlanners;
+    // Heuristic of the objectives (Config::mUseCostToGoField) using the OMPL costs, 
+    // kept while the goal does not change. Has to be reset by initialize().
+    boost::shared_ptr<CostToGoField> mpCostToGoField;
+    // Last solution together with the goal and the space information it has
+    // been found for, see Config::mOmplWarmStart.
+    ompl::base::PathPtr mpWarmStartPath;
+    ompl::base::GoalPtr mpWarmStartGoal;
+    ompl::base::SpaceInformationPtr mpWarmStartSpaceInformation;
       
  public: 
     Ompl(Config config = Config());
@@ -38,11 +55,107 @@ class Ompl : public AbstractMotionPlanningLibrary
     /**
      * Tries to find a valid path for \a time seconds.
      * If this method is called several times it will optimize the found solution.
+     * With Config::mOmplWarmStart the previous solution is used if it is still 
+     * valid and the planner does not find a cheaper one (see createWarmStartPath()).
      */
     virtual bool solve(double time);
+    
+    /**
+     * Sets the start and the nearest goal by setStartGoal() (cost thresholds, 
+     * cost-to-go field) and replaces the goal by the set of all goals afterwards. 
+     * The cost-to-go field only belongs to a single goal, so it is not used 
+     * for several goals. Requires toOmplState().
+     */
+    virtual bool setStartGoals(struct State start_state, std::vector<struct State> const& goal_states);
+    
+    /**
+     * Goal of setStartGoals() which is nearest to the end of the last solution.
+     */
+    virtual int getReachedGoal();
+    
+    /**
+     * Rebinds the validator and the objective to the new map and keeps
+     * the planner. Its tree is only cleared if a vertex or an edge lies 
+     * within the footprint radius of a changed cell, so an optimizing planner 
+     * can continue to improve its solution across map updates.
+     */
+    virtual bool partialMapUpdate(std::vector<CellUpdate>& cell_updates);
+    
+    /**
+     * Adds the validity checks and cost evaluations of the last solve() 
+     * and the number of vertices of the planner trees.
+     */
+    virtual void fillStatistics(struct PlanningStatistics& statistics);
 
  protected:
-    std::vector<ompl::base::State*> getPathStates();
+    /**
+     * States of the current solution, valid until the next solve().
+     */
+    std::vector<ompl::base::State*> const& getPathStates();
+    
+    /**
+     * Can be implemented by the environments to convert a grid state to 
+     * their state space, used by setStartGoal() and setStartGoals(). 
+     * By default false is returned.
+     */
+    virtual bool toOmplState(struct State state, ompl::base::ScopedState<>& ompl_state);
+    
+    /**
+     * Can be implemented by the environments to allow parallel planning. 
+     * Has to return a new planner (not set up) of the same type as mpPlanner.
+     * By default an empty pointer is returned.
+     */
+    virtual ompl::base::PlannerPtr allocatePlanner();
+    
+    /**
+     * Planner for Config::mLazyCollisionChecking (not set up), which checks 
+     * the edges only if they become part of a candidate solution: 
+     * LazyRRT if Config::mSearchUntilFirstSolution is set, otherwise LazyPRMstar 
+     * (RRTstar with delayed collision checking for OMPL < 1.1).
+     */
+    ompl::base::PlannerPtr allocateLazyPlanner();
+    
+    /**
+     * Has to be called after mpPlanner has been set up. If Config::mNumParallelPlanners
+     * is greater than one, additional planners are allocated and executed 
+     * together with mpPlanner by solve(). All planners share the 
+     * space information, so the validator and the objectives have to be re-entrant.
+     */
+    void setupParallelPlanning();
+    
+    /**
+     * Returns the grid position of the passed state of the current environment
+     * or false if the environment does not use the traversability map.
+     */
+    bool getGridPosition(const ompl::base::State* state, double& x, double& y) const;
+    
+    /**
+     * Returns true if one of the vertices or edges of the planner tree lies 
+     * within \a radius (in grid cells) of a changed cell.
+     */
+    bool isPlannerDataAffected(std::vector<CellUpdate> const& cell_updates, int radius) const;
+    
+    /**
+     * Connects the current start state to the rest of the previous solution 
+     * (behind its state nearest to the start) and its end to the nearest goal 
+     * state. Returns an empty pointer if the start, goal and map have not 
+     * changed since the last solve(), if the previous solution is not geometric 
+     * or belongs to another space information or if the new path is invalid.
+     */
+    ompl::base::PathPtr createWarmStartPath() const;
+    
+    /**
+     * Has to be called by setStartGoal() with the goal grid position. If 
+     * Config::mUseCostToGoField is set, the field is (re-)created if its goal 
+     * cell has changed and passed to the objectives. The multi objective 
+     * uses the weighted sum of the heuristics of its objectives.
+     */
+    void updateCostToGoField(double goal_x, double goal_y);
+    
+    /**
+     * OMPL costs of the classes, std::numeric_limits<double>::max() for obstacles.
+     */
+    void getCostToGoClassCosts(std::vector<double>& class_costs) const;
 };
 
 } // end namespace motion_planning_libraries
@@ -6,6 +6,8 @@
 #include <ompl/geometric/planners/rrt/RRTstar.h>
 
 #include <motion_planning_libraries/ompl/objectives/TravGridObjective.hpp>
+#include <motion_planning_libraries/ompl/spaces/PooledStateSpaces.hpp>
+#include <motion_planning_libraries/ompl/validators/ArmValidator.hpp>
 
 namespace ob = ompl::base;
 namespace og = ompl::geometric;
@@ -14,7 +16,11 @@ namespace motion_planning_libraries
 {
     
 // PUBLIC
-OmplEnvARM::OmplEnvARM(Config config) : Ompl(config) {
+OmplEnvARM::OmplEnvARM(Config config) : Ompl(config),
+        mpPathLengthOptimization(),
+        mpMultiOptimization(),
+        mpArmCollisionChecker(),
+        mpArmValidator() {
 }
  
 bool OmplEnvARM::initialize_arm() {
@@ -23,9 +29,9 @@ bool OmplEnvARM::initialize_arm() {
         LOG_WARN("No joints/joint borders defined, arm cannot be initialized");
     }
 
-    LOG_INFO("Create OMPL RealVector(%d) environment", mConfig.mJointBorders.size());
+    LOG_INFO("Create OMPL RealVector(%zu) environment", mConfig.mJointBorders.size());
     
-    mpStateSpace = ob::StateSpacePtr(new ob::RealVectorStateSpace(mConfig.mJointBorders.size()));
+    mpStateSpace = ob::StateSpacePtr(new PooledRealVectorStateSpace(mConfig.mJointBorders.size()));
     ob::RealVectorBounds bounds(mConfig.mJointBorders.size());
     
     std::vector< MinMaxValue >::iterator it = mConfig.mJointBorders.begin();
@@ -40,16 +46,17 @@ bool OmplEnvARM::initialize_arm() {
     //mpStateSpace->setLongestValidSegmentFraction(1/(double)grid_width);
     
     mpSpaceInformation = ob::SpaceInformationPtr(new ob::SpaceInformation(mpStateSpace));
-    // Add your validity checker here (arm collision).
-    //mpTravMapValidator = ob::StateValidityCheckerPtr(new TravMapValidator(
-    //            mpSpaceInformation, grid_width, grid_height, grid_data, mConfig.mEnvType));
-    //mpSpaceInformation->setStateValidityChecker(mpTravMapValidator);
+    mpArmValidator = ob::StateValidityCheckerPtr(new ArmValidator(mpSpaceInformation, 
+            mpArmCollisionChecker, mConfig.mArmValidityCacheResolution));
+    mpSpaceInformation->setStateValidityChecker(mpArmValidator);
     mpSpaceInformation->setup();
         
     // Create problem definition. By default path length optimization will be used.    
     mpProblemDefinition = ob::ProblemDefinitionPtr(new ob::ProblemDefinition(mpSpaceInformation));
    
-    if(mConfig.mSearchUntilFirstSolution) { // Not optimizing planner, 
+    if(mConfig.mLazyCollisionChecking) { // The motions are checked for candidate solutions only.
+        mpPlanner = allocateLazyPlanner();
+    } else if(mConfig.mSearchUntilFirstSolution) { // Not optimizing planner, 
         mpPlanner = ob::PlannerPtr(new og::RRTConnect(mpSpaceInformation));
     } else { // Optimizing planners use all the available time to improve the solution.
         mpPlanner = ob::PlannerPtr(new og::RRTstar(mpSpaceInformation));
@@ -62,6 +69,17 @@ bool OmplEnvARM::initialize_arm() {
     return true;
 }
 
+bool OmplEnvARM::setArmCollisionChecker(boost::shared_ptr<ArmCollisionChecker const> checker) {
+    mpArmCollisionChecker = checker;
+    if(mpArmValidator != NULL) {
+        static_cast<ArmValidator*>(mpArmValidator.get())->setChecker(checker);
+    }
+    if(mpPlanner != NULL) {
+        mpPlanner->clear();
+    }
+    return true;
+}
+
 bool OmplEnvARM::setStartGoal(struct State start_state, struct State goal_state) {
     
     assert(start_state.getJointAngles().size() == goal_state.getJointAngles().size());
@@ -88,12 +106,16 @@ bool OmplEnvARM::setStartGoal(struct State start_state, struct State goal_state)
 }
 
 bool OmplEnvARM::solve(double time) {
+    if(mpArmValidator != NULL) {
+        static_cast<ArmValidator*>(mpArmValidator.get())->resetNumChecks();
+    }
     return Ompl::solve(time);
 }
     
 bool OmplEnvARM::fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid) {
-    std::vector<ompl::base::State*> path_states = getPathStates();
-    std::vector<ompl::base::State*>::iterator it = path_states.begin();
+    std::vector<ompl::base::State*> const& path_states = getPathStates();
+    std::vector<ompl::base::State*>::const_iterator it = path_states.begin();
+    path.reserve(path.size() + path_states.size());
     int counter = 0;
     for(;it != path_states.end(); ++it) { 
         const ompl::base::RealVectorStateSpace::StateType* state = 
@@ -112,4 +134,15 @@ bool OmplEnvARM::fillPath(std::vector<struct State>& path, bool& pos_defined_in_
     return true;
 }
 
+void OmplEnvARM::fillStatistics(struct PlanningStatistics& statistics) {
+    Ompl::fillStatistics(statistics);
+    if(mpArmValidator != NULL) {
+        ArmValidator* validator = static_cast<ArmValidator*>(mpArmValidator.get());
+        statistics.mNumValidityChecks = validator->getNumCollisionChecks();
+        LOG_DEBUG("%llu of %llu arm states have been answered by the cache", 
+                (unsigned long long)(validator->getNumChecks() - validator->getNumCollisionChecks()),
+                (unsigned long long)validator->getNumChecks());
+    }
+}
+
 } // namespace motion_planning_libraries
@@ -9,10 +9,11 @@ namespace motion_planning_libraries
 class OmplEnvARM : public Ompl
 {
  private: 
-    ompl::base::StateValidityCheckerPtr mpTravMapValidator;
     ompl::base::OptimizationObjectivePtr mpPathLengthOptimization;
     ompl::base::OptimizationObjectivePtr mpMultiOptimization;
-    ompl::base::OptimizationObjectivePtr mpTravGridObjective;
+    // Kept to check the states of the next initialization as well.
+    boost::shared_ptr<ArmCollisionChecker const> mpArmCollisionChecker;
+    ompl::base::StateValidityCheckerPtr mpArmValidator;
       
  public: 
     OmplEnvARM(Config config = Config());
@@ -23,6 +24,12 @@ class OmplEnvARM : public Ompl
      */
     virtual bool initialize_arm();
     
+    /**
+     * Passes the checker to the validator and clears the planner, its tree
+     * has been checked with the previous one.
+     */
+    virtual bool setArmCollisionChecker(boost::shared_ptr<ArmCollisionChecker const> checker);
+    
     /**
      * Sets the global start and goal poses (in grid coordinates) in OMPL.
      */ 
@@ -38,6 +45,11 @@ class OmplEnvARM : public Ompl
      * Converts the ompl path to an rigid body state path (both in grid coordinates).
      */
     virtual bool fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid);
+    
+    /**
+     * Reports the collision checks (cache misses) as validity checks.
+     */
+    virtual void fillStatistics(struct PlanningStatistics& statistics);
 };
 
 } // end namespace motion_planning_libraries
@@ -6,8 +6,10 @@
 #include <ompl/geometric/planners/rrt/RRTstar.h>
 #include <ompl/base/samplers/ObstacleBasedValidStateSampler.h>
 #include <ompl/base/samplers/GaussianValidStateSampler.h>
+#include <ompl/util/RandomNumbers.h>
 
 #include <motion_planning_libraries/ompl/validators/TravMapValidator.hpp>
+#include <motion_planning_libraries/ompl/validators/GridMotionValidator.hpp>
 #include <motion_planning_libraries/ompl/objectives/TravGridObjective.hpp>
 #include <motion_planning_libraries/ompl/spaces/SherpaStateSpace.hpp>
 
@@ -16,6 +18,60 @@ namespace og = ompl::geometric;
 
 namespace motion_planning_libraries
 {
+
+namespace {
+/**
+ * Samples the position uniformly and draws the footprint class among the
+ * classes which are free on the sampled cell (footprint class layer of the
+ * TravMapValidator), so no sample is rejected because of its footprint.
+ */
+class FootprintClassSampler : public ob::ValidStateSampler {
+ public:
+    FootprintClassSampler(const ob::SpaceInformation* si, TravMapValidator const* validator) :
+            ob::ValidStateSampler(si),
+            mpSampler(si->allocStateSampler()),
+            mpValidator(validator),
+            mRng() {
+        name_ = "footprint_class";
+    }
+    
+    bool sample(ob::State* state) {
+        for(unsigned int i = 0; i < attempts_; ++i) {
+            mpSampler->sampleUniform(state);
+            if(setFeasibleFootprintClass(state)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    bool sampleNear(ob::State* state, const ob::State* near, const double distance) {
+        for(unsigned int i = 0; i < attempts_; ++i) {
+            mpSampler->sampleUniformNear(state, near, distance);
+            if(setFeasibleFootprintClass(state)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+ private:
+    bool setFeasibleFootprintClass(ob::State* state) {
+        SherpaStateSpace::StateType* state_sherpa = state->as<SherpaStateSpace::StateType>();
+        int max_class = mpValidator->getMaxFootprintClass((int)state_sherpa->getX(), 
+                (int)state_sherpa->getY());
+        if(max_class < 0) {
+            return false;
+        }
+        state_sherpa->setFootprintClass(mRng.uniformInt(0, max_class));
+        return true;
+    }
+    
+    ob::StateSamplerPtr mpSampler;
+    TravMapValidator const* mpValidator;
+    ompl::RNG mRng;
+};
+}
     
 // PUBLIC
 OmplEnvSHERPA::OmplEnvSHERPA(Config config) : Ompl(config) {
@@ -25,6 +81,8 @@ bool OmplEnvSHERPA::initialize(envire::TraversabilityGrid* trav_grid,
             boost::shared_ptr<TravData> grid_data) { 
 
     LOG_INFO("Create OMPL SHERPA environment");
+    // Belongs to the previous map, created again by setStartGoal().
+    mpCostToGoField.reset();
     
     if(mConfig.mFootprintRadiusMinMax.first == 0 || mConfig.mFootprintRadiusMinMax.second == 0) {
         LOG_WARN("No min AND max radius have been defined within the Sherpa environment, abort");
@@ -48,12 +106,16 @@ bool OmplEnvSHERPA::initialize(envire::TraversabilityGrid* trav_grid,
     mpSpaceInformation = ob::SpaceInformationPtr(
             new ob::SpaceInformation(mpStateSpace));
  
-    mpTravMapValidator = ob::StateValidityCheckerPtr(new TravMapValidator(
-                mpSpaceInformation, trav_grid, grid_data, mConfig));
+    mpTravMapValidator = ob::StateValidityCheckerPtr(TravMapValidator::create(
+                mpSpaceInformation, trav_grid, grid_data, mConfig, mpTravClassTable));
     mpSpaceInformation->setStateValidityChecker(mpTravMapValidator);
     // 1/mpStateSpace->getMaximumExtent() (max dist between two states) -> resolution of one meter.
     // mpSpaceInformation->setStateValidityCheckingResolution (1/mpStateSpace->getMaximumExtent());
     mpSpaceInformation->setValidStateSamplerAllocator(allocOBValidStateSampler);
+    if(mConfig.mLazyCollisionChecking) {
+        mpSpaceInformation->setMotionValidator(ob::MotionValidatorPtr(
+                new GridMotionValidator(mpSpaceInformation, ENV_SHERPA)));
+    }
     mpSpaceInformation->setup();
         
     // Create problem definition.        
@@ -61,63 +123,33 @@ bool OmplEnvSHERPA::initialize(envire::TraversabilityGrid* trav_grid,
     // Create optimizations and balance them in getBalancedObjective().
     mpPathLengthOptimization = ob::OptimizationObjectivePtr(
         new ob::PathLengthOptimizationObjective(mpSpaceInformation));
-    mpTravGridObjective = ob::OptimizationObjectivePtr(new TravGridObjective(mpSpaceInformation, false,
-            trav_grid, grid_data, mConfig));
+    mpTravGridObjective = ob::OptimizationObjectivePtr(TravGridObjective::create(mpSpaceInformation, true,
+            trav_grid, grid_data, mConfig, mpTravClassTable));
     mpProblemDefinition->setOptimizationObjective(getBalancedObjective(mpSpaceInformation));
 
-    if(mConfig.mSearchUntilFirstSolution) { // Not optimizing planner, 
-        mpPlanner = ob::PlannerPtr(new og::RRTConnect(mpSpaceInformation));
-    } else { // Optimizing planners use all the available time to improve the solution.
-        mpPlanner = ob::PlannerPtr(new og::RRTstar(mpSpaceInformation));
-        // Allows to configure the max allowed dist between two samples.
-        if(mConfig.mMaxAllowedSampleDist > 0 && !std::isnan(mConfig.mMaxAllowedSampleDist)) {
-            ompl::base::ParamSet param_set = mpPlanner->params();
-            std::stringstream ss;
-            ss << mConfig.mMaxAllowedSampleDist;
-            param_set.setParam("range", ss.str().c_str());
-        }
-    }
+    mpPlanner = allocatePlanner();
 
     // Set the problem instance for our planner to solve
     mpPlanner->setProblemDefinition(mpProblemDefinition);
     mpPlanner->setup(); // Calls mpSpaceInformation->setup() as well.
+    setupParallelPlanning();
     
     return true;
 }
 
 bool OmplEnvSHERPA::setStartGoal(struct State start_state, struct State goal_state) {
     
-    double start_x = start_state.getPose().position[0];
-    double start_y = start_state.getPose().position[1];
-    //double start_yaw = start_state.getPose().getYaw();
-    unsigned int start_fp_class = start_state.getFootprintClass(mConfig.mFootprintRadiusMinMax.first, 
-            mConfig.mFootprintRadiusMinMax.second, mConfig.mNumFootprintClasses);
-    LOG_INFO("Start footprint class %d, min radius %4.2f max radius %4.2f num classes %d\n", 
-            start_fp_class, mConfig.mFootprintRadiusMinMax.first,
-            mConfig.mFootprintRadiusMinMax.second, mConfig.mNumFootprintClasses);
-
-    double goal_x = goal_state.getPose().position[0];
-    double goal_y = goal_state.getPose().position[1];
-    //double goal_yaw = start_state.getPose().getYaw();
-    unsigned int goal_fp_class = goal_state.getFootprintClass(mConfig.mFootprintRadiusMinMax.first, 
-            mConfig.mFootprintRadiusMinMax.second, mConfig.mNumFootprintClasses);
-    LOG_INFO("Goal footprint class %d, min radius %4.2f max radius %4.2f num classes %d\n", 
-            goal_fp_class, mConfig.mFootprintRadiusMinMax.first,
-            mConfig.mFootprintRadiusMinMax.second, mConfig.mNumFootprintClasses);
-    
     ob::ScopedState<> start_ompl(mpStateSpace);
     ob::ScopedState<> goal_ompl(mpStateSpace);
-    
-    start_ompl->as<SherpaStateSpace::StateType>()->setX(start_x);
-    start_ompl->as<SherpaStateSpace::StateType>()->setY(start_y);
-    //start_ompl->as<SherpaStateSpace::StateType>()->setYaw(start_yaw);
-    start_ompl->as<SherpaStateSpace::StateType>()->setFootprintClass(start_fp_class);
-    
-    goal_ompl->as<SherpaStateSpace::StateType>()->setX(goal_x);
-    goal_ompl->as<SherpaStateSpace::StateType>()->setY(goal_y);
-    //goal_ompl->as<SherpaStateSpace::StateType>()->setYaw(goal_yaw);
-    goal_ompl->as<SherpaStateSpace::StateType>()->setFootprintClass(goal_fp_class);
+    toOmplState(start_state, start_ompl);
+    toOmplState(goal_state, goal_ompl);
+    LOG_INFO("Start footprint class %d, goal footprint class %d, min radius %4.2f max radius %4.2f num classes %d\n", 
+            start_ompl->as<SherpaStateSpace::StateType>()->getFootprintClass(),
+            goal_ompl->as<SherpaStateSpace::StateType>()->getFootprintClass(),
+            mConfig.mFootprintRadiusMinMax.first, mConfig.mFootprintRadiusMinMax.second, 
+            mConfig.mNumFootprintClasses);
             
+    updateCostToGoField(goal_state.getPose().position[0], goal_state.getPose().position[1]);
     mpProblemDefinition->setStartAndGoalStates(start_ompl, goal_ompl);
  
     return true;
@@ -125,8 +157,9 @@ bool OmplEnvSHERPA::setStartGoal(struct State start_state, struct State goal_sta
     
 bool OmplEnvSHERPA::fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid) {
     // Downcast from Path to PathGeometric is valid.
-    std::vector<ompl::base::State*> path_states = getPathStates();
-    std::vector<ompl::base::State*>::iterator it = path_states.begin();
+    std::vector<ompl::base::State*> const& path_states = getPathStates();
+    std::vector<ompl::base::State*>::const_iterator it = path_states.begin();
+    path.reserve(path.size() + path_states.size());
 
     int counter = 0;
     for(;it != path_states.end(); ++it) { 
@@ -155,6 +188,36 @@ bool OmplEnvSHERPA::fillPath(std::vector<struct State>& path, bool& pos_defined_
 }
 
 // PROTECTED
+bool OmplEnvSHERPA::toOmplState(struct State state, ob::ScopedState<>& ompl_state) {
+    SherpaStateSpace::StateType* sherpa_state = ompl_state->as<SherpaStateSpace::StateType>();
+    sherpa_state->setX(state.getPose().position[0]);
+    sherpa_state->setY(state.getPose().position[1]);
+    sherpa_state->setFootprintClass(state.getFootprintClass(mConfig.mFootprintRadiusMinMax.first, 
+            mConfig.mFootprintRadiusMinMax.second, mConfig.mNumFootprintClasses));
+    return true;
+}
+
+ompl::base::PlannerPtr OmplEnvSHERPA::allocatePlanner() {
+    if(mConfig.mLazyCollisionChecking) {
+        return allocateLazyPlanner();
+    }
+    
+    ob::PlannerPtr planner;
+    if(mConfig.mSearchUntilFirstSolution) { // Not optimizing planner, 
+        planner = ob::PlannerPtr(new og::RRTConnect(mpSpaceInformation));
+    } else { // Optimizing planners use all the available time to improve the solution.
+        planner = ob::PlannerPtr(new og::RRTstar(mpSpaceInformation));
+        // Allows to configure the max allowed dist between two samples.
+        if(mConfig.mMaxAllowedSampleDist > 0 && !std::isnan(mConfig.mMaxAllowedSampleDist)) {
+            ompl::base::ParamSet param_set = planner->params();
+            std::stringstream ss;
+            ss << mConfig.mMaxAllowedSampleDist;
+            param_set.setParam("range", ss.str().c_str());
+        }
+    }
+    return planner;
+}
+
 ompl::base::OptimizationObjectivePtr OmplEnvSHERPA::getBalancedObjective(
     const ompl::base::SpaceInformationPtr& si) {
 
@@ -167,6 +230,13 @@ ompl::base::OptimizationObjectivePtr OmplEnvSHERPA::getBalancedObjective(
 }
 
 ompl::base::ValidStateSamplerPtr OmplEnvSHERPA::allocOBValidStateSampler(const ompl::base::SpaceInformation *si) {
+    TravMapValidator const* validator = 
+            dynamic_cast<TravMapValidator const*>(si->getStateValidityChecker().get());
+    if(validator != NULL && validator->hasFootprintClassLayer()) {
+        LOG_INFO("Sampler: Footprint classes are drawn from the footprint class layer");
+        return ob::ValidStateSamplerPtr(new FootprintClassSampler(si, validator));
+    }
+    
     // we can perform any additional setup / configuration of a sampler here,
     // but there is nothing to tweak in case of the ObstacleBasedValidStateSampler.
     ob::ValidStateSamplerPtr sampler_ptr = ob::ValidStateSamplerPtr(new ob::ObstacleBasedValidStateSampler(si));
@@ -9,10 +9,8 @@ namespace motion_planning_libraries
 class OmplEnvSHERPA : public Ompl
 {
  private: 
-    ompl::base::StateValidityCheckerPtr mpTravMapValidator;
     ompl::base::OptimizationObjectivePtr mpPathLengthOptimization;
     ompl::base::OptimizationObjectivePtr mpMultiOptimization;
-    ompl::base::OptimizationObjectivePtr mpTravGridObjective;
       
  public: 
     OmplEnvSHERPA(Config config = Config());
@@ -34,6 +32,13 @@ class OmplEnvSHERPA : public Ompl
     virtual bool fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid);
     
  protected:  
+    virtual bool toOmplState(struct State state, ompl::base::ScopedState<>& ompl_state);
+    
+    /**
+     * Creates RRTConnect or RRT* (optimizing) regarding Config::mSearchUntilFirstSolution.
+     */
+    virtual ompl::base::PlannerPtr allocatePlanner();
+    
     /**
      * Creates a combined optimization objective which tries to minimize the
      * costs of the trav grid.
@@ -41,6 +46,10 @@ class OmplEnvSHERPA : public Ompl
     ompl::base::OptimizationObjectivePtr getBalancedObjective(
         const ompl::base::SpaceInformationPtr& si);
     
+    /**
+     * Samples the footprint classes among the free ones if the validator provides
+     * its footprint class layer, otherwise an ObstacleBasedValidStateSampler is used.
+     */
     static ompl::base::ValidStateSamplerPtr allocOBValidStateSampler(
         const ompl::base::SpaceInformation *si);
 };
@@ -6,6 +6,8 @@
 #include <ompl/geometric/planners/rrt/RRTstar.h>
 
 #include <motion_planning_libraries/ompl/validators/TravMapValidator.hpp>
+#include <motion_planning_libraries/ompl/validators/GridMotionValidator.hpp>
+#include <motion_planning_libraries/ompl/spaces/PooledStateSpaces.hpp>
 #include <motion_planning_libraries/ompl/objectives/TravGridObjective.hpp>
 
 namespace ob = ompl::base;
@@ -22,8 +24,10 @@ bool OmplEnvXY::initialize(envire::TraversabilityGrid* trav_grid,
             boost::shared_ptr<TravData> grid_data) { 
 
     LOG_INFO("Create OMPL RealVector(2) environment");
+    // Belongs to the previous map, created again by setStartGoal().
+    mpCostToGoField.reset();
     
-    mpStateSpace = ob::StateSpacePtr(new ob::RealVectorStateSpace(2));
+    mpStateSpace = ob::StateSpacePtr(new PooledRealVectorStateSpace(2));
     ob::RealVectorBounds bounds(2);
     bounds.setLow (0, 0);
     bounds.setHigh(0, trav_grid->getCellSizeX());
@@ -37,11 +41,16 @@ bool OmplEnvXY::initialize(envire::TraversabilityGrid* trav_grid,
     mpSpaceInformation = ob::SpaceInformationPtr(
             new ob::SpaceInformation(mpStateSpace));
  
-    mpTravMapValidator = ob::StateValidityCheckerPtr(new TravMapValidator(
-                mpSpaceInformation, trav_grid, grid_data, mConfig));
+    mpTravMapValidator = ob::StateValidityCheckerPtr(TravMapValidator::create(
+                mpSpaceInformation, trav_grid, grid_data, mConfig, mpTravClassTable));
     mpSpaceInformation->setStateValidityChecker(mpTravMapValidator);
     // 1/mpStateSpace->getMaximumExtent() (max dist between two states) -> resolution of one meter.
     mpSpaceInformation->setStateValidityCheckingResolution (1/mpStateSpace->getMaximumExtent());
+    if(mConfig.mLazyCollisionChecking) {
+        // Each crossed cell is checked once.
+        mpSpaceInformation->setMotionValidator(ob::MotionValidatorPtr(
+                new GridMotionValidator(mpSpaceInformation, ENV_XY)));
+    }
     mpSpaceInformation->setup();
         
     // Create problem definition.        
@@ -49,22 +58,16 @@ bool OmplEnvXY::initialize(envire::TraversabilityGrid* trav_grid,
     // Create optimizations and balance them in getBalancedObjective().
     mpPathLengthOptimization = ob::OptimizationObjectivePtr(
         new ob::PathLengthOptimizationObjective(mpSpaceInformation));
-    mpTravGridObjective = ob::OptimizationObjectivePtr(new TravGridObjective(mpSpaceInformation, false,
-            trav_grid, grid_data, mConfig));
+    mpTravGridObjective = ob::OptimizationObjectivePtr(TravGridObjective::create(mpSpaceInformation, true,
+            trav_grid, grid_data, mConfig, mpTravClassTable));
     mpProblemDefinition->setOptimizationObjective(getBalancedObjective(mpSpaceInformation));
 
-    if(mConfig.mSearchUntilFirstSolution) { // Not optimizing planner, 
-        mpPlanner = ob::PlannerPtr(new og::RRTConnect(mpSpaceInformation));
-    } else { // Optimizing planners use all the available time to improve the solution.
-        mpPlanner = ob::PlannerPtr(new og::RRTstar(mpSpaceInformation));
-        // Allows to configure the max allowed dist between two samples.
-        ompl::base::ParamSet param_set = mpPlanner->params();
-        param_set.setParam("range", "0.5");
-    }
+    mpPlanner = allocatePlanner();
 
     // Set the problem instance for our planner to solve
     mpPlanner->setProblemDefinition(mpProblemDefinition);
     mpPlanner->setup(); // Calls mpSpaceInformation->setup() as well.
+    setupParallelPlanning();
     
     return true;
 }
@@ -73,18 +76,15 @@ bool OmplEnvXY::setStartGoal(struct State start_state, struct State goal_state)
     
     ob::ScopedState<> start_ompl(mpStateSpace);
     ob::ScopedState<> goal_ompl(mpStateSpace);
+    toOmplState(start_state, start_ompl);
+    toOmplState(goal_state, goal_ompl);
     
     double start_x = start_state.getPose().position[0];
     double start_y = start_state.getPose().position[1];
     double goal_x = goal_state.getPose().position[0];
     double goal_y = goal_state.getPose().position[1];
-    
-    start_ompl->as<ob::RealVectorStateSpace::StateType>()->values[0] = start_x;
-    start_ompl->as<ob::RealVectorStateSpace::StateType>()->values[1] = start_y;
-    
-    goal_ompl->as<ob::RealVectorStateSpace::StateType>()->values[0] = goal_x;
-    goal_ompl->as<ob::RealVectorStateSpace::StateType>()->values[1] = goal_y;
             
+    updateCostToGoField(goal_x, goal_y);
     mpProblemDefinition->setStartAndGoalStates(start_ompl, goal_ompl);
     
     // Stop if the found solution is nearly a straight line.
@@ -101,8 +101,9 @@ bool OmplEnvXY::solve(double time) {
 }
     
 bool OmplEnvXY::fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid) {
-    std::vector<ompl::base::State*> path_states = getPathStates();
-    std::vector<ompl::base::State*>::iterator it = path_states.begin();
+    std::vector<ompl::base::State*> const& path_states = getPathStates();
+    std::vector<ompl::base::State*>::const_iterator it = path_states.begin();
+    path.reserve(path.size() + path_states.size());
 
     int counter = 0;
     for(;it != path_states.end(); ++it) { 
@@ -124,6 +125,29 @@ bool OmplEnvXY::fillPath(std::vector<struct State>& path, bool& pos_defined_in_l
 }
 
 // PROTECTED
+bool OmplEnvXY::toOmplState(struct State state, ob::ScopedState<>& ompl_state) {
+    ompl_state->as<ob::RealVectorStateSpace::StateType>()->values[0] = state.getPose().position[0];
+    ompl_state->as<ob::RealVectorStateSpace::StateType>()->values[1] = state.getPose().position[1];
+    return true;
+}
+
+ompl::base::PlannerPtr OmplEnvXY::allocatePlanner() {
+    if(mConfig.mLazyCollisionChecking) {
+        return allocateLazyPlanner();
+    }
+    
+    ob::PlannerPtr planner;
+    if(mConfig.mSearchUntilFirstSolution) { // Not optimizing planner, 
+        planner = ob::PlannerPtr(new og::RRTConnect(mpSpaceInformation));
+    } else { // Optimizing planners use all the available time to improve the solution.
+        planner = ob::PlannerPtr(new og::RRTstar(mpSpaceInformation));
+        // Allows to configure the max allowed dist between two samples.
+        ompl::base::ParamSet param_set = planner->params();
+        param_set.setParam("range", "0.5");
+    }
+    return planner;
+}
+
 ompl::base::OptimizationObjectivePtr OmplEnvXY::getBalancedObjective(
     const ompl::base::SpaceInformationPtr& si) {
 
@@ -9,10 +9,8 @@ namespace motion_planning_libraries
 class OmplEnvXY : public Ompl
 {
  private: 
-    ompl::base::StateValidityCheckerPtr mpTravMapValidator;
     ompl::base::OptimizationObjectivePtr mpPathLengthOptimization;
     ompl::base::OptimizationObjectivePtr mpMultiOptimization;
-    ompl::base::OptimizationObjectivePtr mpTravGridObjective;
       
  public: 
     OmplEnvXY(Config config = Config());
@@ -40,6 +38,13 @@ class OmplEnvXY : public Ompl
     virtual bool fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid);
     
  protected:  
+    /**
+     * Creates RRTConnect or RRT* (optimizing) regarding Config::mSearchUntilFirstSolution.
+     */
+    virtual ompl::base::PlannerPtr allocatePlanner();
+    
+    virtual bool toOmplState(struct State state, ompl::base::ScopedState<>& ompl_state);
+    
     /**
      * Creates a combined optimization objective which tries to minimize the
      * costs of the trav grid.
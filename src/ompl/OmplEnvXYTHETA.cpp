@@ -4,6 +4,8 @@
 #include <ompl/control/planners/rrt/RRT.h>
 
 #include <motion_planning_libraries/ompl/validators/TravMapValidator.hpp>
+#include <motion_planning_libraries/ompl/spaces/PooledStateSpaces.hpp>
+#include <motion_planning_libraries/ompl/propagators/ClosedFormPropagator.hpp>
 #include <motion_planning_libraries/ompl/objectives/TravGridObjective.hpp>
 
 namespace ob = ompl::base;
@@ -12,17 +14,20 @@ namespace og = ompl::geometric;
 namespace motion_planning_libraries
 { 
   
-double OmplEnvXYTHETA::mCarLength = 2.0;   
+namespace {
+// Used if neither a footprint length nor a radius has been defined.
+const double DEFAULT_CAR_LENGTH = 2.0;
+}
     
 // PUBLIC
-OmplEnvXYTHETA::OmplEnvXYTHETA(Config config) : Ompl(config) {
+OmplEnvXYTHETA::OmplEnvXYTHETA(Config config) : Ompl(config), mCarLength(DEFAULT_CAR_LENGTH) {
     double length = std::max(mConfig.mFootprintLengthMinMax.first, mConfig.mFootprintLengthMinMax.second);
     if(length == 0) {
         length = std::max(mConfig.mFootprintRadiusMinMax.first, 
             mConfig.mFootprintRadiusMinMax.second);
         if(length == 0) {
-            LOG_WARN("No length has been defined, use default %4.2f instead", OmplEnvXYTHETA::mCarLength);
-            length = OmplEnvXYTHETA::mCarLength;
+            LOG_WARN("No length has been defined, use default %4.2f instead", DEFAULT_CAR_LENGTH);
+            length = DEFAULT_CAR_LENGTH;
         } else {
             LOG_WARN("No length has been defined, use max radius %4.2f instead", length);
         }
@@ -35,8 +40,10 @@ bool OmplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
   
     // Will define a control problem in SE2 (X, Y, THETA).
     LOG_INFO("Create OMPL SE2 environment");
+    // Belongs to the previous map, created again by setStartGoal().
+    mpCostToGoField.reset();
     
-    mpStateSpace = ompl::base::StateSpacePtr(new ob::SE2StateSpace());
+    mpStateSpace = ompl::base::StateSpacePtr(new PooledSE2StateSpace());
     ob::RealVectorBounds bounds(2);
     bounds.setLow (0, 0);
     bounds.setHigh(0, trav_grid->getCellSizeX());
@@ -64,18 +71,16 @@ bool OmplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
     // Control space information inherits from base space informartion.
     mpControlSpaceInformation = ompl::control::SpaceInformationPtr(
             new ompl::control::SpaceInformation(mpStateSpace,mpControlSpace));
-    mpODESolver = ompl::control::ODESolverPtr(
-            new ompl::control::ODEAdaptiveSolver<> (mpControlSpaceInformation, &simpleOde));
-    // setStatePropagator can also be used to define a post-propagator.
-    mpControlSpaceInformation->setStatePropagator(
-            ompl::control::ODESolver::getStatePropagator(mpODESolver, &postPropagate));
+    // Exact solution of the constant controls (straight segments and arcs).
+    mpControlSpaceInformation->setStatePropagator(ompl::control::StatePropagatorPtr(
+            new ClosedFormPropagator(mpControlSpaceInformation, PROPAGATION_UNICYCLE, mCarLength)));
             
     /// \todo "What does these methods do?"
     mpControlSpaceInformation->setPropagationStepSize(4);
     mpControlSpaceInformation->setMinMaxControlDuration(1,10);
 
-    mpTravMapValidator = ob::StateValidityCheckerPtr(new TravMapValidator(
-                mpControlSpaceInformation, trav_grid, grid_data, mConfig));
+    mpTravMapValidator = ob::StateValidityCheckerPtr(TravMapValidator::create(
+                mpControlSpaceInformation, trav_grid, grid_data, mConfig, mpTravClassTable));
     mpControlSpaceInformation->setStateValidityChecker(mpTravMapValidator);
     mpControlSpaceInformation->setup();
         
@@ -84,8 +89,8 @@ bool OmplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
     // Create optimizations and balance them in getBalancedObjective().
     mpPathLengthOptimization = ob::OptimizationObjectivePtr(
         new ob::PathLengthOptimizationObjective(mpControlSpaceInformation));
-    mpTravGridObjective = ob::OptimizationObjectivePtr(new TravGridObjective(mpControlSpaceInformation, false,
-            trav_grid, grid_data, mConfig));
+    mpTravGridObjective = ob::OptimizationObjectivePtr(TravGridObjective::create(mpControlSpaceInformation, true,
+            trav_grid, grid_data, mConfig, mpTravClassTable));
     mpProblemDefinition->setOptimizationObjective(getBalancedObjective(mpControlSpaceInformation));
     
     // Control based planner, optimization is not supported by OMPL.
@@ -102,22 +107,10 @@ bool OmplEnvXYTHETA::setStartGoal(struct State start_state, struct State goal_st
     
     ob::ScopedState<> start_ompl(mpStateSpace);
     ob::ScopedState<> goal_ompl(mpStateSpace);
-    
-    double start_x = start_state.getPose().position[0];
-    double start_y = start_state.getPose().position[1];
-    double start_yaw = start_state.getPose().getYaw();
-    double goal_x = goal_state.getPose().position[0];
-    double goal_y = goal_state.getPose().position[1];
-    double goal_yaw = goal_state.getPose().getYaw();
-    
-    start_ompl->as<ob::SE2StateSpace::StateType>()->setX(start_x);
-    start_ompl->as<ob::SE2StateSpace::StateType>()->setY(start_y);
-    start_ompl->as<ob::SE2StateSpace::StateType>()->setYaw(start_yaw);
-    
-    goal_ompl->as<ob::SE2StateSpace::StateType>()->setX(goal_x);
-    goal_ompl->as<ob::SE2StateSpace::StateType>()->setY(goal_y);
-    goal_ompl->as<ob::SE2StateSpace::StateType>()->setYaw(goal_yaw);
+    toOmplState(start_state, start_ompl);
+    toOmplState(goal_state, goal_ompl);
 
+    updateCostToGoField(goal_state.getPose().position[0], goal_state.getPose().position[1]);
     mpProblemDefinition->setStartAndGoalStates(start_ompl, goal_ompl);
     
     return true;
@@ -128,8 +121,9 @@ bool OmplEnvXYTHETA::solve(double time) {
 }
     
 bool OmplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid) {
-    std::vector<ompl::base::State*> path_states = getPathStates();
-    std::vector<ompl::base::State*>::iterator it = path_states.begin();
+    std::vector<ompl::base::State*> const& path_states = getPathStates();
+    std::vector<ompl::base::State*>::const_iterator it = path_states.begin();
+    path.reserve(path.size() + path_states.size());
 
     int counter = 0;
     for(;it != path_states.end(); ++it) {
@@ -152,6 +146,13 @@ bool OmplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined
 }
 
 // PROTECTED
+bool OmplEnvXYTHETA::toOmplState(struct State state, ob::ScopedState<>& ompl_state) {
+    ompl_state->as<ob::SE2StateSpace::StateType>()->setX(state.getPose().position[0]);
+    ompl_state->as<ob::SE2StateSpace::StateType>()->setY(state.getPose().position[1]);
+    ompl_state->as<ob::SE2StateSpace::StateType>()->setYaw(state.getPose().getYaw());
+    return true;
+}
+
 ompl::base::OptimizationObjectivePtr OmplEnvXYTHETA::getBalancedObjective(
     const ompl::base::SpaceInformationPtr& si) {
 
@@ -3,7 +3,6 @@
 
 #include <ompl/base/spaces/SE2StateSpace.h>
 #include <ompl/control/SpaceInformation.h>
-#include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
 
 #include "Ompl.hpp"
@@ -16,14 +15,10 @@ class OmplEnvXYTHETA : public Ompl
  private: 
     ompl::control::ControlSpacePtr mpControlSpace;
     ompl::control::SpaceInformationPtr mpControlSpaceInformation;
-    ompl::base::StateValidityCheckerPtr mpTravMapValidator;
     ompl::base::OptimizationObjectivePtr mpPathLengthOptimization;
     ompl::base::OptimizationObjectivePtr mpMultiOptimization;
-    ompl::base::OptimizationObjectivePtr mpTravGridObjective;
-    ompl::control::ODESolverPtr mpODESolver;
-      
-    // Used in static member functions.
-    static double mCarLength;  
+    // Length of the kinematic car model (PROPAGATION_CAR).
+    double mCarLength;  
       
  public: 
     OmplEnvXYTHETA(Config config = Config());
@@ -50,55 +45,9 @@ class OmplEnvXYTHETA : public Ompl
      */
     virtual bool fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid);
     
- private:
-    // Definition of the ODE for the kinematic car. Calculates the delta.
-    static const void kinematicCarOde (const ompl::control::ODESolver::StateType& q, 
-            const ompl::control::Control* control, 
-            ompl::control::ODESolver::StateType& qdot)
-    {
-        
-        // u contains [0] forward velocity and [1] rotational velocity
-        const double *u = control->as<ompl::control::RealVectorControlSpace::ControlType>()->values;
-        // q contains [0] x, [1] y and [2] current orientation. 
-        const double theta = q[2];
-        
-        // Zero out qdot
-        qdot.resize (q.size (), 0);
-
-        // Calculates delta.
-        qdot[0] = u[0] * cos(theta);
-        qdot[1] = u[0] * sin(theta);
-        qdot[2] = u[0] * tan(u[1]) / mCarLength;
-    }
-    
-    // Just sets the delta using the velocities.
-    static const void simpleOde (const ompl::control::ODESolver::StateType& q, 
-            const ompl::control::Control* control, 
-            ompl::control::ODESolver::StateType& qdot)
-    {
-        // u contains [0] forward velocity and [1] rotational velocity
-        const double *u = control->as<ompl::control::RealVectorControlSpace::ControlType>()->values;
-        const double theta = q[2];
-        
-        // Zero out qdot
-        qdot.resize (q.size (), 0);
-        
-        // Calculates the deltas XY and just set the rotational speed.
-        qdot[0] = u[0] * cos(theta);
-        qdot[1] = u[0] * sin(theta);
-        qdot[2] = u[1];
-    }
-    
-    static const void postPropagate(const ompl::base::State* state, const ompl::control::Control* control, 
-            const double duration, ompl::base::State* result)
-    {
-        ompl::base::SO2StateSpace SO2;
-        // Ensure that the car's resulting orientation lies between 0 and 2*pi.
-        ompl::base::SE2StateSpace::StateType& s = *result->as<ompl::base::SE2StateSpace::StateType>();
-        SO2.enforceBounds(s[1]);
-    }
-    
  protected:  
+    virtual bool toOmplState(struct State state, ompl::base::ScopedState<>& ompl_state);
+    
     /**
      * Creates a combined optimization objective which tries to minimize the
      * costs of the trav grid.
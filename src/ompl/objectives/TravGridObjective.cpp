@@ -2,3 +2,4 @@
 
 const double motion_planning_libraries::TravGridObjective::TIME_TO_ADAPT_FOOTPRINT = 40;
 const double motion_planning_libraries::TravGridObjective::PENALTY_TO_ADAPT_FOOTPRINT = 20;
+const double motion_planning_libraries::TravGridObjective::COST_TO_GO_SCALE = 0.92387953; // cos(22.5°)
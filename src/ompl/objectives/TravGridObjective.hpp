@@ -1,6 +1,9 @@
 #ifndef _OBJECTIVE_TRAV_GRID_HPP_
 #define _OBJECTIVE_TRAV_GRID_HPP_
 
+#include <atomic>
+#include <cmath>
+
 #include <ompl/base/spaces/SE2StateSpace.h>
 #include <ompl/base/objectives/StateCostIntegralObjective.h>
 
@@ -8,6 +11,9 @@
 #include <base-logging/Logging.hpp>
 
 #include <motion_planning_libraries/Config.hpp>
+#include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/TravClassTable.hpp>
+#include <motion_planning_libraries/CostToGoField.hpp>
 #include <motion_planning_libraries/ompl/spaces/SherpaStateSpace.hpp>
 
 namespace motion_planning_libraries
@@ -16,7 +22,8 @@ namespace motion_planning_libraries
 typedef envire::TraversabilityGrid::ArrayType TravData;
 
 /**
- * Using the costs of the trav grid. 
+ * Using the costs of the trav grid. If a cost-to-go field is set, it is used
+ * as cost heuristic (e.g. by informed planners), otherwise no heuristic is available.
  */
 class TravGridObjective :  public ompl::base::StateCostIntegralObjective {
 
@@ -24,84 +31,152 @@ class TravGridObjective :  public ompl::base::StateCostIntegralObjective {
      static const unsigned char OMPL_MAX_COST = 100;
      static const double TIME_TO_ADAPT_FOOTPRINT; // Time to move from min to max in sec.
      static const double PENALTY_TO_ADAPT_FOOTPRINT;
+     // 8-connected grid paths are up to 1/cos(22.5°) longer than the straight line,
+     // scales the cost-to-go field to a lower bound.
+     static const double COST_TO_GO_SCALE;
     
- private:
+ protected:
      envire::TraversabilityGrid* mpTravGrid; // To request the driveability values.
      boost::shared_ptr<TravData> mpTravData;
+     boost::shared_ptr<TravClassTable> mpTravClassTable;
      Config mConfig;
+     bool mIntegrateCellCosts;
+     // Number of cell cost lookups since the last resetNumEvaluations().
+     mutable std::atomic<uint64_t> mNumEvaluations;
+     // Has to use the OMPL costs of the classes.
+     boost::shared_ptr<CostToGoField const> mpCostToGoField;
         
  public:
     /**
      * \param enable_motion_cost_interpolation Defines if only start and end state
-     * are used for cost calculations or smaller intermediate steps. By default false.
-     * Not required for correct collision detection.
+     * are used for cost calculations or the costs of all cells which are crossed
+     * by the motion (see integrateCellCosts()). Not required for correct collision detection.
      * \todo "Currently only the cost of the center of the robot is used."
      */
     TravGridObjective(const ompl::base::SpaceInformationPtr& si, 
                         bool enable_motion_cost_interpolation,
                         Config config) : 
-                ompl::base::StateCostIntegralObjective(si, enable_motion_cost_interpolation), 
+                ompl::base::StateCostIntegralObjective(si, false), 
                 mpTravGrid(NULL), 
                 mpTravData(),
-                mConfig(config) {
+                mpTravClassTable(),
+                mConfig(config),
+                mIntegrateCellCosts(enable_motion_cost_interpolation),
+                mNumEvaluations(0),
+                mpCostToGoField() {
     }     
      
     TravGridObjective(const ompl::base::SpaceInformationPtr& si, 
                         bool enable_motion_cost_interpolation,
                         envire::TraversabilityGrid* trav_grid,
                         boost::shared_ptr<TravData> trav_data,
-                        Config config) : 
-                ompl::base::StateCostIntegralObjective(si, enable_motion_cost_interpolation), 
-                mpTravGrid(trav_grid), 
-                mpTravData(trav_data),
-                mConfig(config) {
+                        Config config,
+                        boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>()) : 
+                ompl::base::StateCostIntegralObjective(si, false), 
+                mpTravGrid(NULL), 
+                mpTravData(),
+                mpTravClassTable(),
+                mConfig(config),
+                mIntegrateCellCosts(enable_motion_cost_interpolation),
+                mNumEvaluations(0),
+                mpCostToGoField() {
+        setTravGrid(trav_grid, trav_data, trav_class_table);
     }
     
-    ~TravGridObjective() {
+    virtual ~TravGridObjective() {
     }
     
-    void setTravGrid(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data) {
+    /**
+     * Creates an objective which is specialized to Config::mEnvType at compile
+     * time, so the costs are calculated without evaluating the environment.
+     */
+    static TravGridObjective* create(const ompl::base::SpaceInformationPtr& si, 
+            bool enable_motion_cost_interpolation,
+            envire::TraversabilityGrid* trav_grid,
+            boost::shared_ptr<TravData> trav_data,
+            Config config,
+            boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>());
+    
+    /**
+     * If no class to cost lookup table is passed a new one is created 
+     * using the classes of \a trav_grid.
+     */
+    void setTravGrid(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data,
+            boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>()) {
+        if(trav_class_table == NULL && trav_grid != NULL) {
+            trav_class_table = boost::shared_ptr<TravClassTable>(
+                    new TravClassTable(trav_grid, mConfig));
+        }
         mpTravGrid = trav_grid;
         mpTravData = trav_data;
+        mpTravClassTable = trav_class_table;
     }
     
-    ompl::base::Cost stateCost(const ompl::base::State* s) const
+    inline uint64_t getNumEvaluations() const {
+        return mNumEvaluations;
+    }
+    
+    inline void resetNumEvaluations() {
+        mNumEvaluations = 0;
+    }
+    
+    /**
+     * The field is shared with the planning library which repairs it
+     * after map updates. An empty pointer removes the heuristic.
+     */
+    inline void setCostToGoField(boost::shared_ptr<CostToGoField const> field) {
+        mpCostToGoField = field;
+    }
+    
+    ompl::base::Cost stateCost(const ompl::base::State* s) const {
+        switch(mConfig.mEnvType) {
+            case ENV_XY: return computeStateCost<ENV_XY>(s);
+            case ENV_XYTHETA: return computeStateCost<ENV_XYTHETA>(s);
+            case ENV_SHERPA: return computeStateCost<ENV_SHERPA>(s);
+            default: throw std::runtime_error("TravGridObjective received an unknown environment");
+        }
+    }
+    
+    /**
+     * Lower bound of the cost from the state to the goal of the cost-to-go field.
+     * The footprint costs of ENV_SHERPA and the orientation only increase the 
+     * costs, so they are ignored.
+     */
+    ompl::base::Cost costToGo(const ompl::base::State* s, const ompl::base::Goal* goal) const {
+        switch(mConfig.mEnvType) {
+            case ENV_XY: return computeCostToGo<ENV_XY>(s);
+            case ENV_XYTHETA: return computeCostToGo<ENV_XYTHETA>(s);
+            case ENV_SHERPA: return computeCostToGo<ENV_SHERPA>(s);
+            default: throw std::runtime_error("TravGridObjective received an unknown environment");
+        }
+    }
+    
+    ompl::base::Cost motionCost(const ompl::base::State *s1, const ompl::base::State *s2) const {
+        switch(mConfig.mEnvType) {
+            case ENV_XY: return computeMotionCost<ENV_XY>(s1, s2);
+            case ENV_XYTHETA: return computeMotionCost<ENV_XYTHETA>(s1, s2);
+            case ENV_SHERPA: return computeMotionCost<ENV_SHERPA>(s1, s2);
+            default: throw std::runtime_error("TravGridObjective received an unknown environment");
+        }
+    }
+
+ protected:
+    /**
+     * Implementations of the objective within the environment \a ENV_TYPE, 
+     * used by the specialized objectives (see create()) without evaluating 
+     * the environment for each state.
+     */
+    template <enum EnvType ENV_TYPE>
+    ompl::base::Cost computeStateCost(const ompl::base::State* s) const
     {
         if(mpTravGrid == NULL) {
             throw std::runtime_error("TravGridObjective: No traversability grid available");
         }
+        mNumEvaluations.fetch_add(1, std::memory_order_relaxed);
     
         double x = 0, y = 0;
         int footprint_class = 0;
-        
-        switch(mConfig.mEnvType) {
-            case ENV_XY: {
-                const ompl::base::RealVectorStateSpace::StateType* state_rv = 
-                        s->as<ompl::base::RealVectorStateSpace::StateType>();
-                x = state_rv->values[0];
-                y = state_rv->values[1];
-                break;
-            }
-            case ENV_XYTHETA: {
-                const ompl::base::SE2StateSpace::StateType* state_se2 = 
-                        s->as<ompl::base::SE2StateSpace::StateType>();
-                x = state_se2->getX();
-                y = state_se2->getY();
-                break;
-            }
-            case ENV_SHERPA: {
-                const SherpaStateSpace::StateType* state_sherpa = 
-                        s->as<SherpaStateSpace::StateType>();
-                x = state_sherpa->getX();
-                y = state_sherpa->getY();
-                footprint_class = state_sherpa->getFootprintClass();
-                break;
-            }
-            default: {
-                throw std::runtime_error("TravGridObjective received an unknown environment");
-                break;
-            }
-        }
+        getStateData<ENV_TYPE>(s, x, y, footprint_class);
         
         /// \todo "Assuming: only valid states are passed?"
         if(x < 0 || x >= mpTravGrid->getCellSizeX() || 
@@ -111,38 +186,43 @@ class TravGridObjective :  public ompl::base::StateCostIntegralObjective {
             throw std::runtime_error("Invalid state received");
             //return ompl::base::Cost(0);
         }
+        //return ompl::base::Cost(OMPL_MAX_COST - (driveability * (double)OMPL_MAX_COST + 0.5));        
+        return ompl::base::Cost(getCellCost<ENV_TYPE>((int)x, (int)y, footprint_class));
+    }
     
-        // Estimate time to traverse the cell using forward speed and driveability.
-        double class_value = (double)(*mpTravData)[y][x];
-        double driveability = (mpTravGrid->getTraversabilityClass(class_value)).getDrivability();
-        double cost = 0;
-        if(driveability == 0 || mConfig.mMobility.mSpeed == 0) {
-            cost = std::numeric_limits<double>::max();
-        } else {
-            // Calculate time to traverse the cell. Driveability of 1.0 means, that the cell can
-            // be traversed with full speed.
-            cost = (mpTravGrid->getScaleX() / mConfig.mMobility.mSpeed) /  driveability;
-            // Increases cost regarding the footprint. Max footprint means full speed,
-            // min footprint increases the cost by the number of footprint classes.
-            if(mConfig.mEnvType == ENV_SHERPA) {
-                cost /= (footprint_class+1) / ((double)mConfig.mNumFootprintClasses+1);
-            }
+    template <enum EnvType ENV_TYPE>
+    ompl::base::Cost computeCostToGo(const ompl::base::State* s) const {
+        if(mpCostToGoField == NULL || mpCostToGoField->empty()) {
+            return identityCost();
         }
-        //return ompl::base::Cost(OMPL_MAX_COST - (driveability * (double)OMPL_MAX_COST + 0.5));        
-        return ompl::base::Cost(cost);
+        double x = 0, y = 0;
+        int footprint_class = 0;
+        getStateData<ENV_TYPE>(s, x, y, footprint_class);
+        double cost = mpCostToGoField->getCost((int)x, (int)y);
+        // Unreachable cells could still be connected by the continuous motions.
+        if(!std::isfinite(cost)) {
+            return identityCost();
+        }
+        return ompl::base::Cost(cost * COST_TO_GO_SCALE);
     }
     
-    ompl::base::Cost motionCost(const ompl::base::State *s1, const ompl::base::State *s2) const {
-        // Uses the base motionCost() to calculate the cost to traverse from s1 to s2 
-        // (mean costs of s1 and s2 and the distance (x,y,theta/2.0) between the states,
-        // uses the above stateCost() implementation).
-        ompl::base::Cost cost = ompl::base::StateCostIntegralObjective::motionCost(s1, s2);
+    template <enum EnvType ENV_TYPE>
+    ompl::base::Cost computeMotionCost(const ompl::base::State *s1, const ompl::base::State *s2) const {
+        double cost_v = 0.0;
+        if(mIntegrateCellCosts) {
+            cost_v = integrateCellCosts<ENV_TYPE>(s1, s2);
+        } else {
+            // Uses the base motionCost() to calculate the cost to traverse from s1 to s2 
+            // (mean costs of s1 and s2 and the distance (x,y,theta/2.0) between the states,
+            // uses the above stateCost() implementation).
+            ompl::base::Cost cost = ompl::base::StateCostIntegralObjective::motionCost(s1, s2);
 #if OMPL_VERSION_VALUE > 1000000
-        double cost_v = cost.value();
+            cost_v = cost.value();
 #else
-        double cost_v = cost.v;
+            cost_v = cost.v;
 #endif         
-        switch(mConfig.mEnvType) {
+        }
+        switch(ENV_TYPE) {
                 
             // Adds cost for changing the footprint.
             case ENV_SHERPA: {
@@ -192,11 +272,161 @@ class TravGridObjective :  public ompl::base::StateCostIntegralObjective {
             }
         }
         
-        cost = ompl::base::Cost(cost_v);
+        return ompl::base::Cost(cost_v);
+    }
+
+    /**
+     * Time to traverse the cell using forward speed and driveability (precalculated,
+     * std::numeric_limits<double>::max() for obstacles). Driveability of 1.0 means, 
+     * that the cell can be traversed with full speed.
+     */
+    template <enum EnvType ENV_TYPE>
+    inline double getCellCost(int x, int y, int footprint_class) const {
+        uint8_t class_value = (*mpTravData)[y][x];
+        double cost = mpTravClassTable->getOmplCost(class_value);
+        if(cost != std::numeric_limits<double>::max()) {
+            // Increases cost regarding the footprint. Max footprint means full speed,
+            // min footprint increases the cost by the number of footprint classes.
+            if(ENV_TYPE == ENV_SHERPA) {
+                cost /= (footprint_class+1) / ((double)mConfig.mNumFootprintClasses+1);
+            }
+        }
         return cost;
     }
+    
+    /**
+     * Integrates the cell costs along the straight connection of the positions:
+     * Each crossed cell contributes its cost weighted with the fraction of 
+     * the motion within the cell, the sum is scaled by the state space distance 
+     * like the base implementation. In contrast to the sampling of 
+     * StateCostIntegralObjective no cell is skipped or counted twice. 
+     * The footprint class (ENV_SHERPA) is interpolated within each cell.
+     * Returns infinity if an obstacle or a cell outside of the grid is crossed.
+     */
+    template <enum EnvType ENV_TYPE>
+    double integrateCellCosts(const ompl::base::State* s1, const ompl::base::State* s2) const {
+        if(mpTravGrid == NULL) {
+            throw std::runtime_error("TravGridObjective: No traversability grid available");
+        }
+        double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+        int fp_class1 = 0, fp_class2 = 0;
+        getStateData<ENV_TYPE>(s1, x1, y1, fp_class1);
+        getStateData<ENV_TYPE>(s2, x2, y2, fp_class2);
+        
+        int size_x = mpTravGrid->getCellSizeX();
+        int size_y = mpTravGrid->getCellSizeY();
+        double sum = 0.0;
+        GridTraversal traversal(x1, y1, x2, y2);
+        do {
+            int x = traversal.getX();
+            int y = traversal.getY();
+            if(x < 0 || x >= size_x || y < 0 || y >= size_y) {
+                return std::numeric_limits<double>::infinity();
+            }
+            double fraction = traversal.getExit() - traversal.getEnter();
+            // Rounded like the interpolation of the footprint class dimension.
+            double t = (traversal.getEnter() + traversal.getExit()) / 2.0;
+            int fp_class = (int)std::floor(fp_class1 + (fp_class2 - fp_class1) * t + 0.5);
+            double cost = getCellCost<ENV_TYPE>(x, y, fp_class);
+            if(cost == std::numeric_limits<double>::max()) {
+                return std::numeric_limits<double>::infinity();
+            }
+            sum += cost * fraction;
+        } while(traversal.next());
+        mNumEvaluations.fetch_add(traversal.getNumCells(), std::memory_order_relaxed);
+        
+        return sum * si_->distance(s1, s2);
+    }
+    
+
+    /**
+     * Grid position and footprint class (ENV_SHERPA, 0 otherwise) of the state.
+     */
+    template <enum EnvType ENV_TYPE>
+    void getStateData(const ompl::base::State* s, double& x, double& y, int& footprint_class) const {
+        switch(ENV_TYPE) {
+            case ENV_XY: {
+                const ompl::base::RealVectorStateSpace::StateType* state_rv = 
+                        s->as<ompl::base::RealVectorStateSpace::StateType>();
+                x = state_rv->values[0];
+                y = state_rv->values[1];
+                break;
+            }
+            case ENV_XYTHETA: {
+                const ompl::base::SE2StateSpace::StateType* state_se2 = 
+                        s->as<ompl::base::SE2StateSpace::StateType>();
+                x = state_se2->getX();
+                y = state_se2->getY();
+                break;
+            }
+            case ENV_SHERPA: {
+                const SherpaStateSpace::StateType* state_sherpa = 
+                        s->as<SherpaStateSpace::StateType>();
+                x = state_sherpa->getX();
+                y = state_sherpa->getY();
+                footprint_class = state_sherpa->getFootprintClass();
+                break;
+            }
+            default: {
+                throw std::runtime_error("TravGridObjective received an unknown environment");
+                break;
+            }
+        }
+    }
+};
+
+/**
+ * Objective of a single environment, all environment specific parts
+ * are resolved at compile time.
+ */
+template <enum EnvType ENV_TYPE>
+class EnvTravGridObjective : public TravGridObjective {
+ public:
+    EnvTravGridObjective(const ompl::base::SpaceInformationPtr& si, 
+            bool enable_motion_cost_interpolation,
+            envire::TraversabilityGrid* trav_grid,
+            boost::shared_ptr<TravData> trav_data,
+            Config config,
+            boost::shared_ptr<TravClassTable> trav_class_table) :
+            TravGridObjective(si, enable_motion_cost_interpolation, trav_grid, 
+                    trav_data, config, trav_class_table) {
+    }
+    
+    ompl::base::Cost stateCost(const ompl::base::State* s) const {
+        return computeStateCost<ENV_TYPE>(s);
+    }
+    
+    ompl::base::Cost costToGo(const ompl::base::State* s, const ompl::base::Goal* goal) const {
+        return computeCostToGo<ENV_TYPE>(s);
+    }
+    
+    ompl::base::Cost motionCost(const ompl::base::State *s1, const ompl::base::State *s2) const {
+        return computeMotionCost<ENV_TYPE>(s1, s2);
+    }
 };
 
+inline TravGridObjective* TravGridObjective::create(const ompl::base::SpaceInformationPtr& si, 
+        bool enable_motion_cost_interpolation,
+        envire::TraversabilityGrid* trav_grid,
+        boost::shared_ptr<TravData> trav_data,
+        Config config,
+        boost::shared_ptr<TravClassTable> trav_class_table) {
+    switch(config.mEnvType) {
+        case ENV_XY:
+            return new EnvTravGridObjective<ENV_XY>(si, enable_motion_cost_interpolation, 
+                    trav_grid, trav_data, config, trav_class_table);
+        case ENV_XYTHETA:
+            return new EnvTravGridObjective<ENV_XYTHETA>(si, enable_motion_cost_interpolation, 
+                    trav_grid, trav_data, config, trav_class_table);
+        case ENV_SHERPA:
+            return new EnvTravGridObjective<ENV_SHERPA>(si, enable_motion_cost_interpolation, 
+                    trav_grid, trav_data, config, trav_class_table);
+        default:
+            return new TravGridObjective(si, enable_motion_cost_interpolation, 
+                    trav_grid, trav_data, config, trav_class_table);
+    }
+}
+
 } // end namespace motion_planning_libraries
 
 #endif
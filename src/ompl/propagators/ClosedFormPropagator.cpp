@@ -0,0 +1,61 @@
+#include "ClosedFormPropagator.hpp"
+
+#include <cmath>
+
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/control/spaces/RealVectorControlSpace.h>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+// Below this rotational velocity (rad/sec) the motion is regarded as a straight segment.
+const double MIN_ROTATIONAL_VELOCITY = 1e-9;
+}
+
+ClosedFormPropagator::ClosedFormPropagator(const ompl::control::SpaceInformationPtr& si, 
+        enum PropagationModel model, double car_length) : 
+        ompl::control::StatePropagator(si),
+        mModel(model),
+        mCarLength(car_length) {
+}
+
+void ClosedFormPropagator::propagate(const ompl::base::State* state, 
+        const ompl::control::Control* control,
+        const double duration, ompl::base::State* result) const {
+    const double *u = control->as<ompl::control::RealVectorControlSpace::ControlType>()->values;
+    const ompl::base::SE2StateSpace::StateType* start = 
+            state->as<ompl::base::SE2StateSpace::StateType>();
+    
+    // Copied first, the result may be the start state.
+    double x = start->getX();
+    double y = start->getY();
+    double theta = start->getYaw();
+    double v = u[0];
+    double omega = (mModel == PROPAGATION_CAR) ? v * tan(u[1]) / mCarLength : u[1];
+    double theta_end = theta + omega * duration;
+    
+    if(std::fabs(omega) < MIN_ROTATIONAL_VELOCITY) {
+        x += v * cos(theta) * duration;
+        y += v * sin(theta) * duration;
+    } else {
+        // Arc with the radius v / omega.
+        double radius = v / omega;
+        x += radius * (sin(theta_end) - sin(theta));
+        y -= radius * (cos(theta_end) - cos(theta));
+    }
+    
+    ompl::base::SE2StateSpace::StateType* end = result->as<ompl::base::SE2StateSpace::StateType>();
+    end->setX(x);
+    end->setY(y);
+    // Same as SO2StateSpace::enforceBounds().
+    double yaw = fmod(theta_end, 2.0 * M_PI);
+    if(yaw < -M_PI) {
+        yaw += 2.0 * M_PI;
+    } else if(yaw >= M_PI) {
+        yaw -= 2.0 * M_PI;
+    }
+    end->setYaw(yaw);
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,44 @@
+#ifndef _CLOSED_FORM_PROPAGATOR_HPP_
+#define _CLOSED_FORM_PROPAGATOR_HPP_
+
+#include <ompl/control/SpaceInformation.h>
+#include <ompl/control/StatePropagator.h>
+
+namespace motion_planning_libraries
+{
+
+enum PropagationModel {
+    // Control: forward velocity and rotational velocity.
+    PROPAGATION_UNICYCLE,
+    // Control: forward velocity and steering angle, requires the car length.
+    PROPAGATION_CAR
+};
+
+/**
+ * Propagates SE2 states with constant controls using the exact solution
+ * of the unicycle or the kinematic car model: A constant control results 
+ * in a straight segment or a circular arc, so no numerical integration 
+ * is required and the results are deterministic. The resulting yaw lies within [-pi, pi).
+ */
+class ClosedFormPropagator : public ompl::control::StatePropagator {
+ private:
+    enum PropagationModel mModel;
+    double mCarLength;
+    
+ public:
+    ClosedFormPropagator(const ompl::control::SpaceInformationPtr& si, 
+            enum PropagationModel model, double car_length = 0.0);
+    
+    ~ClosedFormPropagator() {
+    }
+    
+    /**
+     * \a state and \a result may be the same state.
+     */
+    void propagate(const ompl::base::State* state, const ompl::control::Control* control,
+            const double duration, ompl::base::State* result) const;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif
@@ -0,0 +1,41 @@
+#include "PooledStateSpaces.hpp"
+
+namespace motion_planning_libraries {
+
+typedef PositionStateLayout<ompl::base::SE2StateSpace::StateType,
+        ompl::base::SO2StateSpace::StateType> SE2StateLayout;
+
+PooledRealVectorStateSpace::PooledRealVectorStateSpace(unsigned int dim) :
+        ompl::base::RealVectorStateSpace(dim),
+        mValuesOffset(StatePool::align(sizeof(StateType))),
+        mPool(mValuesOffset + dim * sizeof(double)) {
+    setName("Pooled" + getName());
+}
+
+ompl::base::State* PooledRealVectorStateSpace::allocState() const {
+    char* block = static_cast<char*>(mPool.allocate());
+    StateType* state = new (block) StateType();
+    state->values = reinterpret_cast<double*>(block + mValuesOffset);
+    return state;
+}
+
+void PooledRealVectorStateSpace::freeState(ompl::base::State* state) const {
+    StateType* rstate = static_cast<StateType*>(state);
+    rstate->~StateType();
+    mPool.deallocate(rstate);
+}
+
+PooledSE2StateSpace::PooledSE2StateSpace() : ompl::base::SE2StateSpace(),
+        mPool(SE2StateLayout::getBlockSize()) {
+    setName("Pooled" + getName());
+}
+
+ompl::base::State* PooledSE2StateSpace::allocState() const {
+    return SE2StateLayout::construct(mPool.allocate());
+}
+
+void PooledSE2StateSpace::freeState(ompl::base::State* state) const {
+    mPool.deallocate(SE2StateLayout::destruct(state));
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,110 @@
+#ifndef _POOLED_STATE_SPACES_HPP_
+#define _POOLED_STATE_SPACES_HPP_
+
+#include <new>
+
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/base/spaces/SO2StateSpace.h>
+
+#include <motion_planning_libraries/ompl/spaces/StatePool.hpp>
+
+namespace motion_planning_libraries {
+
+/**
+ * Layout of a compound state with a 2D position (first component) and one 
+ * additional component (e.g. yaw) within a single pool block:
+ * state, component list, position, position values and the second component.
+ */
+template <class CompoundStateType, class SecondStateType>
+class PositionStateLayout
+{
+ private:
+    typedef ompl::base::RealVectorStateSpace::StateType PositionStateType;
+
+    static inline size_t getComponentsOffset() {
+        return StatePool::align(sizeof(CompoundStateType));
+    }
+
+    static inline size_t getPositionOffset() {
+        return getComponentsOffset() + StatePool::align(2 * sizeof(ompl::base::State*));
+    }
+
+    static inline size_t getValuesOffset() {
+        return getPositionOffset() + StatePool::align(sizeof(PositionStateType));
+    }
+
+    static inline size_t getSecondOffset() {
+        return getValuesOffset() + StatePool::align(2 * sizeof(double));
+    }
+
+ public:
+    static inline size_t getBlockSize() {
+        return getSecondOffset() + sizeof(SecondStateType);
+    }
+
+    static CompoundStateType* construct(void* block) {
+        char* data = static_cast<char*>(block);
+        CompoundStateType* state = new (data) CompoundStateType();
+        PositionStateType* position = new (data + getPositionOffset()) PositionStateType();
+        position->values = reinterpret_cast<double*>(data + getValuesOffset());
+        state->components = reinterpret_cast<ompl::base::State**>(data + getComponentsOffset());
+        state->components[0] = position;
+        state->components[1] = new (data + getSecondOffset()) SecondStateType();
+        return state;
+    }
+
+    /**
+     * Destructs the parts, returns the block which has to be passed to the pool.
+     */
+    static void* destruct(ompl::base::State* state) {
+        CompoundStateType* compound = static_cast<CompoundStateType*>(state);
+        static_cast<SecondStateType*>(compound->components[1])->~SecondStateType();
+        static_cast<PositionStateType*>(compound->components[0])->~PositionStateType();
+        compound->~CompoundStateType();
+        return compound;
+    }
+};
+
+/**
+ * RealVectorStateSpace which places each state and its values within
+ * one block of a StatePool. The dimension has to be defined by the constructor.
+ */
+class PooledRealVectorStateSpace : public ompl::base::RealVectorStateSpace
+{
+ private:
+    size_t mValuesOffset;
+    mutable StatePool mPool;
+
+ public:
+    PooledRealVectorStateSpace(unsigned int dim);
+
+    virtual ~PooledRealVectorStateSpace() {
+    }
+
+    virtual ompl::base::State* allocState() const;
+    virtual void freeState(ompl::base::State* state) const;
+};
+
+/**
+ * SE2StateSpace which places each state, its component list and both
+ * components (position and yaw) within one block of a StatePool.
+ */
+class PooledSE2StateSpace : public ompl::base::SE2StateSpace
+{
+ private:
+    mutable StatePool mPool;
+
+ public:
+    PooledSE2StateSpace();
+
+    virtual ~PooledSE2StateSpace() {
+    }
+
+    virtual ompl::base::State* allocState() const;
+    virtual void freeState(ompl::base::State* state) const;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif
@@ -1,21 +1,217 @@
 #include "SherpaStateSpace.hpp"
 
-#include "ompl/base/spaces/SE2StateSpace.h"
+#include "ompl/base/StateSampler.h"
 #include "ompl/tools/config/MagicConstants.h"
+#include <cmath>
 #include <cstring>
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <stdexcept>
 
 namespace motion_planning_libraries {
 
+namespace {
+/**
+ * Samples the position like the RealVectorStateSampler and the
+ * footprint class like the DiscreteStateSampler.
+ */
+class SherpaStateSampler : public ompl::base::StateSampler
+{
+public:
+    SherpaStateSampler(const SherpaStateSpace *space) : ompl::base::StateSampler(space)
+    {
+    }
+
+    virtual void sampleUniform(ompl::base::State *state)
+    {
+        const SherpaStateSpace* space = space_->as<SherpaStateSpace>();
+        const ompl::base::RealVectorBounds& bounds = space->getBounds();
+        SherpaStateSpace::StateType* sherpa_state = state->as<SherpaStateSpace::StateType>();
+        for(int i=0; i < 2; ++i) {
+            sherpa_state->mValues[i] = rng_.uniformReal(bounds.low[i], bounds.high[i]);
+        }
+        sherpa_state->mFootprintClass = rng_.uniformInt(0, space->getMaxFootprintClass());
+    }
+
+    virtual void sampleUniformNear(ompl::base::State *state, const ompl::base::State *near,
+            const double distance)
+    {
+        SherpaStateSpace::StateType* sherpa_state = state->as<SherpaStateSpace::StateType>();
+        const SherpaStateSpace::StateType* near_state = near->as<SherpaStateSpace::StateType>();
+        for(int i=0; i < 2; ++i) {
+            sherpa_state->mValues[i] = rng_.uniformReal(near_state->mValues[i] - distance,
+                    near_state->mValues[i] + distance);
+        }
+        int d = (int)std::floor(distance + 0.5);
+        sherpa_state->mFootprintClass = rng_.uniformInt(near_state->mFootprintClass - d,
+                near_state->mFootprintClass + d);
+        space_->enforceBounds(state);
+    }
+
+    virtual void sampleGaussian(ompl::base::State *state, const ompl::base::State *mean,
+            const double stdDev)
+    {
+        SherpaStateSpace::StateType* sherpa_state = state->as<SherpaStateSpace::StateType>();
+        const SherpaStateSpace::StateType* mean_state = mean->as<SherpaStateSpace::StateType>();
+        for(int i=0; i < 2; ++i) {
+            sherpa_state->mValues[i] = rng_.gaussian(mean_state->mValues[i], stdDev);
+        }
+        sherpa_state->mFootprintClass = (int)std::floor(
+                rng_.gaussian(mean_state->mFootprintClass, stdDev) + 0.5);
+        space_->enforceBounds(state);
+    }
+};
+}
+
+SherpaStateSpace::SherpaStateSpace(Config config) : ompl::base::StateSpace(),
+        mConfig(config),
+        mBounds(2),
+        mMaxFootprintClass((int)config.mNumFootprintClasses - 1),
+        mPool(sizeof(StateType))
+{
+    setName("Sherpa" + getName());
+    type_ = ompl::base::STATE_SPACE_TYPE_COUNT + 1;
+}
+
+void SherpaStateSpace::setBounds(const ompl::base::RealVectorBounds &bounds)
+{
+    bounds.check();
+    if(bounds.low.size() != 2) {
+        throw std::runtime_error("SherpaStateSpace: Bounds do not match the dimension of the position");
+    }
+    mBounds = bounds;
+}
+
+unsigned int SherpaStateSpace::getDimension(void) const
+{
+    return 3;
+}
+
+double SherpaStateSpace::getMaximumExtent(void) const
+{
+    // The footprint class is not regarded by the distance.
+    double dx = mBounds.high[0] - mBounds.low[0];
+    double dy = mBounds.high[1] - mBounds.low[1];
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+double SherpaStateSpace::getMeasure(void) const
+{
+    return (mBounds.high[0] - mBounds.low[0]) * (mBounds.high[1] - mBounds.low[1]);
+}
+
+void SherpaStateSpace::enforceBounds(ompl::base::State *state) const
+{
+    StateType* sherpa_state = state->as<StateType>();
+    for(int i=0; i < 2; ++i) {
+        sherpa_state->mValues[i] = std::min(std::max(sherpa_state->mValues[i], mBounds.low[i]),
+                mBounds.high[i]);
+    }
+    sherpa_state->mFootprintClass = std::min(std::max(sherpa_state->mFootprintClass, 0),
+            mMaxFootprintClass);
+}
+
+bool SherpaStateSpace::satisfiesBounds(const ompl::base::State *state) const
+{
+    const StateType* sherpa_state = state->as<StateType>();
+    for(int i=0; i < 2; ++i) {
+        if(sherpa_state->mValues[i] - std::numeric_limits<double>::epsilon() > mBounds.high[i] ||
+                sherpa_state->mValues[i] + std::numeric_limits<double>::epsilon() < mBounds.low[i]) {
+            return false;
+        }
+    }
+    return sherpa_state->mFootprintClass >= 0 && sherpa_state->mFootprintClass <= mMaxFootprintClass;
+}
+
+void SherpaStateSpace::copyState(ompl::base::State *destination, const ompl::base::State *source) const
+{
+    StateType* dest_state = destination->as<StateType>();
+    const StateType* source_state = source->as<StateType>();
+    dest_state->mValues[0] = source_state->mValues[0];
+    dest_state->mValues[1] = source_state->mValues[1];
+    dest_state->mFootprintClass = source_state->mFootprintClass;
+}
+
+double SherpaStateSpace::distance(const ompl::base::State *state1, const ompl::base::State *state2) const
+{
+    const StateType* s1 = state1->as<StateType>();
+    const StateType* s2 = state2->as<StateType>();
+    double dx = s1->mValues[0] - s2->mValues[0];
+    double dy = s1->mValues[1] - s2->mValues[1];
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+bool SherpaStateSpace::equalStates(const ompl::base::State *state1, const ompl::base::State *state2) const
+{
+    const StateType* s1 = state1->as<StateType>();
+    const StateType* s2 = state2->as<StateType>();
+    return std::fabs(s1->mValues[0] - s2->mValues[0]) <= std::numeric_limits<double>::epsilon() * 2.0 &&
+            std::fabs(s1->mValues[1] - s2->mValues[1]) <= std::numeric_limits<double>::epsilon() * 2.0 &&
+            s1->mFootprintClass == s2->mFootprintClass;
+}
+
+void SherpaStateSpace::interpolate(const ompl::base::State *from, const ompl::base::State *to,
+        const double t, ompl::base::State *state) const
+{
+    const StateType* s_from = from->as<StateType>();
+    const StateType* s_to = to->as<StateType>();
+    StateType* s = state->as<StateType>();
+    s->mValues[0] = s_from->mValues[0] + (s_to->mValues[0] - s_from->mValues[0]) * t;
+    s->mValues[1] = s_from->mValues[1] + (s_to->mValues[1] - s_from->mValues[1]) * t;
+    s->mFootprintClass = (int)std::floor(s_from->mFootprintClass +
+            (s_to->mFootprintClass - s_from->mFootprintClass) * t + 0.5);
+}
+
+double* SherpaStateSpace::getValueAddressAtIndex(ompl::base::State *state, const unsigned int index) const
+{
+    // The footprint class is no real value.
+    return index < 2 ? state->as<StateType>()->mValues + index : NULL;
+}
+
+unsigned int SherpaStateSpace::getSerializationLength(void) const
+{
+    return 2 * sizeof(double) + sizeof(int);
+}
+
+void SherpaStateSpace::serialize(void *serialization, const ompl::base::State *state) const
+{
+    const StateType* sherpa_state = state->as<StateType>();
+    memcpy(serialization, sherpa_state->mValues, 2 * sizeof(double));
+    memcpy(static_cast<char*>(serialization) + 2 * sizeof(double),
+            &sherpa_state->mFootprintClass, sizeof(int));
+}
+
+void SherpaStateSpace::deserialize(ompl::base::State *state, const void *serialization) const
+{
+    StateType* sherpa_state = state->as<StateType>();
+    memcpy(sherpa_state->mValues, serialization, 2 * sizeof(double));
+    memcpy(&sherpa_state->mFootprintClass,
+            static_cast<const char*>(serialization) + 2 * sizeof(double), sizeof(int));
+}
+
+void SherpaStateSpace::printState(const ompl::base::State *state, std::ostream &out) const
+{
+    const StateType* sherpa_state = state->as<StateType>();
+    out << "SherpaState [" << sherpa_state->getX() << " " << sherpa_state->getY() <<
+            " " << sherpa_state->getFootprintClass() << "]" << std::endl;
+}
+
+ompl::base::StateSamplerPtr SherpaStateSpace::allocDefaultStateSampler(void) const
+{
+    return ompl::base::StateSamplerPtr(new SherpaStateSampler(this));
+}
+
 ompl::base::State* SherpaStateSpace::allocState(void) const
 {
-    StateType *state = new StateType();
-    allocStateComponents(state);
-    return state;
+    return new (mPool.allocate()) StateType();
 }
 
 void SherpaStateSpace::freeState(ompl::base::State *state) const
 {
-    ompl::base::CompoundStateSpace::freeState(state);
+    StateType* sherpa_state = state->as<StateType>();
+    sherpa_state->~StateType();
+    mPool.deallocate(sherpa_state);
 }
 
 void SherpaStateSpace::registerProjections(void)
@@ -36,15 +232,14 @@ void SherpaStateSpace::registerProjections(void)
         virtual void defaultCellSizes(void)
         {
             cellSizes_.resize(2);
-            bounds_ = space_->as<ompl::base::SE2StateSpace>()->getBounds();
+            bounds_ = space_->as<SherpaStateSpace>()->getBounds();
             cellSizes_[0] = (bounds_.high[0] - bounds_.low[0]) / ompl::magic::PROJECTION_DIMENSION_SPLITS;
             cellSizes_[1] = (bounds_.high[1] - bounds_.low[1]) / ompl::magic::PROJECTION_DIMENSION_SPLITS;
         }
 
         virtual void project(const ompl::base::State *state, ompl::base::EuclideanProjection &projection) const
         {
-            memcpy(&projection(0), state->as<ompl::base::SE2StateSpace::StateType>()->
-                    as<ompl::base::RealVectorStateSpace::StateType>(0)->values, 2 * sizeof(double));
+            memcpy(&projection(0), state->as<SherpaStateSpace::StateType>()->mValues, 2 * sizeof(double));
         }
     };
 
@@ -2,56 +2,72 @@
 #define _SHERPA_STATE_SPACE_HPP_
 
 #include <ompl/base/StateSpace.h>
-#include <ompl/base/spaces/RealVectorStateSpace.h>
-#include <ompl/base/spaces/SO2StateSpace.h>
-#include <ompl/base/spaces/DiscreteStateSpace.h>
+#include <ompl/base/spaces/RealVectorBounds.h>
 
 #include <motion_planning_libraries/Config.hpp>
+#include <motion_planning_libraries/ompl/spaces/StatePool.hpp>
 
 namespace motion_planning_libraries {
 
-class SherpaStateSpace : public ompl::base::CompoundStateSpace
+/**
+ * State space (x, y, footprint class) with a flat state: Position and class
+ * are stored within the state itself, so reading a state does not follow
+ * any component pointers. Behaves like the compound space of a 2D real vector
+ * space (weight 1.0) and a discrete space of the footprint classes (weight 0.0):
+ * The distance only regards the position, the footprint class is interpolated
+ * and rounded like within the DiscreteStateSpace.
+ */
+class SherpaStateSpace : public ompl::base::StateSpace
 {
-protected: 
+protected:
     Config mConfig;
-    
+    ompl::base::RealVectorBounds mBounds;
+    int mMaxFootprintClass;
+    // Each state is placed within one block.
+    mutable StatePool mPool;
+
 public:
 
-    /** \brief A state in SherpaStateSpace: (x, y, footprint_radius) */
-    class StateType : public ompl::base::CompoundStateSpace::StateType
+    /** \brief A state in SherpaStateSpace: (x, y, footprint_class) */
+    class StateType : public ompl::base::State
     {
     public:
-        StateType(void) : ompl::base::CompoundStateSpace::StateType()
+        double mValues[2];
+        int mFootprintClass;
+
+        StateType(void) : ompl::base::State(), mFootprintClass(0)
         {
+            mValues[0] = 0.0;
+            mValues[1] = 0.0;
         }
 
         /** \brief Get the X component of the state */
         double getX(void) const
         {
-            return as<ompl::base::RealVectorStateSpace::StateType>(0)->values[0];
+            return mValues[0];
         }
 
         /** \brief Get the Y component of the state */
         double getY(void) const
         {
-            return as<ompl::base::RealVectorStateSpace::StateType>(0)->values[1];
+            return mValues[1];
         }
-        
+
         unsigned int getFootprintClass(void) const
         {
-            return as<ompl::base::DiscreteStateSpace::StateType>(1)->value;
+            return mFootprintClass;
         }
 
         /** \brief Set the X component of the state */
         void setX(double x)
         {
-            as<ompl::base::RealVectorStateSpace::StateType>(0)->values[0] = x;
+            mValues[0] = x;
         }
 
         /** \brief Set the Y component of the state */
         void setY(double y)
         {
-            as<ompl::base::RealVectorStateSpace::StateType>(0)->values[1] = y;
+            mValues[1] = y;
         }
 
         /** \brief Set the X and Y components of the state */
@@ -63,43 +79,51 @@ public:
 
         void setFootprintClass(unsigned int footprint_class)
         {
-            as<ompl::base::DiscreteStateSpace::StateType>(1)->value = footprint_class;
+            mFootprintClass = footprint_class;
         }
     };
 
-    SherpaStateSpace(Config config = Config()) : ompl::base::CompoundStateSpace(),
-            mConfig(config)
-    {
-        setName("Sherpa" + getName());
-        type_ = ompl::base::STATE_SPACE_TYPE_COUNT + 1;
-        addSubspace(ompl::base::StateSpacePtr(new ompl::base::RealVectorStateSpace(2)), 1.0);
-        // Radius, which should not be regarded in the distance calculation (?).
-        addSubspace(ompl::base::StateSpacePtr(new ompl::base::DiscreteStateSpace(
-                0, config.mNumFootprintClasses-1)), 0.0);
-        lock();
-    }
+    SherpaStateSpace(Config config = Config());
 
     virtual ~SherpaStateSpace(void)
     {
     }
 
     /** \copydoc RealVectorStateSpace::setBounds() */
-    void setBounds(const ompl::base::RealVectorBounds &bounds)
-    {
-        as<ompl::base::RealVectorStateSpace>(0)->setBounds(bounds);
-    }
+    void setBounds(const ompl::base::RealVectorBounds &bounds);
 
     /** \copydoc RealVectorStateSpace::getBounds() */
     const ompl::base::RealVectorBounds& getBounds(void) const
     {
-        return as<ompl::base::RealVectorStateSpace>(0)->getBounds();
+        return mBounds;
     }
 
+    inline int getMaxFootprintClass() const {
+        return mMaxFootprintClass;
+    }
+
+    virtual unsigned int getDimension(void) const;
+    virtual double getMaximumExtent(void) const;
+    virtual double getMeasure(void) const;
+    virtual void enforceBounds(ompl::base::State *state) const;
+    virtual bool satisfiesBounds(const ompl::base::State *state) const;
+    virtual void copyState(ompl::base::State *destination, const ompl::base::State *source) const;
+    virtual double distance(const ompl::base::State *state1, const ompl::base::State *state2) const;
+    virtual bool equalStates(const ompl::base::State *state1, const ompl::base::State *state2) const;
+    virtual void interpolate(const ompl::base::State *from, const ompl::base::State *to,
+            const double t, ompl::base::State *state) const;
+    virtual double* getValueAddressAtIndex(ompl::base::State *state, const unsigned int index) const;
+
+    virtual unsigned int getSerializationLength(void) const;
+    virtual void serialize(void *serialization, const ompl::base::State *state) const;
+    virtual void deserialize(ompl::base::State *state, const void *serialization) const;
+    virtual void printState(const ompl::base::State *state, std::ostream &out) const;
+
+    virtual ompl::base::StateSamplerPtr allocDefaultStateSampler(void) const;
     virtual ompl::base::State* allocState(void) const;
     virtual void freeState(ompl::base::State *state) const;
 
     virtual void registerProjections(void);
-
 };
 
 } // end namespace motion_planning_libraries
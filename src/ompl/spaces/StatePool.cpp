@@ -0,0 +1,59 @@
+#include "StatePool.hpp"
+
+#include <algorithm>
+
+namespace motion_planning_libraries {
+
+StatePool::StatePool(size_t block_size, size_t blocks_per_chunk) :
+        mMutex(),
+        mBlockSize(align(std::max(block_size, sizeof(void*)))),
+        mBlocksPerChunk(std::max(blocks_per_chunk, (size_t)1)),
+        mChunks(),
+        mpFreeBlocks(NULL),
+        mNumUsedBlocks(0) {
+}
+
+StatePool::~StatePool() {
+    std::vector<char*>::iterator it = mChunks.begin();
+    for(; it != mChunks.end(); ++it) {
+        delete[] *it;
+    }
+}
+
+void* StatePool::allocate() {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if(mpFreeBlocks == NULL) {
+        // The default new alignment covers ALIGNMENT.
+        char* chunk = new char[mBlockSize * mBlocksPerChunk];
+        mChunks.push_back(chunk);
+        // Links the new blocks in order of their addresses.
+        for(size_t i = mBlocksPerChunk; i > 0; --i) {
+            char* block = chunk + (i - 1) * mBlockSize;
+            *reinterpret_cast<void**>(block) = mpFreeBlocks;
+            mpFreeBlocks = block;
+        }
+    }
+
+    void* block = mpFreeBlocks;
+    mpFreeBlocks = *reinterpret_cast<void**>(block);
+    mNumUsedBlocks++;
+    return block;
+}
+
+void StatePool::deallocate(void* block) {
+    if(block == NULL) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    *reinterpret_cast<void**>(block) = mpFreeBlocks;
+    mpFreeBlocks = block;
+    mNumUsedBlocks--;
+}
+
+size_t StatePool::getNumUsedBlocks() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumUsedBlocks;
+}
+
+} // end namespace motion_planning_libraries
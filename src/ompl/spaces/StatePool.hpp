@@ -0,0 +1,76 @@
+#ifndef _STATE_POOL_HPP_
+#define _STATE_POOL_HPP_
+
+#include <stddef.h>
+#include <vector>
+#include <mutex>
+
+namespace motion_planning_libraries {
+
+/**
+ * Memory pool of fixed size blocks which are allocated in chunks. Freed blocks
+ * are kept within a free list and reused by the next allocations, the chunks
+ * are only released together with the pool. Used by the state spaces to place
+ * a complete OMPL state (including its components and values) in a single block,
+ * so the planner trees do not allocate each state part separately. Because
+ * each initialize() creates a new state space, the memory of the previous
+ * trees is released in bulk.
+ *
+ * Allocation and deallocation are synchronized, the space information
+ * is shared by parallel planners.
+ */
+class StatePool {
+ public:
+    // Alignment of each block and of the parts within a block.
+    static const size_t ALIGNMENT = 16;
+
+    /**
+     * Rounds \a size up to a multiple of ALIGNMENT.
+     */
+    static inline size_t align(size_t size) {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    explicit StatePool(size_t block_size, size_t blocks_per_chunk = 1024);
+
+    /**
+     * Releases all chunks, blocks which are still in use become invalid.
+     */
+    ~StatePool();
+
+    /**
+     * Returns an uninitialized block of getBlockSize() bytes.
+     */
+    void* allocate();
+
+    /**
+     * Returns the block to the free list.
+     */
+    void deallocate(void* block);
+
+    inline size_t getBlockSize() const {
+        return mBlockSize;
+    }
+
+    /**
+     * Number of blocks which are currently in use.
+     */
+    size_t getNumUsedBlocks();
+
+ private:
+    // Not copyable.
+    StatePool(StatePool const&);
+    StatePool& operator=(StatePool const&);
+
+    std::mutex mMutex;
+    size_t mBlockSize;
+    size_t mBlocksPerChunk;
+    std::vector<char*> mChunks;
+    // Singly linked list stored within the first bytes of the free blocks.
+    void* mpFreeBlocks;
+    size_t mNumUsedBlocks;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif
@@ -0,0 +1,89 @@
+#include "ArmValidator.hpp"
+
+#include <cmath>
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+namespace {
+// The cache is cleared if it exceeds this number of voxels.
+const size_t MAX_CACHE_SIZE = 1 << 20;
+}
+
+ArmValidator::ArmValidator(const ompl::base::SpaceInformationPtr& si,
+        boost::shared_ptr<ArmCollisionChecker const> checker,
+        double cache_resolution) :
+        ompl::base::StateValidityChecker(si),
+        mpChecker(checker),
+        mCacheResolution(cache_resolution),
+        mCacheMutex(),
+        mCache(),
+        mCacheRevision(checker != NULL ? checker->getEnvironmentRevision() : 0),
+        mNumChecks(0),
+        mNumCollisionChecks(0) {
+}
+
+bool ArmValidator::isValid(const ompl::base::State* state) const {
+    mNumChecks++;
+    if(!si_->satisfiesBounds(state)) {
+        return false;
+    }
+    if(mpChecker == NULL) {
+        return true;
+    }
+
+    unsigned int dim = si_->getStateDimension();
+    const double* values = state->as<ompl::base::RealVectorStateSpace::StateType>()->values;
+    std::vector<double> joint_angles(values, values + dim);
+
+    if(mCacheResolution <= 0) {
+        mNumCollisionChecks++;
+        return mpChecker->isCollisionFree(joint_angles);
+    }
+
+    std::vector<int> voxel(dim);
+    for(unsigned int i = 0; i < dim; ++i) {
+        voxel[i] = (int)std::floor(values[i] / mCacheResolution);
+    }
+
+    uint64_t revision = mpChecker->getEnvironmentRevision();
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        if(revision != mCacheRevision) {
+            LOG_DEBUG("Arm environment has changed, %zu cached voxels are dropped", mCache.size());
+            mCache.clear();
+            mCacheRevision = revision;
+        }
+        Cache::const_iterator it = mCache.find(voxel);
+        if(it != mCache.end()) {
+            return it->second;
+        }
+    }
+
+    // The checker is evaluated without the lock, so parallel planners are not serialized.
+    mNumCollisionChecks++;
+    bool valid = mpChecker->isCollisionFree(joint_angles);
+
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+    if(revision == mCacheRevision) {
+        if(mCache.size() >= MAX_CACHE_SIZE) {
+            mCache.clear();
+        }
+        mCache[voxel] = valid;
+    }
+    return valid;
+}
+
+void ArmValidator::setChecker(boost::shared_ptr<ArmCollisionChecker const> checker) {
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+    mpChecker = checker;
+    mCache.clear();
+    mCacheRevision = checker != NULL ? checker->getEnvironmentRevision() : 0;
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,69 @@
+#ifndef _ARM_VALIDATOR_HPP_
+#define _ARM_VALIDATOR_HPP_
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <ompl/base/StateValidityChecker.h>
+
+#include <motion_planning_libraries/ArmCollisionChecker.hpp>
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Checks the joint angles (RealVectorStateSpace) using an ArmCollisionChecker.
+ * Without a checker all states within the joint borders are valid.
+ *
+ * If \a cache_resolution is greater than 0, the results are cached within
+ * joint-space voxels of this size (rad): All configurations of a voxel get
+ * the result of the first one checked, so the resolution has to be smaller
+ * than the safety margin of the checker. The cache is cleared if the 
+ * environment revision of the checker changes or the cache gets too large.
+ */
+class ArmValidator : public ompl::base::StateValidityChecker {
+ private:
+    typedef boost::unordered_map<std::vector<int>, bool> Cache;
+
+    boost::shared_ptr<ArmCollisionChecker const> mpChecker;
+    double mCacheResolution;
+    mutable std::mutex mCacheMutex; // Protects mCache and mCacheRevision.
+    mutable Cache mCache;
+    mutable uint64_t mCacheRevision;
+    // Number of isValid() calls and evaluations of the checker since the last resetNumChecks().
+    mutable std::atomic<uint64_t> mNumChecks;
+    mutable std::atomic<uint64_t> mNumCollisionChecks;
+
+ public:
+    ArmValidator(const ompl::base::SpaceInformationPtr& si,
+            boost::shared_ptr<ArmCollisionChecker const> checker,
+            double cache_resolution);
+
+    virtual bool isValid(const ompl::base::State* state) const;
+
+    /**
+     * Replaces the checker and clears the cache.
+     */
+    void setChecker(boost::shared_ptr<ArmCollisionChecker const> checker);
+
+    inline uint64_t getNumChecks() const {
+        return mNumChecks;
+    }
+
+    inline uint64_t getNumCollisionChecks() const {
+        return mNumCollisionChecks;
+    }
+
+    inline void resetNumChecks() {
+        mNumChecks = 0;
+        mNumCollisionChecks = 0;
+    }
+};
+
+} // end namespace motion_planning_libraries
+
+#endif
@@ -0,0 +1,112 @@
+#include "GridMotionValidator.hpp"
+
+#include <stdexcept>
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+
+#include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/ompl/spaces/SherpaStateSpace.hpp>
+
+namespace motion_planning_libraries
+{
+
+GridMotionValidator::GridMotionValidator(const ompl::base::SpaceInformationPtr& si, 
+        enum EnvType env_type) : 
+        ompl::base::MotionValidator(si),
+        mEnvType(env_type),
+        mNumValidMotions(0),
+        mNumInvalidMotions(0) {
+}
+
+bool GridMotionValidator::checkMotion(const ompl::base::State *s1, 
+        const ompl::base::State *s2) const {
+    double last_valid_t = 0.0;
+    bool valid = walkMotion(s1, s2, last_valid_t);
+    if(valid) {
+        mNumValidMotions++;
+    } else {
+        mNumInvalidMotions++;
+    }
+    return valid;
+}
+
+bool GridMotionValidator::checkMotion(const ompl::base::State *s1, 
+        const ompl::base::State *s2, 
+        std::pair<ompl::base::State*, double>& lastValid) const {
+    double last_valid_t = 0.0;
+    bool valid = walkMotion(s1, s2, last_valid_t);
+    if(valid) {
+        mNumValidMotions++;
+    } else {
+        lastValid.second = last_valid_t;
+        if(lastValid.first != NULL) {
+            si_->getStateSpace()->interpolate(s1, s2, last_valid_t, lastValid.first);
+        }
+        mNumInvalidMotions++;
+    }
+    return valid;
+}
+
+// PRIVATE
+void GridMotionValidator::getPosition(const ompl::base::State* state, double& x, double& y) const {
+    switch(mEnvType) {
+        case ENV_XY: {
+            const ompl::base::RealVectorStateSpace::StateType* state_rv = 
+                    state->as<ompl::base::RealVectorStateSpace::StateType>();
+            x = state_rv->values[0];
+            y = state_rv->values[1];
+            break;
+        }
+        case ENV_SHERPA: {
+            const SherpaStateSpace::StateType* state_sherpa = 
+                    state->as<SherpaStateSpace::StateType>();
+            x = state_sherpa->getX();
+            y = state_sherpa->getY();
+            break;
+        }
+        default: {
+            throw std::runtime_error("GridMotionValidator received an unknown environment");
+        }
+    }
+}
+
+bool GridMotionValidator::walkMotion(const ompl::base::State *s1, 
+        const ompl::base::State *s2, double& last_valid_t) const {
+    double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    getPosition(s1, x0, y0);
+    getPosition(s2, x1, y1);
+    
+    last_valid_t = 0.0;
+    ompl::base::State* state = NULL;
+    bool valid = true;
+    GridTraversal traversal(x0, y0, x1, y1);
+    do {
+        // The target is always checked, the cell of s1 is expected to be valid.
+        if(traversal.isLast()) {
+            valid = si_->isValid(s2);
+            if(valid) {
+                last_valid_t = 1.0;
+            }
+        } else if(traversal.getIndex() > 0) {
+            // Checks the middle of the part of the motion within the cell, 
+            // on the borders of the cells the position could be assigned to the neighbour.
+            double t = (traversal.getEnter() + traversal.getExit()) / 2.0;
+            if(state == NULL) {
+                state = si_->allocState();
+            }
+            si_->getStateSpace()->interpolate(s1, s2, t, state);
+            valid = si_->isValid(state);
+            if(valid) {
+                last_valid_t = t;
+            }
+        }
+    } while(valid && traversal.next());
+    
+    if(state != NULL) {
+        si_->freeState(state);
+    }
+    return valid;
+}
+
+} // end namespace motion_planning_libraries
@@ -0,0 +1,68 @@
+#ifndef _GRID_MOTION_VALIDATOR_HPP_
+#define _GRID_MOTION_VALIDATOR_HPP_
+
+#include <atomic>
+
+#include <ompl/base/MotionValidator.h>
+
+#include <motion_planning_libraries/Config.hpp>
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Checks a motion by walking along the grid cells which are crossed by the
+ * straight connection of the positions (GridTraversal) instead of sampling it with a
+ * fixed resolution. Each crossed cell is checked exactly once (in the middle 
+ * of its part of the motion) using the state validity checker of the space 
+ * information, so obstacles with the size of a single cell cannot be skipped.
+ * Supports ENV_XY and ENV_SHERPA, the states are expected in grid coordinates.
+ * The motion counts are kept in atomic counters because the validator 
+ * can be shared by parallel planners, use getNumValidMotions() and 
+ * getNumInvalidMotions() instead of the (not thread-safe) OMPL counters.
+ */
+class GridMotionValidator : public ompl::base::MotionValidator {
+ 
+ private:
+    enum EnvType mEnvType;
+    mutable std::atomic<unsigned int> mNumValidMotions;
+    mutable std::atomic<unsigned int> mNumInvalidMotions;
+    
+ public:
+    GridMotionValidator(const ompl::base::SpaceInformationPtr& si, 
+            enum EnvType env_type);
+    
+    ~GridMotionValidator() {
+    }
+    
+    bool checkMotion(const ompl::base::State *s1, const ompl::base::State *s2) const;
+
+    /**
+     * \a lastValid receives the last valid interpolated state (if not NULL) 
+     * and its fraction of the motion.
+     */
+    bool checkMotion(const ompl::base::State *s1, const ompl::base::State *s2, 
+            std::pair<ompl::base::State*, double>& lastValid) const;
+    
+    inline unsigned int getNumValidMotions() const {
+        return mNumValidMotions;
+    }
+    
+    inline unsigned int getNumInvalidMotions() const {
+        return mNumInvalidMotions;
+    }
+    
+ private:
+    void getPosition(const ompl::base::State* state, double& x, double& y) const;
+    
+    /**
+     * Returns false at the first invalid check, \a last_valid_t receives 
+     * the fraction of the last successful check (0 for \a s1).
+     */
+    bool walkMotion(const ompl::base::State *s1, const ompl::base::State *s2,
+            double& last_valid_t) const;
+};
+
+} // end namespace motion_planning_libraries
+
+#endif
@@ -1,11 +1,14 @@
 #include "TravMapValidator.hpp"
 
+#include <algorithm>
+
 #include <ompl/base/SpaceInformation.h>
 
 #include <base-logging/Logging.hpp>
 
 #include <motion_planning_libraries/ompl/spaces/SherpaStateSpace.hpp>
 #include <motion_planning_libraries/State.hpp>
+#include <motion_planning_libraries/TraceLog.hpp>
 
 namespace motion_planning_libraries
 {
@@ -14,40 +17,156 @@ TravMapValidator::TravMapValidator(const ompl::base::SpaceInformationPtr& si,
             Config config) : 
             ompl::base::StateValidityChecker(si),
             mpSpaceInformation(si),
+            mpTravGrid(NULL),
+            mpTravData(),
+            mpTravClassTable(),
             mConfig(config), 
-            mGridCalc() {
+            mGridCalc(),
+            mpOccupancyBitmap(),
+            mpObstacleDistanceMap(),
+            mFootprintRadiiGrid(),
+            mFootprintStencils(),
+            mFootprintClassLayer(),
+            mNumChecks(0) {
 }
 
 TravMapValidator::TravMapValidator(const ompl::base::SpaceInformationPtr& si,
             envire::TraversabilityGrid* trav_grid,
             boost::shared_ptr<TravData> grid_data,
-            Config config) : 
+            Config config,
+            boost::shared_ptr<TravClassTable> trav_class_table) : 
             ompl::base::StateValidityChecker(si),
             mpSpaceInformation(si),
-            mpTravGrid(trav_grid),
-            mpTravData(grid_data),
+            mpTravGrid(NULL),
+            mpTravData(),
+            mpTravClassTable(),
             mConfig(config), 
-            mGridCalc() {
-    mGridCalc.setTravGrid(trav_grid, grid_data);
+            mGridCalc(),
+            mpOccupancyBitmap(),
+            mpObstacleDistanceMap(),
+            mFootprintRadiiGrid(),
+            mFootprintStencils(),
+            mFootprintClassLayer(),
+            mNumChecks(0) {
+    setTravGrid(trav_grid, grid_data, trav_class_table);
 }
 
 TravMapValidator::~TravMapValidator() {
 }
 
 void TravMapValidator::setTravGrid(envire::TraversabilityGrid* trav_grid, 
-        boost::shared_ptr<TravData> trav_data) {
+        boost::shared_ptr<TravData> trav_data,
+        boost::shared_ptr<TravClassTable> trav_class_table) {
+    if(trav_class_table == NULL && trav_grid != NULL) {
+        trav_class_table = boost::shared_ptr<TravClassTable>(
+                new TravClassTable(trav_grid, mConfig));
+    }
     mpTravGrid = trav_grid;
     mpTravData = trav_data;
-    mGridCalc.setTravGrid(trav_grid, trav_data);
+    mpTravClassTable = trav_class_table;
+    mGridCalc.setTravGrid(trav_grid, trav_data, trav_class_table);
+    prepareFootprints();
+    
+    mpOccupancyBitmap.reset();
+    if(trav_grid != NULL && trav_data != NULL) {
+        mpOccupancyBitmap = boost::shared_ptr<OccupancyBitmap>(new OccupancyBitmap());
+        mpOccupancyBitmap->create(*trav_data, *trav_class_table);
+        mGridCalc.setOccupancyBitmap(mpOccupancyBitmap);
+    }
+    
+    mpObstacleDistanceMap.reset();
+    mFootprintClassLayer.clear();
+    if(mConfig.mUseObstacleDistanceMap && trav_grid != NULL && 
+            (mConfig.mEnvType == ENV_XYTHETA || mConfig.mEnvType == ENV_SHERPA)) {
+        mpObstacleDistanceMap = boost::shared_ptr<ObstacleDistanceMap>(new ObstacleDistanceMap());
+        mpObstacleDistanceMap->create(*trav_data, *trav_class_table, 
+                getMaxFootprintRadiusInGrid() + 1);
+        updateFootprintClassLayer(0, trav_grid->getCellSizeX(), 0, trav_grid->getCellSizeY());
+    }
 }
+
+void TravMapValidator::partialMapUpdate(envire::TraversabilityGrid* trav_grid, 
+        boost::shared_ptr<TravData> trav_data,
+        boost::shared_ptr<TravClassTable> trav_class_table,
+        std::vector<CellUpdate> const& cell_updates) {
+    if(mpOccupancyBitmap == NULL || trav_grid == NULL || trav_data == NULL || 
+            trav_class_table == NULL) {
+        setTravGrid(trav_grid, trav_data, trav_class_table);
+        return;
+    }
     
-bool TravMapValidator::isValid(const ompl::base::State* state) const
-{  
-    if(mpTravGrid == NULL) {
-        throw std::runtime_error("TravMapValidator: No traversability grid available");
+    mpTravGrid = trav_grid;
+    mpTravData = trav_data;
+    mpTravClassTable = trav_class_table;
+    mGridCalc.setTravGrid(trav_grid, trav_data, trav_class_table);
+    prepareFootprints();
+    
+    if(!mpOccupancyBitmap->update(*trav_data, *trav_class_table, cell_updates)) {
+        mpOccupancyBitmap->create(*trav_data, *trav_class_table);
+    }
+    mGridCalc.setOccupancyBitmap(mpOccupancyBitmap);
+    
+    if(mpObstacleDistanceMap == NULL) {
+        return;
     }
+    
+    int size_x = trav_grid->getCellSizeX();
+    int size_y = trav_grid->getCellSizeY();
+    if(!mpObstacleDistanceMap->update(*trav_data, *trav_class_table, cell_updates)) {
+        mpObstacleDistanceMap->create(*trav_data, *trav_class_table, 
+                getMaxFootprintRadiusInGrid() + 1);
+        updateFootprintClassLayer(0, size_x, 0, size_y);
+        return;
+    }
+    
+    // The distances can only change within the max distance around the changed cells.
+    int x_min = size_x, x_max = -1;
+    int y_min = size_y, y_max = -1;
+    std::vector<CellUpdate>::const_iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); ++it) {
+        x_min = std::min(x_min, (int)it->x);
+        x_max = std::max(x_max, (int)it->x);
+        y_min = std::min(y_min, (int)it->y);
+        y_max = std::max(y_max, (int)it->y);
+    }
+    if(x_max >= 0) {
+        int dist = mpObstacleDistanceMap->getMaxDist();
+        updateFootprintClassLayer(std::max(0, x_min - dist), std::min(size_x, x_max + 1 + dist),
+                std::max(0, y_min - dist), std::min(size_y, y_max + 1 + dist));
+    }
+}
+    
+namespace {
+/**
+ * Validator of a single environment, the environment part of 
+ * checkState() is resolved at compile time.
+ */
+template <enum EnvType ENV_TYPE>
+class EnvTravMapValidator : public TravMapValidator {
+ public:
+    EnvTravMapValidator(const ompl::base::SpaceInformationPtr& si,
+            envire::TraversabilityGrid* trav_grid,
+            boost::shared_ptr<TravData> grid_data,
+            Config config,
+            boost::shared_ptr<TravClassTable> trav_class_table) :
+            TravMapValidator(si, trav_grid, grid_data, config, trav_class_table) {
+    }
+    
+    bool isValid(const ompl::base::State* state) const {
+        if(mpTravGrid == NULL) {
+            throw std::runtime_error("TravMapValidator: No traversability grid available");
+        }
+        mNumChecks.fetch_add(1, std::memory_order_relaxed);
+        return checkState<ENV_TYPE>(state);
+    }
+};
+}
 
-    switch(mConfig.mEnvType) {
+template <enum EnvType ENV_TYPE>
+bool TravMapValidator::checkState(const ompl::base::State* state) const
+{  
+    // Evaluated at compile time.
+    switch(ENV_TYPE) {
         case ENV_XY: {
             int x_grid = 0;
             int y_grid = 0;
@@ -60,16 +179,19 @@ bool TravMapValidator::isValid(const ompl::base::State* state) const
             // Check borders.
             if(     x_grid < 0 || x_grid >= (int)mpTravGrid->getCellSizeX() ||
                     y_grid < 0 || y_grid >= (int)mpTravGrid->getCellSizeY()) {
-                LOG_DEBUG("State (%d,%d) is invalid (not within the grid)", x_grid, y_grid);
+                MPL_TRACE_DEBUG("State (%d,%d) is invalid (not within the grid)", x_grid, y_grid);
                 return false;
             }   
+            
+            if(mpOccupancyBitmap != NULL) {
+                return !mpOccupancyBitmap->isObstacle(x_grid, y_grid);
+            }
 
             // Check obstacle.
-            double class_value = (double)(*mpTravData)[y_grid][x_grid];
-            double driveability = (mpTravGrid->getTraversabilityClass(class_value)).getDrivability();
+            uint8_t class_value = (*mpTravData)[y_grid][x_grid];
                 
-            if(driveability == 0.0) {
-                LOG_DEBUG("State (%d,%d) is invalid (lies on an obstacle)", x_grid, y_grid);
+            if(mpTravClassTable->isObstacle(class_value)) {
+                MPL_TRACE_DEBUG("State (%d,%d) is invalid (lies on an obstacle)", x_grid, y_grid);
                 return false;
             }
 
@@ -84,37 +206,44 @@ bool TravMapValidator::isValid(const ompl::base::State* state) const
             double y_grid = state_se2->as<ompl::base::RealVectorStateSpace::StateType>(0)->values[1];
             double yaw_grid = state_se2->as<ompl::base::SO2StateSpace::StateType>(1)->value;
             
-            double max_fp = std::max(mConfig.mFootprintRadiusMinMax.first, mConfig.mFootprintRadiusMinMax.second);
-            // We use the smaller scale value to check a larger area (actually they should be the same).
-            double min_scale = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());              
+            int radius_grid = mFootprintRadiiGrid[0];
+            
+            if(mpObstacleDistanceMap != NULL && 
+                    radius_grid < (int)mpObstacleDistanceMap->getMaxDist()) {
+                return mpObstacleDistanceMap->isFree((int)x_grid, (int)y_grid, radius_grid);
+            }
             
-            mGridCalc.setFootprintCircleInGrid(0);
-            mGridCalc.setFootprintCircleInGrid((int)std::ceil(max_fp / min_scale));
-            mGridCalc.setFootprintPoseInGrid(x_grid, y_grid, yaw_grid);
-                   
-            return mGridCalc.isValid();
+            // The stencils of the footprint have been prepared in prepareFootprints().
+            return mGridCalc.isValid(*mFootprintStencils[0], 
+                    (int)x_grid, (int)y_grid, mGridCalc.getThetaIndex(yaw_grid));
         }
         case ENV_SHERPA: {
             const SherpaStateSpace::StateType* state_sherpa = state->as<SherpaStateSpace::StateType>();
                 
-            // Get current state XYTHETA.    
-            double x_grid = state_sherpa->as<ompl::base::RealVectorStateSpace::StateType>(0)->values[0];
-            double y_grid = state_sherpa->as<ompl::base::RealVectorStateSpace::StateType>(0)->values[1];
-            double yaw_grid = state_sherpa->as<ompl::base::SO2StateSpace::StateType>(1)->value;
+            double x_grid = state_sherpa->getX();
+            double y_grid = state_sherpa->getY();
             int fp_class = state_sherpa->getFootprintClass();            
             
-            // Use method in State to calculate the radius.
-            State state;
-            state.setFootprintRadius(mConfig.mFootprintRadiusMinMax.first,
-                mConfig.mFootprintRadiusMinMax.second,
-                mConfig.mNumFootprintClasses,
-                fp_class);
-            // Used to calculate the number of grids.
-            double min_scale = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+            if(fp_class < 0 || fp_class >= (int)mFootprintRadiiGrid.size()) {
+                throw std::runtime_error("TravMapValidator received an unknown footprint class");
+            }
+            
+            // Same result as the distance map check below.
+            if(!mFootprintClassLayer.empty()) {
+                return getMaxFootprintClass((int)x_grid, (int)y_grid) >= fp_class;
+            }
+            
+            int radius_grid = mFootprintRadiiGrid[fp_class];
+            
+            // Checks the complete circle instead of its outline.
+            if(mpObstacleDistanceMap != NULL && 
+                    radius_grid < (int)mpObstacleDistanceMap->getMaxDist()) {
+                return mpObstacleDistanceMap->isFree((int)x_grid, (int)y_grid, radius_grid);
+            }
             
-            mGridCalc.setFootprintCircleInGrid(std::ceil(state.getFootprintRadius()/min_scale), false);
-            mGridCalc.setFootprintPoseInGrid(x_grid, y_grid, yaw_grid);
-            return mGridCalc.isValid();
+            // The state has no orientation, the circular footprint does not depend on it.
+            return mGridCalc.isValid(*mFootprintStencils[fp_class], 
+                    (int)x_grid, (int)y_grid, mGridCalc.getThetaIndex(0.0));
         }
         default: {
             throw std::runtime_error("TravMapValidator received an unknown environment");
@@ -123,5 +252,121 @@ bool TravMapValidator::isValid(const ompl::base::State* state) const
    
 }
 
+TravMapValidator* TravMapValidator::create(const ompl::base::SpaceInformationPtr& si,
+        envire::TraversabilityGrid* trav_grid,
+        boost::shared_ptr<TravData> grid_data,
+        Config config,
+        boost::shared_ptr<TravClassTable> trav_class_table) {
+    switch(config.mEnvType) {
+        case ENV_XY: 
+            return new EnvTravMapValidator<ENV_XY>(si, trav_grid, grid_data, config, trav_class_table);
+        case ENV_XYTHETA:
+            return new EnvTravMapValidator<ENV_XYTHETA>(si, trav_grid, grid_data, config, trav_class_table);
+        case ENV_SHERPA:
+            return new EnvTravMapValidator<ENV_SHERPA>(si, trav_grid, grid_data, config, trav_class_table);
+        default:
+            return new TravMapValidator(si, trav_grid, grid_data, config, trav_class_table);
+    }
+}
+    
+bool TravMapValidator::isValid(const ompl::base::State* state) const
+{  
+    if(mpTravGrid == NULL) {
+        throw std::runtime_error("TravMapValidator: No traversability grid available");
+    }
+    mNumChecks.fetch_add(1, std::memory_order_relaxed);
+
+    switch(mConfig.mEnvType) {
+        case ENV_XY: 
+            return checkState<ENV_XY>(state);
+        case ENV_XYTHETA: 
+            return checkState<ENV_XYTHETA>(state);
+        case ENV_SHERPA: 
+            return checkState<ENV_SHERPA>(state);
+        default: {
+            throw std::runtime_error("TravMapValidator received an unknown environment");
+        }
+    }
+}
+
+// PRIVATE
+void TravMapValidator::prepareFootprints() {
+    mFootprintRadiiGrid.clear();
+    mFootprintStencils.clear();
+    
+    if(mpTravGrid == NULL) {
+        return;
+    }
+    
+    // We use the smaller scale value to check a larger area (actually they should be the same).
+    double min_scale = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+    
+    switch(mConfig.mEnvType) {
+        case ENV_XYTHETA: {
+            double max_fp = std::max(mConfig.mFootprintRadiusMinMax.first, mConfig.mFootprintRadiusMinMax.second);
+            int radius_grid = (int)std::ceil(max_fp / min_scale);
+            mGridCalc.setFootprintCircleInGrid(radius_grid);
+            mFootprintRadiiGrid.push_back(radius_grid);
+            mFootprintStencils.push_back(mGridCalc.getFootprintStencils());
+            break;
+        }
+        case ENV_SHERPA: {
+            // Use method in State to calculate the radius of each class.
+            State state;
+            for(unsigned int fp_class = 0; fp_class < mConfig.mNumFootprintClasses; ++fp_class) {
+                state.setFootprintRadius(mConfig.mFootprintRadiusMinMax.first,
+                    mConfig.mFootprintRadiusMinMax.second,
+                    mConfig.mNumFootprintClasses,
+                    fp_class);
+                int radius_grid = (int)std::ceil(state.getFootprintRadius() / min_scale);
+                mGridCalc.setFootprintCircleInGrid(radius_grid, false);
+                mFootprintRadiiGrid.push_back(radius_grid);
+                mFootprintStencils.push_back(mGridCalc.getFootprintStencils());
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+unsigned int TravMapValidator::getMaxFootprintRadiusInGrid() const {
+    if(mpTravGrid == NULL) {
+        return 0;
+    }
+    double max_fp = std::max(mConfig.mFootprintRadiusMinMax.first, mConfig.mFootprintRadiusMinMax.second);
+    double min_scale = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+    return (unsigned int)std::ceil(max_fp / min_scale);
+}
+
+void TravMapValidator::updateFootprintClassLayer(int x_begin, int x_end, int y_begin, int y_end) {
+    // The number of classes has to fit into a byte.
+    if(mConfig.mEnvType != ENV_SHERPA || mpObstacleDistanceMap == NULL || 
+            mFootprintRadiiGrid.empty() || mFootprintRadiiGrid.size() > 255) {
+        return;
+    }
+    int size_x = mpTravGrid->getCellSizeX();
+    if(mFootprintClassLayer.size() != (size_t)size_x * mpTravGrid->getCellSizeY()) {
+        mFootprintClassLayer.assign((size_t)size_x * mpTravGrid->getCellSizeY(), 0);
+    }
+    
+    // The distance map covers the max radius, so each class is checked like isFree().
+    std::vector<uint32_t> squared_radii;
+    std::vector<int>::const_iterator it = mFootprintRadiiGrid.begin();
+    for(; it != mFootprintRadiiGrid.end(); ++it) {
+        squared_radii.push_back((uint32_t)(*it) * (*it));
+    }
+    
+    for(int y = y_begin; y < y_end; ++y) {
+        uint8_t* layer_p = &mFootprintClassLayer[y * size_x];
+        for(int x = x_begin; x < x_end; ++x) {
+            // Number of classes whose squared radius is smaller than the distance.
+            layer_p[x] = std::lower_bound(squared_radii.begin(), squared_radii.end(), 
+                    mpObstacleDistanceMap->getSquaredDist(x, y)) - squared_radii.begin();
+        }
+    }
+}
+
 } // end namespace motion_planning_libraries
 
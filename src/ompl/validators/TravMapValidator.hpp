@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <atomic>
 
 #include <base/samples/RigidBodyState.hpp>
 #include <base/Waypoint.hpp>
@@ -15,6 +16,9 @@
 
 #include <motion_planning_libraries/Config.hpp>
 #include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/TravClassTable.hpp>
+#include <motion_planning_libraries/ObstacleDistanceMap.hpp>
+#include <motion_planning_libraries/OccupancyBitmap.hpp>
 
 namespace envire {
 class TraversabilityGrid;
@@ -27,12 +31,28 @@ typedef envire::TraversabilityGrid::ArrayType TravData;
 
 class TravMapValidator:  public ompl::base::StateValidityChecker {
  
- private:
+ protected:
     ompl::base::SpaceInformationPtr mpSpaceInformation;
     envire::TraversabilityGrid* mpTravGrid; // To request the driveability values.
     boost::shared_ptr<TravData> mpTravData;
+    boost::shared_ptr<TravClassTable> mpTravClassTable;
     Config mConfig;
-    mutable GridCalculations mGridCalc;
+    GridCalculations mGridCalc;
+    // Obstacle bit of each cell, maintained like the obstacle distance map and
+    // used by the cell (ENV_XY) and the footprint checks.
+    boost::shared_ptr<OccupancyBitmap> mpOccupancyBitmap;
+    // Used for the circular footprints if Config::mUseObstacleDistanceMap is set.
+    boost::shared_ptr<ObstacleDistanceMap> mpObstacleDistanceMap;
+    // Footprint radii in grid cells and their stencils, prepared for each
+    // footprint class (XYTHETA only uses one) to keep isValid() re-entrant.
+    std::vector<int> mFootprintRadiiGrid;
+    std::vector< boost::shared_ptr<FootprintStencils const> > mFootprintStencils;
+    // ENV_SHERPA with the obstacle distance map: Number of the footprint classes 
+    // which are free on each cell (row-major). The radii increase with the class,
+    // so class k is valid if the value is greater than k.
+    std::vector<uint8_t> mFootprintClassLayer;
+    // Number of isValid() calls since the last resetNumChecks().
+    mutable std::atomic<uint64_t> mNumChecks;
     
  public:
     TravMapValidator(const ompl::base::SpaceInformationPtr& si,
@@ -41,13 +61,94 @@ class TravMapValidator:  public ompl::base::StateValidityChecker {
     TravMapValidator(const ompl::base::SpaceInformationPtr& si,
             envire::TraversabilityGrid* trav_grid,
             boost::shared_ptr<TravData> grid_data,
-            Config config);
+            Config config,
+            boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>());
+    
+    virtual ~TravMapValidator();
+    
+    /**
+     * Creates a validator which is specialized to Config::mEnvType at compile
+     * time, so isValid() does not evaluate the environment for each state.
+     */
+    static TravMapValidator* create(const ompl::base::SpaceInformationPtr& si,
+            envire::TraversabilityGrid* trav_grid,
+            boost::shared_ptr<TravData> grid_data,
+            Config config,
+            boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>());
+    
+    /**
+     * If no class to cost lookup table is passed a new one is created 
+     * using the classes of \a trav_grid.
+     */
+    void setTravGrid(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data,
+            boost::shared_ptr<TravClassTable> trav_class_table = boost::shared_ptr<TravClassTable>());
+    
+    /**
+     * Sets the new map like setTravGrid(), but only updates the changed cells
+     * of the occupancy bitmap and recalculates the obstacle distance map 
+     * around them.
+     */
+    void partialMapUpdate(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data,
+            boost::shared_ptr<TravClassTable> trav_class_table,
+            std::vector<CellUpdate> const& cell_updates);
     
-    ~TravMapValidator();
+    /**
+     * Does not modify the validator, so it can be used by several planners
+     * (threads) at the same time.
+     */
+    virtual bool isValid(const ompl::base::State* state) const;
+    
+    /**
+     * Returns the largest footprint class which is free on the cell or -1 if
+     * none is (or the cell lies outside of the map). Only available for 
+     * ENV_SHERPA with Config::mUseObstacleDistanceMap, see hasFootprintClassLayer().
+     */
+    inline int getMaxFootprintClass(int x, int y) const {
+        if(x < 0 || x >= (int)mpTravGrid->getCellSizeX() || 
+                y < 0 || y >= (int)mpTravGrid->getCellSizeY()) {
+            return -1;
+        }
+        return (int)mFootprintClassLayer[y * mpTravGrid->getCellSizeX() + x] - 1;
+    }
+    
+    inline bool hasFootprintClassLayer() const {
+        return !mFootprintClassLayer.empty();
+    }
+    
+    inline uint64_t getNumChecks() const {
+        return mNumChecks;
+    }
+    
+    inline void resetNumChecks() {
+        mNumChecks = 0;
+    }
+    
+ protected:
+    /**
+     * Checks the state within the environment \a ENV_TYPE, does not 
+     * count the check.
+     */
+    template <enum EnvType ENV_TYPE>
+    bool checkState(const ompl::base::State* state) const;
+    
+ private:
+    /**
+     * Calculates the footprint radii of all footprint classes and 
+     * prepares their stencils using the current map.
+     */
+    void prepareFootprints();
     
-    void setTravGrid(envire::TraversabilityGrid* trav_grid, boost::shared_ptr<TravData> trav_data);
+    /**
+     * Returns the max footprint radius in grid cells which has to be covered
+     * by the obstacle distance map.
+     */
+    unsigned int getMaxFootprintRadiusInGrid() const;
     
-    bool isValid(const ompl::base::State* state) const;
+    /**
+     * Recalculates the footprint class layer within [x_begin, x_end) x [y_begin, y_end)
+     * using the obstacle distance map.
+     */
+    void updateFootprintClassLayer(int x_begin, int x_end, int y_begin, int y_end);
 };
 
 } // end namespace motion_planning_libraries
@@ -1,42 +1,31 @@
 #ifndef _TURNING_VALIDATOR_HPP_
 #define _TURNING_VALIDATOR_HPP_
 
-#include <vector>
-#include <map>
-
 #include <ompl/base/DiscreteMotionValidator.h>
 
 #include <motion_planning_libraries/Config.hpp>
-
-namespace envire {
-class TraversabilityGrid;
-}
+#include <motion_planning_libraries/TurningReachability.hpp>
 
 namespace motion_planning_libraries
 {
 
 /**
- * Checks if the path between the states does not run through an obstacle
- * and if the required turning angle does not exceed the maximum of the system. 
+ * Checks if the motion between two SE2 states can be driven with the minimal
+ * turning radius (TurningReachability) and if the interpolated states do not
+ * lie on an obstacle (DiscreteMotionValidator). The turning radius has to be
+ * given in the units of the states (grid cells). 
  */
 class TurningValidator :  public ompl::base::DiscreteMotionValidator {
  
  private:
-    ompl::base::SpaceInformationPtr mpSpaceInformation;
-    double mMaxSpeed;
-    double mMaxSteeringAngleRad;
-    enum EnvType mEnvType;
+    TurningReachability mReachability;
     
     bool isValidTurn(const ompl::base::State *s1, const ompl::base::State *s2) const;
     
  public:
     TurningValidator(const ompl::base::SpaceInformationPtr& si, 
-            double max_speed, double max_steering_angle_rad, enum EnvType env_type) : 
-            ompl::base::DiscreteMotionValidator(si),
-            mMaxSpeed(max_speed), 
-            mMaxSteeringAngleRad(max_steering_angle_rad),
-            mEnvType(env_type){
-    }
+            double min_turning_radius, bool allow_backward = false, 
+            double max_length_factor = 1.5);
     
     ~TurningValidator() {
     }
@@ -46,20 +35,8 @@ class TurningValidator :  public ompl::base::DiscreteMotionValidator {
     bool checkMotion (const ompl::base::State *s1, const ompl::base::State *s2, 
             std::pair< ompl::base::State *, double > &lastValid) const;
     
-    inline void setMaxSpeed(double max_speed) {
-        mMaxSpeed = max_speed;
-    }
-    
-    inline double getMaxSpeed() const {
-        return mMaxSpeed;
-    }
-    
-    inline void setMaxSteeringAngle(double max_steering_speed) {
-        mMaxSteeringAngleRad = max_steering_speed;
-    }
-    
-    inline double getMaxSteeringAngle() const {
-        return mMaxSteeringAngleRad;
+    inline double getMinTurningRadius() const {
+        return mReachability.getMinTurningRadius();
     }
 };
 
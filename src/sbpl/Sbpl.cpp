@@ -1,14 +1,45 @@
 #include "Sbpl.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <exception>
 
+#include <base/Time.hpp>
+
 #include <envire/operators/SimpleTraversability.hpp>
 
 #include <sbpl/sbpl_exception.h>
+#include <sbpl/planners/adplanner.h>
+
+#include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/TraceLog.hpp>
 
 namespace motion_planning_libraries
 {
 
+/**
+ * Passes the affected states to SBPLPlanner::costs_changed().
+ */
+class ChangedStatesQuery : public StateChangeQuery
+{
+ public:
+    ChangedStatesQuery(std::vector<int> const* state_ids, bool forward_search) : 
+            mpStateIDs(state_ids), mForwardSearch(forward_search) {
+    }
+    
+    std::vector<int> const* getPredecessors() const {
+        return mForwardSearch ? mpStateIDs : NULL;
+    }
+    
+    std::vector<int> const* getSuccessors() const {
+        return mForwardSearch ? NULL : mpStateIDs;
+    }
+    
+ private:
+    std::vector<int> const* mpStateIDs;
+    bool mForwardSearch;
+};
+
 // PUBLIC
 Sbpl::Sbpl(Config config) : AbstractMotionPlanningLibrary(config),
         mpSBPLEnv(),
@@ -19,33 +50,63 @@ Sbpl::Sbpl(Config config) : AbstractMotionPlanningLibrary(config),
         mLastSolutionCost(0),
         mStartGrid(),
         mGoalGrid(),
-        mEpsilon(0.0) {
+        mEpsilon(0.0),
+        mpCostToGoField(),
+        mSBPLEnvKey(),
+        mDeferredCellUpdates(),
+        mRelevantCells(),
+        mRelevantCellsX(0),
+        mRelevantCellsY(0),
+        mRelevantCellsWidth(0),
+        mRelevantCellsHeight(0),
+        mRelevantCellsPath(),
+        mPathCellsBuffer(),
+        mSelectedCellUpdates() {
             
     LOG_DEBUG("SBPL constructor");
 }
 
 bool Sbpl::solve(double time) {
     
-    LOG_DEBUG("SBPL solve()");
+    MPL_TRACE_DEBUG("SBPL solve()");
     
-    mSBPLWaypointIDs.clear();
+    // A new start or goal outside of the relevant cells can lead to a path
+    // through the deferred cells.
+    if(!mDeferredCellUpdates.empty() && (!isRelevantCell(mStartGrid[0], mStartGrid[1]) ||
+            !isRelevantCell(mGoalGrid[0], mGoalGrid[1]))) {
+        applyDeferredCellUpdates();
+    }
     
-    bool ret = false;
-    try {
-        // Current conclusion: Better not touch each planners epsilon.
-        ret = mpSBPLPlanner->replan(time, &mSBPLWaypointIDs, &mLastSolutionCost);
-        mPathCost = mLastSolutionCost;
-        mEpsilon = mpSBPLPlanner->get_solution_eps();
-    } catch (...) {
-        LOG_ERROR("Replanning failed");
+    base::Time start_t = base::Time::now();
+    if(!replan(time)) {
         return false;
     }
     
-    if(ret) {
-        LOG_INFO("Found solution contains %d waypoints", mSBPLWaypointIDs.size());
-        return true;
-    } else {
-        return false;
+    // Deferred cells which are close to the new path are applied and the path 
+    // is replanned once, afterwards no deferred cell can be close anymore.
+    updateRelevantCells();
+    bool affected = false;
+    std::vector<CellUpdate>::iterator it = mDeferredCellUpdates.begin();
+    for(; it != mDeferredCellUpdates.end() && !affected; it++) {
+        affected = isRelevantCell(it->x, it->y);
+    }
+    if(affected) {
+        applyDeferredCellUpdates();
+        // Both searches share the planning time.
+        double remaining_time = std::max(time - (base::Time::now() - start_t).toSeconds(), 0.0);
+        LOG_INFO("Deferred cell updates are close to the new path, replan within %4.2f sec", 
+                remaining_time);
+        if(!replan(remaining_time)) {
+            return false;
+        }
+        updateRelevantCells();
+    }
+    return true;
+}
+
+void Sbpl::fillStatistics(struct PlanningStatistics& statistics) {
+    if(mpSBPLPlanner != NULL) {
+        statistics.mNumExpansions = mpSBPLPlanner->get_n_expands();
     }
 }
 
@@ -71,40 +132,21 @@ void Sbpl::createSBPLMap(envire::TraversabilityGrid* trav_grid,
         mSBPLNumElementsMap = trav_data->num_elements();
     }
       
-    // Adds the costs to the sbpl map using the driveability value of the traversability classes.
-    double driveability = 0.0;
-    unsigned char sbpl_cost = 0;
+    // The table should have been set by MotionPlanningLibraries::setTravGrid().
+    if(mpTravClassTable == NULL) {
+        mpTravClassTable = boost::shared_ptr<TravClassTable>(new TravClassTable(trav_grid, mConfig));
+    }
+    
+    // Adds the costs to the sbpl map using the precalculated costs of the traversability classes.
+    // The default driveability of unknown areas (mean value of all grids, see 
+    // slam/envire/src/operators/SimpleTraversability) is used.
+    TravClassTable const& table = *mpTravClassTable;
     unsigned char* sbpl_map_p = mpSBPLMapData;
     uint8_t* stop_p = trav_data->origin() + trav_data->num_elements();
-
-    // The calculated costs of unknown areas (mean value of all grids, see 
-    // slam/envire/src/operators/SimpleTraversability)
-    // is set to a close-to-obstacle-cost to prevent using unknown areas.
-    // TODO Actually it should work without this.
-    /*
-    std::vector <envire::TraversabilityClass> trav_classes = trav_grid->getTraversabilityClasses();
-    double bad_driveability = std::numeric_limits< double >::max();
-    for(unsigned int i=0; i<trav_classes.size(); i++) {
-        double cur_driv = (trav_grid->getTraversabilityClass(i)).getDrivability();
-        if(cur_driv != 0 && cur_driv < bad_driveability) {
-            bad_driveability = cur_driv;
-        }
-    }
-    LOG_WARN("Driveability of unknown areas is increased to %4.2f in SBPL", bad_driveability);
-    */
-    // Currently the default driveability of unkonwn areas (mean) is used.
-    double bad_driveability = (trav_grid->getTraversabilityClass(envire::SimpleTraversability::CLASS_UNKNOWN)).getDrivability();
     
     // Fill map.
     for(uint8_t* p = trav_data->origin(); p < stop_p; p++, sbpl_map_p++) {
-        uint8_t class_value = *p;
-        if(class_value == envire::SimpleTraversability::CLASS_UNKNOWN) {
-            driveability = bad_driveability;
-        } else {
-            driveability = (trav_grid->getTraversabilityClass(class_value)).getDrivability();
-        }
-        sbpl_cost = driveability2sbpl_cost(driveability);
-        *sbpl_map_p = sbpl_cost;
+        *sbpl_map_p = table.getSbplCost(*p);
     }
 }
 
@@ -134,12 +176,197 @@ std::vector<sbpl_2Dpt_t> Sbpl::createFootprint(double robot_width, double robot_
 }
 
 bool Sbpl::foundFinalSolution() {
-    LOG_INFO("Current epsilon is %4.2f", mEpsilon);
+    MPL_TRACE_INFO("Current epsilon is %4.2f", mEpsilon);
     return (mEpsilon == 1.0);
 }
 
 unsigned char Sbpl::driveability2sbpl_cost(double driveability) {
-    return SBPL_MAX_COST - (int)(driveability * (double)SBPL_MAX_COST) + 1.0;
+    return TravClassTable::driveability2sbpl_cost(driveability);
+}
+
+// PROTECTED
+void Sbpl::updatePlannerStates(std::vector<int> const& state_ids) {
+    if(mpSBPLPlanner == NULL || state_ids.empty()) {
+        return;
+    }
+    
+    // AD* keeps its search tree and only updates the affected states, 
+    // so replanning costs roughly the size of the change.
+    boost::shared_ptr<ADPlanner> ad_planner = 
+            boost::dynamic_pointer_cast<ADPlanner>(mpSBPLPlanner);
+    if(ad_planner != NULL) {
+        // The update functions do not modify the passed IDs.
+        std::vector<int>* ids = const_cast<std::vector<int>*>(&state_ids);
+        if(mConfig.mSBPLForwardSearch) {
+            ad_planner->update_preds_of_changededges(ids);
+        } else {
+            ad_planner->update_succs_of_changededges(ids);
+        }
+        LOG_INFO("AD* has been informed about %zu affected states", state_ids.size());
+    } else {
+        ChangedStatesQuery query(&state_ids, mConfig.mSBPLForwardSearch);
+        mpSBPLPlanner->costs_changed(query);
+        LOG_INFO("%zu states have been affected, the planner restarts its search", 
+                state_ids.size());
+    }
+}
+
+bool Sbpl::reuseEnvironment(std::string const& env_key) {
+    if(mpSBPLEnv != NULL && mpSBPLPlanner != NULL && 
+            !mSBPLEnvKey.empty() && env_key == mSBPLEnvKey) {
+        return true;
+    }
+    mpSBPLPlanner.reset();
+    mSBPLEnvKey.clear();
+    return false;
+}
+
+std::vector<CellUpdate>& Sbpl::selectCellUpdates(std::vector<CellUpdate>& cell_updates) {
+    if(mRelevantCells.empty()) {
+        return cell_updates;
+    }
+    
+    mSelectedCellUpdates.clear();
+    std::vector<CellUpdate>::iterator it = cell_updates.begin();
+    for(; it != cell_updates.end(); it++) {
+        if(isRelevantCell(it->x, it->y)) {
+            mSelectedCellUpdates.push_back(*it);
+        } else {
+            mDeferredCellUpdates.push_back(*it);
+        }
+    }
+    MPL_TRACE_DEBUG("%zu cell updates are applied, %zu are deferred", 
+            mSelectedCellUpdates.size(), mDeferredCellUpdates.size());
+    return mSelectedCellUpdates;
+}
+
+bool Sbpl::applyDeferredCellUpdates() {
+    if(mDeferredCellUpdates.empty()) {
+        return false;
+    }
+    
+    // Without the relevant cells partialMapUpdate() applies all updates.
+    std::vector<CellUpdate> cell_updates;
+    cell_updates.swap(mDeferredCellUpdates);
+    std::vector<uint8_t> relevant_cells;
+    relevant_cells.swap(mRelevantCells);
+    LOG_INFO("Apply %zu deferred cell updates", cell_updates.size());
+    if(!partialMapUpdate(cell_updates)) {
+        LOG_WARN("Deferred cell updates could not be applied");
+    }
+    relevant_cells.swap(mRelevantCells);
+    return true;
+}
+
+void Sbpl::clearDeferredCellUpdates() {
+    mDeferredCellUpdates.clear();
+    clearRelevantCells();
+}
+
+// PRIVATE
+bool Sbpl::replan(double time) {
+    mSBPLWaypointIDs.clear();
+    
+    bool ret = false;
+    try {
+        // Current conclusion: Better not touch each planners epsilon.
+        ret = mpSBPLPlanner->replan(time, &mSBPLWaypointIDs, &mLastSolutionCost);
+        mPathCost = mLastSolutionCost;
+        mEpsilon = mpSBPLPlanner->get_solution_eps();
+    } catch (...) {
+        LOG_ERROR("Replanning failed");
+        return false;
+    }
+    
+    if(ret) {
+        LOG_INFO("Found solution contains %zu waypoints", mSBPLWaypointIDs.size());
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void Sbpl::updateRelevantCells() {
+    if(mConfig.mSBPLDeferUpdateDist <= 0 || mpTravGrid == NULL || mpTravData == NULL ||
+            mSBPLWaypointIDs.empty()) {
+        clearRelevantCells();
+        return;
+    }
+    
+    // The cells only depend on the start and the waypoints, an unchanged 
+    // solution (e.g. replanned after the deferred updates) keeps them.
+    mPathCellsBuffer.clear();
+    mPathCellsBuffer.push_back(mStartGrid[0]);
+    mPathCellsBuffer.push_back(mStartGrid[1]);
+    mPathCellsBuffer.insert(mPathCellsBuffer.end(), mSBPLWaypointIDs.begin(), mSBPLWaypointIDs.end());
+    if(!mRelevantCells.empty() && mPathCellsBuffer == mRelevantCellsPath) {
+        return;
+    }
+    mRelevantCellsPath.swap(mPathCellsBuffer);
+    
+    // Waypoint cells, the path is bounded by their box.
+    int width = mpTravData->shape()[1];
+    int height = mpTravData->shape()[0];
+    mPathCellsBuffer.clear();
+    mPathCellsBuffer.push_back(mStartGrid[0]);
+    mPathCellsBuffer.push_back(mStartGrid[1]);
+    int min_x = mStartGrid[0], max_x = mStartGrid[0];
+    int min_y = mStartGrid[1], max_y = mStartGrid[1];
+    int x = 0, y = 0;
+    std::vector<int>::iterator it = mSBPLWaypointIDs.begin();
+    for(; it != mSBPLWaypointIDs.end(); it++) {
+        if(!getStateCell(*it, x, y)) {
+            clearRelevantCells();
+            return;
+        }
+        mPathCellsBuffer.push_back(x);
+        mPathCellsBuffer.push_back(y);
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+    
+    // Only the box around the path (extended by the defer distance) is marked 
+    // and dilated instead of the complete map.
+    int radius = (int)std::ceil(mConfig.mSBPLDeferUpdateDist / mpTravGrid->getScaleX());
+    int box_x0 = std::max(min_x - radius, 0);
+    int box_y0 = std::max(min_y - radius, 0);
+    int box_x1 = std::min(max_x + radius, width - 1);
+    int box_y1 = std::min(max_y + radius, height - 1);
+    if(box_x0 > box_x1 || box_y0 > box_y1) {
+        clearRelevantCells();
+        return;
+    }
+    int box_width = box_x1 - box_x0 + 1;
+    int box_height = box_y1 - box_y0 + 1;
+    mRelevantCells.assign((size_t)box_width * box_height, 0);
+    
+    // Cells crossed by the segments between the waypoints (cell centers).
+    for(size_t i = 2; i + 1 < mPathCellsBuffer.size(); i += 2) {
+        GridTraversal traversal(mPathCellsBuffer[i-2] + 0.5, mPathCellsBuffer[i-1] + 0.5, 
+                mPathCellsBuffer[i] + 0.5, mPathCellsBuffer[i+1] + 0.5);
+        do {
+            int box_x = traversal.getX() - box_x0;
+            int box_y = traversal.getY() - box_y0;
+            if(box_x >= 0 && box_x < box_width && box_y >= 0 && box_y < box_height) {
+                mRelevantCells[(size_t)box_y * box_width + box_x] = 1;
+            }
+        } while(traversal.next());
+    }
+    
+    // Square neighborhood of the crossed cells.
+    dilateCells(mRelevantCells, box_width, box_height, radius);
+    mRelevantCellsX = box_x0;
+    mRelevantCellsY = box_y0;
+    mRelevantCellsWidth = box_width;
+    mRelevantCellsHeight = box_height;
+}
+
+void Sbpl::clearRelevantCells() {
+    mRelevantCells.clear();
+    mRelevantCellsWidth = mRelevantCellsHeight = 0;
+    mRelevantCellsPath.clear();
 }
 
 } // namespace motion_planning_libraries
@@ -1,11 +1,13 @@
 #ifndef _MOTION_PLANNING_LIBRARIES_SBPL_HPP_
 #define _MOTION_PLANNING_LIBRARIES_SBPL_HPP_
 
+#include <string>
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
 
 #include <motion_planning_libraries/AbstractMotionPlanningLibrary.hpp>
+#include <motion_planning_libraries/CostToGoField.hpp>
 
 #include <sbpl/utils/utils.h>
 #include <sbpl/config.h> // here #define DEBUG 0, causes a lot of trouble
@@ -26,7 +28,7 @@ class Sbpl : public AbstractMotionPlanningLibrary
  protected:
     // Driveability 0.0 to 1.0 will be mapped to SBPL_MAX_COST + 1 to 1 
     // with obstacle threshold of SBPL_MAX_COST + 1.
-    static const unsigned char SBPL_MAX_COST = 20;
+    static const unsigned char SBPL_MAX_COST = TravClassTable::SBPL_MAX_COST;
     
     boost::shared_ptr<DiscreteSpaceInformation> mpSBPLEnv;
     boost::shared_ptr<SBPLPlanner> mpSBPLPlanner;
@@ -38,6 +40,27 @@ class Sbpl : public AbstractMotionPlanningLibrary
     // - after planning have failed - whether the states intersect with an obstacle.
     Eigen::Vector3i mStartGrid, mGoalGrid;
     double mEpsilon;
+    // Goal heuristic shared with the environment (Config::mUseCostToGoField), 
+    // kept while the goal does not change.
+    boost::shared_ptr<CostToGoField> mpCostToGoField;
+    // Configuration (map size, footprint, primitives, planner) of mpSBPLEnv and 
+    // mpSBPLPlanner, empty if they cannot be reused by the next initialization.
+    std::string mSBPLEnvKey;
+    // Cell updates which have not been applied to the SBPL environment yet
+    // because they are farther than Config::mSBPLDeferUpdateDist from the last 
+    // path (see selectCellUpdates()).
+    std::vector<CellUpdate> mDeferredCellUpdates;
+    // Cells (row-major) within the defer distance of the last path and its start, 
+    // empty if no path is known and all updates have to be applied. Only 
+    // the box around the path starting at cell (mRelevantCellsX, mRelevantCellsY) is stored.
+    std::vector<uint8_t> mRelevantCells;
+    int mRelevantCellsX, mRelevantCellsY;
+    int mRelevantCellsWidth, mRelevantCellsHeight;
+    // Start cell and waypoint IDs of mRelevantCells, an unchanged path keeps the cells.
+    std::vector<int> mRelevantCellsPath;
+    std::vector<int> mPathCellsBuffer;
+    // Buffer of the updates which are applied immediately.
+    std::vector<CellUpdate> mSelectedCellUpdates;
         
  public: 
     Sbpl(Config config = Config());
@@ -48,7 +71,7 @@ class Sbpl : public AbstractMotionPlanningLibrary
     virtual bool solve(double time);    
    
     /**
-     * Converts the trav map to a sbpl map using the driveability value.
+     * Converts the trav map to a sbpl map using the class to cost lookup table.
      * Driveability 0.0 to 1.0 is mapped to costs SBPL_MAX_COST + 1  to 1 with obstacle threshold SBPL_MAX_COST + 1.
      * (+1 because costs of 0 should be avoided).
      */
@@ -66,7 +89,107 @@ class Sbpl : public AbstractMotionPlanningLibrary
      */
     bool foundFinalSolution();
     
+    /**
+     * Epsilon of the last solution.
+     */
+    virtual double getEpsilon() {
+        return mEpsilon;
+    }
+    
+    /**
+     * Adds the number of states expanded by the planner.
+     */
+    virtual void fillStatistics(struct PlanningStatistics& statistics);
+    
     unsigned char driveability2sbpl_cost(double driveability);
+    
+ protected:
+    /**
+     * Informs the planner about the states whose edges have been changed by a 
+     * partial map update: The predecessors of the changed edges for a forward search, 
+     * the successors for a backward search. AD* only repairs the affected part
+     * of its search, all other planners will restart their search.
+     */
+    void updatePlannerStates(std::vector<int> const& state_ids);
+    
+    /**
+     * Returns true if environment and planner have been created with the same
+     * \a env_key and can be reused by applying the new map in place.
+     * Otherwise the planner is released (it refers to the environment 
+     * which will be replaced) and mSBPLEnvKey is cleared, it has to be set 
+     * again after the new environment has been initialized.
+     */
+    bool reuseEnvironment(std::string const& env_key);
+    
+    /**
+     * Returns the cell updates which have to be applied to the SBPL environment 
+     * immediately: Cells near the last path (Config::mSBPLDeferUpdateDist), 
+     * all others are appended to mDeferredCellUpdates and applied by solve()
+     * once they could affect the solution. Returns \a cell_updates itself if 
+     * nothing is deferred.
+     */
+    std::vector<CellUpdate>& selectCellUpdates(std::vector<CellUpdate>& cell_updates);
+    
+    /**
+     * Applies all deferred cell updates by partialMapUpdate().
+     * Returns false if there have not been any.
+     */
+    bool applyDeferredCellUpdates();
+    
+    /**
+     * Discards the deferred cell updates and the relevant cells, has to be 
+     * called if the complete map is applied or the grid coordinates change.
+     */
+    void clearDeferredCellUpdates();
+    
+    /**
+     * Discrete cell of an environment state, used to mark the cells of the path.
+     */
+    virtual bool getStateCell(int state_id, int& x, int& y) {
+        return false;
+    }
+    
+    /**
+     * Writes the costs of mpSBPLMapData which differ from the current costs 
+     * of the environment (EnvironmentNAV2D or EnvironmentNAVXYTHETALAT) into the 
+     * environment, its allocations (hash tables, precomputed footprints) are kept. 
+     * Returns the number of changed cells.
+     */
+    template <class EnvType>
+    unsigned int updateSBPLEnvMap(EnvType& env, int width, int height) {
+        unsigned int num_changed = 0;
+        unsigned char const* cost_p = mpSBPLMapData;
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x, ++cost_p) {
+                if(env.GetMapCost(x, y) != *cost_p) {
+                    env.UpdateCost(x, y, *cost_p);
+                    num_changed++;
+                }
+            }
+        }
+        return num_changed;
+    }
+    
+ private:
+    /**
+     * Runs the planner, the solution is stored within mSBPLWaypointIDs.
+     */
+    bool replan(double time);
+    
+    /**
+     * Marks the cells within the defer distance of the start and 
+     * the current solution as relevant.
+     */
+    void updateRelevantCells();
+    
+    void clearRelevantCells();
+    
+    inline bool isRelevantCell(int x, int y) const {
+        x -= mRelevantCellsX;
+        y -= mRelevantCellsY;
+        return x >= 0 && x < mRelevantCellsWidth && y >= 0 && y < mRelevantCellsHeight &&
+                mRelevantCells[y * mRelevantCellsWidth + x];
+    }
 };
     
 } // end namespace motion_planning_libraries
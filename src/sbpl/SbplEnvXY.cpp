@@ -1,12 +1,19 @@
 #include "SbplEnvXY.hpp"
 
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
 #include <sbpl/headers.h>
 
 namespace motion_planning_libraries
 {
 
 // PUBLIC
-SbplEnvXY::SbplEnvXY(Config config) : Sbpl(config) {
+SbplEnvXY::SbplEnvXY(Config config) : Sbpl(config), 
+        mpEnvXY(), 
+        mObstacleDistanceMap(), 
+        mInflationRadius(0) {
     LOG_DEBUG("SBPLEnvXY constructor");
 }
 
@@ -18,51 +25,77 @@ bool SbplEnvXY::initialize(envire::TraversabilityGrid* trav_grid,
     size_t grid_width = trav_grid->getCellSizeX();
     size_t grid_height = trav_grid->getCellSizeY();
 
-    mpSBPLEnv = boost::shared_ptr<EnvironmentNAV2D>(new EnvironmentNAV2D());
+    // Environment and planner are kept if the new map can be applied in place.
+    bool reuse_env = false;
+    clearDeferredCellUpdates();
          
     try {
         // Use the sbpl-env file if path is given.
         if(!mConfig.mSBPLEnvFile.empty()) {
             LOG_INFO("Load SBPL environment '%s'", mConfig.mSBPLEnvFile.c_str());
-            mpSBPLEnv->InitializeEnv(mConfig.mSBPLEnvFile.c_str());
+            mSBPLEnvKey.clear();
+            mpSBPLPlanner.reset();
+            mpEnvXY = boost::shared_ptr<EnvironmentNAV2D>(new EnvironmentNAV2D());
+            mpSBPLEnv = mpEnvXY;
+            mpEnvXY->InitializeEnv(mConfig.mSBPLEnvFile.c_str());
         // Create an sbpl-environment.
         } else {
             createSBPLMap(trav_grid, grid_data);
+            inflateSBPLMap();
 
-            LOG_INFO("Create SBPL EnvironmentNAV2D environment");
-            boost::shared_ptr<EnvironmentNAV2D> env_xy =
-                    boost::dynamic_pointer_cast<EnvironmentNAV2D>(mpSBPLEnv);
-            env_xy->InitializeEnv(grid_width, grid_height, mpSBPLMapData, SBPL_MAX_COST + 1);
+            std::stringstream env_key;
+            env_key << grid_width << " " << grid_height << " " << 
+                    (int)mConfig.mPlanner << " " << mConfig.mSBPLForwardSearch;
+            reuse_env = reuseEnvironment(env_key.str());
+            if(reuse_env) {
+                unsigned int num_changed = updateSBPLEnvMap(*mpEnvXY, 
+                        grid_width, grid_height);
+                LOG_INFO("SBPL environment is reused, %d cells have been changed", num_changed);
+            } else {
+                LOG_INFO("Create SBPL EnvironmentNAV2D environment");
+                boost::shared_ptr<EnvironmentNAV2D> env_xy = 
+                        boost::shared_ptr<EnvironmentNAV2D>(new EnvironmentNAV2D());
+                mpSBPLEnv = env_xy;
+                mpEnvXY = env_xy;
+                env_xy->InitializeEnv(grid_width, grid_height, mpSBPLMapData, SBPL_MAX_COST + 1);
+                mSBPLEnvKey = env_key.str();
+            }
         }
     } catch (SBPL_Exception* e) {
         LOG_ERROR("SBPL environment '%s' could not be loaded (%s)", 
                 mConfig.mSBPLEnvFile.c_str(),
                 e->what());
         mpSBPLEnv.reset();
+        mpEnvXY.reset();
         return false;
     } 
       
     // Create planner.
-    switch(mConfig.mPlanner) {
-        case UNDEFINED_PLANNER: {
-        }
-        case ANYTIME_DSTAR: {
-            mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ADPlanner(mpSBPLEnv.get(), 
-                    mConfig.mSBPLForwardSearch));
-            break;
-        }
-        case ANYTIME_NONPARAMETRIC_ASTAR: {
-            mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new anaPlanner(mpSBPLEnv.get(), 
-                    mConfig.mSBPLForwardSearch));
-            break;
-        }
-        case ANYTIME_ASTAR: {
-            mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ARAPlanner(mpSBPLEnv.get(), 
-                    mConfig.mSBPLForwardSearch));
-        }
-        default: {
-            LOG_ERROR("Planner %d is not available for this environment", (int)mConfig.mPlanner);
-            return false;
+    if(reuse_env) {
+        // The allocated search state is kept, the search restarts with the new costs.
+        mpSBPLPlanner->force_planning_from_scratch();
+    } else {
+        switch(mConfig.mPlanner) {
+            case UNDEFINED_PLANNER: {
+            }
+            case ANYTIME_DSTAR: {
+                mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ADPlanner(mpSBPLEnv.get(), 
+                        mConfig.mSBPLForwardSearch));
+                break;
+            }
+            case ANYTIME_NONPARAMETRIC_ASTAR: {
+                mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new anaPlanner(mpSBPLEnv.get(), 
+                        mConfig.mSBPLForwardSearch));
+                break;
+            }
+            case ANYTIME_ASTAR: {
+                mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ARAPlanner(mpSBPLEnv.get(), 
+                        mConfig.mSBPLForwardSearch));
+            }
+            default: {
+                LOG_ERROR("Planner %d is not available for this environment", (int)mConfig.mPlanner);
+                return false;
+            }
         }
     }
     mpSBPLPlanner->set_search_mode(mConfig.mSearchUntilFirstSolution); 
@@ -97,18 +130,90 @@ bool SbplEnvXY::partialMapUpdate(std::vector<CellUpdate>& cell_updates) {
         return true;
     }
     
-    boost::shared_ptr<EnvironmentNAV2D> env_xy =
-        boost::dynamic_pointer_cast<EnvironmentNAV2D>(mpSBPLEnv);
-    
-    // Runs through all the cell updates and uses the stored driveability for the 
-    // SBPL cost calculation.
-    std::vector<CellUpdate>::iterator it = cell_updates.begin();
-    for(; it != cell_updates.end(); it++) {
-        if(!env_xy->UpdateCost(it->x, it->y, driveability2sbpl_cost(it->driveability))) {
-            LOG_WARN("SBPL cell (%d, %d) could not be updated", it->x, it->y);
-            return false;
+    // Runs through all the cell updates and uses the precalculated SBPL cost of the 
+    // new class (driveability of the cell update). Only cells with a changed cost 
+    // are passed to the planner. Cells far from the last path are deferred.
+    TravClassTable const& table = *mpTravClassTable;
+    std::vector<CellUpdate>& selected_updates = selectCellUpdates(cell_updates);
+    std::vector<nav2dcell_t> changed_cells;
+    nav2dcell_t cell;
+    if(mConfig.mSBPLInflateObstacles && !mObstacleDistanceMap.empty()) {
+        // The inflation of each changed cell can only change the cells within 
+        // the inflation radius, so only these windows are compared.
+        mObstacleDistanceMap.update(*mpTravData, table, cell_updates);
+        int width = mpTravData->shape()[1];
+        int height = mpTravData->shape()[0];
+        int r = mInflationRadius;
+        std::vector<CellUpdate>::iterator it = selected_updates.begin();
+        for(; it != selected_updates.end(); it++) {
+            int x_end = std::min((int)it->x + r + 1, width);
+            int y_end = std::min((int)it->y + r + 1, height);
+            for(int y = std::max((int)it->y - r, 0); y < y_end; ++y) {
+                for(int x = std::max((int)it->x - r, 0); x < x_end; ++x) {
+                    unsigned char cost = getInflatedCost(x, y);
+                    if(mpEnvXY->GetMapCost(x, y) == cost) {
+                        continue;
+                    }
+                    if(!mpEnvXY->UpdateCost(x, y, cost)) {
+                        LOG_WARN("SBPL cell (%d, %d) could not be updated", x, y);
+                        return false;
+                    }
+                    cell.x = x;
+                    cell.y = y;
+                    changed_cells.push_back(cell);
+                }
+            }
+        }
+    } else {
+        std::vector<CellUpdate>::iterator it = selected_updates.begin();
+        for(; it != selected_updates.end(); it++) {
+            unsigned char cost = table.getSbplCost(it->klass);
+            if(mpEnvXY->GetMapCost(it->x, it->y) == cost) {
+                continue;
+            }
+            if(!mpEnvXY->UpdateCost(it->x, it->y, cost)) {
+                LOG_WARN("SBPL cell (%d, %d) could not be updated", it->x, it->y);
+                return false;
+            }
+            cell.x = it->x;
+            cell.y = it->y;
+            changed_cells.push_back(cell);
         }
     }
+    
+    if(changed_cells.empty()) {
+        return true;
+    }
+    
+    // The environment maps the changed cells to the states whose edges 
+    // pass the cells (the robot is defined as a point).
+    std::vector<int> state_ids;
+    if(mConfig.mSBPLForwardSearch) {
+        mpEnvXY->GetPredsofChangedEdges(&changed_cells, &state_ids);
+    } else {
+        mpEnvXY->GetSuccsofChangedEdges(&changed_cells, &state_ids);
+    }
+    updatePlannerStates(state_ids);
+    return true;
+}
+
+bool SbplEnvXY::shiftMap(int shift_x, int shift_y, std::vector<CellUpdate>& cell_updates) {
+    // A loaded SBPL environment does not belong to the traversability map.
+    if(!mConfig.mSBPLEnvFile.empty() || mpEnvXY == NULL || mpSBPLPlanner == NULL) {
+        return false;
+    }
+    
+    // Nearly all cells of the unshifted environment differ from the new map, 
+    // so the complete map is compared instead of using the cell updates.
+    clearDeferredCellUpdates();
+    createSBPLMap(mpTravGrid, mpTravData);
+    inflateSBPLMap();
+    unsigned int num_changed = updateSBPLEnvMap(*mpEnvXY, 
+            mpTravData->shape()[1], mpTravData->shape()[0]);
+    LOG_INFO("Map shifted by (%d, %d), %d cells have been changed", 
+            shift_x, shift_y, num_changed);
+    
+    mpSBPLPlanner->force_planning_from_scratch();
     return true;
 }
 
@@ -119,12 +224,9 @@ bool SbplEnvXY::setStartGoal(struct State start_state, struct State goal_state)
     int start_id = 0;
     int goal_id = 0;
     
-    boost::shared_ptr<EnvironmentNAV2D> env_xy =
-            boost::dynamic_pointer_cast<EnvironmentNAV2D>(mpSBPLEnv);
-            
-    start_id = env_xy->SetStart(start_state.getPose().position[0], 
+    start_id = mpEnvXY->SetStart(start_state.getPose().position[0], 
             start_state.getPose().position[1]);
-    goal_id = env_xy->SetGoal(goal_state.getPose().position[0], 
+    goal_id = mpEnvXY->SetGoal(goal_state.getPose().position[0], 
             goal_state.getPose().position[1]);
 
     if (mpSBPLPlanner->set_start(start_id) == 0) {
@@ -136,6 +238,12 @@ bool SbplEnvXY::setStartGoal(struct State start_state, struct State goal_state)
         LOG_ERROR("Failed to set goal state");
         return false;
     }
+    
+    // Stores discrete start and goal position to check for validity.
+    mStartGrid[0] = start_state.getPose().position[0];
+    mStartGrid[1] = start_state.getPose().position[1];
+    mGoalGrid[0] = goal_state.getPose().position[0];
+    mGoalGrid[1] = goal_state.getPose().position[1];
       
     return true;
 }
@@ -153,12 +261,11 @@ bool SbplEnvXY::fillPath(std::vector<struct State>& path, bool& pos_defined_in_l
     int x = 0, y = 0, theta = 0; // In SBPL theta is an integer as well.
     
     // Fill path with the found solution.
+    path.reserve(path.size() + mSBPLWaypointIDs.size());
     std::vector<int>::iterator it = mSBPLWaypointIDs.begin();
     for(; it != mSBPLWaypointIDs.end(); it++) {
        
-        boost::shared_ptr<EnvironmentNAV2D> env_xy =
-                boost::dynamic_pointer_cast<EnvironmentNAV2D>(mpSBPLEnv);
-        env_xy->GetCoordFromState(*it, x, y);
+        mpEnvXY->GetCoordFromState(*it, x, y);
 
         rbs.position = base::Vector3d(x,y,0);
         rbs.orientation =  Eigen::AngleAxis<double>(theta, base::Vector3d(0,0,1));
@@ -172,20 +279,51 @@ enum MplErrors SbplEnvXY::isStartGoalValid() {
      LOG_INFO("Check discrete start (%d, %d) and goal position (%d, %d) for validity",
             mStartGrid[0], mStartGrid[1], mGoalGrid[0], mGoalGrid[1]);
      
-    boost::shared_ptr<EnvironmentNAV2D> env_xy =
-            boost::dynamic_pointer_cast<EnvironmentNAV2D>(mpSBPLEnv);
-        
     int err = (int)MPL_ERR_NONE;
     
-    if(!env_xy->IsObstacle(mStartGrid[0], mStartGrid[1])) {
+    if(!mpEnvXY->IsObstacle(mStartGrid[0], mStartGrid[1])) {
         err += (int)MPL_ERR_START_ON_OBSTACLE;
     }
     
-    if(!env_xy->IsObstacle(mGoalGrid[0], mGoalGrid[1])) {
+    if(!mpEnvXY->IsObstacle(mGoalGrid[0], mGoalGrid[1])) {
         err += (int)MPL_ERR_GOAL_ON_OBSTACLE;
     }
     
     return (enum MplErrors)err;
 }
 
+// PROTECTED
+bool SbplEnvXY::getStateCell(int state_id, int& x, int& y) {
+    mpEnvXY->GetCoordFromState(state_id, x, y);
+    return true;
+}
+
+// PRIVATE
+void SbplEnvXY::inflateSBPLMap() {
+    if(!mConfig.mSBPLInflateObstacles) {
+        mObstacleDistanceMap = ObstacleDistanceMap();
+        return;
+    }
+    
+    double min_cell_size = std::min(mpTravGrid->getScaleX(), mpTravGrid->getScaleY());
+    mInflationRadius = (unsigned int)std::ceil(mConfig.getMaxRadius() / min_cell_size);
+    mObstacleDistanceMap.create(*mpTravData, *mpTravClassTable, mInflationRadius + 1);
+    
+    int width = mpTravData->shape()[1];
+    int height = mpTravData->shape()[0];
+    unsigned char* cost_p = mpSBPLMapData;
+    unsigned int num_inflated = 0;
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x, ++cost_p) {
+            if(!mObstacleDistanceMap.isFree(x, y, mInflationRadius) && 
+                    *cost_p != SBPL_MAX_COST + 1) {
+                *cost_p = SBPL_MAX_COST + 1;
+                num_inflated++;
+            }
+        }
+    }
+    LOG_INFO("Obstacles inflated by %d cells, %d cells have become obstacles", 
+            mInflationRadius, num_inflated);
+}
+
 } // namespace motion_planning_libraries
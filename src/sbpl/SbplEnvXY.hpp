@@ -3,11 +3,20 @@
 
 #include "Sbpl.hpp"
 
+#include <motion_planning_libraries/ObstacleDistanceMap.hpp>
+
 namespace motion_planning_libraries
 {
     
 class SbplEnvXY : public Sbpl
 {      
+ protected:
+    // Typed mpSBPLEnv, set together with it by initialize().
+    boost::shared_ptr<EnvironmentNAV2D> mpEnvXY;
+    // Clearance of the cells used to inflate the obstacles (Config::mSBPLInflateObstacles),
+    // repaired by the partial map updates.
+    ObstacleDistanceMap mObstacleDistanceMap;
+    unsigned int mInflationRadius; // In grid cells.
    
  public: 
     SbplEnvXY(Config config = Config());
@@ -20,6 +29,12 @@ class SbplEnvXY : public Sbpl
     
     virtual bool partialMapUpdate(std::vector<CellUpdate>& cell_updates);
     
+    /**
+     * The 2D environment cannot be shifted in place, all changed costs are
+     * written into the existing environment instead of creating a new one.
+     */
+    virtual bool shiftMap(int shift_x, int shift_y, std::vector<CellUpdate>& cell_updates);
+    
     /**
      * 
      */
@@ -36,6 +51,26 @@ class SbplEnvXY : public Sbpl
     virtual bool fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid);       
     
     enum MplErrors isStartGoalValid();
+    
+ protected:
+    virtual bool getStateCell(int state_id, int& x, int& y);
+    
+ private:
+    /**
+     * Creates the distance map and sets the cells of mpSBPLMapData within
+     * mInflationRadius of an obstacle to the obstacle cost.
+     */
+    void inflateSBPLMap();
+    
+    /**
+     * SBPL cost of the cell regarding the inflated obstacles.
+     */
+    inline unsigned char getInflatedCost(int x, int y) const {
+        if(!mObstacleDistanceMap.isFree(x, y, mInflationRadius)) {
+            return SBPL_MAX_COST + 1;
+        }
+        return mpTravClassTable->getSbplCost((*mpTravData)[y][x]);
+    }
 };
     
 } // end namespace motion_planning_libraries
@@ -1,16 +1,31 @@
 #include "SbplEnvXYTHETA.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <exception>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include <sbpl/headers.h>
 #include <sbpl/sbpl_exception.h>
 
+#include "SbplEnvironmentNAVXYTHETAMLEVLAT.hpp"
+
 namespace motion_planning_libraries
 {
 
 // PUBLIC
 SbplEnvXYTHETA::SbplEnvXYTHETA(Config config) : Sbpl(config), 
-        mSBPLScaleX(0), mSBPLScaleY(0), mPrims(NULL), mGoalLocal() {
+        mSBPLScaleX(0), mSBPLScaleY(0), mPrims(), mPrimsKey(), mSBPLPrims(),
+        mPrimitiveGenerationTime(0.0), mpEnvXYTHETA(), mpCoarseEnv(), mpCoarsePlanner(), 
+        mCoarseWidth(0), mCoarseHeight(0), mCorridor(), mAppliedCorridor(), mCorridorOutdated(true), 
+        mCorridorGoal(-1, -1), mGoalLocal() {
     LOG_DEBUG("SbplEnvXYTHETA constructor");
 }
 
@@ -19,8 +34,6 @@ bool SbplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
     
     LOG_DEBUG("SBPLEnvXYTHETA initialize");
     
-    mPrims = NULL;
-    
     size_t grid_width = trav_grid->getCellSizeX();
     size_t grid_height = trav_grid->getCellSizeY();
     double scale_x = trav_grid->getScaleX();
@@ -35,24 +48,30 @@ bool SbplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
         LOG_WARN("SBPL uses a cell size of 0.1m, other values will probably produce strange results.");
     }
        
-    // Create and fill SBPL environment.
-    mpSBPLEnv = boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT>(
-            new EnvironmentNAVXYTHETAMLEVLAT());
-
+    // Environment and planner are kept if the new map can be applied in place.
+    bool reuse_env = false;
+    clearDeferredCellUpdates();
 
     // Use the sbpl-env file if path is given.
     if(!mConfig.mSBPLEnvFile.empty()) {
         LOG_INFO("Load SBPL environment '%s'", mConfig.mSBPLEnvFile.c_str());
+        mPrims.reset();
+        mPrimsKey.clear();
+        mSBPLEnvKey.clear();
+        mpSBPLPlanner.reset();
+        mpEnvXYTHETA = boost::shared_ptr<SbplEnvironmentNAVXYTHETAMLEVLAT>(
+                new SbplEnvironmentNAVXYTHETAMLEVLAT());
+        mpSBPLEnv = mpEnvXYTHETA;
         
         try {
-            mpSBPLEnv->InitializeEnv(mConfig.mSBPLEnvFile.c_str());
+            mpEnvXYTHETA->InitializeEnv(mConfig.mSBPLEnvFile.c_str());
         
             // Request loaded cellsize / scale for environment SBPL_XYTHETA.
-            boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-                    boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
-            mSBPLScaleX = mSBPLScaleY = env_xytheta->GetEnvNavConfig()->cellsize_m;
+            mSBPLScaleX = mSBPLScaleY = mpEnvXYTHETA->GetEnvNavConfig()->cellsize_m;
         } catch (SBPL_Exception* e) {
             LOG_ERROR("EnvironmentNAVXYTHETAMLEVLAT could not be initialized using %s (%s)", mConfig.mSBPLEnvFile.c_str(), e->what());
+            // The partly loaded environment must not be used for planning or map updates.
+            resetEnvironment();
             return false;
         }        
     // Create an sbpl-environment.
@@ -65,16 +84,15 @@ bool SbplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
         if(mprim_file.empty()) {
             LOG_INFO("No sbpl mprim file specified, it will be generated");
             assert(scale_x == scale_y);
-            mprim_file = "sbpl_motion_primitives.mprim";
-            MotionPrimitivesConfig mprim_config(mConfig, grid_width, grid_height, scale_x);
-            mPrims = new struct SbplMotionPrimitives(mprim_config);
-            mPrims->createPrimitives();
-            mPrims->storeToFile(mprim_file);
+            if(!generateMotionPrimitives(grid_width, grid_height, scale_x)) {
+                return false;
+            }
+        } else {
+            mPrims.reset();
+            mPrimsKey.clear();
+            mSBPLPrims.clear();
         }
         createSBPLMap(trav_grid, grid_data);
-        LOG_INFO("Create SBPL EnvironmentNAVXYTHETAMLEVLAT environment");
-        boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-                boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
         try {
             // SBPL does not allow the definition of forward AND backward velocity.
             double speed = fabs(mConfig.mMobility.mSpeed);
@@ -110,52 +128,101 @@ bool SbplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
             LOG_INFO("SBPL does not support variable footprints, using max width,length (%4.2f, %4.2f)", 
                     robot_width, robot_length);
             std::vector<sbpl_2Dpt_t> fp_vec = createFootprint(robot_width, robot_length);
+            
+            std::stringstream env_key;
+            env_key << std::setprecision(17) << grid_width << " " << grid_height << " " << 
+                    scale_x << " " << speed << " " << time_to_turn_45_degree << " " << 
+                    robot_width << " " << robot_length << " " << 
+                    (mprim_file.empty() ? mPrimsKey : mprim_file) << " " <<
+                    (int)mConfig.mPlanner << " " << mConfig.mSBPLForwardSearch;
+            reuse_env = reuseEnvironment(env_key.str());
             base::Time start_t = base::Time::now();
-            env_xytheta->InitializeEnv(grid_width, grid_height, 
-                mpSBPLMapData, // initial map
-                0,0,0, //mStartGrid.position.x(), mStartGrid.position.y(), mStartGrid.getYaw(), 
-                0,0,0, //mGoalGrid.position.x(), mGoalGrid.position.y(), mGoalGrid.getYaw(),
-                0.1, 0.1, 0.1, // tolerance x,y,yaw, ignored
-                fp_vec, 
-                scale_x,  // Size of a cell in meter => in SBPL cells have to be quadrats
-                speed, 
-                time_to_turn_45_degree, 
-                SBPL_MAX_COST, // cost threshold
-                mprim_file.c_str()); // motion primitives file
+            boost::shared_ptr<SbplEnvironmentNAVXYTHETAMLEVLAT> env_xytheta;
+            if(reuse_env) {
+                env_xytheta = mpEnvXYTHETA;
+                unsigned int num_changed = updateSBPLEnvMap(*env_xytheta, grid_width, grid_height);
+                LOG_INFO("SBPL environment is reused, %d cells have been changed", num_changed);
+            } else if(mprim_file.empty()) {
+                LOG_INFO("Create SBPL EnvironmentNAVXYTHETAMLEVLAT environment");
+                env_xytheta = boost::shared_ptr<SbplEnvironmentNAVXYTHETAMLEVLAT>(
+                        new SbplEnvironmentNAVXYTHETAMLEVLAT());
+                mpSBPLEnv = env_xytheta;
+                mpEnvXYTHETA = env_xytheta;
+                // Generated primitives are passed directly, no mprim file is used.
+                if(!env_xytheta->InitializeEnvWithPrimitives(grid_width, grid_height, 
+                        mpSBPLMapData, // initial map
+                        fp_vec, 
+                        scale_x,  // Size of a cell in meter => in SBPL cells have to be quadrats
+                        speed, 
+                        time_to_turn_45_degree, 
+                        SBPL_MAX_COST, // cost threshold
+                        mSBPLPrims)) {
+                    LOG_ERROR("EnvironmentNAVXYTHETAMLEVLAT could not be created using the generated primitives");
+                    resetEnvironment();
+                    return false;
+                }
+            } else {
+                LOG_INFO("Create SBPL EnvironmentNAVXYTHETAMLEVLAT environment");
+                env_xytheta = boost::shared_ptr<SbplEnvironmentNAVXYTHETAMLEVLAT>(
+                        new SbplEnvironmentNAVXYTHETAMLEVLAT());
+                mpSBPLEnv = env_xytheta;
+                mpEnvXYTHETA = env_xytheta;
+                env_xytheta->InitializeEnv(grid_width, grid_height, 
+                    mpSBPLMapData, // initial map
+                    0,0,0, //mStartGrid.position.x(), mStartGrid.position.y(), mStartGrid.getYaw(), 
+                    0,0,0, //mGoalGrid.position.x(), mGoalGrid.position.y(), mGoalGrid.getYaw(),
+                    0.1, 0.1, 0.1, // tolerance x,y,yaw, ignored
+                    fp_vec, 
+                    scale_x,  // Size of a cell in meter => in SBPL cells have to be quadrats
+                    speed, 
+                    time_to_turn_45_degree, 
+                    SBPL_MAX_COST, // cost threshold
+                    mprim_file.c_str()); // motion primitives file
+            }
             LOG_INFO("SBPL environment initialized within %4.2f sec", 
                     (base::Time::now() - start_t).toSeconds());
+            if(!reuse_env) {
+                mSBPLEnvKey = env_key.str();
+            }
         } catch (SBPL_Exception* e) {
-            LOG_ERROR("EnvironmentNAVXYTHETAMLEVLAT could not be created using the motion primitive file %s (%s)", 
+            LOG_ERROR("EnvironmentNAVXYTHETAMLEVLAT could not be created using the motion primitive file '%s' (%s)", 
                     mprim_file.c_str(),
                     e->what());
+            resetEnvironment();
             return false;
         } catch ( ... ) {
              LOG_ERROR("EnvironmentNAVXYTHETAMLEVLAT initialization: catched a exception");
+             resetEnvironment();
              return false;
         }
     }
  
     // Create planner.
-    switch(mConfig.mPlanner) {
-        case UNDEFINED_PLANNER: {
-        }
-        case ANYTIME_DSTAR: {
-            mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ADPlanner(mpSBPLEnv.get(), 
-                    mConfig.mSBPLForwardSearch));
-            break;
-        }
-        case ANYTIME_NONPARAMETRIC_ASTAR: {
-            mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new anaPlanner(mpSBPLEnv.get(), 
-                    mConfig.mSBPLForwardSearch));
-            break;
-        }
-        case ANYTIME_ASTAR: {
-            mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ARAPlanner(mpSBPLEnv.get(), 
-                    mConfig.mSBPLForwardSearch));
-        }
-        default: {
-            LOG_ERROR("Planner %d is not available for this environment", (int)mConfig.mPlanner);
-            return false;
+    if(reuse_env) {
+        // The allocated search state is kept, the search restarts with the new costs.
+        mpSBPLPlanner->force_planning_from_scratch();
+    } else {
+        switch(mConfig.mPlanner) {
+            case UNDEFINED_PLANNER: {
+            }
+            case ANYTIME_DSTAR: {
+                mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ADPlanner(mpSBPLEnv.get(), 
+                        mConfig.mSBPLForwardSearch));
+                break;
+            }
+            case ANYTIME_NONPARAMETRIC_ASTAR: {
+                mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new anaPlanner(mpSBPLEnv.get(), 
+                        mConfig.mSBPLForwardSearch));
+                break;
+            }
+            case ANYTIME_ASTAR: {
+                mpSBPLPlanner = boost::shared_ptr<SBPLPlanner>(new ARAPlanner(mpSBPLEnv.get(), 
+                        mConfig.mSBPLForwardSearch));
+            }
+            default: {
+                LOG_ERROR("Planner %d is not available for this environment", (int)mConfig.mPlanner);
+                return false;
+            }
         }
     }
     mpSBPLPlanner->set_search_mode(mConfig.mSearchUntilFirstSolution); 
@@ -181,30 +248,175 @@ bool SbplEnvXYTHETA::initialize(envire::TraversabilityGrid* trav_grid,
         }
     }
 
+    // The field is created for the first goal.
+    mpCostToGoField.reset();
+    if(mConfig.mUseCostToGoField && mConfig.mSBPLEnvFile.empty()) {
+        mpCostToGoField = boost::shared_ptr<CostToGoField>(new CostToGoField());
+    }
+    mpEnvXYTHETA->setCostToGoField(mpCostToGoField);
+
+    // The coarse environment requires the traversability map.
+    mpCoarseEnv.reset();
+    mpCoarsePlanner.reset();
+    mCorridor.clear();
+    mAppliedCorridor.clear();
+    mCorridorOutdated = true;
+    if(mConfig.mSBPLCoarseFactor > 1 && mConfig.mSBPLEnvFile.empty()) {
+        if(!createCoarseEnvironment(*grid_data)) {
+            LOG_WARN("Coarse environment could not be created, the complete map will be searched");
+        }
+    }
+
     // Print primitive informations.
     //std::cout << "Primitives: " << std::endl << mPrims->toString() << std::endl;
-    LOG_INFO("Primitives:\n%s", mPrims->toString().c_str());
+    if(mPrims != NULL) {
+        LOG_INFO("Primitives:\n%s", mPrims->toString().c_str());
+    }
 
     return true;
 }
 
 bool SbplEnvXYTHETA::partialMapUpdate(std::vector<CellUpdate>& cell_updates) {
+    // Reset by a failed shiftMap(), the map has to be initialized completely.
+    if(mpEnvXYTHETA == NULL || mpSBPLPlanner == NULL) {
+        return false;
+    }
     if(cell_updates.size() == 0) {
         return true;
     }
     
-    boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-        boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
-    
-    // Runs through all the cell updates and uses the stored driveability for the 
-    // SBPL cost calculation.
-    std::vector<CellUpdate>::iterator it = cell_updates.begin();
-    for(; it != cell_updates.end(); it++) {
-        if(!env_xytheta->UpdateCost(it->x, it->y, driveability2sbpl_cost(it->driveability))) {
-            LOG_WARN("SBPL cell (%d, %d) could not be updated", it->x, it->y);
+    // Runs through all the cell updates and uses the precalculated SBPL cost of the 
+    // new class (driveability of the cell update). Only cells with a changed cost 
+    // are passed to the planner. Cells far from the last path are deferred, 
+    // the coarse environment and the cost-to-go field get all cells.
+    TravClassTable const& table = *mpTravClassTable;
+    std::vector<CellUpdate>& selected_updates = selectCellUpdates(cell_updates);
+    std::vector<nav2dcell_t> changed_cells;
+    nav2dcell_t cell;
+    std::vector<CellUpdate>::iterator it = selected_updates.begin();
+    for(; it != selected_updates.end(); it++) {
+        // Cells outside of the corridor stay blocked.
+        unsigned char cost = isWithinCorridor(it->x, it->y) ? 
+                table.getSbplCost(it->klass) : SBPL_MAX_COST + 1;
+        if(mpEnvXYTHETA->GetMapCost(it->x, it->y) == cost) {
+            continue;
+        }
+        if(!mpEnvXYTHETA->UpdateCost(it->x, it->y, cost)) {
+            LOG_WARN("SBPL cell (%zu, %zu) could not be updated", it->x, it->y);
             return false;
         }
+        cell.x = it->x;
+        cell.y = it->y;
+        changed_cells.push_back(cell);
+    }
+    
+    // Updates the worst costs of the affected coarse cells. The corridor is 
+    // only replanned if one of its own cells has been changed, the cells
+    // outside are blocked anyway.
+    if(mpCoarseEnv != NULL) {
+        int factor = mConfig.mSBPLCoarseFactor;
+        for(it = cell_updates.begin(); it != cell_updates.end(); it++) {
+            int x_coarse = it->x / factor;
+            int y_coarse = it->y / factor;
+            unsigned char coarse_cost = calculateCoarseCost(*mpTravData, x_coarse, y_coarse);
+            if(mpCoarseEnv->GetMapCost(x_coarse, y_coarse) != coarse_cost) {
+                mpCoarseEnv->UpdateCost(x_coarse, y_coarse, coarse_cost);
+                if(isWithinCorridor(it->x, it->y)) {
+                    mCorridorOutdated = true;
+                }
+            }
+        }
+    }
+    
+    // Has to be done before the planners are informed, the heuristic
+    // values are requested during their repair.
+    if(mpCostToGoField != NULL && !mpCostToGoField->empty()) {
+        std::vector<double> class_costs;
+        getCostToGoClassCosts(class_costs);
+        if(!mpCostToGoField->update(*mpTravData, class_costs, cell_updates)) {
+            mpCostToGoField->create(*mpTravData, class_costs, 
+                    mpCostToGoField->getGoalX(), mpCostToGoField->getGoalY());
+        }
+    }
+    
+    if(changed_cells.empty()) {
+        return true;
+    }
+    
+    // The environment maps the changed cells to the states whose edges 
+    // pass the cells (regarding the footprint of the robot).
+    std::vector<int> state_ids;
+    if(mConfig.mSBPLForwardSearch) {
+        mpEnvXYTHETA->GetPredsofChangedEdges(&changed_cells, &state_ids);
+    } else {
+        mpEnvXYTHETA->GetSuccsofChangedEdges(&changed_cells, &state_ids);
+    }
+    updatePlannerStates(state_ids);
+    return true;
+}
+
+bool SbplEnvXYTHETA::shiftMap(int shift_x, int shift_y, std::vector<CellUpdate>& cell_updates) {
+    // A loaded SBPL environment does not belong to the traversability map.
+    if(!mConfig.mSBPLEnvFile.empty() || mpEnvXYTHETA == NULL || mpSBPLPlanner == NULL) {
+        return false;
+    }
+    
+    // The deferred cells belong to the unshifted grid, the planner 
+    // plans from scratch anyway.
+    TravClassTable const& table = *mpTravClassTable;
+    std::vector<CellUpdate>::iterator it = mDeferredCellUpdates.begin();
+    for(; it != mDeferredCellUpdates.end(); it++) {
+        unsigned char cost = isWithinCorridor(it->x, it->y) ? 
+                table.getSbplCost(it->klass) : SBPL_MAX_COST + 1;
+        if(mpEnvXYTHETA->GetMapCost(it->x, it->y) != cost) {
+            mpEnvXYTHETA->UpdateCost(it->x, it->y, cost);
+        }
+    }
+    clearDeferredCellUpdates();
+    
+    if(!mpEnvXYTHETA->shiftMap(shift_x, shift_y)) {
+        return false;
+    }
+    
+    // The corridor belongs to the old map. If it has been applied, the
+    // shifted cells which have been blocked are restored together with the
+    // updated cells, otherwise only the updated cells have to be written.
+    // The blocked cells have been moved, so every coarse cell is marked
+    // as blocked to rewrite the complete map.
+    if(!mCorridor.empty()) {
+        mCorridor.clear();
+        mAppliedCorridor.assign(mCoarseWidth * mCoarseHeight, 0);
+        applyCorridor();
+    } else {
+        for(it = cell_updates.begin(); it != cell_updates.end(); it++) {
+            unsigned char cost = table.getSbplCost(it->klass);
+            if(mpEnvXYTHETA->GetMapCost(it->x, it->y) != cost && 
+                    !mpEnvXYTHETA->UpdateCost(it->x, it->y, cost)) {
+                // The grid has been shifted already, an unshifted partial 
+                // update would corrupt it.
+                LOG_WARN("SBPL cell (%zu, %zu) could not be updated, the environment is reset", 
+                        it->x, it->y);
+                resetEnvironment();
+                return false;
+            }
+        }
+    }
+    mCorridorOutdated = true;
+    if(mpCoarseEnv != NULL) {
+        mpCoarsePlanner.reset();
+        mpCoarseEnv.reset();
+        if(!createCoarseEnvironment(*mpTravData)) {
+            LOG_WARN("Coarse environment could not be created, the complete map will be searched");
+        }
     }
+    
+    // The goal cell has been moved, the field is recreated by setStartGoal().
+    if(mpCostToGoField != NULL) {
+        mpCostToGoField->clear();
+    }
+    
+    // The states keep their grid coordinates, so the search tree is invalid.
+    mpSBPLPlanner->force_planning_from_scratch();
     return true;
 }
 
@@ -216,9 +428,6 @@ bool SbplEnvXYTHETA::setStartGoal(struct State start_state, struct State goal_st
     int goal_id = 0;
     
     // Start/goal have to be defined in meters (grid_local).
-    boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-            boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
-    
     double start_x = start_state.getPose().position[0] * mSBPLScaleX;
     double start_y = start_state.getPose().position[1] * mSBPLScaleY;
     double start_yaw = start_state.getPose().getYaw();
@@ -229,8 +438,16 @@ bool SbplEnvXYTHETA::setStartGoal(struct State start_state, struct State goal_st
     LOG_INFO("Change start/goal within SBPL env and planner to (%4.2f, %4.2f, %4.2f), (%4.2f, %4.2f, %4.2f)",
         start_x, start_y, start_yaw, goal_x, goal_y, goal_yaw);
     
-    start_id = env_xytheta->SetStart(start_x, start_y, start_yaw);
-    goal_id = env_xytheta->SetGoal(goal_x, goal_y, goal_yaw);
+    start_id = mpEnvXYTHETA->SetStart(start_x, start_y, start_yaw);
+    goal_id = mpEnvXYTHETA->SetGoal(goal_x, goal_y, goal_yaw);
+
+    // Has to be available before the planner requests the first heuristic.
+    if(mpCostToGoField != NULL) {
+        int goal_x_discrete = 0, goal_y_discrete = 0, goal_theta_discrete = 0;
+        mpEnvXYTHETA->GetCoordFromState(goal_id, goal_x_discrete, goal_y_discrete, 
+                goal_theta_discrete);
+        updateCostToGoField(goal_x_discrete, goal_y_discrete);
+    }
 
     if (mpSBPLPlanner->set_start(start_id) == 0) {
         LOG_ERROR("Failed to set start state");
@@ -254,12 +471,43 @@ bool SbplEnvXYTHETA::setStartGoal(struct State start_state, struct State goal_st
     mGoalGrid[0] = goal_state.getPose().position[0];
     mGoalGrid[1] = goal_state.getPose().position[1];
     mGoalGrid[2] = mPrims->calcDiscreteEndOrientation(goal_state.getPose().getYaw());
+    
+    // The corridor is already required by isStartGoalValid().
+    if(mpCoarseEnv != NULL) {
+        int factor = mConfig.mSBPLCoarseFactor;
+        Eigen::Vector2i goal_coarse(mGoalGrid[0] / factor, mGoalGrid[1] / factor);
+        if(goal_coarse != mCorridorGoal || !isWithinCorridor(mStartGrid[0], mStartGrid[1])) {
+            mCorridorOutdated = true;
+        }
+        updateCorridor();
+    }
       
     return true;
 }
     
 bool SbplEnvXYTHETA::solve(double time) {
-    return Sbpl::solve(time);
+    if(mpCoarseEnv == NULL) {
+        return Sbpl::solve(time);
+    }
+    
+    updateCorridor();
+    base::Time start_t = base::Time::now();
+    bool solved = Sbpl::solve(time);
+    if(solved || mCorridor.empty()) {
+        return solved;
+    }
+    
+    // The corridor may have excluded the only valid path (e.g. a passage which
+    // is blocked in the downsampled map), so the remaining time is used 
+    // to search the complete map. The goal or a map change creates a new corridor.
+    double remaining_time = time - (base::Time::now() - start_t).toSeconds();
+    LOG_WARN("No solution found within the corridor, the complete map will be searched");
+    mCorridor.clear();
+    applyCorridor();
+    if(remaining_time <= 0) {
+        return false;
+    }
+    return Sbpl::solve(remaining_time);
 }
     
 bool SbplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid) {
@@ -278,10 +526,8 @@ bool SbplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined
     std::vector<int>::iterator it = mSBPLWaypointIDs.begin();
     for(; it != mSBPLWaypointIDs.end(); it++) {
         // Fill path with the found solution.
-        boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-                boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
         // Provides grid coordinates, not grid local.
-        env_xytheta->GetCoordFromState(*it, x_discrete, y_discrete, theta_discrete);
+        mpEnvXYTHETA->GetCoordFromState(*it, x_discrete, y_discrete, theta_discrete);
 
         // MotionPlanningLibraries expects grid coordinates, but a real angle in rad,
         // not the discrete one! (0-15), adapts to OMPL angles with (-PI,PI]
@@ -302,16 +548,13 @@ bool SbplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined
         path_ids.push_back(*it);
     }
     
-    boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-        boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
-    
     // Use ConvertStateIDPathintoXYThetaPath to create the path in the local grid frame
     // using the intermediate points. In this case 'pos_defined_in_local_grid' has to be set to true.
     // The intermediate poses already contain start and goal and their orientations
     // are already adapted to (-PI,PI].
     if(mConfig.mNumIntermediatePoints > 0) {         
         // The returned path is already transformed to grid-local.   
-        env_xytheta->ConvertStateIDPathintoXYThetaPath(&path_ids, &path_xytheta);
+        mpEnvXYTHETA->ConvertStateIDPathintoXYThetaPath(&path_ids, &path_xytheta);
         pos_defined_in_local_grid = true;
         
         sbpl_xy_theta_pt_t xyt_m_rad;
@@ -336,7 +579,7 @@ bool SbplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined
     // The prim ids and the speed values are just assigned
     // to the first starting state of each primitive.
     std::vector<EnvNAVXYTHETALATAction_t> action_list;
-    env_xytheta->GetActionsFromStateIDPath(&path_ids, &action_list);
+    mpEnvXYTHETA->GetActionsFromStateIDPath(&path_ids, &action_list);
     std::vector<EnvNAVXYTHETALATAction_t>::iterator it_action = action_list.begin();
     std::vector<struct State>::iterator it_state = path.begin();
     unsigned int prim_id = 0;
@@ -384,20 +627,17 @@ bool SbplEnvXYTHETA::fillPath(std::vector<struct State>& path, bool& pos_defined
 }
 
 enum MplErrors SbplEnvXYTHETA::isStartGoalValid() {
-    boost::shared_ptr<EnvironmentNAVXYTHETAMLEVLAT> env_xytheta =
-        boost::dynamic_pointer_cast<EnvironmentNAVXYTHETAMLEVLAT>(mpSBPLEnv);
-    
     LOG_INFO("Check discrete start (%d, %d, %d) and goal pose (%d, %d, %d) for validity",
             mStartGrid[0], mStartGrid[1], mStartGrid[2], mGoalGrid[0], mGoalGrid[1], mGoalGrid[2]);
         
     int err = (int)MPL_ERR_NONE;
     
-    if(!env_xytheta->IsValidConfiguration(mStartGrid[0], mStartGrid[1], mStartGrid[2])) {
+    if(!mpEnvXYTHETA->IsValidConfiguration(mStartGrid[0], mStartGrid[1], mStartGrid[2])) {
         LOG_WARN("Start lies on an obstacle");
         err += (int)MPL_ERR_START_ON_OBSTACLE;
     }
     
-    if(!env_xytheta->IsValidConfiguration(mGoalGrid[0], mGoalGrid[1], mGoalGrid[2])) {
+    if(!mpEnvXYTHETA->IsValidConfiguration(mGoalGrid[0], mGoalGrid[1], mGoalGrid[2])) {
         LOG_WARN("Goal lies on an obstacle");
         err += (int)MPL_ERR_GOAL_ON_OBSTACLE;
     }
@@ -405,4 +645,301 @@ enum MplErrors SbplEnvXYTHETA::isStartGoalValid() {
     return (enum MplErrors)err;
 }
 
+void SbplEnvXYTHETA::fillStatistics(struct PlanningStatistics& statistics) {
+    Sbpl::fillStatistics(statistics);
+    statistics.mPrimitiveGenerationTime = mPrimitiveGenerationTime;
+}
+
+// PROTECTED
+bool SbplEnvXYTHETA::getStateCell(int state_id, int& x, int& y) {
+    int theta = 0;
+    mpEnvXYTHETA->GetCoordFromState(state_id, x, y, theta);
+    return true;
+}
+
+// PRIVATE
+bool SbplEnvXYTHETA::generateMotionPrimitives(size_t grid_width, size_t grid_height, 
+        double scale) {
+    MotionPrimitivesConfig mprim_config(mConfig, grid_width, grid_height, scale);
+    std::string prims_key = mprim_config.getKey();
+    
+    if(mPrims != NULL && prims_key == mPrimsKey) {
+        LOG_INFO("Configuration of the motion primitives has not changed, reuse them");
+        mPrimitiveGenerationTime = 0.0;
+        return true;
+    }
+    
+    base::Time start_t = base::Time::now();
+    mPrims = boost::shared_ptr<struct SbplMotionPrimitives>(
+            new struct SbplMotionPrimitives(mprim_config));
+    mPrims->createPrimitives();
+    mPrimsKey.clear();
+    if(!SbplEnvironmentNAVXYTHETAMLEVLAT::convertPrimitives(*mPrims, mSBPLPrims)) {
+        LOG_ERROR("Generated motion primitives could not be converted");
+        mPrims.reset();
+        mSBPLPrims.clear();
+        return false;
+    }
+    mPrimsKey = prims_key;
+    mPrimitiveGenerationTime = (base::Time::now() - start_t).toSeconds();
+    LOG_INFO("Motion primitives generated within %4.2f sec", mPrimitiveGenerationTime);
+    
+    if(mConfig.mSBPLMotionPrimitivesCacheDir.empty()) {
+        return true;
+    }
+    
+    // Files within the cache directory are never changed after they have been 
+    // created, so they can be shared by all planners using the same configuration.
+    std::string mprim_file = mConfig.mSBPLMotionPrimitivesCacheDir + 
+            "/sbpl_motion_primitives_" + mprim_config.getHashString() + ".mprim";
+    if(access(mprim_file.c_str(), R_OK) == 0) {
+        return true;
+    }
+    
+    if(mkdir(mConfig.mSBPLMotionPrimitivesCacheDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG_WARN("Motion primitive cache directory %s could not be created", 
+                mConfig.mSBPLMotionPrimitivesCacheDir.c_str());
+        return true;
+    }
+    
+    // Writes to a temporary file first, so no other process reads an incomplete file.
+    // mkstemp() creates a unique name, so concurrent planners of the same process
+    // (e.g. batch workers) do not write to the same temporary file.
+    std::string tmp_file = mprim_file + ".XXXXXX";
+    int fd = mkstemp(&tmp_file[0]);
+    if(fd < 0) {
+        LOG_WARN("Temporary motion primitive file %s could not be created", tmp_file.c_str());
+        return true;
+    }
+    // The cache is shared, mkstemp() only allows the owner to read the file.
+    fchmod(fd, 0644);
+    close(fd);
+    mPrims->storeToFile(tmp_file);
+    if(rename(tmp_file.c_str(), mprim_file.c_str()) != 0) {
+        LOG_WARN("Motion primitive file %s could not be moved to %s", 
+                tmp_file.c_str(), mprim_file.c_str());
+        remove(tmp_file.c_str());
+        return true;
+    }
+    LOG_INFO("Motion primitives have been stored to %s", mprim_file.c_str());
+    return true;
+}
+
+void SbplEnvXYTHETA::resetEnvironment() {
+    clearDeferredCellUpdates();
+    mpSBPLPlanner.reset();
+    mpSBPLEnv.reset();
+    mpEnvXYTHETA.reset();
+    mSBPLEnvKey.clear();
+    mpCoarsePlanner.reset();
+    mpCoarseEnv.reset();
+    mCorridor.clear();
+    mAppliedCorridor.clear();
+    mCorridorOutdated = true;
+    if(mpCostToGoField != NULL) {
+        mpCostToGoField->clear();
+    }
+}
+
+bool SbplEnvXYTHETA::createCoarseEnvironment(TravData const& trav_data) {
+    int factor = mConfig.mSBPLCoarseFactor;
+    mCoarseWidth = (trav_data.shape()[1] + factor - 1) / factor;
+    mCoarseHeight = (trav_data.shape()[0] + factor - 1) / factor;
+    
+    std::vector<unsigned char> coarse_map(mCoarseWidth * mCoarseHeight);
+    for(int y = 0; y < mCoarseHeight; ++y) {
+        for(int x = 0; x < mCoarseWidth; ++x) {
+            coarse_map[y * mCoarseWidth + x] = calculateCoarseCost(trav_data, x, y);
+        }
+    }
+    
+    mpCoarseEnv = boost::shared_ptr<EnvironmentNAV2D>(new EnvironmentNAV2D());
+    try {
+        // Same obstacle threshold as the XYTHETA environment.
+        mpCoarseEnv->InitializeEnv(mCoarseWidth, mCoarseHeight, &coarse_map[0], SBPL_MAX_COST);
+    } catch (SBPL_Exception* e) {
+        LOG_ERROR("Coarse EnvironmentNAV2D could not be created (%s)", e->what());
+        mpCoarseEnv.reset();
+        return false;
+    }
+    
+    // The coarse search is cheap, so only optimal coarse paths are used.
+    mpCoarsePlanner = boost::shared_ptr<SBPLPlanner>(new ARAPlanner(mpCoarseEnv.get(), true));
+    mpCoarsePlanner->set_initialsolution_eps(1.0);
+    mpCoarsePlanner->set_search_mode(true);
+    
+    LOG_INFO("Coarse environment (%d x %d cells, factor %d) has been created", 
+            mCoarseWidth, mCoarseHeight, factor);
+    return true;
+}
+
+unsigned char SbplEnvXYTHETA::calculateCoarseCost(TravData const& trav_data, 
+        int x_coarse, int y_coarse) const {
+    TravClassTable const& table = *mpTravClassTable;
+    int factor = mConfig.mSBPLCoarseFactor;
+    int x_end = std::min((x_coarse + 1) * factor, (int)trav_data.shape()[1]);
+    int y_end = std::min((y_coarse + 1) * factor, (int)trav_data.shape()[0]);
+    
+    unsigned char max_cost = 0;
+    for(int y = y_coarse * factor; y < y_end; ++y) {
+        for(int x = x_coarse * factor; x < x_end; ++x) {
+            max_cost = std::max(max_cost, table.getSbplCost(trav_data[y][x]));
+        }
+    }
+    return max_cost;
+}
+
+void SbplEnvXYTHETA::updateCorridor() {
+    if(mpCoarseEnv == NULL || !mCorridorOutdated) {
+        return;
+    }
+    mCorridorOutdated = false;
+    
+    if(!planCorridor()) {
+        LOG_WARN("No coarse path found, the complete map will be searched");
+        mCorridor.clear();
+    }
+    applyCorridor();
+}
+
+bool SbplEnvXYTHETA::planCorridor() {
+    // Time is only exceeded if the coarse map is huge.
+    const double COARSE_PLANNING_TIME = 1.0;
+    
+    int factor = mConfig.mSBPLCoarseFactor;
+    int start_x = mStartGrid[0] / factor, start_y = mStartGrid[1] / factor;
+    int goal_x = mGoalGrid[0] / factor, goal_y = mGoalGrid[1] / factor;
+    mCorridorGoal = Eigen::Vector2i(goal_x, goal_y);
+    
+    if(mpTravData == NULL) {
+        return false;
+    }
+    int width = mpTravData->shape()[1];
+    int height = mpTravData->shape()[0];
+    if(mStartGrid[0] < 0 || mStartGrid[0] >= width || mStartGrid[1] < 0 || mStartGrid[1] >= height ||
+            mGoalGrid[0] < 0 || mGoalGrid[0] >= width || mGoalGrid[1] < 0 || mGoalGrid[1] >= height) {
+        return false;
+    }
+    
+    // The worst cost may block the coarse cells of start and goal (e.g. close
+    // to a wall), so the costs of the start and goal cell are used during the planning.
+    TravClassTable const& table = *mpTravClassTable;
+    unsigned char start_cost = mpCoarseEnv->GetMapCost(start_x, start_y);
+    unsigned char goal_cost = mpCoarseEnv->GetMapCost(goal_x, goal_y);
+    mpCoarseEnv->UpdateCost(start_x, start_y, 
+            table.getSbplCost((*mpTravData)[mStartGrid[1]][mStartGrid[0]]));
+    mpCoarseEnv->UpdateCost(goal_x, goal_y, 
+            table.getSbplCost((*mpTravData)[mGoalGrid[1]][mGoalGrid[0]]));
+    
+    std::vector<int> state_ids;
+    int solution_cost = 0;
+    bool solved = false;
+    try {
+        int start_id = mpCoarseEnv->SetStart(start_x, start_y);
+        int goal_id = mpCoarseEnv->SetGoal(goal_x, goal_y);
+        if(start_id >= 0 && goal_id >= 0 &&
+                mpCoarsePlanner->set_start(start_id) && mpCoarsePlanner->set_goal(goal_id)) {
+            mpCoarsePlanner->force_planning_from_scratch();
+            solved = mpCoarsePlanner->replan(COARSE_PLANNING_TIME, &state_ids, &solution_cost);
+        }
+    } catch (...) {
+        LOG_ERROR("Coarse planning failed");
+        solved = false;
+    }
+    
+    mpCoarseEnv->UpdateCost(goal_x, goal_y, goal_cost);
+    mpCoarseEnv->UpdateCost(start_x, start_y, start_cost);
+    
+    if(!solved || state_ids.empty()) {
+        return false;
+    }
+    
+    // Marks all coarse cells within the corridor width around the path.
+    int radius = (int)std::ceil(mConfig.mSBPLCorridorWidth / (factor * mSBPLScaleX));
+    mCorridor.assign(mCoarseWidth * mCoarseHeight, 0);
+    int x = 0, y = 0;
+    std::vector<int>::iterator it = state_ids.begin();
+    for(; it != state_ids.end(); ++it) {
+        mpCoarseEnv->GetCoordFromState(*it, x, y);
+        for(int yc = std::max(0, y - radius); yc <= std::min(mCoarseHeight - 1, y + radius); ++yc) {
+            for(int xc = std::max(0, x - radius); xc <= std::min(mCoarseWidth - 1, x + radius); ++xc) {
+                mCorridor[yc * mCoarseWidth + xc] = 1;
+            }
+        }
+    }
+    LOG_INFO("Coarse path contains %zu cells, the corridor uses a radius of %d coarse cells", 
+            state_ids.size(), radius);
+    return true;
+}
+
+void SbplEnvXYTHETA::applyCorridor() {
+    if(mpEnvXYTHETA == NULL || mpTravData == NULL) {
+        return;
+    }
+    
+    TravClassTable const& table = *mpTravClassTable;
+    TravData const& trav_data = *mpTravData;
+    int width = trav_data.shape()[1];
+    int height = trav_data.shape()[0];
+    int factor = mConfig.mSBPLCoarseFactor;
+    int num_changed = 0;
+    for(int y_coarse = 0; y_coarse < mCoarseHeight; ++y_coarse) {
+        for(int x_coarse = 0; x_coarse < mCoarseWidth; ++x_coarse) {
+            int i = y_coarse * mCoarseWidth + x_coarse;
+            bool within = mCorridor.empty() || mCorridor[i] != 0;
+            bool within_applied = mAppliedCorridor.empty() || mAppliedCorridor[i] != 0;
+            if(within == within_applied) {
+                continue;
+            }
+            int x_end = std::min((x_coarse + 1) * factor, width);
+            int y_end = std::min((y_coarse + 1) * factor, height);
+            for(int y = y_coarse * factor; y < y_end; ++y) {
+                for(int x = x_coarse * factor; x < x_end; ++x) {
+                    unsigned char cost = within ? 
+                            table.getSbplCost(trav_data[y][x]) : SBPL_MAX_COST + 1;
+                    if(mpEnvXYTHETA->GetMapCost(x, y) != cost) {
+                        mpEnvXYTHETA->UpdateCost(x, y, cost);
+                        num_changed++;
+                    }
+                }
+            }
+        }
+    }
+    mAppliedCorridor = mCorridor;
+    
+    // The blocked cells change the edges of many states, a repair of the search is not worth it.
+    if(num_changed > 0 && mpSBPLPlanner != NULL) {
+        mpSBPLPlanner->force_planning_from_scratch();
+    }
+    LOG_INFO("Corridor has been applied, %d cells have been changed", num_changed);
+}
+
+void SbplEnvXYTHETA::getCostToGoClassCosts(std::vector<double>& class_costs) const {
+    class_costs.assign(CostToGoField::NUM_CLASSES, std::numeric_limits<double>::max());
+    double cellsize_mm = mSBPLScaleX * 1000.0;
+    for(unsigned int i = 0; i < CostToGoField::NUM_CLASSES; ++i) {
+        unsigned char cost = mpTravClassTable->getSbplCost(i);
+        // Same obstacle threshold as the environment.
+        if(cost < SBPL_MAX_COST) {
+            class_costs[i] = (cost + 1) * cellsize_mm;
+        }
+    }
+}
+
+void SbplEnvXYTHETA::updateCostToGoField(int goal_x, int goal_y) {
+    if(mpCostToGoField->hasGoal(goal_x, goal_y)) {
+        LOG_DEBUG("Goal cell has not changed, cost-to-go field is reused");
+        return;
+    }
+    std::vector<double> class_costs;
+    getCostToGoClassCosts(class_costs);
+    base::Time start_t = base::Time::now();
+    if(!mpCostToGoField->create(*mpTravData, class_costs, goal_x, goal_y)) {
+        LOG_WARN("Cost-to-go field could not be created, the heuristic of SBPL is used");
+        return;
+    }
+    LOG_INFO("Cost-to-go field created within %4.2f sec", 
+            (base::Time::now() - start_t).toSeconds());
+}
+
 } // namespace motion_planning_libraries
@@ -6,6 +6,8 @@
 
 namespace motion_planning_libraries
 {
+
+class SbplEnvironmentNAVXYTHETAMLEVLAT;
     
 class SbplEnvXYTHETA : public Sbpl
 {          
@@ -13,7 +15,29 @@ class SbplEnvXYTHETA : public Sbpl
     // Required to set start/goal in ENV_XYTHETA 
     // (grid coordinates have to be converted back to meters) 
     double mSBPLScaleX, mSBPLScaleY; 
-    struct SbplMotionPrimitives* mPrims;
+    // Generated primitives, reused by the following initializations 
+    // as long as the key of their configuration does not change.
+    boost::shared_ptr<struct SbplMotionPrimitives> mPrims;
+    std::string mPrimsKey;
+    // mPrims converted to the SBPL structure, passed to the environment without a mprim file.
+    std::vector<SBPL_xytheta_mprimitive> mSBPLPrims;
+    // Time in sec of the last generation, 0 if the primitives have been reused.
+    double mPrimitiveGenerationTime;
+    // Typed mpSBPLEnv, set together with it by initialize() so the
+    // environment has not to be casted on each access.
+    boost::shared_ptr<SbplEnvironmentNAVXYTHETAMLEVLAT> mpEnvXYTHETA;
+    // Coarse-to-fine planning (Config::mSBPLCoarseFactor > 1): 2D environment and 
+    // planner on the downsampled grid and the coarse cells of the corridor.
+    boost::shared_ptr<EnvironmentNAV2D> mpCoarseEnv;
+    boost::shared_ptr<SBPLPlanner> mpCoarsePlanner;
+    int mCoarseWidth, mCoarseHeight;
+    // Flag for each coarse cell, empty if the search is not restricted.
+    std::vector<unsigned char> mCorridor;
+    // Corridor the costs of the environment belong to, empty if no cell is blocked.
+    std::vector<unsigned char> mAppliedCorridor;
+    // Set if the goal or the coarse map have changed or the start has left the corridor.
+    bool mCorridorOutdated;
+    Eigen::Vector2i mCorridorGoal;
     // Used to store the local goal pose (x,y,theta) to add it to the end of the 
     // found intermediate path (last pose is not supported).
     base::Vector3d mGoalLocal;
@@ -29,6 +53,15 @@ class SbplEnvXYTHETA : public Sbpl
     
     virtual bool partialMapUpdate(std::vector<CellUpdate>& cell_updates);
     
+    /**
+     * Shifts the costs within the environment, the corridor and the 
+     * cost-to-go field are recreated. The planner plans from scratch.
+     * If a cell cannot be applied after the environment has been shifted, 
+     * the environment is reset and false is returned, so the caller's 
+     * unshifted partial update fails as well and initialize() is used.
+     */
+    virtual bool shiftMap(int shift_x, int shift_y, std::vector<CellUpdate>& cell_updates);
+    
     /**
      * 
      */
@@ -44,10 +77,84 @@ class SbplEnvXYTHETA : public Sbpl
     virtual bool fillPath(std::vector<struct State>& path, bool& pos_defined_in_local_grid);
     
     inline struct SbplMotionPrimitives* getMotionPrimitives() {
-        return mPrims;
+        return mPrims.get();
     }
     
     enum MplErrors isStartGoalValid();
+    
+    /**
+     * Adds the primitive generation time of the last initialization.
+     */
+    virtual void fillStatistics(struct PlanningStatistics& statistics);
+    
+ protected:
+    virtual bool getStateCell(int state_id, int& x, int& y);
+    
+ private:
+    /**
+     * Generates and converts the primitives if their configuration has changed.
+     * If a cache directory is configured the primitives are stored there 
+     * as a mprim file (e.g. to inspect or to load them with other tools).
+     */
+    bool generateMotionPrimitives(size_t grid_width, size_t grid_height, double scale);
+    
+    /**
+     * Drops environment and planner, so the next map is applied by a complete
+     * initialize() (partialMapUpdate() fails until then).
+     */
+    void resetEnvironment();
+    
+    /**
+     * Creates the downsampled map, its 2D environment and planner.
+     */
+    bool createCoarseEnvironment(TravData const& trav_data);
+    
+    /**
+     * Worst SBPL cost of the cells which are covered by the coarse cell.
+     */
+    unsigned char calculateCoarseCost(TravData const& trav_data, int x_coarse, int y_coarse) const;
+    
+    inline bool isWithinCorridor(int x, int y) const {
+        if(mCorridor.empty()) {
+            return true;
+        }
+        int factor = mConfig.mSBPLCoarseFactor;
+        if(x < 0 || x >= mCoarseWidth * factor || y < 0 || y >= mCoarseHeight * factor) {
+            return false;
+        }
+        return mCorridor[(y / factor) * mCoarseWidth + x / factor] != 0;
+    }
+    
+    /**
+     * Plans the coarse path from the current start to the current goal 
+     * and applies the corridor if the corridor is outdated. 
+     */
+    void updateCorridor();
+    
+    /**
+     * Plans the 2D path on the downsampled map and marks the coarse cells 
+     * within Config::mSBPLCorridorWidth. Returns false (empty corridor)
+     * if no coarse path could be found.
+     */
+    bool planCorridor();
+    
+    /**
+     * Blocks the cells which have left the corridor since the last call and
+     * restores the cells which have entered it, the other cells are not touched.
+     * The planner has to plan from scratch if a cell has been changed.
+     */
+    void applyCorridor();
+    
+    /**
+     * Cost of each class for the cost-to-go field, uses the units of the 
+     * 2D heuristic search of SBPL: (cost + 1) * cell size in mm.
+     */
+    void getCostToGoClassCosts(std::vector<double>& class_costs) const;
+    
+    /**
+     * Creates the cost-to-go field if it does not belong to the passed goal cell.
+     */
+    void updateCostToGoField(int goal_x, int goal_y);
 };
     
 } // end namespace motion_planning_libraries
@@ -0,0 +1,161 @@
+#include "SbplEnvironmentNAVXYTHETAMLEVLAT.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string.h>
+
+#include <base-logging/Logging.hpp>
+
+namespace motion_planning_libraries
+{
+
+SbplEnvironmentNAVXYTHETAMLEVLAT::SbplEnvironmentNAVXYTHETAMLEVLAT() :
+        EnvironmentNAVXYTHETAMLEVLAT(), mpCostToGoField() {
+}
+
+bool SbplEnvironmentNAVXYTHETAMLEVLAT::InitializeEnvWithPrimitives(int width, int height,
+        const unsigned char* mapdata,
+        const std::vector<sbpl_2Dpt_t>& perimeterptsV,
+        double cellsize_m,
+        double nominalvel_mpersecs,
+        double timetoturn45degsinplace_secs,
+        unsigned char obsthresh,
+        const std::vector<SBPL_xytheta_mprimitive>& mprims) {
+
+    if(mprims.empty()) {
+        LOG_ERROR("No motion primitives have been passed");
+        return false;
+    }
+
+    // Without a mprim file InitializeEnv() uses the primitives which
+    // are already stored within the environment configuration.
+    EnvNAVXYTHETALATCfg.mprimV = mprims;
+    return InitializeEnv(width, height, mapdata,
+            0,0,0, // start x,y,theta, set later on
+            0,0,0, // goal x,y,theta, set later on
+            0.1, 0.1, 0.1, // tolerance x,y,yaw, ignored
+            perimeterptsV,
+            cellsize_m,
+            nominalvel_mpersecs,
+            timetoturn45degsinplace_secs,
+            obsthresh,
+            NULL); // no motion primitives file
+}
+
+int SbplEnvironmentNAVXYTHETAMLEVLAT::GetGoalHeuristic(int stateID) {
+    if(!useCostToGoField()) {
+        return EnvironmentNAVXYTHETAMLEVLAT::GetGoalHeuristic(stateID);
+    }
+
+    EnvNAVXYTHETALATHashEntry_t* entry = StateID2CoordTable[stateID];
+    double h2D = mpCostToGoField->getCost(entry->X, entry->Y);
+    double h_euclid = NAVXYTHETALAT_COSTMULT_MTOMM * EuclideanDistance_m(entry->X, entry->Y,
+            EnvNAVXYTHETALATCfg.EndX_c, EnvNAVXYTHETALATCfg.EndY_c);
+    // Same value as the 2D search of SBPL for cells which cannot reach the goal.
+    if(!std::isfinite(h2D)) {
+        h2D = INFINITECOST;
+    }
+    return (int)(std::max(h2D, h_euclid) / EnvNAVXYTHETALATCfg.nominalvel_mpersecs);
+}
+
+void SbplEnvironmentNAVXYTHETAMLEVLAT::EnsureHeuristicsUpdated(bool bGoalHeuristics) {
+    // The recompute flag of SBPL is kept, so its own search is executed
+    // as soon as the field is not used anymore.
+    if(bGoalHeuristics && useCostToGoField()) {
+        return;
+    }
+    EnvironmentNAVXYTHETAMLEVLAT::EnsureHeuristicsUpdated(bGoalHeuristics);
+}
+
+bool SbplEnvironmentNAVXYTHETAMLEVLAT::shiftMap(int shift_x, int shift_y) {
+    if(numofadditionalzlevs > 0) {
+        LOG_WARN("Map shift is not supported for additional levels");
+        return false;
+    }
+
+    int width = EnvNAVXYTHETALATCfg.EnvWidth_c;
+    int height = EnvNAVXYTHETALATCfg.EnvHeight_c;
+    unsigned char** grid = EnvNAVXYTHETALATCfg.Grid2D;
+
+    // Grid2D[x] is a column of the map, new column x is the old column x + shift_x.
+    int rotation = ((shift_x % width) + width) % width;
+    std::rotate(grid, grid + rotation, grid + width);
+
+    if(shift_y != 0 && std::abs(shift_y) < height) {
+        for(int x = 0; x < width; ++x) {
+            if(shift_y > 0) {
+                memmove(grid[x], grid[x] + shift_y, height - shift_y);
+            } else {
+                memmove(grid[x] - shift_y, grid[x], height + shift_y);
+            }
+        }
+    }
+
+    bNeedtoRecomputeStartHeuristics = true;
+    bNeedtoRecomputeGoalHeuristics = true;
+    return true;
+}
+
+bool SbplEnvironmentNAVXYTHETAMLEVLAT::convertPrimitives(SbplMotionPrimitives const& prims,
+        std::vector<SBPL_xytheta_mprimitive>& mprims) {
+
+    if((int)prims.mConfig.mNumAngles != SBPL_NUM_ANGLES) {
+        LOG_ERROR("SBPL requires %d discrete angles, primitives use %d",
+                SBPL_NUM_ANGLES, prims.mConfig.mNumAngles);
+        return false;
+    }
+
+    mprims.clear();
+    mprims.reserve(prims.getNumTablePrimitives());
+
+    for(unsigned int i=0; i < prims.getNumTablePrimitives(); ++i) {
+        SBPL_xytheta_mprimitive mprim = SBPL_xytheta_mprimitive();
+        mprim.motprimID = prims.mTableIds[i];
+        mprim.starttheta_c = prims.mTableStartAngles[i];
+        mprim.additionalactioncostmult = prims.mTableCostMultipliers[i];
+        mprim.endcell.x = prims.mTableEndDeltas[3*i];
+        mprim.endcell.y = prims.mTableEndDeltas[3*i+1];
+        mprim.endcell.theta = NORMALIZEDISCTHETA(prims.mTableEndDeltas[3*i+2], SBPL_NUM_ANGLES);
+
+        unsigned int num_poses = 0;
+        const double* poses = prims.getTablePoses(i, num_poses);
+        mprim.intermptV.resize(num_poses);
+        for(unsigned int p=0; p < num_poses; ++p) {
+            mprim.intermptV[p].x = poses[3*p];
+            mprim.intermptV[p].y = poses[3*p+1];
+            mprim.intermptV[p].theta = poses[3*p+2];
+        }
+
+        if(!checkEndPose(mprim, prims.mConfig.mGridSize)) {
+            return false;
+        }
+        mprims.push_back(mprim);
+    }
+    return true;
+}
+
+// PRIVATE
+bool SbplEnvironmentNAVXYTHETAMLEVLAT::checkEndPose(SBPL_xytheta_mprimitive const& mprim,
+        double cellsize_m) {
+    if(mprim.intermptV.empty()) {
+        LOG_ERROR("Primitive %d of angle %d does not contain any poses",
+                mprim.motprimID, (int)mprim.starttheta_c);
+        return false;
+    }
+
+    sbpl_xy_theta_pt_t const& end_pose = mprim.intermptV.back();
+    int end_x = CONTXY2DISC(DISCXY2CONT(0, cellsize_m) + end_pose.x, cellsize_m);
+    int end_y = CONTXY2DISC(DISCXY2CONT(0, cellsize_m) + end_pose.y, cellsize_m);
+    int end_theta = ContTheta2Disc(end_pose.theta, SBPL_NUM_ANGLES);
+
+    if(end_x != mprim.endcell.x || end_y != mprim.endcell.y || end_theta != mprim.endcell.theta) {
+        LOG_ERROR("Primitive %d of angle %d ends in (%d,%d,%d) instead of (%d,%d,%d)",
+                mprim.motprimID, (int)mprim.starttheta_c, end_x, end_y, end_theta,
+                mprim.endcell.x, mprim.endcell.y, mprim.endcell.theta);
+        return false;
+    }
+    return true;
+}
+
+} // end namespace motion_planning_libraries
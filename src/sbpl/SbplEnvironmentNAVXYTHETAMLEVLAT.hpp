@@ -0,0 +1,99 @@
+#ifndef _MOTION_PLANNING_LIBRARIES_SBPL_ENVIRONMENT_NAVXYTHETAMLEVLAT_HPP_
+#define _MOTION_PLANNING_LIBRARIES_SBPL_ENVIRONMENT_NAVXYTHETAMLEVLAT_HPP_
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <sbpl/utils/utils.h>
+#include <sbpl/config.h>
+#include <sbpl/discrete_space_information/environment_navxythetamlevlat.h>
+
+#include "SbplMotionPrimitives.hpp"
+#include <motion_planning_libraries/CostToGoField.hpp>
+
+namespace motion_planning_libraries
+{
+
+/**
+ * Extends the SBPL XYTHETA environment to receive the motion primitives
+ * directly instead of reading them from a mprim file. So no file has to be
+ * written and parsed during the initialization and several planners
+ * within one process do not share a primitive file anymore.
+ * In addition an external cost-to-go field can be used as goal heuristic
+ * instead of the 2D search SBPL runs after each goal or map change.
+ */
+class SbplEnvironmentNAVXYTHETAMLEVLAT : public EnvironmentNAVXYTHETAMLEVLAT
+{
+ public:
+    // Number of discrete angles used by the SBPL XYTHETA environment.
+    static const int SBPL_NUM_ANGLES = 16;
+
+    SbplEnvironmentNAVXYTHETAMLEVLAT();
+
+    /**
+     * Same as EnvironmentNAVXYTHETALAT::InitializeEnv() without start, goal and
+     * tolerances, but uses the passed primitives instead of a mprim file.
+     * Throws an SBPL_Exception like InitializeEnv() if the initialization fails.
+     */
+    bool InitializeEnvWithPrimitives(int width, int height,
+            const unsigned char* mapdata,
+            const std::vector<sbpl_2Dpt_t>& perimeterptsV,
+            double cellsize_m,
+            double nominalvel_mpersecs,
+            double timetoturn45degsinplace_secs,
+            unsigned char obsthresh,
+            const std::vector<SBPL_xytheta_mprimitive>& mprims);
+
+    /**
+     * Converts the flat primitive table of SbplMotionPrimitives to the SBPL primitive structure.
+     * Returns false if a primitive does not end within its discrete end pose
+     * (the same check is done by SBPL while reading a mprim file).
+     */
+    static bool convertPrimitives(SbplMotionPrimitives const& prims,
+            std::vector<SBPL_xytheta_mprimitive>& mprims);
+
+    /**
+     * The field has to use the SBPL costs in mm (see SBPL2DGridSearch) and 
+     * is only used while its goal matches the goal of the environment.
+     * An empty pointer restores the heuristic of SBPL.
+     */
+    inline void setCostToGoField(boost::shared_ptr<CostToGoField const> field) {
+        mpCostToGoField = field;
+    }
+
+    /**
+     * Same as EnvironmentNAVXYTHETALAT::GetGoalHeuristic() but uses
+     * the cost-to-go field as 2D lower bound if available.
+     */
+    virtual int GetGoalHeuristic(int stateID);
+
+    /**
+     * Skips the 2D search from the goal if the cost-to-go field is used.
+     */
+    virtual void EnsureHeuristicsUpdated(bool bGoalHeuristics);
+
+    /**
+     * Shifts the costs of the map in place, the new cell (x, y) gets the cost
+     * of the cell (x + shift_x, y + shift_y). The columns of the grid are rotated
+     * and each column is moved, so no memory is allocated. The costs of 
+     * the newly exposed cells are undefined and have to be set using UpdateCost().
+     * The states keep their grid coordinates, so the planner has to plan from scratch.
+     * Returns false if additional levels are used.
+     */
+    bool shiftMap(int shift_x, int shift_y);
+
+ private:
+    boost::shared_ptr<CostToGoField const> mpCostToGoField;
+
+    inline bool useCostToGoField() const {
+        return mpCostToGoField != NULL && mpCostToGoField->hasGoal(
+                EnvNAVXYTHETALATCfg.EndX_c, EnvNAVXYTHETALATCfg.EndY_c);
+    }
+
+    static bool checkEndPose(SBPL_xytheta_mprimitive const& mprim, double cellsize_m);
+};
+
+} // end namespace motion_planning_libraries
+
+#endif // _MOTION_PLANNING_LIBRARIES_SBPL_ENVIRONMENT_NAVXYTHETAMLEVLAT_HPP_
@@ -1,16 +1,21 @@
 #include "SbplMotionPrimitives.hpp"
 #include <base-logging/Logging.hpp>
+#include <cstdlib>
 #include <set>
 
 namespace motion_planning_libraries {
 
 SbplMotionPrimitives::SbplMotionPrimitives() : mConfig(), mListPrimitivesAngle0(),
-        mListPrimitives(), mRadPerDiscreteAngle(0), mPrimIDInfos()
+        mListPrimitives(), mRadPerDiscreteAngle(0), mPrimIDInfos(),
+        mTableIds(), mTableStartAngles(), mTableCostMultipliers(), mTableEndDeltas(),
+        mTablePoseOffsets(), mTablePoses(), mIdSpeeds(), mIdMovTypes()
 {
 }
     
 SbplMotionPrimitives::SbplMotionPrimitives(struct MotionPrimitivesConfig config) : mConfig(config),
-        mListPrimitivesAngle0(), mListPrimitives(), mRadPerDiscreteAngle(0), mPrimIDInfos()
+        mListPrimitivesAngle0(), mListPrimitives(), mRadPerDiscreteAngle(0), mPrimIDInfos(),
+        mTableIds(), mTableStartAngles(), mTableCostMultipliers(), mTableEndDeltas(),
+        mTablePoseOffsets(), mTablePoses(), mIdSpeeds(), mIdMovTypes()
 {
     mRadPerDiscreteAngle = (M_PI*2.0) / (double)mConfig.mNumAngles;
 }
@@ -28,8 +33,27 @@ void SbplMotionPrimitives::createPrimitives() {
     }
     
     std::vector<struct Primitive> prim_angle_0 = createMPrimsForAngle0();
-    createMPrims(prim_angle_0); // Stores to global prim list mListPrimitives as well.
-    createIntermediatePoses(mListPrimitives); // Adds intermediate poses.
+    
+    bool symmetric = false;
+    if(mConfig.mUseSymmetry) {
+        if(mConfig.mNumAngles % 8 != 0) {
+            LOG_WARN("Symmetric primitives require a multiple of 8 discrete angles, %d are used", 
+                    mConfig.mNumAngles);
+        } else {
+            createMPrims(prim_angle_0, mConfig.mNumAngles / 8 + 1);
+            createIntermediatePoses(mListPrimitives);
+            symmetric = createSymmetricPrimitives(prim_angle_0);
+            if(!symmetric) {
+                LOG_WARN("Primitives are not symmetric, all start angles are generated");
+            }
+        }
+    }
+    
+    if(!symmetric) {
+        createMPrims(prim_angle_0); // Stores to global prim list mListPrimitives as well.
+        createIntermediatePoses(mListPrimitives); // Adds intermediate poses.
+    }
+    createPrimitiveTable();
 }
 
 std::vector<struct Primitive> SbplMotionPrimitives::createMPrimsForAngle0() { 
@@ -205,7 +229,8 @@ std::vector<struct Primitive> SbplMotionPrimitives::createMPrimsForAngle0() {
     return mListPrimitivesAngle0;
 }
 
-std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<struct Primitive> prims_angle_0) {
+std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<struct Primitive> prims_angle_0,
+        unsigned int num_start_angles) {
 
     // Creates discrete end poses for all angles.
     mListPrimitives.clear();
@@ -217,16 +242,33 @@ std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<str
     double increase_value_grids = 0.1;
     
     assert(mConfig.mNumAngles != 0);
+    if(num_start_angles == 0 || num_start_angles > mConfig.mNumAngles) {
+        num_start_angles = mConfig.mNumAngles;
+    }
     
     std::stringstream ss;
     
     mPrimIDInfos.clear();
     
+    // Rotations by a multiple of the discrete angle used by the curves,
+    // index k + mNumAngles rotates by k discrete angles.
+    std::vector<Eigen::Matrix3d> discrete_rotations(2 * mConfig.mNumAngles + 1);
+    for(int k = -(int)mConfig.mNumAngles; k <= (int)mConfig.mNumAngles; ++k) {
+        discrete_rotations[k + mConfig.mNumAngles] = Eigen::AngleAxis<double>(
+                k * mRadPerDiscreteAngle, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+    }
+    
     // Runs through all discrete angles (default 16) and created mNumPrimPartition
     // primitives for each primitive in prims_angle_0.
-    for(unsigned int angle=0; angle < mConfig.mNumAngles; ++angle) {
+    for(unsigned int angle=0; angle < num_start_angles; ++angle) {
         std::vector< struct Primitive >::iterator it = prims_angle_0.begin();
         
+        // The rotations of the current angle are the same for all primitives.
+        Eigen::Matrix3d rotation_angle = Eigen::AngleAxis<double>(angle * mRadPerDiscreteAngle, 
+                Eigen::Vector3d::UnitZ()).toRotationMatrix();
+        Eigen::Matrix3d rotation_angle_back = Eigen::AngleAxis<double>(-angle * mRadPerDiscreteAngle, 
+                Eigen::Vector3d::UnitZ()).toRotationMatrix();
+        
         // Runs through all endposes in grid-local which have been defined for angle 0.
         int prims_added_for_this_angle = 0;
         int prims_added_for_this_angle_last = 0;
@@ -238,12 +280,10 @@ std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<str
             turned_end_position = it->mEndPose;
             theta_tmp = turned_end_position[2];
             turned_end_position[2] = 0;
-            turned_end_position = Eigen::AngleAxis<double>(angle * mRadPerDiscreteAngle, 
-                    Eigen::Vector3d::UnitZ()) * turned_end_position;
+            turned_end_position = rotation_angle * turned_end_position;
             
             // Turn center of rotation vector as well
-            turned_center_of_rotation = Eigen::AngleAxis<double>(angle * mRadPerDiscreteAngle, 
-                    Eigen::Vector3d::UnitZ()) * it->mCenterOfRotation;
+            turned_center_of_rotation = rotation_angle * it->mCenterOfRotation;
                     
             base::Vector3d discrete_end_pose;
             base::Vector3d discrete_end_pose_rounded;
@@ -295,7 +335,12 @@ std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<str
                         
                         ss << "Scaled center of rotation " << scaled_center_of_rotation.transpose() << std::endl;
                         discrete_end_pose -= scaled_center_of_rotation;
-                        discrete_end_pose = Eigen::AngleAxis<double>(angle_rad, Eigen::Vector3d::UnitZ()) * discrete_end_pose;
+                        int turn_steps = current_discrete_angle * theta_tmp;
+                        if(abs(turn_steps) <= (int)mConfig.mNumAngles) {
+                            discrete_end_pose = discrete_rotations[turn_steps + mConfig.mNumAngles] * discrete_end_pose;
+                        } else {
+                            discrete_end_pose = Eigen::AngleAxis<double>(angle_rad, Eigen::Vector3d::UnitZ()) * discrete_end_pose;
+                        }
                         discrete_end_pose += scaled_center_of_rotation;
                         ss << "Discrete end pose " << discrete_end_pose.transpose() << std::endl;
                          // Discrete orientation can be < 0 and > mNumAngles. Will be stored for intermediate point calculation.
@@ -330,8 +375,7 @@ std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<str
                 // to be on the same side like the center of rotation and greater 0.
                 base::Vector3d discrete_pose_rotate_back;
                 discrete_pose_rotate_back.setZero();
-                discrete_pose_rotate_back = Eigen::AngleAxis<double>(-angle * mRadPerDiscreteAngle, 
-                        Eigen::Vector3d::UnitZ()) * discrete_end_pose_rounded;
+                discrete_pose_rotate_back = rotation_angle_back * discrete_end_pose_rounded;
                         
                 // Checks.
                 // Checks if a primitive became too long. This check is necessary, because  
@@ -410,6 +454,7 @@ std::vector<struct Primitive> SbplMotionPrimitives::createMPrims(std::vector<str
                     prim_discrete.setDiscreteEndOrientation(discrete_angle, mConfig.mNumAngles);
                     // Applies the discretization difference to the center of rotation.
                     prim_discrete.mCenterOfRotation = scaled_center_of_rotation;// + diff_end_to_rounded;
+                    prim_discrete.mBaseId = it - prims_angle_0.begin();
                     mListPrimitives.push_back(prim_discrete);
                     prims_added++;
                     prims_added_for_this_angle++;
@@ -601,29 +646,206 @@ void SbplMotionPrimitives::createIntermediatePoses(std::vector<struct Primitive>
     LOG_DEBUG("%s", ss.str().c_str());
 }
 
+namespace {
+// Truncates to (-PI,PI] like the intermediate poses.
+double normalizeYaw(double yaw) {
+    while(yaw <= -M_PI)
+        yaw += 2*M_PI;
+    while(yaw > M_PI)
+        yaw -= 2*M_PI;
+    return yaw;
+}
+
+// Rotates a discrete primitive by num_quarters * 90 degree around the start pose.
+Primitive rotatePrimitive(Primitive const& prim, unsigned int num_quarters, unsigned int num_angles) {
+    Primitive rotated = prim;
+    int quarter_angles = num_angles / 4;
+    for(unsigned int q=0; q < num_quarters; ++q) {
+        rotated.mEndPose = base::Vector3d(-rotated.mEndPose[1], rotated.mEndPose[0], rotated.mEndPose[2]);
+        rotated.mCenterOfRotation = base::Vector3d(-rotated.mCenterOfRotation[1], 
+                rotated.mCenterOfRotation[0], rotated.mCenterOfRotation[2]);
+        for(unsigned int i=0; i < rotated.mIntermediatePoses.size(); ++i) {
+            base::Vector3d& pose = rotated.mIntermediatePoses[i];
+            pose = base::Vector3d(-pose[1], pose[0], normalizeYaw(pose[2] + M_PI/2.0));
+        }
+    }
+    rotated.mStartAngle = prim.mStartAngle + num_quarters * quarter_angles;
+    rotated.setDiscreteEndOrientation(prim.mDiscreteEndOrientationNotTruncated + 
+            num_quarters * quarter_angles, num_angles);
+    return rotated;
+}
+
+// Reflects a discrete primitive at the diagonal x = y (start angle a becomes 
+// num_angles/4 - a), e.g. left curves become right curves.
+Primitive reflectPrimitive(Primitive const& prim, unsigned int num_angles) {
+    Primitive reflected = prim;
+    int quarter_angles = num_angles / 4;
+    reflected.mEndPose = base::Vector3d(prim.mEndPose[1], prim.mEndPose[0], prim.mEndPose[2]);
+    reflected.mCenterOfRotation = base::Vector3d(prim.mCenterOfRotation[1], 
+            prim.mCenterOfRotation[0], prim.mCenterOfRotation[2]);
+    for(unsigned int i=0; i < reflected.mIntermediatePoses.size(); ++i) {
+        base::Vector3d& pose = reflected.mIntermediatePoses[i];
+        pose = base::Vector3d(pose[1], pose[0], normalizeYaw(M_PI/2.0 - pose[2]));
+    }
+    reflected.mStartAngle = quarter_angles - prim.mStartAngle;
+    reflected.setDiscreteEndOrientation(quarter_angles - prim.mDiscreteEndOrientationNotTruncated, 
+            num_angles);
+    return reflected;
+}
+}
+
+bool SbplMotionPrimitives::createSymmetricPrimitives(std::vector<struct Primitive> const& prims_angle_0) {
+    unsigned int quarter_angles = mConfig.mNumAngles / 4;
+    unsigned int octant_angles = mConfig.mNumAngles / 8;
+    unsigned int num_bases = prims_angle_0.size();
+    
+    // Finds the primitive mirrored at the x-axis for each angle 0 primitive.
+    std::vector<int> mirrored_bases(num_bases, -1);
+    for(unsigned int b=0; b < num_bases; ++b) {
+        Primitive const& base = prims_angle_0[b];
+        base::Vector3d mirrored_end(base.mEndPose[0], -base.mEndPose[1], -base.mEndPose[2]);
+        base::Vector3d mirrored_cor(base.mCenterOfRotation[0], -base.mCenterOfRotation[1], 
+                base.mCenterOfRotation[2]);
+        for(unsigned int m=0; m < num_bases; ++m) {
+            Primitive const& other = prims_angle_0[m];
+            if(other.mMovType == base.mMovType && other.mSpeed == base.mSpeed &&
+                    other.mCostMultiplier == base.mCostMultiplier &&
+                    other.mEndPose == mirrored_end && other.mCenterOfRotation == mirrored_cor) {
+                mirrored_bases[b] = m;
+                break;
+            }
+        }
+        if(mirrored_bases[b] < 0) {
+            LOG_WARN("No mirrored primitive for primitive %d", b);
+            return false;
+        }
+    }
+    
+    // Sorts the primitives of each generated angle by (base id, sub-primitive).
+    // The ids of angle 0 define the order of all angles.
+    std::vector< std::vector< std::vector<unsigned int> > > prims_by_base(octant_angles + 1, 
+            std::vector< std::vector<unsigned int> >(num_bases));
+    for(unsigned int i=0; i < mListPrimitives.size(); ++i) {
+        Primitive const& prim = mListPrimitives[i];
+        if(prim.mStartAngle > octant_angles || prim.mBaseId >= num_bases) {
+            return false;
+        }
+        prims_by_base[prim.mStartAngle][prim.mBaseId].push_back(i);
+    }
+    for(unsigned int angle=0; angle <= octant_angles; ++angle) {
+        for(unsigned int b=0; b < num_bases; ++b) {
+            std::vector<unsigned int> const& prims = prims_by_base[angle][b];
+            if(prims.size() != prims_by_base[0][b].size() || 
+                    prims.size() != prims_by_base[angle][mirrored_bases[b]].size()) {
+                LOG_WARN("Different number of primitives for primitive %d within angle %d", b, angle);
+                return false;
+            }
+            for(unsigned int j=0; j < prims.size(); ++j) {
+                if(mListPrimitives[prims[j]].mId != mListPrimitives[prims_by_base[0][b][j]].mId) {
+                    LOG_WARN("Different primitive ids for primitive %d within angle %d", b, angle);
+                    return false;
+                }
+            }
+        }
+    }
+    
+    std::vector<struct Primitive> all_prims;
+    all_prims.reserve(mListPrimitives.size() / (octant_angles + 1) * mConfig.mNumAngles);
+    for(unsigned int angle=0; angle < mConfig.mNumAngles; ++angle) {
+        unsigned int num_quarters = angle / quarter_angles;
+        unsigned int angle_in_quarter = angle % quarter_angles;
+        bool reflect = angle_in_quarter > octant_angles;
+        unsigned int source_angle = reflect ? quarter_angles - angle_in_quarter : angle_in_quarter;
+        
+        unsigned int first_prim = all_prims.size();
+        for(unsigned int b=0; b < num_bases; ++b) {
+            std::vector<unsigned int> const& sources = 
+                    prims_by_base[source_angle][reflect ? mirrored_bases[b] : b];
+            for(unsigned int j=0; j < sources.size(); ++j) {
+                Primitive prim = mListPrimitives[sources[j]];
+                if(reflect) {
+                    prim = reflectPrimitive(prim, mConfig.mNumAngles);
+                }
+                prim = rotatePrimitive(prim, num_quarters, mConfig.mNumAngles);
+                prim.mId = mListPrimitives[prims_by_base[0][b][j]].mId;
+                prim.mBaseId = b;
+                all_prims.push_back(prim);
+            }
+        }
+        // Same order as the generation: ascending ids within each angle.
+        std::vector<struct Primitive> angle_prims(all_prims.begin() + first_prim, all_prims.end());
+        for(unsigned int i=0; i < angle_prims.size(); ++i) {
+            if(angle_prims[i].mId >= angle_prims.size()) {
+                return false;
+            }
+            all_prims[first_prim + angle_prims[i].mId] = angle_prims[i];
+        }
+    }
+    
+    mListPrimitives.swap(all_prims);
+    LOG_INFO("%zu primitives have been created using symmetry", mListPrimitives.size());
+    return true;
+}
+
+void SbplMotionPrimitives::createPrimitiveTable() {
+    unsigned int num_prims = mListPrimitives.size();
+    mTableIds.resize(num_prims);
+    mTableStartAngles.resize(num_prims);
+    mTableCostMultipliers.resize(num_prims);
+    mTableEndDeltas.resize(3 * num_prims);
+    mTablePoseOffsets.resize(num_prims + 1);
+    
+    unsigned int num_poses = 0;
+    for(unsigned int i=0; i < num_prims; ++i) {
+        mTablePoseOffsets[i] = num_poses;
+        num_poses += mListPrimitives[i].mIntermediatePoses.size();
+    }
+    mTablePoseOffsets[num_prims] = num_poses;
+    mTablePoses.resize(3 * num_poses);
+    
+    for(unsigned int i=0; i < num_prims; ++i) {
+        struct Primitive const& prim = mListPrimitives[i];
+        mTableIds[i] = prim.mId;
+        mTableStartAngles[i] = prim.mStartAngle;
+        mTableCostMultipliers[i] = prim.mCostMultiplier;
+        for(unsigned int c=0; c < 3; ++c) {
+            mTableEndDeltas[3 * i + c] = (int)prim.mEndPose[c];
+        }
+        for(unsigned int p=0; p < prim.mIntermediatePoses.size(); ++p) {
+            for(unsigned int c=0; c < 3; ++c) {
+                mTablePoses[3 * (mTablePoseOffsets[i] + p) + c] = prim.mIntermediatePoses[p][c];
+            }
+        }
+    }
+    
+    mIdSpeeds.resize(mPrimIDInfos.size());
+    mIdMovTypes.resize(mPrimIDInfos.size());
+    for(unsigned int id=0; id < mPrimIDInfos.size(); ++id) {
+        mIdSpeeds[id] = mPrimIDInfos[id].mSpeed;
+        mIdMovTypes[id] = mPrimIDInfos[id].mMovType;
+    }
+}
+
 void SbplMotionPrimitives::storeToFile(std::string path) {
     std::ofstream mprim_file;
     mprim_file.open(path.c_str());
     
     mprim_file << "resolution_m: " <<  std::fixed << std::setprecision(6) << mConfig.mGridSize << std::endl;
     mprim_file << "numberofangles: " << mConfig.mNumAngles << std::endl;
-    mprim_file << "totalnumberofprimitives: " << mListPrimitives.size() << std::endl;
-    
-    
-    struct Primitive mprim;
-    for(unsigned int i=0; i < mListPrimitives.size(); ++i) {
-        mprim =  mListPrimitives[i];
-        mprim_file << "primID: " << mprim.mId << std::endl;
-        mprim_file << "startangle_c: " << mprim.mStartAngle << std::endl;
-        mprim_file << "endpose_c: " << (int)mprim.mEndPose[0] << " " << 
-                (int)mprim.mEndPose[1] << " " << (int)mprim.mEndPose[2] << std::endl;
-        mprim_file << "additionalactioncostmult: " << mprim.mCostMultiplier << std::endl;
-        mprim_file << "intermediateposes: " << mprim.mIntermediatePoses.size() << std::endl;
-        base::Vector3d v3d;
-        for(unsigned int i=0; i < mprim.mIntermediatePoses.size(); ++i) {
-            v3d = mprim.mIntermediatePoses[i];
+    mprim_file << "totalnumberofprimitives: " << getNumTablePrimitives() << std::endl;
+    
+    for(unsigned int i=0; i < getNumTablePrimitives(); ++i) {
+        mprim_file << "primID: " << mTableIds[i] << std::endl;
+        mprim_file << "startangle_c: " << mTableStartAngles[i] << std::endl;
+        mprim_file << "endpose_c: " << mTableEndDeltas[3*i] << " " << 
+                mTableEndDeltas[3*i+1] << " " << mTableEndDeltas[3*i+2] << std::endl;
+        mprim_file << "additionalactioncostmult: " << mTableCostMultipliers[i] << std::endl;
+        unsigned int num_poses = 0;
+        const double* poses = getTablePoses(i, num_poses);
+        mprim_file << "intermediateposes: " << num_poses << std::endl;
+        for(unsigned int p=0; p < num_poses; ++p) {
             mprim_file << std::fixed << std::setprecision(4) << 
-                    v3d[0] << " " << v3d[1] << " " << v3d[2] << std::endl;
+                    poses[3*p] << " " << poses[3*p+1] << " " << poses[3*p+2] << std::endl;
         }
     }
     
@@ -676,26 +898,6 @@ int SbplMotionPrimitives::calcDiscreteEndOrientation(double yaw_rad) {
     return discrete_theta;
 }
 
-bool SbplMotionPrimitives::getSpeed(unsigned int const prim_id, double& speed) {
-    if(prim_id >= mPrimIDInfos.size()) {
-        LOG_WARN("Speed for primitive id %d is not available\n", prim_id);
-        return false;
-    }
-
-    speed = mPrimIDInfos[prim_id].mSpeed;
-    return true;
-}
-
-bool SbplMotionPrimitives::getMovementType(unsigned int const prim_id, enum MovementType& mov_type) {
-    if(prim_id >=  mPrimIDInfos.size()) {
-        LOG_WARN("Movement type for primitive id %d is not available\n", prim_id);
-        return false;
-    }
-
-    mov_type = (enum MovementType) mPrimIDInfos[prim_id].mMovType;
-    return true;
-}
-
 /// \todo "Does not work yet!"
 bool SbplMotionPrimitives::calculateOrthogonalIntersection(
         base::Vector3d start_position, double start_theta_rad, 
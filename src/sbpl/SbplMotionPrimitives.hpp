@@ -6,6 +6,9 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <sstream>
+
+#include <boost/functional/hash.hpp>
 
 #include <base/Eigen.hpp>
 #include <base/samples/RigidBodyState.hpp>
@@ -73,7 +76,8 @@ struct MotionPrimitivesConfig {
             mMapWidth(100),
             mMapHeight(100),
             mGridSize(0.1),
-            mPrimAccuracy(0.25) {   
+            mPrimAccuracy(0.25),
+            mUseSymmetry(false) {   
     }
     
     MotionPrimitivesConfig(Config config, int trav_map_width, int trav_map_height, double grid_size) :
@@ -84,7 +88,8 @@ struct MotionPrimitivesConfig {
         mMapWidth(trav_map_width),
         mMapHeight(trav_map_height),
         mGridSize(grid_size),
-        mPrimAccuracy(config.mPrimAccuracy) {   
+        mPrimAccuracy(config.mPrimAccuracy),
+        mUseSymmetry(config.mSymmetricPrimitives) {   
     }   
     
   public:
@@ -98,6 +103,44 @@ struct MotionPrimitivesConfig {
     unsigned int mMapHeight;
     double mGridSize; // Width/length of a grid cell in meter.
     double mPrimAccuracy;
+    bool mUseSymmetry; // See Config::mSymmetricPrimitives.
+    
+    /**
+     * Contains all the parameters which influence the created primitives
+     * (the map size is not used). Two configurations with the same key 
+     * create the same primitives.
+     */
+    std::string getKey() const {
+        std::stringstream ss;
+        ss << std::setprecision(17) << 
+                mMobility.mSpeed << " " << 
+                mMobility.mTurningSpeed << " " << 
+                mMobility.mMinTurningRadius << " " << 
+                mMobility.mMultiplierForward << " " << 
+                mMobility.mMultiplierBackward << " " << 
+                mMobility.mMultiplierLateral << " " << 
+                mMobility.mMultiplierForwardTurn << " " << 
+                mMobility.mMultiplierBackwardTurn << " " << 
+                mMobility.mMultiplierPointTurn << " " << 
+                mMobility.mMultiplierLateralCurve << " " << 
+                mNumPrimPartition << " " << 
+                mNumPosesPerPrim << " " << 
+                mNumAngles << " " << 
+                mGridSize << " " << 
+                mPrimAccuracy << " " << 
+                mUseSymmetry;
+        return ss.str();
+    }
+    
+    /**
+     * Hash of getKey() as a hex string, e.g. used as part of the file name 
+     * of cached primitives.
+     */
+    std::string getHashString() const {
+        std::stringstream ss;
+        ss << std::hex << boost::hash<std::string>()(getKey());
+        return ss.str();
+    }
 };
 
 /**
@@ -121,10 +164,13 @@ struct Primitive {
     // Stores the center of rotation for curves.
     // Used to calculate the intermediate poses.
     base::Vector3d mCenterOfRotation;
+    // Index of the angle 0 primitive (mListPrimitivesAngle0) this discrete
+    // primitive has been created from.
+    unsigned int mBaseId;
      
     Primitive() : mId(0), mStartAngle(0), mEndPose(), 
             mCostMultiplier(0), mIntermediatePoses(), mMovType(MOV_UNDEFINED), mSpeed(0.0),
-            mDiscreteEndOrientationNotTruncated(0), mCenterOfRotation()
+            mDiscreteEndOrientationNotTruncated(0), mCenterOfRotation(), mBaseId(0)
     {
         mEndPose.setZero();
         mCenterOfRotation.setZero();
@@ -141,7 +187,7 @@ struct Primitive {
             mId(id), mStartAngle(start_angle), mEndPose(end_pose), 
             mCostMultiplier(cost_multiplier), 
             mIntermediatePoses(), mMovType(mov_type), mSpeed(speed),
-            mDiscreteEndOrientationNotTruncated(0), mCenterOfRotation()
+            mDiscreteEndOrientationNotTruncated(0), mCenterOfRotation(), mBaseId(0)
     {
         mCenterOfRotation.setZero();
     }
@@ -210,6 +256,21 @@ struct SbplMotionPrimitives {
     double mRadPerDiscreteAngle;
     // Matches the prim id (same for each angle) to speed and the type of the movement.
     std::vector<struct PrimIDInfo> mPrimIDInfos;
+    
+    // Flat copy of mListPrimitives (same order) created by createPrimitiveTable(),
+    // used for the conversion to SBPL, the mprim file and the lookups during planning.
+    std::vector<unsigned int> mTableIds;
+    std::vector<unsigned int> mTableStartAngles;
+    std::vector<unsigned int> mTableCostMultipliers;
+    // Discrete end pose deltas (x, y, truncated theta), three entries per primitive.
+    std::vector<int> mTableEndDeltas;
+    // Intermediate poses (x, y, theta) of primitive i are the entries
+    // 3 * mTablePoseOffsets[i] to 3 * mTablePoseOffsets[i+1] of mTablePoses.
+    std::vector<unsigned int> mTablePoseOffsets;
+    std::vector<double> mTablePoses;
+    // Dense prim id tables, copied from mPrimIDInfos.
+    std::vector<double> mIdSpeeds;
+    std::vector<enum MovementType> mIdMovTypes;
      
     SbplMotionPrimitives();
      
@@ -233,8 +294,11 @@ struct SbplMotionPrimitives {
      * calculate all primitives. This is done by rotating the angle 0 prims
      * mNumAngles-1 times to cover the complete 2*M_PI and to find the discrete
      * pose.
+     * \param num_start_angles Only the start angles 0 to num_start_angles-1 are 
+     * created, 0 creates all mNumAngles.
      */
-    std::vector<struct Primitive> createMPrims(std::vector<struct Primitive> prims_angle_0);
+    std::vector<struct Primitive> createMPrims(std::vector<struct Primitive> prims_angle_0,
+            unsigned int num_start_angles = 0);
     
     /**
      * Runs through all the discrete motion primitives and adds the
@@ -243,6 +307,38 @@ struct SbplMotionPrimitives {
      */
     void createIntermediatePoses(std::vector<struct Primitive>& discrete_mprims);
     
+    /**
+     * Replaces mListPrimitives, which has to contain the primitives of the start 
+     * angles 0 to mNumAngles/8 including their intermediate poses, by the primitives 
+     * of all angles. The angles of the second half of the octant are reflected at the 
+     * diagonal (mirrored primitive ids, e.g. left and right curves are swapped), 
+     * all other quadrants are rotated by multiples of 90 degree. Both are exact 
+     * for the discrete end poses.
+     * \return False if the primitives are not symmetric (e.g. mirrored primitive 
+     * missing or different ids / numbers of primitives per angle), mListPrimitives
+     * is not changed in this case.
+     */
+    bool createSymmetricPrimitives(std::vector<struct Primitive> const& prims_angle_0);
+    
+    /**
+     * Fills the flat primitive table (mTable* and mId*) with mListPrimitives
+     * and mPrimIDInfos, has to be called after createIntermediatePoses().
+     */
+    void createPrimitiveTable();
+    
+    inline unsigned int getNumTablePrimitives() const {
+        return mTableIds.size();
+    }
+    
+    /**
+     * Returns the intermediate poses (x, y, theta) of primitive \a index 
+     * of the flat table.
+     */
+    inline const double* getTablePoses(unsigned int index, unsigned int& num_poses) const {
+        num_poses = mTablePoseOffsets[index+1] - mTablePoseOffsets[index];
+        return num_poses == 0 ? NULL : &mTablePoses[3 * mTablePoseOffsets[index]];
+    }
+    
     void storeToFile(std::string path);
     
     /**
@@ -277,12 +373,24 @@ struct SbplMotionPrimitives {
      * Each prim id has been assigned a speed value.
      * Currently one speed is used, just inverted for backward movements.
      */
-    bool getSpeed(unsigned int const prim_id, double& speed);
+    inline bool getSpeed(unsigned int const prim_id, double& speed) const {
+        if(prim_id >= mIdSpeeds.size()) {
+            return false;
+        }
+        speed = mIdSpeeds[prim_id];
+        return true;
+    }
     
     /**
      * Returns the movement type of the primitive (frward, backward, pointturn..).
      */
-    bool getMovementType(unsigned int const prim_id, enum MovementType& mov_type);
+    inline bool getMovementType(unsigned int const prim_id, enum MovementType& mov_type) const {
+        if(prim_id >= mIdMovTypes.size()) {
+            return false;
+        }
+        mov_type = mIdMovTypes[prim_id];
+        return true;
+    }
     
     /**
      * Calculates the center of rotation for the new discretized end position.
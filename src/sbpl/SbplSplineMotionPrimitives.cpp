@@ -1,6 +1,10 @@
 #include "SbplSplineMotionPrimitives.hpp"
-#include <iostream> //FIXME remove after debug
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <set>
+#include <thread>
 
 using namespace base::geometry;
 namespace motion_planning_libraries 
@@ -63,23 +67,125 @@ std::vector<Eigen::Vector2i> SbplSplineMotionPrimitives::generateDestinationCell
 
 void SbplSplineMotionPrimitives::generatePrimitives(const SplinePrimitivesConfig& config)
 {
-    std::vector<Eigen::Vector2i> destinaionCells = generateDestinationCells(config);
-  
-    for(int startAngle = 0; startAngle < config.numAngles; ++startAngle)
+    const std::vector<Eigen::Vector2i> destinaionCells = generateDestinationCells(config);
+    
+    unsigned numThreads = config.numThreads;
+    if(numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::min(numThreads, (unsigned)config.numAngles);
+    
+    //with symmetry only the angles of the first octant are generated, the others are derived afterwards
+    const bool symmetric = config.useSymmetry && config.numAngles % 8 == 0;
+    const int numGeneratedAngles = symmetric ? config.numAngles / 8 + 1 : config.numAngles;
+    
+    //each start angle is generated independently into its own vector
+    std::atomic<int> nextAngle(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]()
+    {
+        for(int startAngle = nextAngle++; startAngle < numGeneratedAngles; startAngle = nextAngle++)
+        {
+            try
+            {
+                generatePrimitivesForAngle(startAngle, destinaionCells);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    for(unsigned i = 1; i < numThreads; ++i)
+    {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for(std::thread& t : workers)
+    {
+        t.join();
+    }
+    
+    if(error)
+        std::rethrow_exception(error);
+    
+    if(symmetric)
     {
-        generatePrimitivesForAngle(startAngle, destinaionCells);
+        for(int angle = numGeneratedAngles; angle < config.numAngles; ++angle)
+        {
+            derivePrimitivesForAngle(angle);
+        }
     }
+}
+
+void SbplSplineMotionPrimitives::derivePrimitivesForAngle(const int angle)
+{
+    const int quarterAngles = config.numAngles / 4;
+    const int numQuarters = angle / quarterAngles;
+    const int angleInQuarter = angle % quarterAngles;
+    const bool reflect = angleInQuarter > quarterAngles / 2;
+    const int sourceAngle = reflect ? quarterAngles - angleInQuarter : angleInQuarter;
+    
+    //reflection at the diagonal x = y, followed by numQuarters rotations by 90°
+    Eigen::Matrix2i cellTransform = Eigen::Matrix2i::Identity();
+    if(reflect)
+        cellTransform << 0, 1, 1, 0;
+    Eigen::Matrix2i rot90;
+    rot90 << 0, -1, 1, 0;
+    for(int q = 0; q < numQuarters; ++q)
+        cellTransform = rot90 * cellTransform;
+    
+    auto transformAngle = [&](const int a)
+    {
+        const int reflected = reflect ? quarterAngles - a : a;
+        return (reflected + numQuarters * quarterAngles + config.numAngles) % config.numAngles;
+    };
     
-    //debug code below
-    size_t count = 0;
-    for(int angle = 0; angle < config.numAngles; ++angle)
+    std::vector<SplinePrimitive>& prims = primitivesByAngle[angle];
+    prims.clear();
+    for(const SplinePrimitive& prim : primitivesByAngle[sourceAngle])
     {
-        count += getPrimitiveForAngle(angle).size();
+        prims.push_back(transformPrimitive(prim, cellTransform, transformAngle(prim.startAngle),
+                                           transformAngle(prim.endAngle)));
     }
 }
 
+SplinePrimitive SbplSplineMotionPrimitives::transformPrimitive(const SplinePrimitive& prim,
+                                                               const Eigen::Matrix2i& cellTransform,
+                                                               const int newStartAngle,
+                                                               const int newEndAngle) const
+{
+    SplinePrimitive result = prim;
+    result.startAngle = newStartAngle;
+    result.startAngleRad = newStartAngle * radPerDiscreteAngle;
+    result.endAngle = newEndAngle;
+    result.endAngleRad = newEndAngle * radPerDiscreteAngle;
+    result.endPosition = cellTransform * prim.endPosition;
+    
+    if(prim.motionType == SplinePrimitive::SPLINE_POINT_TURN)
+        return result;
+    
+    //b-splines are affine invariant: transforming the control points transforms the curve
+    const Eigen::Matrix2d transform = cellTransform.cast<double>();
+    const base::Vector2d center(config.cellCenterOffset * config.gridSize);
+    std::vector<double> coordinates = prim.spline.getCoordinates();
+    for(size_t i = 0; i + 1 < coordinates.size(); i += 2)
+    {
+        const base::Vector2d point(coordinates[i], coordinates[i + 1]);
+        const base::Vector2d transformed = center + transform * (point - center);
+        coordinates[i] = transformed.x();
+        coordinates[i + 1] = transformed.y();
+    }
+    result.spline.reset(coordinates, prim.spline.getKnots(), prim.spline.getSISLCurveType());
+    return result;
+}
+
 void SbplSplineMotionPrimitives::generatePrimitivesForAngle(const int startAngle,
-                                                            std::vector<Eigen::Vector2i> destinationCells)
+                                                            const std::vector<Eigen::Vector2i>& destinationCells)
 {
     /* Main idea:
      * For each destination cell: generate primitives from (0,0) to that cell.
@@ -91,6 +197,8 @@ void SbplSplineMotionPrimitives::generatePrimitivesForAngle(const int startAngle
     int id = 0; //the "same" primitives should have the same id for each start angle according to sbpl
     const double radStartAngle = startAngle * radPerDiscreteAngle;
     const double epsilon = 0.1; //makes the distinction between forward/backward/lateral easier
+    //the end angles only depend on the start angle
+    const std::vector<int> endAngles = generateEndAngles(startAngle, config);
         
     for(const Eigen::Vector2i& dest : destinationCells)
     { 
@@ -99,7 +207,6 @@ void SbplSplineMotionPrimitives::generatePrimitivesForAngle(const int startAngle
         const Eigen::Vector2d destRot = Eigen::Rotation2D<double>(-radStartAngle) * (dest.cast<double>() + config.cellCenterOffset);
 
         //forward and backward movements
-        const std::vector<int> endAngles = generateEndAngles(startAngle, config);
         for(int endAngle : endAngles)
         {
             //forward movement
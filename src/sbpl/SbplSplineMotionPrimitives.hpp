@@ -52,11 +52,26 @@ public:
     const std::vector<SplinePrimitive>& getPrimitiveForAngle(const int angle) const;
     const SplinePrimitivesConfig& getConfig() const;
 private:
+    /** Generates the primitives of all start angles using config.numThreads threads.
+     *  The ids only depend on the start angle, so the result does not depend on the
+     *  number of threads. */
     void generatePrimitives(const SplinePrimitivesConfig& config);
     
+    /** Derives primitivesByAngle[angle] of an angle outside of the first octant from the
+     *  generated ones. Angles of the second half of an octant are reflected at the
+     *  diagonal through the start cell, then the primitives are rotated by multiples of 90°.
+     *  Only writes to primitivesByAngle[angle]. */
+    void derivePrimitivesForAngle(const int angle);
+    
+    /** Applies @p cellTransform (rotation or reflection, exact for the cells) to @p prim.
+     *  The spline is transformed around the center of the start cell. */
+    SplinePrimitive transformPrimitive(const SplinePrimitive& prim, const Eigen::Matrix2i& cellTransform,
+                                       const int newStartAngle, const int newEndAngle) const;
+    
     /** @param startAngle defines the starting orientation of the robot. Is discrete.
-    *  @param destinationCells indices of cells that the primitives should go to */
-    void generatePrimitivesForAngle(const int startAngle, std::vector<Eigen::Vector2i> destinationCells);
+    *  @param destinationCells indices of cells that the primitives should go to 
+    *  Only writes to primitivesByAngle[startAngle]. */
+    void generatePrimitivesForAngle(const int startAngle, const std::vector<Eigen::Vector2i>& destinationCells);
     
     /**Generates a circular field of destination cells based on config.destinationCircleRadius */ 
     std::vector<Eigen::Vector2i> generateDestinationCells(const SplinePrimitivesConfig& config) const;
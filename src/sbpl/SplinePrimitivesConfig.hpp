@@ -34,11 +34,21 @@ struct SplinePrimitivesConfig
     bool generateLateralMotions;
     bool generatePointTurnMotions;
     
+    /**Number of threads used to generate the primitives of the start angles in parallel.
+     * 0 uses one thread per core. Does not change the generated primitives. */
+    unsigned numThreads;
+    
+    /**Generates the start angles of the first octant only and derives the other angles
+     * by rotation and reflection around the start cell. Requires numAngles to be a
+     * multiple of 8, otherwise all angles are generated. */
+    bool useSymmetry;
+    
     SplinePrimitivesConfig() : gridSize(0.1), numAngles(16), numEndAngles(7),
                                destinationCircleRadius(20), cellSkipFactor(0.3),
                                cellCenterOffset(0.5, 0.5), splineGeometricResolution(0.1),
                                splineOrder(4), generateForwardMotions(true),
                                generateBackwardMotions(true), generateLateralMotions(true),
-                               generatePointTurnMotions(true){}
+                               generatePointTurnMotions(true), numThreads(0),
+                               useSymmetry(false){}
 };
 }
\ No newline at end of file
@@ -2,16 +2,71 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <functional>
+#include <queue>
 
 #include <motion_planning_libraries/MotionPlanningLibraries.hpp>
 #include <motion_planning_libraries/Helpers.hpp>
+#include <motion_planning_libraries/ObstacleDistanceMap.hpp>
+#include <motion_planning_libraries/OccupancyBitmap.hpp>
+#include <motion_planning_libraries/CostToGoField.hpp>
+#include <motion_planning_libraries/PathPostProcessor.hpp>
 #include <motion_planning_libraries/sbpl/SbplMotionPrimitives.hpp>
+#include <motion_planning_libraries/sbpl/SbplEnvironmentNAVXYTHETAMLEVLAT.hpp>
+#include <motion_planning_libraries/ompl/validators/GridMotionValidator.hpp>
+#include <motion_planning_libraries/ompl/validators/ArmValidator.hpp>
+#include <motion_planning_libraries/ompl/OmplEnvARM.hpp>
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
 
 #include <envire/core/Environment.hpp>
 #include <envire/maps/TraversabilityGrid.hpp>
 
 using namespace motion_planning_libraries;
 
+/**
+ * ENV_XY states (grid coordinates) are only invalid within cell (5,5).
+ */
+class SingleCellValidator : public ompl::base::StateValidityChecker {
+ public:
+    SingleCellValidator(const ompl::base::SpaceInformationPtr& si) : 
+            ompl::base::StateValidityChecker(si) {
+    }
+    
+    bool isValid(const ompl::base::State* state) const {
+        const ompl::base::RealVectorStateSpace::StateType* state_rv = 
+                state->as<ompl::base::RealVectorStateSpace::StateType>();
+        return !((int)state_rv->values[0] == 5 && (int)state_rv->values[1] == 5);
+    }
+};
+
+/**
+ * Two joints, the configurations with |joint 0| < 0.5 and joint 1 < 1.0 collide.
+ * Counts its evaluations.
+ */
+class WallArmCollisionChecker : public ArmCollisionChecker {
+ public:
+    WallArmCollisionChecker() : mNumCalls(0), mRevision(0) {
+    }
+    
+    bool isCollisionFree(std::vector<double> const& joint_angles) const {
+        mNumCalls++;
+        return !(std::fabs(joint_angles[0]) < 0.5 && joint_angles[1] < 1.0);
+    }
+    
+    uint64_t getEnvironmentRevision() const {
+        return mRevision;
+    }
+    
+    mutable std::atomic<unsigned int> mNumCalls;
+    std::atomic<uint64_t> mRevision;
+};
+
 struct Fixture {
     Fixture(){
         env = new  envire::Environment();
@@ -71,7 +126,778 @@ BOOST_AUTO_TEST_CASE(sbpl_mprims)
     mprims.createPrimitives();
     mprims.storeToFile("test.mprim");
 }
+
+BOOST_AUTO_TEST_CASE(sbpl_mprims_symmetry)
+{
+    conf.mMobility.mSpeed = 1.0;
+    conf.mMobility.mTurningSpeed = 1.0;
+    conf.mMobility.mMinTurningRadius = 0.5;
+    conf.mMobility.mMultiplierForward = 1;
+    conf.mMobility.mMultiplierBackward = 2;
+    conf.mMobility.mMultiplierLateral = 3;
+    conf.mMobility.mMultiplierForwardTurn = 2;
+    conf.mMobility.mMultiplierBackwardTurn = 3;
+    conf.mMobility.mMultiplierPointTurn = 4;
+    conf.mMobility.mMultiplierLateralCurve = 5;
+    conf.mNumIntermediatePoints = 3;
+    
+    double partitions[] = {1, 2, 4};
+    for(unsigned int p = 0; p < 3; ++p) {
+        conf.mNumPrimPartition = partitions[p];
+        MotionPrimitivesConfig config(conf, 100, 100, 0.1);
+        config.mUseSymmetry = false;
+        SbplMotionPrimitives direct(config);
+        direct.createPrimitives();
+        config.mUseSymmetry = true;
+        SbplMotionPrimitives symmetric(config);
+        symmetric.createPrimitives();
+        
+        // The mirrored primitives of all start angles have to match the directly generated ones.
+        BOOST_REQUIRE_EQUAL(direct.mListPrimitives.size(), symmetric.mListPrimitives.size());
+        for(unsigned int i = 0; i < direct.mListPrimitives.size(); ++i) {
+            Primitive& prim = direct.mListPrimitives[i];
+            Primitive& prim_sym = symmetric.mListPrimitives[i];
+            BOOST_CHECK_EQUAL(prim.mId, prim_sym.mId);
+            BOOST_CHECK_EQUAL(prim.mStartAngle, prim_sym.mStartAngle);
+            BOOST_CHECK(prim.mEndPose == prim_sym.mEndPose);
+            BOOST_CHECK_EQUAL(prim.mCostMultiplier, prim_sym.mCostMultiplier);
+            BOOST_CHECK_EQUAL((int)prim.mMovType, (int)prim_sym.mMovType);
+            BOOST_REQUIRE_EQUAL(prim.mIntermediatePoses.size(), prim_sym.mIntermediatePoses.size());
+            for(unsigned int k = 0; k < prim.mIntermediatePoses.size(); ++k) {
+                base::Vector3d diff = prim.mIntermediatePoses[k] - prim_sym.mIntermediatePoses[k];
+                diff[2] = atan2(sin(diff[2]), cos(diff[2]));
+                BOOST_CHECK_SMALL(diff.norm(), 1e-9);
+            }
+        }
+    }
+}
+
+/** Provides the primitives SBPL uses after the initialization. */
+class PrimitiveEnvironment : public SbplEnvironmentNAVXYTHETAMLEVLAT {
+ public:
+    std::vector<SBPL_xytheta_mprimitive> const& getPrimitives() const {
+        return EnvNAVXYTHETALATCfg.mprimV;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(sbpl_mprims_conversion)
+{
+    conf.mMobility.mSpeed = 1.0;
+    conf.mMobility.mTurningSpeed = 1.0;
+    conf.mMobility.mMinTurningRadius = 0.5;
+    conf.mMobility.mMultiplierForward = 1;
+    conf.mMobility.mMultiplierBackward = 2;
+    conf.mMobility.mMultiplierLateral = 3;
+    conf.mMobility.mMultiplierForwardTurn = 2;
+    conf.mMobility.mMultiplierBackwardTurn = 3;
+    conf.mMobility.mMultiplierPointTurn = 4;
+    conf.mNumPrimPartition = 2;
+
+    MotionPrimitivesConfig config(conf, 20, 20, 0.1);
+    SbplMotionPrimitives prims(config);
+    prims.createPrimitives();
+    prims.storeToFile("test_conversion.mprim");
+
+    std::vector<SBPL_xytheta_mprimitive> mprims;
+    BOOST_REQUIRE(SbplEnvironmentNAVXYTHETAMLEVLAT::convertPrimitives(prims, mprims));
+
+    std::vector<unsigned char> map(20 * 20, 0);
+    std::vector<sbpl_2Dpt_t> footprint;
+    PrimitiveEnvironment env_direct, env_file;
+    BOOST_REQUIRE(env_direct.InitializeEnvWithPrimitives(20, 20, &map[0], footprint,
+            0.1, 1.0, 1.0, TravClassTable::SBPL_MAX_COST, mprims));
+    BOOST_REQUIRE(env_file.InitializeEnv(20, 20, &map[0], 0, 0, 0, 0, 0, 0,
+            0.1, 0.1, 0.1, footprint, 0.1, 1.0, 1.0, TravClassTable::SBPL_MAX_COST, "test_conversion.mprim"));
+
+    // The file stores the poses with four decimals.
+    std::vector<SBPL_xytheta_mprimitive> const& direct = env_direct.getPrimitives();
+    std::vector<SBPL_xytheta_mprimitive> const& file = env_file.getPrimitives();
+    BOOST_REQUIRE_EQUAL(direct.size(), prims.getNumTablePrimitives());
+    BOOST_REQUIRE_EQUAL(direct.size(), file.size());
+    for(unsigned int i = 0; i < direct.size(); ++i) {
+        BOOST_CHECK_EQUAL(direct[i].motprimID, file[i].motprimID);
+        BOOST_CHECK_EQUAL((int)direct[i].starttheta_c, (int)file[i].starttheta_c);
+        BOOST_CHECK_EQUAL(direct[i].additionalactioncostmult, file[i].additionalactioncostmult);
+        BOOST_CHECK_EQUAL(direct[i].endcell.x, file[i].endcell.x);
+        BOOST_CHECK_EQUAL(direct[i].endcell.y, file[i].endcell.y);
+        BOOST_CHECK_EQUAL(direct[i].endcell.theta, file[i].endcell.theta);
+        BOOST_REQUIRE_EQUAL(direct[i].intermptV.size(), file[i].intermptV.size());
+        for(unsigned int p = 0; p < direct[i].intermptV.size(); ++p) {
+            sbpl_xy_theta_pt_t const& pose = direct[i].intermptV[p];
+            sbpl_xy_theta_pt_t const& pose_file = file[i].intermptV[p];
+            double diff_theta = pose.theta - pose_file.theta;
+            BOOST_CHECK_SMALL(pose.x - pose_file.x, 1e-4);
+            BOOST_CHECK_SMALL(pose.y - pose_file.y, 1e-4);
+            BOOST_CHECK_SMALL(atan2(sin(diff_theta), cos(diff_theta)), 1e-4);
+        }
+    }
+    remove("test_conversion.mprim");
+}
+
+/**
+ * Compares the footprint checks on the class bytes with the checks on the 
+ * occupancy bitmap for all stencil angles at random cells and along the map borders.
+ */
+void compareOccupancyBitmap(envire::TraversabilityGrid* grid, boost::shared_ptr<TravData> data, 
+        boost::shared_ptr<TravClassTable> table, OccupancyBitmap const& bitmap_data) {
+    boost::shared_ptr<OccupancyBitmap const> bitmap(new OccupancyBitmap(bitmap_data));
+    GridCalculations calc_bytes, calc_bits;
+    calc_bytes.setTravGrid(grid, data, table);
+    calc_bits.setTravGrid(grid, data, table);
+    calc_bits.setOccupancyBitmap(bitmap);
+    
+    int width = data->shape()[1];
+    int height = data->shape()[0];
+    std::vector<int> cells;
+    for(int i = 0; i < 300; ++i) {
+        cells.push_back(rand() % (width + 20) - 10);
+        cells.push_back(rand() % (height + 20) - 10);
+    }
+    for(int i = -2; i < 3; ++i) {
+        for(int k = 0; k < 20; ++k) {
+            int x = rand() % width, y = rand() % height;
+            cells.push_back(i); cells.push_back(y);
+            cells.push_back(width - 1 + i); cells.push_back(y);
+            cells.push_back(x); cells.push_back(i);
+            cells.push_back(x); cells.push_back(height - 1 + i);
+        }
+    }
+    
+    int radii[] = {1, 2, 5, 9};
+    int rectangles[][2] = {{1, 1}, {4, 3}, {9, 5}, {21, 6}};
+    for(int f = 0; f < 8; ++f) {
+        if(f < 4) {
+            calc_bytes.setFootprintCircleInGrid(radii[f]);
+            calc_bits.setFootprintCircleInGrid(radii[f]);
+        } else {
+            calc_bytes.setFootprintRectangleInGrid(rectangles[f-4][0], rectangles[f-4][1]);
+            calc_bits.setFootprintRectangleInGrid(rectangles[f-4][0], rectangles[f-4][1]);
+        }
+        for(unsigned int theta = 0; theta < calc_bytes.getNumStencilAngles(); ++theta) {
+            for(size_t i = 0; i + 1 < cells.size(); i += 2) {
+                bool valid_bytes = calc_bytes.isValid(cells[i], cells[i+1], theta);
+                bool valid_bits = calc_bits.isValid(cells[i], cells[i+1], theta);
+                if(valid_bytes != valid_bits) {
+                    BOOST_ERROR("Footprint " << f << " angle " << theta << " differs at cell (" << 
+                            cells[i] << ", " << cells[i+1] << ") of a " << width << "x" << height << " map");
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(occupancy_bitmap_is_valid)
+{
+    srand(46);
+    // The fixture map and a map whose width is not a multiple of 64 (and exceeds one word).
+    envire::TraversabilityGrid* trav_odd = new envire::TraversabilityGrid(131, 77, 0.1, 0.1);
+    trav_odd->setTraversabilityClass(0, envire::TraversabilityClass(0.5));
+    trav_odd->setTraversabilityClass(1, envire::TraversabilityClass(0.0));
+    env->attachItem(trav_odd);
+    envire::TraversabilityGrid* grids[] = {trav, trav_odd};
+    
+    for(int g = 0; g < 2; ++g) {
+        boost::shared_ptr<TravData> data(new TravData(
+                grids[g]->getGridData(envire::TraversabilityGrid::TRAVERSABILITY)));
+        int width = data->shape()[1];
+        int height = data->shape()[0];
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                (*data)[y][x] = rand() % 100 < 3 ? 1 : 0;
+            }
+        }
+        boost::shared_ptr<TravClassTable> table(new TravClassTable(grids[g], conf));
+        OccupancyBitmap bitmap;
+        bitmap.create(*data, *table);
+        compareOccupancyBitmap(grids[g], data, table, bitmap);
+        
+        // Partial update, also clears obstacles.
+        std::vector<CellUpdate> cell_updates;
+        for(int i = 0; i < 200; ++i) {
+            size_t x = rand() % width, y = rand() % height;
+            uint8_t klass = (*data)[y][x] == 1 ? 0 : 1;
+            (*data)[y][x] = klass;
+            cell_updates.push_back(CellUpdate(x, y, klass, 1.0, klass == 1 ? 0.0 : 0.5));
+        }
+        BOOST_REQUIRE(bitmap.update(*data, *table, cell_updates));
+        compareOccupancyBitmap(grids[g], data, table, bitmap);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(obstacle_distance_map)
+{
+    TravClassTable table(trav, conf);
+    (*trav_data)[50][50] = 1; // obstacle
+    
+    ObstacleDistanceMap dist_map;
+    dist_map.create(*trav_data, table, 5);
+    BOOST_CHECK(dist_map.isFree(50, 50, 0) == false);
+    BOOST_CHECK(dist_map.isFree(53, 50, 2) == true);
+    BOOST_CHECK(dist_map.isFree(53, 50, 3) == false);
+    BOOST_CHECK(dist_map.isFree(52, 52, 2) == true);
+    // The area outside of the map is regarded as an obstacle.
+    BOOST_CHECK(dist_map.isFree(1, 80, 2) == false);
+    BOOST_CHECK(dist_map.isFree(2, 80, 2) == true);
+    
+    // Remove the obstacle and add a new one.
+    std::vector<CellUpdate> cell_updates;
+    (*trav_data)[50][50] = 0;
+    cell_updates.push_back(CellUpdate(50, 50, 0, 0.0, 0.5));
+    (*trav_data)[50][60] = 1;
+    cell_updates.push_back(CellUpdate(60, 50, 1, 0.0, 0.0));
+    BOOST_CHECK(dist_map.update(*trav_data, table, cell_updates) == true);
+    BOOST_CHECK(dist_map.isFree(53, 50, 3) == true);
+    BOOST_CHECK(dist_map.isFree(57, 50, 3) == false);
+    BOOST_CHECK(dist_map.getSquaredDist(60, 50) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(cost_to_go_field_update)
+{
+    std::vector<double> class_costs(CostToGoField::NUM_CLASSES, 1.0);
+    class_costs[1] = std::numeric_limits<double>::max(); // obstacle
+    class_costs[2] = 3.0;
+    class_costs[3] = 0.5;
+    
+    // Wall with a gap between the goal and the lower part of the map.
+    for(int x = 10; x < 90; ++x) {
+        (*trav_data)[40][x] = 1;
+    }
+    (*trav_data)[40][50] = 0;
+    
+    CostToGoField field;
+    BOOST_REQUIRE(field.create(*trav_data, class_costs, 50, 80) == true);
+    
+    // More expensive cells: The gap is closed, a slow area and a new obstacle 
+    // on the shortest paths. Cheaper cells: A new gap and a fast area.
+    std::vector<CellUpdate> cell_updates;
+    (*trav_data)[40][50] = 1;
+    cell_updates.push_back(CellUpdate(50, 40, 1, 0.0, 0.0));
+    for(int y = 60; y < 70; ++y) {
+        for(int x = 45; x < 55; ++x) {
+            (*trav_data)[y][x] = 2;
+            cell_updates.push_back(CellUpdate(x, y, 2, 0.0, 0.0));
+        }
+    }
+    (*trav_data)[75][50] = 1;
+    cell_updates.push_back(CellUpdate(50, 75, 1, 0.0, 0.0));
+    (*trav_data)[40][20] = 0;
+    cell_updates.push_back(CellUpdate(20, 40, 0, 0.0, 0.0));
+    for(int y = 20; y < 30; ++y) {
+        for(int x = 15; x < 25; ++x) {
+            (*trav_data)[y][x] = 3;
+            cell_updates.push_back(CellUpdate(x, y, 3, 0.0, 0.0));
+        }
+    }
+    BOOST_REQUIRE(field.update(*trav_data, class_costs, cell_updates) == true);
+    
+    // The repaired field has to equal a field created on the new map.
+    CostToGoField created_field;
+    BOOST_REQUIRE(created_field.create(*trav_data, class_costs, 50, 80) == true);
+    for(int y = 0; y < 100; ++y) {
+        for(int x = 0; x < 100; ++x) {
+            double repaired = field.getCost(x, y);
+            double created = created_field.getCost(x, y);
+            if(std::isinf(created)) {
+                BOOST_CHECK(std::isinf(repaired));
+            } else {
+                BOOST_CHECK_CLOSE(repaired, created, 1e-9);
+            }
+        }
+    }
+    BOOST_CHECK(std::isinf(field.getCost(50, 40)));
+}
+
+/**
+ * Straight path through the passed corners (grid coordinates) with a state per cell.
+ */
+std::vector<State> createCornerPath(std::vector<Eigen::Vector2d> const& corners) {
+    std::vector<State> path;
+    base::samples::RigidBodyState rbs;
+    for(unsigned int c = 0; c < corners.size(); ++c) {
+        Eigen::Vector2d dir = c + 1 < corners.size() ? Eigen::Vector2d(corners[c+1] - corners[c]) : 
+                Eigen::Vector2d(Eigen::Vector2d::Zero());
+        int num_states = c + 1 < corners.size() ? (int)dir.norm() : 1;
+        for(int i = 0; i < num_states; ++i) {
+            Eigen::Vector2d p = num_states > 1 ? Eigen::Vector2d(corners[c] + dir * i / num_states) : 
+                    corners[c];
+            rbs.setPose(base::Pose(base::Position(p.x(), p.y(), 0), base::Orientation::Identity()));
+            path.push_back(State(rbs));
+        }
+    }
+    return path;
+}
+
+BOOST_AUTO_TEST_CASE(path_post_processor_corner)
+{
+    conf.mEnvType = ENV_XY;
+    conf.mMobility.mSpeed = 1.0;
+    conf.mMobility.mMinTurningRadius = 1.0; // 10 cells
+    // Blocks the shortcuts across the corners.
+    for(int y = 12; y < 40; ++y) {
+        for(int x = 20; x < 40; ++x) {
+            (*trav_data)[y][x] = 1;
+        }
+    }
+    boost::shared_ptr<TravClassTable> table(new TravClassTable(trav, conf));
+    PathPostProcessor post_processor(conf);
+    post_processor.setTravGrid(trav, trav_data, table);
+    
+    // Right angle with enough space for the min turning radius: The arc touches 
+    // both segments 10 cells before and after the corner.
+    std::vector<Eigen::Vector2d> corners;
+    corners.push_back(Eigen::Vector2d(10.5, 10.5));
+    corners.push_back(Eigen::Vector2d(50.5, 10.5));
+    corners.push_back(Eigen::Vector2d(50.5, 50.5));
+    std::vector<State> path = createCornerPath(corners);
+    BOOST_REQUIRE(post_processor.process(path, false) == true);
+    BOOST_REQUIRE(path.size() > 4);
+    BOOST_CHECK_SMALL((path.front().mPose.position.head<2>() - corners[0]).norm(), 1e-6);
+    BOOST_CHECK_SMALL((path.back().mPose.position.head<2>() - corners[2]).norm(), 1e-6);
+    double last_yaw = 0.0;
+    for(unsigned int i = 1; i + 1 < path.size(); ++i) {
+        Eigen::Vector2d p = path[i].mPose.position.head<2>();
+        BOOST_CHECK_CLOSE((p - Eigen::Vector2d(40.5, 20.5)).norm(), 10.0, 1e-6);
+        // The headings follow the arc from 0 to 90 degrees.
+        double yaw = path[i].mPose.getYaw();
+        BOOST_CHECK(yaw >= last_yaw - 1e-6 && yaw <= M_PI / 2.0 + 1e-6);
+        last_yaw = yaw;
+    }
+    BOOST_CHECK_CLOSE(last_yaw, M_PI / 2.0, 1e-6);
+    // The arc is shorter than the corner.
+    BOOST_CHECK(post_processor.getCostRatio() < 1.0);
+    BOOST_CHECK(post_processor.getCostRatio() > 0.9);
+    
+    // The second segment is too short for the min turning radius, 
+    // an arc with a radius of 6 cells is used instead of the corner.
+    corners[2] = Eigen::Vector2d(50.5, 16.5);
+    path = createCornerPath(corners);
+    BOOST_REQUIRE(post_processor.process(path, false) == true);
+    BOOST_REQUIRE(path.size() > 4);
+    BOOST_CHECK_SMALL((path.back().mPose.position.head<2>() - corners[2]).norm(), 1e-6);
+    BOOST_CHECK((path[path.size()-2].mPose.position.head<2>() - corners[2]).norm() > 1e-3);
+    for(unsigned int i = 1; i + 1 < path.size(); ++i) {
+        Eigen::Vector2d p = path[i].mPose.position.head<2>();
+        BOOST_CHECK_CLOSE((p - Eigen::Vector2d(44.5, 16.5)).norm(), 6.0, 1e-6);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sbpl_xytheta_shift_map)
+{
+    conf.mPlanningLibType = LIB_SBPL;
+    conf.mEnvType = ENV_XYTHETA;
+    conf.mPlanner = ANYTIME_DSTAR;
+    conf.mShiftScrollingMap = true;
+    conf.mMobility.mSpeed = 0.8;
+    conf.mMobility.mTurningSpeed = 0.5;
+    conf.mMobility.mMinTurningRadius = 1.0;
+    conf.mMobility.mMultiplierForward = 1;
+    conf.mMobility.mMultiplierBackward = 2;
+    conf.mMobility.mMultiplierForwardTurn = 3;
+    conf.mMobility.mMultiplierPointTurn = 3;
+    conf.mFootprintRadiusMinMax = MinMaxValue(0.2, 0.2);
+    conf.mFootprintLengthMinMax = MinMaxValue(0.4, 0.4);
+    conf.mFootprintWidthMinMax = MinMaxValue(0.4, 0.4);
+    
+    // Wall between start and goal at x = 5 m with a passage above y = 7 m.
+    TravData& grid_data = trav->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
+    for(int y = 0; y < 70; ++y) {
+        grid_data[y][50] = 1;
+    }
+    rbs_start.setPose(base::Pose(base::Position(2,2,0), base::Orientation::Identity()));
+    rbs_goal.setPose(base::Pose(base::Position(8,2,0), base::Orientation::Identity()));
+    
+    MotionPlanningLibraries sbpl(conf);
+    BOOST_REQUIRE(sbpl.setTravGrid(env, "/trav_map"));
+    BOOST_REQUIRE(sbpl.setStartState(State(rbs_start)));
+    BOOST_REQUIRE(sbpl.setGoalState(State(rbs_goal)));
+    double cost = 0.0;
+    BOOST_REQUIRE(sbpl.plan(10, cost));
+    
+    // Scrolls the map by 1 m (10 cells) in x: The new cell x covers the old cell x + 10,
+    // the exposed cells are unknown.
+    trav->getFrameNode()->setTransform(Eigen::Affine3d(Eigen::Translation3d(1, 0, 0)));
+    for(int y = 0; y < 100; ++y) {
+        for(int x = 0; x < 100; ++x) {
+            grid_data[y][x] = x + 10 < 100 ? grid_data[y][x + 10] : 0;
+        }
+    }
+    BOOST_REQUIRE(sbpl.setTravGrid(env, "/trav_map"));
+    BOOST_CHECK(sbpl.getStatistics().mPartialUpdate == true);
+    BOOST_REQUIRE(sbpl.plan(10, cost));
+    
+    // The shifted SBPL grid has to contain the wall at its new position.
+    std::vector<State> path = sbpl.getStatesInWorld();
+    BOOST_REQUIRE(path.size() > 0);
+    base::samples::RigidBodyState grid_pose;
+    for(unsigned int i = 0; i < path.size(); ++i) {
+        BOOST_REQUIRE(MotionPlanningLibraries::world2grid(trav, path[i].getPose(), grid_pose));
+        int x = (int)grid_pose.position.x();
+        int y = (int)grid_pose.position.y();
+        BOOST_CHECK(grid_data[y][x] != 1);
+    }
+    BOOST_CHECK(path.back().getPose().position.x() > 7.5);
+}
+
+/**
+ * Costs of the 8-connected 2D search of SBPL (EnvironmentNAV2D) from the
+ * start to all coarse cells with uniform costs, diagonal moves require
+ * both adjacent cells to be free.
+ */
+void calculateCoarseDistances(std::vector<bool> const& blocked, int width, int height,
+        int start_x, int start_y, std::vector<int>& dist) {
+    dist.assign(width * height, std::numeric_limits<int>::max());
+    typedef std::pair<int, int> Entry; // distance, cell
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+    dist[start_y * width + start_x] = 0;
+    queue.push(Entry(0, start_y * width + start_x));
+    while(!queue.empty()) {
+        Entry entry = queue.top();
+        queue.pop();
+        if(entry.first > dist[entry.second]) {
+            continue;
+        }
+        int x = entry.second % width, y = entry.second / width;
+        for(int dy = -1; dy <= 1; ++dy) {
+            for(int dx = -1; dx <= 1; ++dx) {
+                int nx = x + dx, ny = y + dy;
+                if((dx == 0 && dy == 0) || nx < 0 || nx >= width || ny < 0 || ny >= height ||
+                        blocked[ny * width + nx]) {
+                    continue;
+                }
+                if(dx != 0 && dy != 0 && (blocked[y * width + nx] || blocked[ny * width + x])) {
+                    continue;
+                }
+                int d = entry.first + (dx != 0 && dy != 0 ? 1414 : 1000);
+                if(d < dist[ny * width + nx]) {
+                    dist[ny * width + nx] = d;
+                    queue.push(Entry(d, ny * width + nx));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sbpl_xytheta_coarse_to_fine)
+{
+    conf.mPlanningLibType = LIB_SBPL;
+    conf.mEnvType = ENV_XYTHETA;
+    conf.mPlanner = ANYTIME_ASTAR;
+    conf.mSearchUntilFirstSolution = false;
+    conf.mMobility.mSpeed = 0.8;
+    conf.mMobility.mTurningSpeed = 0.5;
+    conf.mMobility.mMinTurningRadius = 1.0;
+    conf.mMobility.mMultiplierForward = 1;
+    conf.mMobility.mMultiplierBackward = 2;
+    conf.mMobility.mMultiplierForwardTurn = 3;
+    conf.mMobility.mMultiplierPointTurn = 3;
+    conf.mFootprintRadiusMinMax = MinMaxValue(0.2, 0.2);
+    conf.mFootprintLengthMinMax = MinMaxValue(0.4, 0.4);
+    conf.mFootprintWidthMinMax = MinMaxValue(0.4, 0.4);
+
+    // Wall between start and goal at x = 5 m with a passage above y = 7 m,
+    // the route leads around the wall.
+    TravData& grid_data = trav->getGridData(envire::TraversabilityGrid::TRAVERSABILITY);
+    for(int y = 0; y < 70; ++y) {
+        grid_data[y][50] = 1;
+    }
+    rbs_start.setPose(base::Pose(base::Position(1,1,0), base::Orientation::Identity()));
+    rbs_goal.setPose(base::Pose(base::Position(9,1,0), base::Orientation::Identity()));
+
+    MotionPlanningLibraries sbpl_full(conf);
+    BOOST_REQUIRE(sbpl_full.setTravGrid(env, "/trav_map"));
+    BOOST_REQUIRE(sbpl_full.setStartState(State(rbs_start)));
+    BOOST_REQUIRE(sbpl_full.setGoalState(State(rbs_goal)));
+    double cost_full = 0.0;
+    BOOST_REQUIRE(sbpl_full.plan(5, cost_full));
+
+    const int factor = 5;
+    conf.mSBPLCoarseFactor = factor;
+    conf.mSBPLCorridorWidth = 1.0;
+    MotionPlanningLibraries sbpl(conf);
+    BOOST_REQUIRE(sbpl.setTravGrid(env, "/trav_map"));
+    BOOST_REQUIRE(sbpl.setStartState(State(rbs_start)));
+    BOOST_REQUIRE(sbpl.setGoalState(State(rbs_goal)));
+    double cost = 0.0;
+    BOOST_REQUIRE(sbpl.plan(5, cost));
+    BOOST_CHECK_CLOSE(cost, cost_full, 20.0);
+
+    // The coarse path is one of the shortest paths on the downsampled map,
+    // so the path has to stay within the corridor width around the cells of these paths.
+    int width = (100 + factor - 1) / factor;
+    int height = (100 + factor - 1) / factor;
+    std::vector<bool> blocked(width * height, false);
+    for(int y = 0; y < 100; ++y) {
+        for(int x = 0; x < 100; ++x) {
+            if(grid_data[y][x] == 1) {
+                blocked[(y / factor) * width + x / factor] = true;
+            }
+        }
+    }
+    std::vector<int> dist_start, dist_goal;
+    calculateCoarseDistances(blocked, width, height, 10 / factor, 10 / factor, dist_start);
+    calculateCoarseDistances(blocked, width, height, 90 / factor, 10 / factor, dist_goal);
+    int dist = dist_start[(10 / factor) * width + 90 / factor];
+    BOOST_REQUIRE(dist < std::numeric_limits<int>::max());
+
+    int radius = (int)std::ceil(conf.mSBPLCorridorWidth / (factor * 0.1));
+    std::vector<bool> corridor(width * height, false);
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x) {
+            // Slack of one step for the rounding of the SBPL costs.
+            if(blocked[y * width + x] ||
+                    dist_start[y * width + x] + dist_goal[y * width + x] > dist + 1000) {
+                continue;
+            }
+            for(int yc = std::max(0, y - radius); yc <= std::min(height - 1, y + radius); ++yc) {
+                for(int xc = std::max(0, x - radius); xc <= std::min(width - 1, x + radius); ++xc) {
+                    corridor[yc * width + xc] = true;
+                }
+            }
+        }
+    }
+
+    std::vector<State> path = sbpl.getStatesInWorld();
+    BOOST_REQUIRE(path.size() > 0);
+    base::samples::RigidBodyState grid_pose;
+    for(unsigned int i = 0; i < path.size(); ++i) {
+        BOOST_REQUIRE(MotionPlanningLibraries::world2grid(trav, path[i].getPose(), grid_pose));
+        int x = (int)grid_pose.position.x();
+        int y = (int)grid_pose.position.y();
+        BOOST_CHECK_MESSAGE(corridor[(y / factor) * width + x / factor],
+                "Pose " << i << " in cell (" << x << ", " << y << ") is outside of the corridor");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ompl_xytheta_multiple_goals)
+{
+    conf.mPlanningLibType = LIB_OMPL;
+    conf.mEnvType = ENV_XYTHETA;
+    conf.mMobility.mSpeed = 0.8;
+    conf.mMobility.mTurningSpeed = 0.5;
+    conf.mMobility.mMinTurningRadius = 1.0;
+    conf.mFootprintRadiusMinMax = MinMaxValue(0.2, 0.2);
+    conf.mFootprintLengthMinMax = MinMaxValue(0.4, 0.4);
+    conf.mFootprintWidthMinMax = MinMaxValue(0.4, 0.4);
+    
+    MotionPlanningLibraries ompl(conf);
+    BOOST_REQUIRE(ompl.setTravGrid(env, "/trav_map"));
+    BOOST_REQUIRE(ompl.setStartState(State(rbs_start)));
+    
+    // Both goals are passed to a single query of the control planner.
+    std::vector<State> goals;
+    goals.push_back(State(rbs_goal));
+    base::samples::RigidBodyState rbs_goal2;
+    rbs_goal2.setPose(base::Pose(base::Position(8,2,0), base::Orientation::Identity()));
+    goals.push_back(State(rbs_goal2));
+    double cost = 0.0;
+    int goal_index = -1;
+    BOOST_REQUIRE(ompl.planToGoals(goals, 10, cost, goal_index));
+    BOOST_REQUIRE(goal_index == 0 || goal_index == 1);
+    
+    // The reached goal is the one closest to the end of the path.
+    std::vector<State> path = ompl.getStatesInWorld();
+    BOOST_REQUIRE(!path.empty());
+    base::Vector3d end = path.back().getPose().position;
+    double dist_reached = (goals[goal_index].getPose().position - end).head(2).norm();
+    double dist_other = (goals[1 - goal_index].getPose().position - end).head(2).norm();
+    BOOST_CHECK(dist_reached <= dist_other);
+}
+
+BOOST_AUTO_TEST_CASE(ompl_warm_start_after_start_move)
+{
+    conf.mPlanningLibType = LIB_OMPL;
+    conf.mEnvType = ENV_XY;
+    conf.mOmplWarmStart = true;
+    conf.mFootprintRadiusMinMax = MinMaxValue(0.2, 0.2);
+    
+    MotionPlanningLibraries ompl(conf);
+    BOOST_REQUIRE(ompl.setTravGrid(env, "/trav_map"));
+    BOOST_REQUIRE(ompl.setStartState(State(rbs_start)));
+    BOOST_REQUIRE(ompl.setGoalState(State(rbs_goal)));
+    double cost = 0.0;
+    BOOST_REQUIRE(ompl.plan(10, cost));
+    std::vector<State> first_path = ompl.getStatesInWorld();
+    BOOST_REQUIRE(first_path.size() >= 2);
+    
+    // The robot has moved along the first segment, the rest of the path is still valid.
+    base::Vector3d p0 = first_path[0].getPose().position;
+    base::Vector3d p1 = first_path[1].getPose().position;
+    base::samples::RigidBodyState rbs_moved = rbs_start;
+    rbs_moved.position = p0 + (p1 - p0) * 0.3;
+    BOOST_REQUIRE(ompl.setStartState(State(rbs_moved)));
+    BOOST_REQUIRE(ompl.plan(10, cost));
+    std::vector<State> path = ompl.getStatesInWorld();
+    
+    // Due to mSearchUntilFirstSolution the planner is not executed: 
+    // The new start is connected to the states of the previous path.
+    BOOST_REQUIRE(path.size() >= 2);
+    BOOST_CHECK(path.size() <= first_path.size());
+    BOOST_CHECK_SMALL((path.front().getPose().position - rbs_moved.position).head(2).norm(), 0.1);
+    for(unsigned int i = 1; i < path.size(); ++i) {
+        double min_dist = std::numeric_limits<double>::max();
+        for(unsigned int k = 0; k < first_path.size(); ++k) {
+            min_dist = std::min(min_dist, 
+                    (path[i].getPose().position - first_path[k].getPose().position).head(2).norm());
+        }
+        BOOST_CHECK_SMALL(min_dist, 1e-3);
+    }
+    BOOST_CHECK_SMALL((path.back().getPose().position - 
+            first_path.back().getPose().position).head(2).norm(), 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(arm_validator_voxel_cache)
+{
+    ompl::base::RealVectorStateSpace* space_rv = new ompl::base::RealVectorStateSpace(2);
+    space_rv->setBounds(-M_PI, M_PI);
+    ompl::base::StateSpacePtr space(space_rv);
+    ompl::base::SpaceInformationPtr si(new ompl::base::SpaceInformation(space));
+    boost::shared_ptr<WallArmCollisionChecker> checker(new WallArmCollisionChecker());
+    ArmValidator validator(si, checker, 0.1);
+    ompl::base::State* state = si->allocState();
+    double* values = state->as<ompl::base::RealVectorStateSpace::StateType>()->values;
+    
+    // The first configuration of a voxel evaluates the checker.
+    values[0] = 0.01; values[1] = 0.01;
+    BOOST_CHECK(validator.isValid(state) == false);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 1u);
+    // Same voxel, answered by the cache.
+    values[0] = 0.09; values[1] = 0.05;
+    BOOST_CHECK(validator.isValid(state) == false);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 1u);
+    // Neighbouring voxel.
+    values[0] = 0.11;
+    BOOST_CHECK(validator.isValid(state) == false);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 2u);
+    values[0] = 2.0; values[1] = 0.0;
+    BOOST_CHECK(validator.isValid(state) == true);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 3u);
+    BOOST_CHECK_EQUAL(validator.getNumChecks(), 4u);
+    BOOST_CHECK_EQUAL(validator.getNumCollisionChecks(), 3u);
+    
+    // A new environment revision drops the cached voxels.
+    checker->mRevision = 1;
+    values[0] = 0.05; values[1] = 0.05;
+    BOOST_CHECK(validator.isValid(state) == false);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 4u);
+    
+    // States outside of the joint borders are invalid without a check.
+    values[0] = 4.0;
+    BOOST_CHECK(validator.isValid(state) == false);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 4u);
+    
+    // Without a cache each state is checked.
+    ArmValidator uncached(si, checker, 0.0);
+    values[0] = 2.0; values[1] = 0.0;
+    BOOST_CHECK(uncached.isValid(state) == true);
+    BOOST_CHECK(uncached.isValid(state) == true);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 6u);
+    
+    // Without a checker only the joint borders are regarded.
+    validator.setChecker(boost::shared_ptr<ArmCollisionChecker const>());
+    values[0] = 0.05; values[1] = 0.05;
+    BOOST_CHECK(validator.isValid(state) == true);
+    BOOST_CHECK_EQUAL(checker->mNumCalls.load(), 6u);
+    si->freeState(state);
+}
+
+BOOST_AUTO_TEST_CASE(arm_collision_checker_planning)
+{
+    conf.mPlanningLibType = LIB_OMPL;
+    conf.mEnvType = ENV_ARM;
+    conf.mJointBorders.clear();
+    conf.mJointBorders.push_back(MinMaxValue(-M_PI, M_PI));
+    conf.mJointBorders.push_back(MinMaxValue(-M_PI, M_PI));
+    conf.mArmValidityCacheResolution = 0.02;
+    
+    OmplEnvARM arm(conf);
+    BOOST_REQUIRE(arm.initialize_arm());
+    boost::shared_ptr<WallArmCollisionChecker> checker(new WallArmCollisionChecker());
+    BOOST_REQUIRE(arm.setArmCollisionChecker(checker));
+    
+    // The wall can only be passed above joint 1 = 1.0.
+    std::vector<double> start_angles(2, 0.0), goal_angles(2, 0.0);
+    start_angles[0] = -1.0;
+    goal_angles[0] = 1.0;
+    BOOST_REQUIRE(arm.setStartGoal(State(start_angles), State(goal_angles)));
+    BOOST_REQUIRE(arm.solve(10));
+    
+    // Each evaluation of the backend is counted by the validator.
+    PlanningStatistics statistics;
+    arm.fillStatistics(statistics);
+    BOOST_CHECK(checker->mNumCalls > 0);
+    BOOST_CHECK_EQUAL(statistics.mNumValidityChecks, (uint64_t)checker->mNumCalls.load());
+    
+    std::vector<State> path;
+    bool pos_defined_in_local_grid = false;
+    BOOST_REQUIRE(arm.fillPath(path, pos_defined_in_local_grid));
+    BOOST_REQUIRE(path.size() >= 2);
+    bool above_wall = false;
+    for(unsigned int i = 0; i < path.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(path[i].mJointAngles.size(), 2u);
+        BOOST_CHECK(checker->isCollisionFree(path[i].mJointAngles));
+        above_wall = above_wall || path[i].mJointAngles[1] > 0.9;
+    }
+    BOOST_CHECK(above_wall);
+}
+
+BOOST_AUTO_TEST_CASE(grid_motion_validator_single_cell)
+{
+    ompl::base::RealVectorStateSpace* space_rv = new ompl::base::RealVectorStateSpace(2);
+    space_rv->setBounds(0, 10);
+    ompl::base::StateSpacePtr space(space_rv);
+    ompl::base::SpaceInformationPtr si(new ompl::base::SpaceInformation(space));
+    si->setStateValidityChecker(ompl::base::StateValidityCheckerPtr(new SingleCellValidator(si)));
+    GridMotionValidator* validator = new GridMotionValidator(si, ENV_XY);
+    si->setMotionValidator(ompl::base::MotionValidatorPtr(validator));
+    si->setup();
+    
+    ompl::base::State* s1 = si->allocState();
+    ompl::base::State* s2 = si->allocState();
+    ompl::base::State* last_valid_state = si->allocState();
+    std::pair<ompl::base::State*, double> last_valid(last_valid_state, 0.0);
     
+    // Straight and diagonal motions crossing the obstacle cell.
+    double motions[3][4] = {{0.5, 5.5, 9.5, 5.5}, {0.5, 4.2, 9.5, 6.8}, {9.3, 0.5, 1.7, 9.5}};
+    for(int i = 0; i < 3; ++i) {
+        s1->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] = motions[i][0];
+        s1->as<ompl::base::RealVectorStateSpace::StateType>()->values[1] = motions[i][1];
+        s2->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] = motions[i][2];
+        s2->as<ompl::base::RealVectorStateSpace::StateType>()->values[1] = motions[i][3];
+        BOOST_CHECK(validator->checkMotion(s1, s2) == false);
+        BOOST_CHECK(validator->checkMotion(s1, s2, last_valid) == false);
+        // The last valid state lies in front of the obstacle cell.
+        double x = last_valid_state->as<ompl::base::RealVectorStateSpace::StateType>()->values[0];
+        double y = last_valid_state->as<ompl::base::RealVectorStateSpace::StateType>()->values[1];
+        BOOST_CHECK(last_valid.second > 0.0 && last_valid.second < 1.0);
+        BOOST_CHECK(!((int)x == 5 && (int)y == 5));
+        // The reversed motion is blocked as well.
+        BOOST_CHECK(validator->checkMotion(s2, s1) == false);
+    }
+    
+    // Passes the obstacle cell in the neighbouring row.
+    s1->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] = 0.5;
+    s1->as<ompl::base::RealVectorStateSpace::StateType>()->values[1] = 6.5;
+    s2->as<ompl::base::RealVectorStateSpace::StateType>()->values[0] = 9.5;
+    s2->as<ompl::base::RealVectorStateSpace::StateType>()->values[1] = 6.5;
+    BOOST_CHECK(validator->checkMotion(s1, s2) == true);
+    
+    BOOST_CHECK_EQUAL(validator->getNumValidMotions(), 1u);
+    BOOST_CHECK_EQUAL(validator->getNumInvalidMotions(), 9u);
+    
+    si->freeState(s1);
+    si->freeState(s2);
+    si->freeState(last_valid_state);
+}
+
+BOOST_AUTO_TEST_CASE(missing_footprint_throws)
+{
+    conf.mFootprintRadiusMinMax = MinMaxValue(nan(""), nan(""));
+    conf.mFootprintLengthMinMax = MinMaxValue(nan(""), nan(""));
+    conf.mFootprintWidthMinMax = MinMaxValue(nan(""), nan(""));
+    // Thrown by value, so callers catching std::exception& (e.g. the batch workers) get it.
+    BOOST_CHECK_THROW(MotionPlanningLibraries mpl(conf), std::runtime_error);
+}
+
 #if 0
 
 BOOST_AUTO_TEST_CASE(helper_rectangle)
@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+#define private public //need to be able to block the drain thread
+#include <motion_planning_libraries/TraceLog.hpp>
+
+#include <stddef.h>
+
+#include <string>
+
+using namespace motion_planning_libraries;
+
+namespace {
+
+TraceRecord createRecord(const char* format) {
+    TraceRecord record;
+    record.mTimeMicroseconds = 0;
+    record.mFormat = format;
+    record.mFile = __FILE__;
+    record.mLine = __LINE__;
+    record.mLevel = TRACE_WARN;
+    record.mNumArgs = 0;
+    return record;
+}
+
+template <class... Args>
+TraceRecord createRecord(const char* format, Args... args) {
+    TraceRecord record = createRecord(format);
+    record.mNumArgs = sizeof...(Args);
+    TraceLog::setArgs(record.mArgs, args...);
+    return record;
+}
+
+std::string format(TraceRecord const& record) {
+    std::string text;
+    TraceLog::format(record, text);
+    return text;
+}
+
+} // end anonymous namespace
+
+BOOST_AUTO_TEST_CASE(trace_log_format)
+{
+    size_t num_cells = 4096;
+    BOOST_CHECK_EQUAL(format(createRecord("%zu cells", num_cells)), "4096 cells");
+    BOOST_CHECK_EQUAL(format(createRecord("%lu/%llu", 3ul, 7ull)), "3/7");
+
+    // Integer to floating point conversion and vice versa.
+    BOOST_CHECK_EQUAL(format(createRecord("%4.2f", 3)), "3.00");
+    BOOST_CHECK_EQUAL(format(createRecord("%6.1f|", 12)), "  12.0|");
+    BOOST_CHECK_EQUAL(format(createRecord("%d", 2.75)), "2");
+    BOOST_CHECK_EQUAL(format(createRecord("%03d", -1.5)), "-01");
+    BOOST_CHECK_EQUAL(format(createRecord("%x", 255)), "ff");
+
+    BOOST_CHECK_EQUAL(format(createRecord("100%%")), "100%");
+    BOOST_CHECK_EQUAL(format(createRecord("%d%% of %d", 50, 8)), "50% of 8");
+
+    // Missing arguments are printed as '?', a trailing '%' is ignored.
+    BOOST_CHECK_EQUAL(format(createRecord("%d %d %f", 5)), "5 ? ?");
+    BOOST_CHECK_EQUAL(format(createRecord("no args %d")), "no args ?");
+    BOOST_CHECK_EQUAL(format(createRecord("end %", 1)), "end ");
+}
+
+BOOST_AUTO_TEST_CASE(trace_log_dropped_records)
+{
+    TraceLog& trace_log = TraceLog::getInstance();
+    TraceLevel level = (TraceLevel)trace_log.mLevel.load();
+    trace_log.setLevel(TRACE_DEBUG);
+    trace_log.flush();
+
+    const unsigned int num_extra = 100;
+    uint64_t num_records = trace_log.getNumRecords();
+    uint64_t num_dropped = trace_log.getNumDropped();
+    {
+        // Keeps the drain thread from emptying the buffer.
+        std::lock_guard<std::mutex> lock(trace_log.mDrainMutex);
+        for(unsigned int i = 0; i < TraceLog::CAPACITY + num_extra; ++i) {
+            // Not the macro, it could be compiled out by MPL_TRACE_MIN_LEVEL.
+            trace_log.record(TRACE_DEBUG, __FILE__, __LINE__, "trace_log_dropped_records %u", i);
+        }
+    }
+    BOOST_CHECK_EQUAL(trace_log.getNumRecords() - num_records, TraceLog::CAPACITY + num_extra);
+    BOOST_CHECK_EQUAL(trace_log.getNumDropped() - num_dropped, num_extra);
+
+    // The drained buffer accepts records again.
+    trace_log.flush();
+    trace_log.record(TRACE_DEBUG, __FILE__, __LINE__, "trace_log_dropped_records done");
+    BOOST_CHECK_EQUAL(trace_log.getNumDropped() - num_dropped, num_extra);
+
+    trace_log.flush();
+    trace_log.setLevel(level);
+}
@@ -1,6 +1,7 @@
 #include "MotionPlanningLibrariesSbplMprimsVisualization.hpp"
 
 #include <iostream>
+#include <map>
 
 #include <osg/Geometry>
 #include <osg/Group>
@@ -13,6 +14,13 @@ struct MotionPlanningLibrariesSbplMprimsVisualization::Data {
     //
     // Making a copy is required because of how OSG works
     motion_planning_libraries::SbplMotionPrimitives data;
+    // Nodes of the start angles which have been shown since the last data
+    // or property change, created on demand.
+    std::map<unsigned int, osg::ref_ptr<osg::Group> > angleGroups;
+    bool angleGroupsValid;
+    
+    Data() : data(), angleGroups(), angleGroupsValid(false) {
+    }
 };
 
 // PUBLIC
@@ -43,6 +51,7 @@ bool MotionPlanningLibrariesSbplMprimsVisualization::allAnglesShown() const {
 
 void MotionPlanningLibrariesSbplMprimsVisualization::setShowAllAngles(bool enabled) {
     mAllAnglesShown = enabled;
+    p->angleGroupsValid = false;
     emit propertyChanged("show_all_angles");
     setDirty();
 }
@@ -53,6 +62,7 @@ double  MotionPlanningLibrariesSbplMprimsVisualization::getRadiusEndpoints() con
 
 void  MotionPlanningLibrariesSbplMprimsVisualization::setRadiusEndpoints(double radius) {
     mRadiusEndpoints = radius;
+    p->angleGroupsValid = false;
     emit propertyChanged("endpoint_radius_changed");
     setDirty();
 }
@@ -72,63 +82,68 @@ void MotionPlanningLibrariesSbplMprimsVisualization::updateMainNode ( osg::Node*
     osg::Group* group = node->asGroup();
     group->removeChildren(0, node->asGroup()->getNumChildren());
     
-    // Update the main node using the data in        double sphere_radius = mRadiusEndpoints; p->data
-    addPrimitives(group, p->data);
+    if(!p->angleGroupsValid) {
+        p->angleGroups.clear();
+        p->angleGroupsValid = true;
+    }
+    
+    // Only the shown angles are created, switching between them reuses the nodes.
+    unsigned int angle_begin = mAllAnglesShown ? 0 : mAngleNum;
+    unsigned int angle_end = mAllAnglesShown ? p->data.mConfig.mNumAngles : mAngleNum + 1;
+    for(unsigned int angle = angle_begin; angle < angle_end; ++angle) {
+        osg::ref_ptr<osg::Group>& angle_group = p->angleGroups[angle];
+        if(angle_group == NULL) {
+            angle_group = createAngleGroup(p->data, angle);
+        }
+        group->addChild(angle_group);
+    }
 }
 
 void MotionPlanningLibrariesSbplMprimsVisualization::updateDataIntern(motion_planning_libraries::SbplMotionPrimitives const& data)
 {
     p->data = data;
-    //std::cout << "got new sample data vector" << std::endl;
+    p->angleGroupsValid = false;
 }
 
-void MotionPlanningLibrariesSbplMprimsVisualization::addPrimitives(osg::Group* group, 
-        motion_planning_libraries::SbplMotionPrimitives& primitives) {
-        
-    std::vector<motion_planning_libraries::Primitive> prim_list = primitives.mListPrimitives;
-    std::vector<motion_planning_libraries::Primitive>::iterator it = prim_list.begin();
+osg::ref_ptr<osg::Group> MotionPlanningLibrariesSbplMprimsVisualization::createAngleGroup( 
+        motion_planning_libraries::SbplMotionPrimitives const& primitives, unsigned int angle) {
+    
+    osg::ref_ptr<osg::Group> group = new osg::Group();
     
-    double hue_step = 1.0 / (double)primitives.mConfig.mNumAngles;
-    double hue = 0.0;
+    // Each angle gets its own color if all angles are shown.
     float r=0, g=0, b=0;
-    osg::Vec4 color(r, g, b, 1.0f); 
-    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
-    int last_angle = -1;
+    double hue = mAllAnglesShown ? angle / (double)primitives.mConfig.mNumAngles : 0.0;
+    vizkit3d::hslToRgb(hue, 1.0, 0.5, r, g, b);
+    osg::Vec4 angle_color(r, g, b, 1.0f);
+    
+    // The intermediate lines of all primitives are stored within a single geometry.
+    osg::ref_ptr<osg::Geode> geode_intermediate_points = new osg::Geode();
+    osg::ref_ptr<osg::Geometry> fp_geometry = new osg::Geometry();
+    osg::ref_ptr<osg::Vec3Array> fp_vertices = new osg::Vec3Array();
+    osg::ref_ptr<osg::Vec4Array> fp_colors = new osg::Vec4Array();
     
-    for(; it != prim_list.end(); it++) {
+    std::vector<motion_planning_libraries::Primitive>::const_iterator it = 
+            primitives.mListPrimitives.begin();
+    for(; it != primitives.mListPrimitives.end(); it++) {
         
-        // If mAlleAnglesShow is not set, just draw all prims of mAngleNum.
-        if(!mAllAnglesShown && it->mStartAngle != (unsigned int)mAngleNum) {
+        if(it->mStartAngle != angle) {
             continue;
         }
         
+        osg::Vec4 color = angle_color;
         if(mColorizeTypes)
         {
             const double step = 1.0/motion_planning_libraries::MOV_NUM_TYPES;
             const double h = step * it->mMovType;
             vizkit3d::hslToRgb(h, 1.0, 0.5, r, g, b);
             color = osg::Vec4(r, g, b, 1.0f);    
-            colors = new osg::Vec4Array;
-            colors->clear();
-            colors->push_back(color);
-        }
-        
-        
-        // Changes the prim color for each new angle. (overrides mColorizeTypes)
-        if((int)it->mStartAngle != last_angle) {
-            vizkit3d::hslToRgb(hue, 1.0, 0.5, r, g, b);
-            color = osg::Vec4(r, g, b, 1.0f);    
-            colors = new osg::Vec4Array;
-            colors->clear();
-            colors->push_back( color );
-            hue += hue_step;
-            
-            last_angle = it->mStartAngle;
         }
+        osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+        colors->push_back(color);
     
-        osg::ref_ptr<osg::Geode> geode = new osg::Geode();
-        
         if(mRadiusEndpoints > 0) {
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode();
+            
             // Create sphere.
             osg::ref_ptr<osg::Sphere> sp = new osg::Sphere(osg::Vec3d(0,0,0), mRadiusEndpoints);
             osg::ref_ptr<osg::ShapeDrawable> sd = new osg::ShapeDrawable(sp.get());
@@ -155,13 +170,10 @@ void MotionPlanningLibrariesSbplMprimsVisualization::addPrimitives(osg::Group* g
             // Move the sphere and the triangle to the endpose (converted from grid to world)
             // using a transform.
             base::Vector3d mEndPose = it->mEndPose;
-            //std::cout << "Endpose " << mEndPose[0] << " " << mEndPose[1] << " scale factor " << primitives.mScaleFactor << std::endl;
             double x = mEndPose[0] * primitives.mConfig.mGridSize;
             double y = mEndPose[1] * primitives.mConfig.mGridSize;
             double z = 0; // mEndPose[2] * primitives.mScaleFactor; // z is discrete orientation
             double theta = mEndPose[2] * ((2*M_PI)/primitives.mConfig.mNumAngles);
-
-            //std::cout << "Draw sphere and triangle at XYZTHETA: " << x << " "  << y << " " << z << " " << theta << " " << std::endl; 
             
             osg::ref_ptr<osg::PositionAttitudeTransform> transform = 
                     new osg::PositionAttitudeTransform();
@@ -202,32 +214,23 @@ void MotionPlanningLibrariesSbplMprimsVisualization::addPrimitives(osg::Group* g
             }
         }
         
-        // Draw intermediate lines representing the mprim within the world.
-        osg::ref_ptr<osg::Geode> geode_intermediate_points = new osg::Geode();
-        
-        std::vector<base::Vector3d> i_p = it->mIntermediatePoses;
-        osg::ref_ptr<osg::Geometry> fp_geometry = new osg::Geometry();
-        osg::ref_ptr<osg::Vec3Array> fp_vertices = new osg::Vec3Array();
-        base::Vector3d v_tmp;
-        
-        //std::cout << "Number of intermediate points: " << i_p.size() << std::endl;
+        // Intermediate lines representing the mprim within the world.
+        std::vector<base::Vector3d> const& i_p = it->mIntermediatePoses;
+        unsigned int first = fp_vertices->size();
         for(unsigned int i = 0; i < i_p.size(); ++i) {
-            v_tmp = i_p[i];
-            fp_vertices->push_back(osg::Vec3(v_tmp[0], v_tmp[1], 0));
-            //if(i == i_p.size() - 1) {
-                //std::cout << "Draw intermediate points to endpoint XY: " << v_tmp[0] << " " << v_tmp[1] << std::endl;
-            //}
+            fp_vertices->push_back(osg::Vec3(i_p[i][0], i_p[i][1], 0));
+            fp_colors->push_back(color);
         }
-        
-        fp_geometry->setVertexArray(fp_vertices);
-        fp_geometry->setColorArray(colors);
-        fp_geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
-        fp_geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP,0,i_p.size()));
-        geode_intermediate_points->addDrawable(fp_geometry);
-        
-        // Add intermediate points to the passed group.
-        group->addChild(geode_intermediate_points);
+        fp_geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP, 
+                first, i_p.size()));
     }
+    
+    fp_geometry->setVertexArray(fp_vertices);
+    fp_geometry->setColorArray(fp_colors);
+    fp_geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+    geode_intermediate_points->addDrawable(fp_geometry);
+    group->addChild(geode_intermediate_points);
+    return group;
 }
 
 bool MotionPlanningLibrariesSbplMprimsVisualization::getColorizeTypes() const
@@ -238,6 +241,7 @@ bool MotionPlanningLibrariesSbplMprimsVisualization::getColorizeTypes() const
 void MotionPlanningLibrariesSbplMprimsVisualization::setColorizeTypes(const bool value)
 {
     mColorizeTypes = value;
+    p->angleGroupsValid = false;
     emit propertyChanged("colorizeByType");
     setDirty();
 }
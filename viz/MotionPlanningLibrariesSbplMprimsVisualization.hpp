@@ -5,6 +5,7 @@
 #include <vizkit3d/Vizkit3DPlugin.hpp>
 #include <vizkit3d/ColorConversionHelper.hpp>
 #include <osg/Geode>
+#include <osg/Group>
 #include <motion_planning_libraries/sbpl/SbplMotionPrimitives.hpp>
 
 namespace vizkit3d
@@ -48,7 +49,11 @@ namespace vizkit3d
         virtual osg::ref_ptr<osg::Node> createMainNode();
         virtual void updateMainNode(osg::Node* node);
         virtual void updateDataIntern(motion_planning_libraries::SbplMotionPrimitives const& data);
-        void addPrimitives(osg::Group* group, motion_planning_libraries::SbplMotionPrimitives& primitives);
+        /**
+         * Creates the nodes of all primitives of the start angle.
+         */
+        osg::ref_ptr<osg::Group> createAngleGroup(
+                motion_planning_libraries::SbplMotionPrimitives const& primitives, unsigned int angle);
         
     private:
         struct Data;
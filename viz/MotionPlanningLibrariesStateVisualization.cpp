@@ -1,18 +1,37 @@
 #include "MotionPlanningLibrariesStateVisualization.hpp"
 
 #include <iostream>
+#include <map>
 
 #include <osg/Geometry>
 #include <osg/Group>
+#include <osg/PositionAttitudeTransform>
 #include <osg/ShapeDrawable>
 
 using namespace vizkit3d;
 
 struct MotionPlanningLibrariesStateVisualization::Data {
-    // Copy of the value given to updateDataIntern.
+    // Copy of the value given to updateDataIntern. Only the latest states are
+    // kept, so a fast producer never queues more than one update.
     //
     // Making a copy is required because of how OSG works
     std::vector <motion_planning_libraries::State> data;
+    
+    // Persistent nodes: One transform for each drawn state (drawnStates) 
+    // sharing the marker geodes of its footprint radius, and the line 
+    // between the states which is updated in place.
+    std::vector <motion_planning_libraries::State> drawnStates;
+    std::vector< osg::ref_ptr<osg::PositionAttitudeTransform> > markers;
+    std::map< double, osg::ref_ptr<osg::Geode> > markerGeodes;
+    osg::ref_ptr<osg::Geode> lineGeode;
+    osg::ref_ptr<osg::Geometry> lineGeometry;
+    osg::ref_ptr<osg::Vec3Array> lineVertices;
+    osg::ref_ptr<osg::DrawArrays> lineDrawArrays;
+    bool colorChanged;
+    
+    Data() : data(), drawnStates(), markers(), markerGeodes(), lineGeode(), 
+            lineGeometry(), lineVertices(), lineDrawArrays(), colorChanged(false) {
+    }
 };
 
 
@@ -28,44 +47,110 @@ MotionPlanningLibrariesStateVisualization::~MotionPlanningLibrariesStateVisualiz
 
 osg::ref_ptr<osg::Node> MotionPlanningLibrariesStateVisualization::createMainNode()
 {
-    std::cout << "create main node" << std::endl;
     // Geode is a common node used for vizkit3d plugins. It allows to display
     // "arbitrary" geometries
     //return new osg::Geode();
-    return new osg::Group();
+    osg::ref_ptr<osg::Group> group = new osg::Group();
+    
+    // The line is the first child, followed by the markers.
+    p->lineGeode = new osg::Geode();
+    p->lineGeometry = new osg::Geometry();
+    p->lineVertices = new osg::Vec3Array();
+    p->lineDrawArrays = new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP, 0, 0);
+    p->lineGeometry->setUseDisplayList(false);
+    p->lineGeometry->setUseVertexBufferObjects(true);
+    p->lineGeometry->setVertexArray(p->lineVertices);
+    p->lineGeometry->addPrimitiveSet(p->lineDrawArrays);
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+    colors->push_back( color );
+    p->lineGeometry->setColorArray(colors);
+    p->lineGeometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+    p->lineGeode->addDrawable(p->lineGeometry);
+    group->addChild(p->lineGeode);
+    
+    p->drawnStates.clear();
+    p->markers.clear();
+    return group;
 }
 
 void MotionPlanningLibrariesStateVisualization::updateMainNode ( osg::Node* node )
 {
-    std::cout << "update main node" << std::endl;
-    //osg::Geode* geode = static_cast<osg::Geode*>(node);
     osg::Group* group = node->asGroup();
-    group->removeChildren(0, node->asGroup()->getNumChildren());
     
-    // Update the main node using the data in p->data
-    std::vector <motion_planning_libraries::State>::iterator it = p->data.begin();
-    for(;it != p->data.end(); ++it) {
-        drawState(group, *it);
+    // A new color requires new marker geodes.
+    if(p->colorChanged) {
+        p->markerGeodes.clear();
+        p->drawnStates.clear();
+        group->removeChildren(1, p->markers.size());
+        p->markers.clear();
+        osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+        colors->push_back( color );
+        p->lineGeometry->setColorArray(colors);
+        p->colorChanged = false;
     }
-    drawLineBetweenStates(group);
+    
+    // Only the markers of changed states are moved, new ones are appended.
+    for(unsigned int i = 0; i < p->data.size(); ++i) {
+        motion_planning_libraries::State& state = p->data[i];
+        if(i < p->markers.size()) {
+            motion_planning_libraries::State& drawn = p->drawnStates[i];
+            if(drawn.mPose.position == state.mPose.position && 
+                    drawn.mPose.orientation.coeffs() == state.mPose.orientation.coeffs() &&
+                    drawn.getFootprintRadius() == state.getFootprintRadius()) {
+                continue;
+            }
+            if(drawn.getFootprintRadius() != state.getFootprintRadius()) {
+                p->markers[i]->setChild(0, getMarkerGeode(state.getFootprintRadius()));
+            }
+            drawn = state;
+        } else {
+            osg::ref_ptr<osg::PositionAttitudeTransform> transform = 
+                    new osg::PositionAttitudeTransform();
+            transform->addChild(getMarkerGeode(state.getFootprintRadius()));
+            group->addChild(transform);
+            p->markers.push_back(transform);
+            p->drawnStates.push_back(state);
+        }
+        updateMarker(p->markers[i], state);
+    }
+    if(p->markers.size() > p->data.size()) {
+        unsigned int num_removed = p->markers.size() - p->data.size();
+        group->removeChildren(1 + p->data.size(), num_removed);
+        p->markers.resize(p->data.size());
+        p->drawnStates.resize(p->data.size());
+    }
+    
+    // The vertices of the line are overwritten within the existing buffer.
+    p->lineVertices->resize(p->data.size());
+    base::Position pos;
+    for(unsigned int i = 0; i < p->data.size(); ++i) {
+        pos = p->data[i].mPose.position;
+        (*p->lineVertices)[i] = osg::Vec3(pos[0], pos[1], 0.01);
+    }
+    p->lineVertices->dirty();
+    p->lineDrawArrays->setCount(p->data.size());
+    p->lineGeometry->dirtyBound();
 }
 
 void MotionPlanningLibrariesStateVisualization::updateDataIntern(std::vector<motion_planning_libraries::State> const& data)
 {
     p->data = data;
-    std::cout << "got new sample data vector" << std::endl;
 }
 
 void MotionPlanningLibrariesStateVisualization::updateDataIntern(motion_planning_libraries::State const& data)
 {
     p->data.clear();
     p->data.push_back(data);
-    std::cout << "got new sample data" << std::endl;
 }
 
-void MotionPlanningLibrariesStateVisualization::drawState(osg::Group* group, motion_planning_libraries::State& state) {
+osg::ref_ptr<osg::Geode> MotionPlanningLibrariesStateVisualization::getMarkerGeode(double footprint_radius) {
+    osg::ref_ptr<osg::Geode>& geode = p->markerGeodes[footprint_radius];
+    if(geode != NULL) {
+        return geode;
+    }
+    
     // Create geode and add drawables.
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode();
+    geode = new osg::Geode();
     
     // Create triangle.
     osg::ref_ptr<osg::Geometry> triangle_geometry = new osg::Geometry();
@@ -108,13 +193,13 @@ void MotionPlanningLibrariesStateVisualization::drawState(osg::Group* group, mot
         geode->addDrawable(fp_geometry);
     }
     */
-    if(state.getFootprintRadius() > 0) {
+    if(footprint_radius > 0) {
         osg::ref_ptr<osg::Geometry> fp_geometry = new osg::Geometry();
         osg::ref_ptr<osg::Vec3Array> fp_vertices = new osg::Vec3Array();
         
         int num_vertices = 32;
         double rot = 2*M_PI/(double)num_vertices;
-        base::Vector3d vec(state.getFootprintRadius(), 0.0, 0.0);
+        base::Vector3d vec(footprint_radius, 0.0, 0.0);
         
         for(int i=0; i<num_vertices+1; ++i) {
             vec = Eigen::AngleAxisd(rot, Eigen::Vector3d::UnitZ()) * vec;
@@ -128,49 +213,24 @@ void MotionPlanningLibrariesStateVisualization::drawState(osg::Group* group, mot
            
         geode->addDrawable(fp_geometry);
     }
-    
-    // Create transformer.
-    osg::ref_ptr<osg::PositionAttitudeTransform> transform = 
-            new osg::PositionAttitudeTransform();
+    return geode;
+}
+
+void MotionPlanningLibrariesStateVisualization::updateMarker(osg::PositionAttitudeTransform* transform, 
+        motion_planning_libraries::State& state) {
     base::Vector3d vec = state.mPose.position;
     osg::Vec3 position = osg::Vec3d(vec.x(), vec.y(), vec.z());
     position[2] += 0.01; // Moves the waypoints a little bit above the z=0 plane.
     transform->setPosition(position);
     // osg::Quat(0,0,1,heading) != osg::Quat(heading, Vec(0,0,1)).. why?
     transform->setAttitude(osg::Quat(state.mPose.getYaw(), osg::Vec3f(0,0,1)));
-    transform->addChild(geode);
-    
-    // Adds the waypoints to the main node.
-    group->addChild(transform);
-}
-
-void MotionPlanningLibrariesStateVisualization::drawLineBetweenStates(osg::Group* group) {
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode();
-    osg::ref_ptr<osg::Geometry> line_geometry = new osg::Geometry();
-    osg::ref_ptr<osg::Vec3Array> line_vertices = new osg::Vec3Array();
-    
-    std::vector <motion_planning_libraries::State>::iterator it = p->data.begin();
-    base::Position pos;
-    for(;it != p->data.end(); ++it) {
-        pos = it->getPose().position;
-        line_vertices->push_back(osg::Vec3(pos[0], pos[1], 0.01));
-    }
-    
-    line_geometry->setVertexArray(line_vertices);
-    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
-    colors->push_back( color );
-    line_geometry->setColorArray(colors);
-    line_geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
-    line_geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP,0,p->data.size()));
-    geode->addDrawable(line_geometry);
-    
-    group->addChild(geode);
 }
 
 void MotionPlanningLibrariesStateVisualization::setColor(QColor q_color)
 {
     color = osg::Vec4(q_color.redF(), q_color.greenF(), 
             q_color.blueF(), q_color.alphaF());
+    p->colorChanged = true;
     setDirty();
 }
 
@@ -4,6 +4,7 @@
 #include <boost/noncopyable.hpp>
 #include <vizkit3d/Vizkit3DPlugin.hpp>
 #include <osg/Geode>
+#include <osg/PositionAttitudeTransform>
 #include <motion_planning_libraries/State.hpp>
 #include <motion_planning_libraries/sbpl/SbplMotionPrimitives.hpp>
 
@@ -40,8 +41,13 @@ namespace vizkit3d
         virtual void updateMainNode(osg::Node* node);
         virtual void updateDataIntern(motion_planning_libraries::State const& data);
         virtual void updateDataIntern(std::vector<motion_planning_libraries::State> const& data);
-        void drawState(osg::Group* group, motion_planning_libraries::State& state);
-        void drawLineBetweenStates(osg::Group* group) ;
+        /**
+         * Triangle and footprint circle of the states with the passed radius,
+         * created once and shared by all their markers.
+         */
+        osg::ref_ptr<osg::Geode> getMarkerGeode(double footprint_radius);
+        void updateMarker(osg::PositionAttitudeTransform* transform, 
+                motion_planning_libraries::State& state);
         
     private:
         struct Data;